@@ -25,27 +25,32 @@
 
 static void
 handle_packet_in( packet_in event ) {
-  openflow_actions *actions = create_actions();
-  append_action_output( actions, ( uint16_t ) ( event.in_port + 1 ), UINT16_MAX );
+  openflow_action_builder actions;
+  init_action_builder( &actions );
+  build_action_output( &actions, ( uint16_t ) ( event.in_port + 1 ), UINT16_MAX );
 
   struct ofp_match match;
   set_match_from_packet( &match, event.in_port, 0, event.data );
 
-  buffer *flow_mod = create_flow_mod( get_transaction_id(), match, get_cookie(),
-                                      OFPFC_ADD, 0, 0, UINT16_MAX, event.buffer_id,
-                                      OFPP_NONE, OFPFF_SEND_FLOW_REM, actions );
+  buffer *flow_mod = create_flow_mod_into( event.user_data, get_transaction_id(), match, get_cookie(),
+                                           OFPFC_ADD, 0, 0, UINT16_MAX, event.buffer_id,
+                                           OFPP_NONE, OFPFF_SEND_FLOW_REM, &actions );
   send_openflow_message( event.datapath_id, flow_mod );
-
-  free_buffer( flow_mod );
-  delete_actions( actions );
 }
 
 
 int
 main( int argc, char *argv[] ) {
   init_trema( &argc, &argv );
-  set_packet_in_handler( handle_packet_in, NULL );
+
+  // reused for every flow_mod
+  buffer *flow_mod = alloc_buffer();
+  set_packet_in_handler( handle_packet_in, flow_mod );
+
   start_trema();
+
+  free_buffer( flow_mod );
+
   return 0;
 }
 
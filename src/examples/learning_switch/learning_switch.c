@@ -88,48 +88,51 @@ learn( hash_table *forwarding_db, struct key new_key, uint16_t port_no ) {
 }
 
 
+// reused for every flow_mod and packet_out
+static buffer *message = NULL;
+static compiled_actions *flood_actions = NULL;
+
+
 static void
 do_flooding( packet_in packet_in ) {
-  openflow_actions *actions = create_actions();
-  append_action_output( actions, OFPP_FLOOD, UINT16_MAX );
-
-  buffer *packet_out;
   if ( packet_in.buffer_id == UINT32_MAX ) {
     buffer *frame = duplicate_buffer( packet_in.data );
     fill_ether_padding( frame );
-    packet_out = create_packet_out(
+    create_packet_out_with_compiled_actions(
+      message,
       get_transaction_id(),
       packet_in.buffer_id,
       packet_in.in_port,
-      actions,
+      flood_actions,
       frame
     );
     free_buffer( frame );
   }
   else {
-    packet_out = create_packet_out(
+    create_packet_out_with_compiled_actions(
+      message,
       get_transaction_id(),
       packet_in.buffer_id,
       packet_in.in_port,
-      actions,
+      flood_actions,
       NULL
     );
   }
-  send_openflow_message( packet_in.datapath_id, packet_out );
-  free_buffer( packet_out );
-  delete_actions( actions );
+  send_openflow_message( packet_in.datapath_id, message );
 }
 
 
 static void
 send_packet( uint16_t destination_port, packet_in packet_in ) {
-  openflow_actions *actions = create_actions();
-  append_action_output( actions, destination_port, UINT16_MAX );
+  openflow_action_builder actions;
+  init_action_builder( &actions );
+  build_action_output( &actions, destination_port, UINT16_MAX );
 
   struct ofp_match match;
   set_match_from_packet( &match, packet_in.in_port, 0, packet_in.data );
 
-  buffer *flow_mod = create_flow_mod(
+  create_flow_mod_into(
+    message,
     get_transaction_id(),
     match,
     get_cookie(),
@@ -140,27 +143,24 @@ send_packet( uint16_t destination_port, packet_in packet_in ) {
     packet_in.buffer_id,
     OFPP_NONE,
     OFPFF_SEND_FLOW_REM,
-    actions
+    &actions
   );
-  send_openflow_message( packet_in.datapath_id, flow_mod );
-  free_buffer( flow_mod );
+  send_openflow_message( packet_in.datapath_id, message );
 
   if ( packet_in.buffer_id == UINT32_MAX ) {
     buffer *frame = duplicate_buffer( packet_in.data );
     fill_ether_padding( frame );
-    buffer *packet_out = create_packet_out(
+    create_packet_out_into(
+      message,
       get_transaction_id(),
       packet_in.buffer_id,
       packet_in.in_port,
-      actions,
+      &actions,
       frame
     );
-    send_openflow_message( packet_in.datapath_id, packet_out );
-    free_buffer( packet_out );
+    send_openflow_message( packet_in.datapath_id, message );
     free_buffer( frame );
   }
-
-  delete_actions( actions );
 }
 
 
@@ -215,9 +215,17 @@ main( int argc, char *argv[] ) {
   hash_table *forwarding_db = create_hash( compare_forwarding_entry, hash_forwarding_entry );
   add_periodic_event_callback( AGING_INTERVAL, update_forwarding_db, forwarding_db );
   set_packet_in_handler( handle_packet_in, forwarding_db );
+  message = alloc_buffer();
+  openflow_actions *actions = create_actions();
+  append_action_output( actions, OFPP_FLOOD, UINT16_MAX );
+  flood_actions = compile_actions( actions );
+  delete_actions( actions );
 
   start_trema();
 
+  release_compiled_actions( flood_actions );
+  free_buffer( message );
+
   return 0;
 }
 
@@ -0,0 +1,128 @@
+/*
+ * Measures how long validate_openflow_message() takes for typical
+ * messages that applications send to switches.
+ *
+ * Copyright (C) 2008-2011 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "trema.h"
+
+
+#define DEFAULT_COUNT 1000000
+
+
+static void
+print_usage( const char *name ) {
+  printf( "Usage: %s [COUNT]\n", name );
+}
+
+
+static buffer *
+create_flow_mod_with_actions( void ) {
+  struct ofp_match match;
+  memset( &match, 0, sizeof( struct ofp_match ) );
+  match.wildcards = OFPFW_ALL & ~( uint32_t ) ( OFPFW_IN_PORT | OFPFW_DL_TYPE );
+  match.in_port = 1;
+  match.dl_type = 0x0800;
+
+  openflow_actions *actions = create_actions();
+  append_action_set_vlan_vid( actions, 10 );
+  append_action_set_nw_tos( actions, 0x20 );
+  append_action_output( actions, 2, UINT16_MAX );
+  append_action_output( actions, 3, UINT16_MAX );
+  buffer *flow_mod = create_flow_mod( 1, match, 1, OFPFC_ADD, 60, 0, 100, UINT32_MAX, OFPP_NONE, OFPFF_SEND_FLOW_REM, actions );
+  delete_actions( actions );
+
+  return flow_mod;
+}
+
+
+static buffer *
+create_packet_out_with_data( void ) {
+  openflow_actions *actions = create_actions();
+  append_action_output( actions, OFPP_FLOOD, UINT16_MAX );
+  buffer *data = alloc_buffer_with_length( 64 );
+  memset( append_back_buffer( data, 64 ), 0, 64 );
+  buffer *packet_out = create_packet_out( 1, UINT32_MAX, 1, actions, data );
+  free_buffer( data );
+  delete_actions( actions );
+
+  return packet_out;
+}
+
+
+static buffer *
+create_flow_stats_request_for_all( void ) {
+  struct ofp_match match;
+  memset( &match, 0, sizeof( struct ofp_match ) );
+  match.wildcards = OFPFW_ALL;
+
+  return create_flow_stats_request( 1, 0, match, 0xff, OFPP_NONE );
+}
+
+
+static void
+run( const char *name, buffer *message, long count ) {
+  struct timespec start, end;
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+  int failed = 0;
+  for ( long i = 0; i < count; i++ ) {
+    if ( validate_openflow_message( message ) < 0 ) {
+      failed++;
+    }
+  }
+  clock_gettime( CLOCK_MONOTONIC, &end );
+
+  double elapsed = ( double ) ( end.tv_sec - start.tv_sec ) * 1e9 + ( double ) ( end.tv_nsec - start.tv_nsec );
+  printf( "%-20s %6zu bytes %8.1f ns/message%s\n", name, message->length, elapsed / ( double ) count,
+          failed > 0 ? " (invalid)" : "" );
+
+  free_buffer( message );
+}
+
+
+int
+main( int argc, char *argv[] ) {
+  long count = DEFAULT_COUNT;
+  if ( argc > 1 ) {
+    count = atol( argv[ 1 ] );
+    if ( count <= 0 ) {
+      print_usage( argv[ 0 ] );
+      return -1;
+    }
+  }
+
+  run( "flow_mod", create_flow_mod_with_actions(), count );
+  run( "packet_out", create_packet_out_with_data(), count );
+  run( "flow_stats_request", create_flow_stats_request_for_all(), count );
+  run( "echo_request", create_echo_request( 1, NULL ), count );
+
+  return 0;
+}
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -48,6 +48,7 @@ typedef struct private_buffer {
   size_t real_length; /*!<True length of allocated buffer */
   void *top; /*!<Pointer to the head of user data area. only valid if public.data is allocated.*/
   pthread_mutex_t *mutex; /*!<mutual exclusion support for buffer access/modification*/
+  bool built_by_library; /*!<Data is a message built by the library and not resized since*/
 } private_buffer;
 
 
@@ -144,12 +145,13 @@ static private_buffer *
 append_front( private_buffer *pbuf, size_t length ) {
   assert( pbuf != NULL );
 
-  void *new_data = xmalloc( front_length_of( pbuf ) + pbuf->public.length + length );
+  size_t new_length = front_length_of( pbuf ) + pbuf->public.length + length;
+  void *new_data = xmalloc( new_length );
   memcpy( ( char * ) new_data + front_length_of( pbuf ) + length, pbuf->public.data, pbuf->public.length );
   xfree( pbuf->top );
 
   pbuf->public.data = ( char * ) new_data + front_length_of( pbuf );
-  pbuf->real_length = sizeof( new_data );
+  pbuf->real_length = new_length;
   pbuf->top = new_data;
 
   return pbuf;
@@ -170,12 +172,13 @@ static private_buffer *
 append_back( private_buffer *pbuf, size_t length ) {
   assert( pbuf != NULL );
 
-  void *new_data = xmalloc( front_length_of( pbuf ) + pbuf->public.length + length );
+  size_t new_length = front_length_of( pbuf ) + pbuf->public.length + length;
+  void *new_data = xmalloc( new_length );
   memcpy( ( char * ) new_data + front_length_of( pbuf ), pbuf->public.data, pbuf->public.length );
   xfree( pbuf->top );
 
   pbuf->public.data = ( char * ) new_data + front_length_of( pbuf );
-  pbuf->real_length = sizeof( new_data );
+  pbuf->real_length = new_length;
   pbuf->top = new_data;
 
   return pbuf;
@@ -264,6 +267,7 @@ append_front_buffer( buffer *buf, size_t length ) {
   pthread_mutex_lock( ( ( private_buffer * ) buf )->mutex );
 
   private_buffer *pbuf = ( private_buffer * ) buf;
+  pbuf->built_by_library = false;
 
   if ( pbuf->top == NULL ) {
     alloc_new_data( pbuf, length );
@@ -303,6 +307,7 @@ remove_front_buffer( buffer *buf, size_t length ) {
 
   private_buffer *pbuf = ( private_buffer * ) buf;
   assert( pbuf->public.length >= length );
+  pbuf->built_by_library = false;
 
   pbuf->public.data = ( char * ) pbuf->public.data + length;
   pbuf->public.length -= length;
@@ -328,6 +333,7 @@ append_back_buffer( buffer *buf, size_t length ) {
   pthread_mutex_lock( ( ( private_buffer * ) buf )->mutex );
 
   private_buffer *pbuf = ( private_buffer * ) buf;
+  pbuf->built_by_library = false;
 
   if ( pbuf->real_length == 0 ) {
     alloc_new_data( pbuf, length );
@@ -375,6 +381,7 @@ duplicate_buffer( const buffer *buf ) {
   new_buffer->public.user_data = old_buffer->public.user_data;
   new_buffer->public.user_data_free_function = NULL;
   new_buffer->public.data = ( char * ) ( new_buffer->public.data ) + front_length_of( old_buffer );
+  new_buffer->built_by_library = old_buffer->built_by_library;
 
   pthread_mutex_unlock( old_buffer->mutex );
 
@@ -382,6 +389,61 @@ duplicate_buffer( const buffer *buf ) {
 }
 
 
+/**
+ * This function empties a buffer without releasing its allocated space, so that the buffer can be
+ * reused for building another message without allocating memory again.
+ * @param buf Pointer to buffer type to be emptied
+ * @return None
+ */
+void
+reset_buffer( buffer *buf ) {
+  assert( buf != NULL );
+
+  pthread_mutex_lock( ( ( private_buffer * ) buf )->mutex );
+
+  private_buffer *pbuf = ( private_buffer * ) buf;
+  pbuf->built_by_library = false;
+  if ( pbuf->top != NULL ) {
+    pbuf->public.data = pbuf->top;
+  }
+  pbuf->public.length = 0;
+
+  pthread_mutex_unlock( pbuf->mutex );
+}
+
+
+/**
+ * This function marks the data of a buffer as a message built by the library, e.g. an OpenFlow
+ * message created with create_flow_mod(). The mark is cleared when the buffer is resized.
+ * @param buf Pointer to buffer type which holds the built message
+ * @return None
+ * @see buffer_built_by_library
+ */
+void
+mark_buffer_built_by_library( buffer *buf ) {
+  assert( buf != NULL );
+
+  pthread_mutex_lock( ( ( private_buffer * ) buf )->mutex );
+  ( ( private_buffer * ) buf )->built_by_library = true;
+  pthread_mutex_unlock( ( ( private_buffer * ) buf )->mutex );
+}
+
+
+/**
+ * This function tells if the data of a buffer is a message built by the library and the buffer
+ * has not been resized since.
+ * @param buf Pointer to buffer type to check
+ * @return bool True if the buffer holds a message built by the library, else False
+ * @see mark_buffer_built_by_library
+ */
+bool
+buffer_built_by_library( const buffer *buf ) {
+  assert( buf != NULL );
+
+  return ( ( const private_buffer * ) buf )->built_by_library;
+}
+
+
 /**
  * This function is a pluggable method for printing/dumping a buffer onto a I/O stream (like terminal). 
  * It can accept as argument a function pointer which defines the method for handling the I/O stream.
@@ -30,6 +30,7 @@
 #define BUFFER_H
 
 
+#include <stdbool.h>
 #include <stddef.h>
 
 
@@ -53,6 +54,9 @@ void *append_front_buffer( buffer *buf, size_t length );
 void *remove_front_buffer( buffer *buf, size_t length );
 void *append_back_buffer( buffer *buf, size_t length );
 buffer *duplicate_buffer( const buffer *buf );
+void reset_buffer( buffer *buf );
+void mark_buffer_built_by_library( buffer *buf );
+bool buffer_built_by_library( const buffer *buf );
 void dump_buffer( const buffer *buf, void dump_function( const char *format, ... ) );
 
 
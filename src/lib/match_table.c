@@ -19,6 +19,7 @@
 
 
 #include <assert.h>
+#include <inttypes.h>
 #include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
@@ -35,10 +36,24 @@
 #endif // UNIT_TESTING
 
 
+#define MATCH_CACHE_SIZE 4096 // must be a power of two
+
+
+typedef struct match_cache_entry {
+  struct ofp_match ofp_match; // exact match extracted from a packet. host byte order
+  match_entry *entry; // lookup result ( may be NULL )
+  uint32_t generation; // table generation at the time of caching
+} match_cache_entry;
+
+
 typedef struct match_table {
   hash_table *exact_table; // no wildcards are set
   list_element *wildcard_table; // wildcard flags are set
   pthread_mutex_t *mutex;
+  match_cache_entry *cache; // direct-mapped microflow cache in front of the tables
+  uint32_t generation; // bumped on every insertion/deletion
+  uint64_t cache_hits;
+  uint64_t cache_misses;
 } match_table;
 
 
@@ -141,10 +156,31 @@ free_match_table_walker( void *key, void *value, void *user_data ) {
 }
 
 
+static void
+update_generation( void ) {
+  match_table_head.generation++;
+  if ( match_table_head.generation == 0 ) {
+    // wrapped around. flush all slots so that no stale entry can match.
+    memset( match_table_head.cache, 0, sizeof( match_cache_entry ) * MATCH_CACHE_SIZE );
+    match_table_head.generation = 1;
+  }
+}
+
+
+static match_cache_entry *
+cache_slot_of( struct ofp_match *ofp_match ) {
+  return &match_table_head.cache[ hash_match_entry( ofp_match ) & ( MATCH_CACHE_SIZE - 1 ) ];
+}
+
+
 void
 init_match_table( void ) {
   match_table_head.exact_table = create_hash( compare_match_entry, hash_match_entry );
   create_list( &match_table_head.wildcard_table );
+  match_table_head.cache = xcalloc( MATCH_CACHE_SIZE, sizeof( match_cache_entry ) );
+  match_table_head.generation = 1;
+  match_table_head.cache_hits = 0;
+  match_table_head.cache_misses = 0;
 
   pthread_mutexattr_t attr;
   pthread_mutexattr_init( &attr );
@@ -170,6 +206,12 @@ finalize_match_table( void ) {
   delete_list( match_table_head.wildcard_table );
   match_table_head.wildcard_table = NULL;
 
+  debug( "Match cache statistics ( hits = %" PRIu64 ", misses = %" PRIu64 " ).",
+         match_table_head.cache_hits, match_table_head.cache_misses );
+  xfree( match_table_head.cache );
+  match_table_head.cache = NULL;
+  match_table_head.generation = 0;
+
   pthread_mutex_unlock( match_table_head.mutex );
   pthread_mutex_destroy( match_table_head.mutex );
   xfree( match_table_head.mutex );
@@ -224,39 +266,42 @@ insert_match_entry( struct ofp_match *ofp_match, uint16_t priority, const char *
     }
   }
   add_service_name( entry, service_name );
+  update_generation();
   pthread_mutex_unlock( match_table_head.mutex );
 }
 
 
+static match_entry *
+lookup_match_table_strict( struct ofp_match *ofp_match, uint16_t priority ) {
+  if ( !ofp_match->wildcards ) {
+    return lookup_hash_entry( match_table_head.exact_table, ofp_match );
+  }
+
+  // wildcard flags are set
+  list_element *element;
+  for ( element = match_table_head.wildcard_table; element != NULL; element = element->next ) {
+    match_entry *entry = element->data;
+    if ( entry->priority == priority
+         && ( ( entry->ofp_match.wildcards ^ ofp_match->wildcards ) & OFPFW_ALL ) == 0
+         && compare_match( &entry->ofp_match, ofp_match ) ) {
+      return entry;
+    }
+  }
+
+  return NULL;
+}
+
+
 void
 delete_match_entry( struct ofp_match *ofp_match, uint16_t priority, const char *service_name ) {
   assert( ofp_match != NULL );
   assert( service_name != NULL );
 
   pthread_mutex_lock( match_table_head.mutex );
-  match_entry *entry = NULL;
-  if ( !ofp_match->wildcards ) {
-    entry = lookup_hash_entry( match_table_head.exact_table, ofp_match );
-    if ( entry == NULL ) {
-      pthread_mutex_unlock( match_table_head.mutex );
-      return;
-    }
-  }
-  else {
-    // wildcard flags are set
-    list_element *element;
-    for ( element = match_table_head.wildcard_table; element != NULL; element = element->next ) {
-      entry = element->data;
-      if ( entry->priority == priority 
-           && ( ( entry->ofp_match.wildcards ^ ofp_match->wildcards ) & OFPFW_ALL ) == 0
-           && compare_match( &entry->ofp_match, ofp_match ) ) {
-        break;
-      }
-    }
-    if ( element == NULL ) {
-      pthread_mutex_unlock( match_table_head.mutex );
-      return;
-    }
+  match_entry *entry = lookup_match_table_strict( ofp_match, priority );
+  if ( entry == NULL ) {
+    pthread_mutex_unlock( match_table_head.mutex );
+    return;
   }
   delete_service_name( entry, service_name );
   if ( services_name_length_of( entry ) == 0 ) {
@@ -268,35 +313,140 @@ delete_match_entry( struct ofp_match *ofp_match, uint16_t priority, const char *
     }
     free_match_entry( entry );
   }
+  update_generation();
   pthread_mutex_unlock( match_table_head.mutex );
   return;
 }
 
 
+/*
+ * Looks up the entry whose match and priority are identical to the given
+ * ones. Unlike lookup_match_entry(), wildcarded fields are not used for
+ * matching. Priority is ignored for exact match entries.
+ */
 match_entry *
-lookup_match_entry( struct ofp_match *ofp_match ) {
-  match_entry *entry;
-  list_element *list;
+lookup_match_strict_entry( struct ofp_match *ofp_match, uint16_t priority ) {
+  assert( ofp_match != NULL );
 
   pthread_mutex_lock( match_table_head.mutex );
+  match_entry *entry = lookup_match_table_strict( ofp_match, priority );
+  pthread_mutex_unlock( match_table_head.mutex );
+
+  return entry;
+}
+
+
+static match_entry *
+lookup_match_table( struct ofp_match *ofp_match ) {
+  match_entry *entry;
+  list_element *list;
 
   entry = lookup_hash_entry( match_table_head.exact_table, ofp_match );
   if ( entry != NULL ) {
-    pthread_mutex_unlock( match_table_head.mutex );
     return entry;
   }
 
   for ( list = match_table_head.wildcard_table; list != NULL; list = list->next ) {
     entry = list->data;
     if ( compare_match( &entry->ofp_match, ofp_match ) ) {
-      pthread_mutex_unlock( match_table_head.mutex );
       return entry;
     }
   }
 
+  return NULL;
+}
+
+
+match_entry *
+lookup_match_entry( struct ofp_match *ofp_match ) {
+  match_entry *entry;
+
+  pthread_mutex_lock( match_table_head.mutex );
+
+  if ( ofp_match->wildcards ) {
+    entry = lookup_match_table( ofp_match );
+    pthread_mutex_unlock( match_table_head.mutex );
+    return entry;
+  }
+
+  match_cache_entry *slot = cache_slot_of( ofp_match );
+  if ( slot->generation == match_table_head.generation
+       && compare_match( &slot->ofp_match, ofp_match ) ) {
+    match_table_head.cache_hits++;
+    entry = slot->entry;
+    pthread_mutex_unlock( match_table_head.mutex );
+    return entry;
+  }
+
+  match_table_head.cache_misses++;
+  entry = lookup_match_table( ofp_match );
+  slot->ofp_match = *ofp_match;
+  slot->entry = entry;
+  slot->generation = match_table_head.generation;
+
   pthread_mutex_unlock( match_table_head.mutex );
 
-  return NULL;
+  return entry;
+}
+
+
+typedef struct {
+  void ( *function )( struct ofp_match match, uint16_t priority, const char *service_name, void *user_data );
+  void *user_data;
+} match_table_walker_param;
+
+
+static void
+call_function_for_services( match_entry *entry, match_table_walker_param *param ) {
+  list_element *element;
+  for ( element = entry->services_name; element != NULL; element = element->next ) {
+    param->function( entry->ofp_match, entry->priority, element->data, param->user_data );
+  }
+}
+
+
+static void
+exact_match_table_walker( void *key, void *value, void *user_data ) {
+  UNUSED( key );
+
+  call_function_for_services( value, user_data );
+}
+
+
+/*
+ * Calls the function once for each ( match, priority, service name ) in the
+ * table. Exact match entries come first, followed by wildcard entries in
+ * descending order of priority. The table must not be modified from the
+ * function.
+ */
+void
+foreach_match_table( void function( struct ofp_match match, uint16_t priority, const char *service_name, void *user_data ), void *user_data ) {
+  assert( function != NULL );
+
+  match_table_walker_param param = { function, user_data };
+
+  pthread_mutex_lock( match_table_head.mutex );
+
+  foreach_hash( match_table_head.exact_table, exact_match_table_walker, &param );
+
+  list_element *list;
+  for ( list = match_table_head.wildcard_table; list != NULL; list = list->next ) {
+    call_function_for_services( list->data, &param );
+  }
+
+  pthread_mutex_unlock( match_table_head.mutex );
+}
+
+
+void
+get_match_table_cache_stats( uint64_t *hits, uint64_t *misses ) {
+  assert( hits != NULL );
+  assert( misses != NULL );
+
+  pthread_mutex_lock( match_table_head.mutex );
+  *hits = match_table_head.cache_hits;
+  *misses = match_table_head.cache_misses;
+  pthread_mutex_unlock( match_table_head.mutex );
 }
 
 
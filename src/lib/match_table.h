@@ -41,6 +41,9 @@ void finalize_match_table( void );
 void insert_match_entry( struct ofp_match *ofp_match, uint16_t priority, const char *service_name );
 void delete_match_entry( struct ofp_match *ofp_match, uint16_t priority, const char *service_name );
 match_entry *lookup_match_entry( struct ofp_match *match );
+match_entry *lookup_match_strict_entry( struct ofp_match *match, uint16_t priority );
+void foreach_match_table( void function( struct ofp_match match, uint16_t priority, const char *service_name, void *user_data ), void *user_data );
+void get_match_table_cache_stats( uint64_t *hits, uint64_t *misses );
 
 
 #endif // MATCH_TABLE_H
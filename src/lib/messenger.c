@@ -26,7 +26,9 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <sys/un.h>
 #include <unistd.h>
 #include "doubly_linked_list.h"
@@ -174,6 +176,8 @@ typedef struct receive_queue {
   dlist_element *message_callbacks;
   int listen_socket;
   struct sockaddr_un listen_addr;
+  dev_t listen_dev;
+  ino_t listen_ino;
   dlist_element *client_sockets;
   message_buffer *buffer;
 } receive_queue;
@@ -185,6 +189,7 @@ typedef struct send_queue {
   struct timespec reconnect_at;
   struct sockaddr_un server_addr;
   message_buffer *buffer;
+  uint32_t partial_length; // bytes left of the head message after a partial send
 } send_queue;
 
 
@@ -208,6 +213,16 @@ static void ( *external_check_fd_isset )( fd_set *read_set, fd_set *write_set )
 static uint32_t last_transaction_id = 0;
 static void ( *external_callback )( void ) = NULL;
 
+/*
+ * With local delivery enabled, messages to services received in this
+ * process are not written to sockets but are queued here, each preceded by
+ * the name of the service, and are passed to the callbacks from the main
+ * loop.
+ */
+static bool local_delivery = false;
+static message_buffer *local_queue = NULL;
+static message_buffer *delivering_queue = NULL;
+
 
 static void
 _delete_context( void *key, void *value, void *user_data ) {
@@ -436,9 +451,14 @@ delete_receive_queue( void *service_name, void *_rq, void *user_data ) {
   }
   delete_dlist( rq->client_sockets );
 
+  // the path may have been taken over by another process since. It is
+  // checked before closing the socket, which keeps its inode in use.
+  struct stat st;
+  if ( stat( rq->listen_addr.sun_path, &st ) == 0 && st.st_dev == rq->listen_dev && st.st_ino == rq->listen_ino ) {
+    unlink( rq->listen_addr.sun_path );
+  }
   close( rq->listen_socket );
   free_message_buffer( rq->buffer );
-  unlink( rq->listen_addr.sun_path );
 
   if ( receive_queues != NULL ) {
     delete_hash_entry( receive_queues, rq->service_name );
@@ -490,6 +510,15 @@ finalize_messenger() {
   if ( context_db != NULL ) {
     delete_context_db();
   }
+  if ( local_queue != NULL ) {
+    free_message_buffer( local_queue );
+    local_queue = NULL;
+  }
+  if ( delivering_queue != NULL ) {
+    free_message_buffer( delivering_queue );
+    delivering_queue = NULL;
+  }
+  local_delivery = false;
 
   set_fd_set_callback( NULL );
   set_check_fd_isset_callback( NULL );
@@ -557,6 +586,12 @@ create_receive_queue( const char *service_name ) {
     return NULL;
   }
 
+  struct stat st;
+  memset( &st, 0, sizeof( struct stat ) );
+  stat( rq->listen_addr.sun_path, &st );
+  rq->listen_dev = st.st_dev;
+  rq->listen_ino = st.st_ino;
+
   ret = listen( rq->listen_socket, SOMAXCONN );
   if ( ret == -1 ) {
     error( "Failed to listen (fd = %d, sun_path = %s, errno = %s [%d]).",
@@ -868,6 +903,7 @@ create_send_queue( const char *service_name ) {
   sq->refused_count = 0;
   sq->reconnect_at.tv_sec = 0;
   sq->reconnect_at.tv_nsec = 0;
+  sq->partial_length = 0;
 
   if ( send_queue_connect( sq ) == -1 ) {
     xfree( sq );
@@ -906,11 +942,39 @@ write_message_buffer( message_buffer *buf, const void *data, size_t len ) {
 
 
 static bool
-push_message_to_send_queue( const char *service_name, const uint8_t message_type, const uint16_t tag, const void *data, size_t len ) {
+push_iov_to_local_queue( const char *service_name, const message_header *header, const struct iovec *iov, int iovcnt ) {
   assert( service_name != NULL );
+  assert( header != NULL );
+
+  if ( local_queue == NULL ) {
+    local_queue = create_message_buffer( messenger_send_queue_length );
+  }
+
+  if ( message_buffer_remain_bytes( local_queue ) < MESSENGER_SERVICE_NAME_LENGTH + header->message_length ) {
+    warn( "Could not write a message to local queue due to overflow ( service_name = %s ).", service_name );
+    return false;
+  }
+
+  char name[ MESSENGER_SERVICE_NAME_LENGTH ];
+  memset( name, 0, sizeof( name ) );
+  strncpy( name, service_name, sizeof( name ) - 1 );
+  write_message_buffer( local_queue, name, sizeof( name ) );
+  write_message_buffer( local_queue, header, sizeof( message_header ) );
+  int i;
+  for ( i = 0; i < iovcnt; i++ ) {
+    if ( iov[ i ].iov_len > 0 ) {
+      write_message_buffer( local_queue, iov[ i ].iov_base, iov[ i ].iov_len );
+    }
+  }
+
+  return true;
+}
 
-  debug( "Pushing a message to send queue ( service_name = %s, message_type = %#x, tag = %#x, data = %p, len = %u ).",
-         service_name, message_type, tag, data, len );
+
+static bool
+push_iov_to_send_queue( const char *service_name, const uint8_t message_type, const uint16_t tag, const struct iovec *iov, int iovcnt ) {
+  assert( service_name != NULL );
+  assert( iovcnt >= 0 );
 
   message_header header;
 
@@ -919,11 +983,10 @@ push_message_to_send_queue( const char *service_name, const uint8_t message_type
     return false;
   }
 
-  send_queue *sq = lookup_hash_entry( send_queues, service_name );
-
-  if ( NULL == sq ) {
-    sq = create_send_queue( service_name );
-    assert( sq != NULL );
+  size_t len = 0;
+  int i;
+  for ( i = 0; i < iovcnt; i++ ) {
+    len += iov[ i ].iov_len;
   }
 
   header.version = 0;
@@ -931,6 +994,17 @@ push_message_to_send_queue( const char *service_name, const uint8_t message_type
   header.tag = tag;
   header.message_length = ( uint32_t ) ( sizeof( message_header ) + len );
 
+  if ( local_delivery && lookup_hash_entry( receive_queues, service_name ) != NULL ) {
+    return push_iov_to_local_queue( service_name, &header, iov, iovcnt );
+  }
+
+  send_queue *sq = lookup_hash_entry( send_queues, service_name );
+
+  if ( NULL == sq ) {
+    sq = create_send_queue( service_name );
+    assert( sq != NULL );
+  }
+
   if ( message_buffer_remain_bytes( sq->buffer ) < header.message_length ) {
     warn( "Could not write a message to send queue due to overflow ( service_name = %s ).", sq->service_name );
     send_dump_message( MESSENGER_DUMP_SEND_OVERFLOW, sq->service_name, NULL, 0 );
@@ -938,12 +1012,27 @@ push_message_to_send_queue( const char *service_name, const uint8_t message_type
   }
 
   write_message_buffer( sq->buffer, &header, sizeof( message_header ) );
-  write_message_buffer( sq->buffer, data, len );
+  for ( i = 0; i < iovcnt; i++ ) {
+    write_message_buffer( sq->buffer, iov[ i ].iov_base, iov[ i ].iov_len );
+  }
 
   return true;
 }
 
 
+static bool
+push_message_to_send_queue( const char *service_name, const uint8_t message_type, const uint16_t tag, const void *data, size_t len ) {
+  assert( service_name != NULL );
+
+  debug( "Pushing a message to send queue ( service_name = %s, message_type = %#x, tag = %#x, data = %p, len = %u ).",
+         service_name, message_type, tag, data, len );
+
+  struct iovec iov = { ( void * ) ( uintptr_t ) data, len };
+
+  return push_iov_to_send_queue( service_name, message_type, tag, &iov, 1 );
+}
+
+
 bool
 send_message( const char *service_name, const uint16_t tag, const void *data, size_t len ) {
   assert( service_name != NULL );
@@ -955,6 +1044,147 @@ send_message( const char *service_name, const uint16_t tag, const void *data, si
 }
 
 
+
+/**
+ * Same as send_message() except that the message is gathered from iovcnt
+ * buffers, which are written to the send queue without being joined first.
+ */
+bool
+send_message_iov( const char *service_name, const uint16_t tag, const struct iovec *iov, int iovcnt ) {
+  assert( service_name != NULL );
+  assert( iov != NULL || iovcnt == 0 );
+
+  debug( "Sending a message ( service_name = %s, tag = %#x, iov = %p, iovcnt = %d ).",
+         service_name, tag, iov, iovcnt );
+
+  return push_iov_to_send_queue( service_name, MESSAGE_TYPE_NOTIFY, tag, iov, iovcnt );
+}
+
+
+/*
+ * A messenger channel is a connection to a service that is owned by a
+ * single thread. Messages are written straight to the socket and never
+ * go through the send queues, so threads other than the one running the
+ * messenger loop can send with their own channels. A message that does
+ * not fit into the socket buffer is not sent.
+ */
+struct messenger_channel {
+  char service_name[ MESSENGER_SERVICE_NAME_LENGTH ];
+  int fd;
+};
+
+
+messenger_channel *
+open_messenger_channel( const char *service_name ) {
+  assert( service_name != NULL );
+  assert( strlen( service_name ) < MESSENGER_SERVICE_NAME_LENGTH );
+
+  struct sockaddr_un addr;
+  memset( &addr, 0, sizeof( struct sockaddr_un ) );
+  addr.sun_family = AF_UNIX;
+  snprintf( addr.sun_path, sizeof( addr.sun_path ), "%s/trema.%s.sock", socket_directory, service_name );
+
+  int fd = socket( AF_UNIX, SOCK_SEQPACKET, 0 );
+  if ( fd == -1 ) {
+    error( "Failed to call socket ( errno = %s [%d] ).", strerror( errno ), errno );
+    return NULL;
+  }
+  if ( connect( fd, ( struct sockaddr * ) &addr, sizeof( struct sockaddr_un ) ) == -1 ) {
+    debug( "Connection refused ( service_name = %s, sun_path = %s, fd = %d, errno = %s [%d] ).",
+           service_name, addr.sun_path, fd, strerror( errno ), errno );
+    close( fd );
+    return NULL;
+  }
+
+  messenger_channel *channel = xmalloc( sizeof( messenger_channel ) );
+  memset( channel->service_name, 0, sizeof( channel->service_name ) );
+  strncpy( channel->service_name, service_name, sizeof( channel->service_name ) - 1 );
+  channel->fd = fd;
+
+  debug( "Channel opened ( service_name = %s, fd = %d ).", channel->service_name, channel->fd );
+
+  return channel;
+}
+
+
+/**
+ * Sends a message to the service of channel without blocking. Returns 1
+ * if the message is sent, 0 if the socket buffer is full and -1 if the
+ * connection has been lost, in which case the channel has to be closed.
+ */
+int
+send_message_to_channel( messenger_channel *channel, const uint16_t tag, const void *data, size_t len ) {
+  assert( channel != NULL );
+
+  message_header header;
+  header.version = 0;
+  header.message_type = MESSAGE_TYPE_NOTIFY;
+  header.tag = tag;
+  header.message_length = ( uint32_t ) ( sizeof( message_header ) + len );
+
+  struct iovec iov[ 2 ];
+  iov[ 0 ].iov_base = &header;
+  iov[ 0 ].iov_len = sizeof( message_header );
+  iov[ 1 ].iov_base = ( void * ) ( uintptr_t ) data;
+  iov[ 1 ].iov_len = len;
+  struct msghdr msg;
+  memset( &msg, 0, sizeof( struct msghdr ) );
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 2;
+
+  // a record on a SOCK_SEQPACKET socket is sent entirely or not at all
+  ssize_t ret = sendmsg( channel->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL );
+  if ( ret < 0 ) {
+    if ( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ) {
+      return 0;
+    }
+    warn( "Failed to send a message to channel ( service_name = %s, fd = %d, errno = %s [%d] ).",
+          channel->service_name, channel->fd, strerror( errno ), errno );
+    return -1;
+  }
+
+  return 1;
+}
+
+
+void
+close_messenger_channel( messenger_channel *channel ) {
+  assert( channel != NULL );
+
+  debug( "Closing channel ( service_name = %s, fd = %d ).", channel->service_name, channel->fd );
+
+  close( channel->fd );
+  xfree( channel );
+}
+
+
+/**
+ * Returns how much of the send queue to service_name is in use, in
+ * percent. Callers may shed load towards a service that does not keep up
+ * before messages to it start to overflow. Zero is returned if nothing has
+ * been sent to the service yet.
+ */
+unsigned int
+messenger_send_queue_usage( const char *service_name ) {
+  assert( service_name != NULL );
+
+  if ( send_queues == NULL ) {
+    return 0;
+  }
+  if ( local_delivery && lookup_hash_entry( receive_queues, service_name ) != NULL ) {
+    if ( local_queue == NULL ) {
+      return 0;
+    }
+    return ( unsigned int ) ( local_queue->data_length * 100 / local_queue->size );
+  }
+  send_queue *sq = lookup_hash_entry( send_queues, service_name );
+  if ( sq == NULL ) {
+    return 0;
+  }
+
+  return ( unsigned int ) ( sq->buffer->data_length * 100 / sq->buffer->size );
+}
+
 static messenger_context *
 insert_context( void *user_data ) {
   messenger_context *context = xmalloc( sizeof( messenger_context ) );
@@ -1478,11 +1708,19 @@ static uint32_t
 get_send_data( send_queue *sq, size_t offset ) {
   assert( sq != NULL );
 
+  if ( offset == 0 && sq->partial_length > 0 ) {
+    return sq->partial_length;
+  }
+
   message_header *header;
   uint32_t length = 0;
   while ( ( sq->buffer->data_length - offset ) >= sizeof( message_header ) ) {
     header = ( message_header * ) ( ( char * ) get_message_buffer_head( sq->buffer ) + offset );
     if ( length + header->message_length > messenger_bucket_size ) {
+      if ( length == 0 ) {
+        // a message larger than a bucket is sent by itself
+        length = header->message_length;
+      }
       break;
     }
     length += header->message_length;
@@ -1492,6 +1730,21 @@ get_send_data( send_queue *sq, size_t offset ) {
 }
 
 
+static uint32_t
+get_partial_length( send_queue *sq, size_t offset, size_t sent_len ) {
+  size_t end = offset + sent_len;
+  size_t next = offset;
+  if ( offset == 0 && sq->partial_length > 0 ) {
+    next = sq->partial_length;
+  }
+  while ( next < end ) {
+    message_header *header = ( message_header * ) ( ( char * ) get_message_buffer_head( sq->buffer ) + next );
+    next += header->message_length;
+  }
+  return ( uint32_t ) ( next - end );
+}
+
+
 static void
 on_send( int fd, send_queue *sq ) {
   assert( sq != NULL );
@@ -1523,15 +1776,28 @@ on_send( int fd, send_queue *sq ) {
         sq->refused_count = 0;
       }
       truncate_message_buffer( sq->buffer, sent_total );
+      if ( sq->server_socket == -1 && sq->partial_length > 0 ) {
+        // a new connection must start at a message boundary
+        truncate_message_buffer( sq->buffer, sq->partial_length );
+        sq->partial_length = 0;
+      }
       if ( err == EMSGSIZE || err == ENOBUFS || err == ENOMEM ) {
         warn( "Dropping %u bytes data in send queue ( service_name = %s ).", sq->buffer->data_length, sq->service_name );
         truncate_message_buffer( sq->buffer, sq->buffer->data_length );
+        sq->partial_length = 0;
       }
       return;
     }
     assert( sent_len != 0 );
     send_dump_message( MESSENGER_DUMP_SENT, sq->service_name, data, ( uint32_t ) sent_len );
+    if ( ( size_t ) sent_len < send_len ) {
+      // the rest is sent when the socket gets writable again
+      sq->partial_length = get_partial_length( sq, sent_total, ( size_t ) sent_len );
+      sent_total += ( size_t ) sent_len;
+      break;
+    }
     sent_total += ( size_t ) sent_len;
+    sq->partial_length = 0;
   }
   truncate_message_buffer( sq->buffer, sent_total );
 }
@@ -1558,6 +1824,8 @@ check_send_queue_fd_isset( fd_set *read_set, fd_set *write_set ) {
         send_dump_message( MESSENGER_DUMP_SEND_CLOSED, sq->service_name, NULL, 0 );
         close( sq->server_socket );
         sq->server_socket = -1;
+        truncate_message_buffer( sq->buffer, sq->partial_length );
+        sq->partial_length = 0;
         continue;
       }
     }
@@ -1568,6 +1836,47 @@ check_send_queue_fd_isset( fd_set *read_set, fd_set *write_set ) {
 }
 
 
+/**
+ * delivers messages in the local queue to the callbacks. The queue is
+ * swapped out first, so that messages are passed to the callbacks where
+ * they are queued and messages queued by the callbacks are left for the
+ * next round.
+ */
+static void
+deliver_local_messages( void ) {
+  if ( local_queue == NULL || local_queue->data_length == 0 ) {
+    return;
+  }
+
+  message_buffer *queue = local_queue;
+  if ( delivering_queue == NULL ) {
+    delivering_queue = create_message_buffer( queue->size );
+  }
+  local_queue = delivering_queue;
+  delivering_queue = NULL;
+
+  while ( queue->data_length > 0 ) {
+    char *head = get_message_buffer_head( queue );
+    const char *service_name = head;
+    message_header *header = ( message_header * ) ( head + MESSENGER_SERVICE_NAME_LENGTH );
+    size_t entry_length = MESSENGER_SERVICE_NAME_LENGTH + header->message_length;
+
+    receive_queue *rq = lookup_hash_entry( receive_queues, service_name );
+    if ( rq == NULL ) {
+      debug( "No receive queue found. Discarding a local message ( service_name = %s ).", service_name );
+    }
+    else {
+      call_message_callbacks( rq, header->message_type, header->tag, header->value,
+                              header->message_length - sizeof( message_header ) );
+    }
+    truncate_message_buffer( queue, entry_length );
+  }
+
+  queue->head_offset = 0;
+  delivering_queue = queue;
+}
+
+
 static bool
 run_once( void ) {
   fd_set read_set, write_set;
@@ -1581,6 +1890,8 @@ run_once( void ) {
     external_callback = NULL;
   }
 
+  deliver_local_messages();
+
   FD_ZERO( &read_set );
   FD_ZERO( &write_set );
   set_recv_queue_fd_set( &read_set );
@@ -1591,6 +1902,9 @@ run_once( void ) {
 
   timeout.tv_sec = 0;
   timeout.tv_usec = 100 * 1000;
+  if ( local_queue != NULL && local_queue->data_length > 0 ) {
+    timeout.tv_usec = 0;
+  }
 
   set_count = select( FD_SETSIZE, &read_set, &write_set, NULL, &timeout );
 
@@ -1739,6 +2053,19 @@ set_external_callback( void ( *callback ) ( void ) ) {
 }
 
 
+/**
+ * Delivers messages to services received in this process without sockets,
+ * for applications that link the switch daemon in. Messages are passed to
+ * the callbacks from the main loop in the order sent.
+ */
+void
+enable_messenger_local_delivery( void ) {
+  debug( "Enabling local delivery." );
+
+  local_delivery = true;
+}
+
+
 /*
  * Local variables:
  * c-basic-offset: 2
@@ -28,6 +28,7 @@
 #include <stdint.h>
 #include <stdlib.h>
 #include <time.h>
+#include <sys/uio.h>
 #include "checks.h"
 #include "bool.h"
 
@@ -110,6 +111,8 @@ typedef struct text_dump_header {
 
 typedef void ( *callback_message_received )( uint16_t tag, void *data, size_t len );
 
+typedef struct messenger_channel messenger_channel;
+
 
 bool init_messenger( const char *working_directory );
 bool add_message_received_callback( const char *service_name, const callback_message_received function );
@@ -124,6 +127,7 @@ bool delete_timer_event_callback( void ( *callback )( void *user_data ) );
 bool delete_periodic_event_callback( void ( *callback )( void *user_data ) );
 bool rename_message_received_callback( const char *old_service_name, const char *new_service_name );
 bool send_message( const char *service_name, const uint16_t tag, const void *data, size_t len );
+bool send_message_iov( const char *service_name, const uint16_t tag, const struct iovec *iov, int iovcnt );
 bool send_request_message( const char *to_service_name, const char *from_service_name, const uint16_t tag, const void *data, size_t len, void *user_data );
 bool send_reply_message( const messenger_context_handle *handle, const uint16_t tag, const void *data, size_t len );
 int flush_messenger( void );
@@ -133,9 +137,14 @@ bool finalize_messenger( void );
 void start_messenger_dump( const char *dump_app_name, const char *dump_service_name );
 void stop_messenger_dump( void );
 bool messenger_dump_enabled( void );
+unsigned int messenger_send_queue_usage( const char *service_name );
+messenger_channel *open_messenger_channel( const char *service_name );
+int send_message_to_channel( messenger_channel *channel, const uint16_t tag, const void *data, size_t len );
+void close_messenger_channel( messenger_channel *channel );
 void set_fd_set_callback( void ( *callback )( fd_set *read_set, fd_set *write_set ) );
 void set_check_fd_isset_callback( void ( *callback )( fd_set *read_set, fd_set *write_set ) );
 bool set_external_callback( void ( *callback ) ( void ) );
+void enable_messenger_local_delivery( void );
 
 
 #endif // MESSENGER_H
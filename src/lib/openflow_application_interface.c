@@ -49,6 +49,12 @@ const char *mock_get_trema_name( void );
 #define send_message mock_send_message
 bool mock_send_message( char *service_name, uint16_t tag, void *data, size_t len );
 
+#ifdef send_message_iov
+#undef send_message_iov
+#endif
+#define send_message_iov mock_send_message_iov
+bool mock_send_message_iov( const char *service_name, uint16_t tag, const struct iovec *iov, int iovcnt );
+
 #ifdef send_request_message
 #undef send_request_message
 #endif
@@ -90,6 +96,18 @@ bool mock_delete_message_received_callback( char *service_name,
 bool mock_delete_message_replied_callback( char *service_name,
                                            void ( *callback )( uint16_t tag, void *data, size_t len, void *user_data ) );
 
+#ifdef add_periodic_event_callback
+#undef add_periodic_event_callback
+#endif
+#define add_periodic_event_callback mock_add_periodic_event_callback
+bool mock_add_periodic_event_callback( const time_t seconds, void ( *callback )( void *user_data ), void *user_data );
+
+#ifdef delete_periodic_event_callback
+#undef delete_periodic_event_callback
+#endif
+#define delete_periodic_event_callback mock_delete_periodic_event_callback
+bool mock_delete_periodic_event_callback( void ( *callback )( void *user_data ) );
+
 #ifdef getpid
 #undef getpid
 #endif
@@ -145,7 +163,90 @@ static openflow_event_handlers_t event_handlers;
 static char service_name[ MESSENGER_SERVICE_NAME_LENGTH ];
 
 
+typedef struct {
+  uint64_t datapath_id;
+  struct ofp_match match;
+} packet_in_flow_key;
+
+typedef struct {
+  packet_in_flow_key key;
+  struct timespec expires_at;
+  uint64_t suppressed;
+} coalesced_packet_in;
+
+static hash_table *coalesced_packet_ins = NULL;
+static struct timespec packet_in_coalescing_window = { 0, 0 };
+static const time_t PACKET_IN_COALESCING_AGING_INTERVAL = 1;
+
+
+struct flow_mod_batch {
+  list_element *chunks; // buffers of flow_mod messages in a row, each sent in a single messenger message
+  buffer *last_chunk;
+  unsigned int n_flow_mods;
+  bool built; // all flow_mods have been built by the library
+};
+
+/*
+ * A batch sent to a switch. It is completed by the reply to the barrier
+ * request that follows its flow_mods.
+ */
+typedef struct {
+  uint64_t datapath_id;
+  uint32_t *transaction_ids; // of the flow_mods in the batch
+  unsigned int n_flow_mods;
+  uint32_t barrier_transaction_id;
+  flow_mod_batch_error *errors;
+  unsigned int n_errors;
+  unsigned int errors_size;
+  flow_mod_batch_handler callback;
+  void *user_data;
+} pending_flow_mod_batch;
+
+static list_element *pending_flow_mod_batches = NULL;
+
+// bytes of OpenFlow messages sent in a single messenger message
+#define FLOW_MOD_BATCH_CHUNK_LENGTH 65536
+
+
+/*
+ * Bodies of a multipart stats reply received so far. Only kept while a
+ * stats reply completion handler is set.
+ */
+typedef struct {
+  uint64_t datapath_id;
+  uint32_t transaction_id;
+  uint16_t type;
+  buffer *body;
+  size_t body_size; // allocated length of body
+} partial_stats_reply;
+
+static list_element *partial_stats_replies = NULL;
+
+
+/*
+ * Requests sent with send_openflow_request() that wait for their reply,
+ * looked up by datapath id and transaction id.
+ */
+typedef struct {
+  uint64_t datapath_id;
+  uint32_t transaction_id;
+} openflow_request_key;
+
+typedef struct {
+  openflow_request_key key;
+  bool expires;
+  struct timespec expires_at;
+  openflow_reply_handler reply_callback;
+  openflow_request_timeout_handler timeout_callback;
+  void *user_data;
+} pending_openflow_request;
+
+static hash_table *pending_openflow_requests = NULL;
+static const time_t OPENFLOW_REQUEST_AGING_INTERVAL = 1;
+
+
 static void handle_message( uint16_t message_type, void *data, size_t length );
+static void age_openflow_requests( void *user_data );
 static void handle_list_switches_reply( uint16_t message_type, void *dpid, size_t length, void *user_data );
 
 
@@ -155,6 +256,131 @@ enum {
 };
 
 
+/*
+ * Messages sent and received are counted in arrays indexed by message
+ * type, direction and result. Names are rendered only when statistics
+ * are dumped.
+ */
+#define OPENFLOW_MESSAGE_UNDEFINED ( OFPT_QUEUE_GET_CONFIG_REPLY + 1 )
+
+static const char *openflow_message_names[ OPENFLOW_MESSAGE_UNDEFINED + 1 ] = {
+  [ OFPT_HELLO ] = "hello",
+  [ OFPT_ERROR ] = "error",
+  [ OFPT_ECHO_REQUEST ] = "echo_request",
+  [ OFPT_ECHO_REPLY ] = "echo_reply",
+  [ OFPT_VENDOR ] = "vendor",
+  [ OFPT_FEATURES_REQUEST ] = "features_request",
+  [ OFPT_FEATURES_REPLY ] = "features_reply",
+  [ OFPT_GET_CONFIG_REQUEST ] = "get_config_request",
+  [ OFPT_GET_CONFIG_REPLY ] = "get_config_reply",
+  [ OFPT_SET_CONFIG ] = "set_config",
+  [ OFPT_PACKET_IN ] = "packet_in",
+  [ OFPT_FLOW_REMOVED ] = "flow_removed",
+  [ OFPT_PORT_STATUS ] = "port_status",
+  [ OFPT_PACKET_OUT ] = "packet_out",
+  [ OFPT_FLOW_MOD ] = "flow_mod",
+  [ OFPT_PORT_MOD ] = "port_mod",
+  [ OFPT_STATS_REQUEST ] = "stats_request",
+  [ OFPT_STATS_REPLY ] = "stats_reply",
+  [ OFPT_BARRIER_REQUEST ] = "barrier_request",
+  [ OFPT_BARRIER_REPLY ] = "barrier_reply",
+  [ OFPT_QUEUE_GET_CONFIG_REQUEST ] = "queue_get_config_request",
+  [ OFPT_QUEUE_GET_CONFIG_REPLY ] = "queue_get_config_reply",
+  [ OPENFLOW_MESSAGE_UNDEFINED ] = "undefined_message_type",
+};
+
+enum {
+  SWITCH_EVENT_CONNECTED = 0,
+  SWITCH_EVENT_READY,
+  SWITCH_EVENT_DISCONNECTED,
+  SWITCH_EVENT_PACKET_IN_THROTTLED,
+  SWITCH_EVENT_LIVENESS_REQUEST,
+  SWITCH_EVENT_LIVENESS_REPLY,
+  SWITCH_EVENT_UNDEFINED,
+};
+
+static const char *switch_event_names[ SWITCH_EVENT_UNDEFINED + 1 ] = {
+  [ SWITCH_EVENT_CONNECTED ] = "switch_connected",
+  [ SWITCH_EVENT_READY ] = "switch_ready",
+  [ SWITCH_EVENT_DISCONNECTED ] = "switch_disconnected",
+  [ SWITCH_EVENT_PACKET_IN_THROTTLED ] = "packet_in_throttled",
+  [ SWITCH_EVENT_LIVENESS_REQUEST ] = "switch_liveness_request",
+  [ SWITCH_EVENT_LIVENESS_REPLY ] = "switch_liveness_reply",
+  [ SWITCH_EVENT_UNDEFINED ] = "undefined_switch_event",
+};
+
+// [ type ][ send or receive ][ failed or succeeded ]
+static uint64_t openflow_message_counts[ OPENFLOW_MESSAGE_UNDEFINED + 1 ][ 2 ][ 2 ];
+static uint64_t switch_event_counts[ SWITCH_EVENT_UNDEFINED + 1 ][ 2 ][ 2 ];
+
+enum {
+  PACKET_IN_COALESCED = 0,
+  PACKET_IN_BUFFER_RELEASED,
+  PACKET_IN_COALESCING_UNDEFINED,
+};
+
+static const char *packet_in_coalescing_names[ PACKET_IN_COALESCING_UNDEFINED ] = {
+  [ PACKET_IN_COALESCED ] = "packet_in_coalesced",
+  [ PACKET_IN_BUFFER_RELEASED ] = "packet_in_buffer_released",
+};
+
+static uint64_t packet_in_coalescing_counts[ PACKET_IN_COALESCING_UNDEFINED ];
+
+
+static unsigned int
+message_counter_index( unsigned int type, int send_receive, bool result ) {
+  return ( type * 2 + ( unsigned int ) send_receive ) * 2 + ( result ? 1 : 0 );
+}
+
+
+static void
+render_message_counter_name( const char *type_name, unsigned int index, char *name, size_t length ) {
+  snprintf( name, length, "openflow_application_interface.%s%s%s", type_name,
+            ( index / 2 ) % 2 == OPENFLOW_MESSAGE_SEND ? "_send" : "_receive",
+            index % 2 == 1 ? "_succeeded" : "_failed" );
+}
+
+
+static void
+openflow_message_counter_name( unsigned int index, char *name, size_t length ) {
+  render_message_counter_name( openflow_message_names[ index / 4 ], index, name, length );
+}
+
+
+static void
+switch_event_counter_name( unsigned int index, char *name, size_t length ) {
+  render_message_counter_name( switch_event_names[ index / 4 ], index, name, length );
+}
+
+
+static void
+packet_in_coalescing_counter_name( unsigned int index, char *name, size_t length ) {
+  snprintf( name, length, "openflow_application_interface.%s", packet_in_coalescing_names[ index ] );
+}
+
+
+static stat_counters openflow_message_counters = {
+  ( uint64_t * ) openflow_message_counts,
+  sizeof( openflow_message_counts ) / sizeof( uint64_t ),
+  openflow_message_counter_name,
+  NULL
+};
+
+static stat_counters switch_event_counters = {
+  ( uint64_t * ) switch_event_counts,
+  sizeof( switch_event_counts ) / sizeof( uint64_t ),
+  switch_event_counter_name,
+  NULL
+};
+
+static stat_counters packet_in_coalescing_counters = {
+  packet_in_coalescing_counts,
+  PACKET_IN_COALESCING_UNDEFINED,
+  packet_in_coalescing_counter_name,
+  NULL
+};
+
+
 bool
 openflow_application_interface_is_initialized() {
   return openflow_application_interface_initialized;
@@ -198,12 +424,148 @@ init_openflow_application_interface( const char *custom_service_name ) {
   add_message_received_callback( service_name, handle_message );
   add_message_replied_callback( service_name, handle_list_switches_reply );
 
+  create_list( &pending_flow_mod_batches );
+  create_list( &partial_stats_replies );
+
+  memset( openflow_message_counts, 0, sizeof( openflow_message_counts ) );
+  memset( switch_event_counts, 0, sizeof( switch_event_counts ) );
+  memset( packet_in_coalescing_counts, 0, sizeof( packet_in_coalescing_counts ) );
+  add_stat_counters( &openflow_message_counters );
+  add_stat_counters( &switch_event_counters );
+  add_stat_counters( &packet_in_coalescing_counters );
+
   openflow_application_interface_initialized = true;
 
   return true;
 }
 
 
+static void
+delete_pending_flow_mod_batch( pending_flow_mod_batch *pending ) {
+  delete_element( &pending_flow_mod_batches, pending );
+  xfree( pending->transaction_ids );
+  if ( pending->errors != NULL ) {
+    xfree( pending->errors );
+  }
+  xfree( pending );
+}
+
+
+static bool
+lookup_flow_mod_index( const pending_flow_mod_batch *pending, uint32_t transaction_id, unsigned int *index ) {
+  if ( pending->n_flow_mods == 0 ) {
+    return false;
+  }
+
+  // transaction ids are usually consecutive
+  unsigned int i = ( uint16_t ) ( transaction_id - pending->transaction_ids[ 0 ] );
+  if ( i < pending->n_flow_mods && pending->transaction_ids[ i ] == transaction_id ) {
+    *index = i;
+    return true;
+  }
+  for ( i = 0; i < pending->n_flow_mods; i++ ) {
+    if ( pending->transaction_ids[ i ] == transaction_id ) {
+      *index = i;
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+static bool
+handle_flow_mod_batch_error( uint64_t datapath_id, uint32_t transaction_id, uint16_t type, uint16_t code ) {
+  list_element *element;
+  for ( element = pending_flow_mod_batches; element != NULL; element = element->next ) {
+    pending_flow_mod_batch *pending = element->data;
+    unsigned int index;
+    if ( pending->datapath_id != datapath_id || !lookup_flow_mod_index( pending, transaction_id, &index ) ) {
+      continue;
+    }
+
+    if ( pending->n_errors == pending->errors_size ) {
+      unsigned int size = pending->errors_size > 0 ? pending->errors_size * 2 : 16;
+      flow_mod_batch_error *errors = xmalloc( sizeof( flow_mod_batch_error ) * size );
+      if ( pending->errors != NULL ) {
+        memcpy( errors, pending->errors, sizeof( flow_mod_batch_error ) * pending->n_errors );
+        xfree( pending->errors );
+      }
+      pending->errors = errors;
+      pending->errors_size = size;
+    }
+    flow_mod_batch_error *error = &pending->errors[ pending->n_errors++ ];
+    error->index = index;
+    error->type = type;
+    error->code = code;
+
+    return true;
+  }
+
+  return false;
+}
+
+
+static bool
+complete_flow_mod_batch( uint64_t datapath_id, uint32_t transaction_id ) {
+  list_element *element;
+  for ( element = pending_flow_mod_batches; element != NULL; element = element->next ) {
+    pending_flow_mod_batch *pending = element->data;
+    if ( pending->datapath_id != datapath_id || pending->barrier_transaction_id != transaction_id ) {
+      continue;
+    }
+
+    debug( "Calling flow_mod batch handler ( callback = %p, user_data = %p, n_flow_mods = %u, n_errors = %u ).",
+           pending->callback, pending->user_data, pending->n_flow_mods, pending->n_errors );
+    pending->callback( datapath_id, true, pending->errors, pending->n_errors, pending->user_data );
+    delete_pending_flow_mod_batch( pending );
+
+    return true;
+  }
+
+  return false;
+}
+
+
+static void
+abort_flow_mod_batches( uint64_t datapath_id ) {
+  list_element *element = pending_flow_mod_batches;
+  while ( element != NULL ) {
+    pending_flow_mod_batch *pending = element->data;
+    element = element->next;
+    if ( pending->datapath_id != datapath_id ) {
+      continue;
+    }
+
+    pending->callback( datapath_id, false, pending->errors, pending->n_errors, pending->user_data );
+    delete_pending_flow_mod_batch( pending );
+  }
+}
+
+
+static void
+delete_partial_stats_reply( partial_stats_reply *partial ) {
+  delete_element( &partial_stats_replies, partial );
+  free_buffer( partial->body );
+  xfree( partial );
+}
+
+
+static void
+discard_partial_stats_replies( uint64_t datapath_id ) {
+  list_element *element = partial_stats_replies;
+  while ( element != NULL ) {
+    partial_stats_reply *partial = element->data;
+    element = element->next;
+    if ( partial->datapath_id == datapath_id ) {
+      debug( "Discarding a partial stats reply ( datapath_id = %#" PRIx64 ", transaction_id = %#x ).",
+             datapath_id, partial->transaction_id );
+      delete_partial_stats_reply( partial );
+    }
+  }
+}
+
+
 bool
 finalize_openflow_application_interface() {
   debug( "Finalizing OpenFlow Application Interface." );
@@ -213,6 +575,34 @@ finalize_openflow_application_interface() {
   delete_message_received_callback( service_name, handle_message );
   delete_message_replied_callback( service_name, handle_list_switches_reply );
 
+  if ( coalesced_packet_ins != NULL ) {
+    set_packet_in_coalescing_window( 0 );
+  }
+
+  while ( pending_flow_mod_batches != NULL ) {
+    delete_pending_flow_mod_batch( pending_flow_mod_batches->data );
+  }
+  while ( partial_stats_replies != NULL ) {
+    delete_partial_stats_reply( partial_stats_replies->data );
+  }
+
+  if ( pending_openflow_requests != NULL ) {
+    delete_periodic_event_callback( age_openflow_requests );
+    hash_iterator iter;
+    hash_entry *e;
+    init_hash_iterator( pending_openflow_requests, &iter );
+    while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
+      xfree( e->value );
+    }
+    delete_hash( pending_openflow_requests );
+    pending_openflow_requests = NULL;
+  }
+
+  publish_stat_counters();
+  delete_stat_counters( &openflow_message_counters );
+  delete_stat_counters( &switch_event_counters );
+  delete_stat_counters( &packet_in_coalescing_counters );
+
   memset( &event_handlers, 0, sizeof( openflow_event_handlers_t ) );
   memset( service_name, '\0', sizeof( service_name ) );
 
@@ -435,6 +825,54 @@ set_stats_reply_handler( stats_reply_handler callback, void *user_data ) {
 }
 
 
+/**
+ * Sets a handler called for each part of a stats reply as it arrives. The
+ * entries are not copied, so the iterator is valid only during the call.
+ */
+bool
+set_stats_reply_part_handler( stats_reply_part_handler callback, void *user_data ) {
+  if ( callback == NULL ) {
+    die( "Callback function ( stats_reply_part_handler ) must not be NULL." );
+  }
+  assert( callback != NULL );
+
+  maybe_init_openflow_application_interface();
+  assert( openflow_application_interface_initialized );
+
+  debug( "Setting a stats reply part handler ( callback = %p, user_data = %p ).",
+         callback, user_data );
+
+  event_handlers.stats_reply_part_callback = callback;
+  event_handlers.stats_reply_part_user_data = user_data;
+
+  return true;
+}
+
+
+/**
+ * Sets a handler called once the last part of a stats reply arrives, with
+ * the entries of all parts. Parts are kept in network byte order until then.
+ */
+bool
+set_stats_reply_completion_handler( stats_reply_completion_handler callback, void *user_data ) {
+  if ( callback == NULL ) {
+    die( "Callback function ( stats_reply_completion_handler ) must not be NULL." );
+  }
+  assert( callback != NULL );
+
+  maybe_init_openflow_application_interface();
+  assert( openflow_application_interface_initialized );
+
+  debug( "Setting a stats reply completion handler ( callback = %p, user_data = %p ).",
+         callback, user_data );
+
+  event_handlers.stats_reply_completion_callback = callback;
+  event_handlers.stats_reply_completion_user_data = user_data;
+
+  return true;
+}
+
+
 bool
 set_barrier_reply_handler( barrier_reply_handler callback, void *user_data ) {
   if ( callback == NULL ) {
@@ -493,6 +931,264 @@ set_list_switches_reply_handler( list_switches_reply_handler callback ) {
 }
 
 
+bool
+set_packet_in_throttled_handler( packet_in_throttled_handler callback, void *user_data ) {
+  if ( callback == NULL ) {
+    die( "Callback function ( packet_in_throttled_handler ) must not be NULL." );
+  }
+  assert( callback != NULL );
+
+  maybe_init_openflow_application_interface();
+  assert( openflow_application_interface_initialized );
+
+  debug( "Setting a packet_in throttled handler ( callback = %p, user_data = %p ).",
+         callback, user_data );
+
+  event_handlers.packet_in_throttled_callback = callback;
+  event_handlers.packet_in_throttled_user_data = user_data;
+
+  return true;
+}
+
+
+bool
+set_switch_liveness_reply_handler( switch_liveness_reply_handler callback, void *user_data ) {
+  if ( callback == NULL ) {
+    die( "Callback function ( switch_liveness_reply_handler ) must not be NULL." );
+  }
+  assert( callback != NULL );
+
+  maybe_init_openflow_application_interface();
+  assert( openflow_application_interface_initialized );
+
+  debug( "Setting a switch liveness reply handler ( callback = %p, user_data = %p ).",
+         callback, user_data );
+
+  event_handlers.switch_liveness_reply_callback = callback;
+  event_handlers.switch_liveness_reply_user_data = user_data;
+
+  return true;
+}
+
+
+static bool
+compare_packet_in_flow_key( const void *x, const void *y ) {
+  return memcmp( x, y, sizeof( packet_in_flow_key ) ) == 0;
+}
+
+
+static unsigned int
+hash_packet_in_flow_key( const void *key ) {
+  return hash_core( key, sizeof( packet_in_flow_key ) );
+}
+
+
+static bool
+timespec_passed( const struct timespec *deadline, const struct timespec *now ) {
+  if ( now->tv_sec != deadline->tv_sec ) {
+    return now->tv_sec > deadline->tv_sec;
+  }
+  return now->tv_nsec >= deadline->tv_nsec;
+}
+
+
+static void
+age_coalesced_packet_ins( void *user_data ) {
+  UNUSED( user_data );
+
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+
+  hash_iterator iter;
+  hash_entry *e;
+  init_hash_iterator( coalesced_packet_ins, &iter );
+  while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
+    coalesced_packet_in *entry = e->value;
+    if ( timespec_passed( &entry->expires_at, &now ) ) {
+      if ( entry->suppressed > 0 ) {
+        debug( "%" PRIu64 " duplicated packet_in messages were suppressed ( datapath_id = %#" PRIx64 " ).",
+               entry->suppressed, entry->key.datapath_id );
+      }
+      delete_hash_entry( coalesced_packet_ins, &entry->key );
+      xfree( entry );
+    }
+  }
+}
+
+
+/*
+ * Once a packet_in is delivered, further packet_ins for the same flow
+ * ( the match extracted from the packet and the datapath id ) that arrive
+ * within the window are dropped without calling the packet_in handler.
+ * This avoids setting up the same flow once per packet while the first
+ * flow_mod is on its way to the switch. A window of zero disables it.
+ */
+bool
+set_packet_in_coalescing_window( uint32_t msec ) {
+  maybe_init_openflow_application_interface();
+  assert( openflow_application_interface_initialized );
+
+  debug( "Setting a packet_in coalescing window ( msec = %u ).", msec );
+
+  packet_in_coalescing_window.tv_sec = ( time_t ) ( msec / 1000 );
+  packet_in_coalescing_window.tv_nsec = ( long ) ( msec % 1000 ) * 1000000;
+
+  if ( msec > 0 && coalesced_packet_ins == NULL ) {
+    coalesced_packet_ins = create_hash( compare_packet_in_flow_key, hash_packet_in_flow_key );
+    add_periodic_event_callback( PACKET_IN_COALESCING_AGING_INTERVAL, age_coalesced_packet_ins, NULL );
+  }
+  else if ( msec == 0 && coalesced_packet_ins != NULL ) {
+    delete_periodic_event_callback( age_coalesced_packet_ins );
+    hash_iterator iter;
+    hash_entry *e;
+    init_hash_iterator( coalesced_packet_ins, &iter );
+    while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
+      xfree( e->value );
+    }
+    delete_hash( coalesced_packet_ins );
+    coalesced_packet_ins = NULL;
+  }
+
+  return true;
+}
+
+
+static bool
+compare_openflow_request_key( const void *x, const void *y ) {
+  return memcmp( x, y, sizeof( openflow_request_key ) ) == 0;
+}
+
+
+static unsigned int
+hash_openflow_request_key( const void *key ) {
+  return hash_core( key, sizeof( openflow_request_key ) );
+}
+
+
+static void
+init_openflow_request_key( openflow_request_key *key, uint64_t datapath_id, uint32_t transaction_id ) {
+  memset( key, 0, sizeof( openflow_request_key ) );
+  key->datapath_id = datapath_id;
+  key->transaction_id = transaction_id;
+}
+
+
+/*
+ * Removes the requests that satisfy expired() from the pending table
+ * first, so that timeout handlers may send new requests.
+ */
+static void
+expire_openflow_requests( bool expired( const pending_openflow_request *request, void *user_data ), void *user_data ) {
+  if ( pending_openflow_requests == NULL ) {
+    return;
+  }
+
+  list_element *expired_requests;
+  create_list( &expired_requests );
+  hash_iterator iter;
+  hash_entry *e;
+  init_hash_iterator( pending_openflow_requests, &iter );
+  while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
+    pending_openflow_request *request = e->value;
+    if ( expired( request, user_data ) ) {
+      delete_hash_entry( pending_openflow_requests, &request->key );
+      append_to_tail( &expired_requests, request );
+    }
+  }
+
+  for ( list_element *element = expired_requests; element != NULL; element = element->next ) {
+    pending_openflow_request *request = element->data;
+    debug( "An OpenFlow request is expired ( datapath_id = %#" PRIx64 ", transaction_id = %#x ).",
+           request->key.datapath_id, request->key.transaction_id );
+    if ( request->timeout_callback != NULL ) {
+      request->timeout_callback( request->key.datapath_id, request->key.transaction_id, request->user_data );
+    }
+    xfree( request );
+  }
+  delete_list( expired_requests );
+}
+
+
+static bool
+openflow_request_timed_out( const pending_openflow_request *request, void *now ) {
+  return request->expires && timespec_passed( &request->expires_at, now );
+}
+
+
+static void
+age_openflow_requests( void *user_data ) {
+  UNUSED( user_data );
+
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+
+  expire_openflow_requests( openflow_request_timed_out, &now );
+}
+
+
+static bool
+openflow_request_sent_to( const pending_openflow_request *request, void *datapath_id ) {
+  return request->key.datapath_id == *( uint64_t * ) datapath_id;
+}
+
+
+static void
+abort_openflow_requests( uint64_t datapath_id ) {
+  expire_openflow_requests( openflow_request_sent_to, &datapath_id );
+}
+
+
+/*
+ * Passes a reply to the request it answers, if any. Requests answered by
+ * a stats reply stay pending until its last part.
+ */
+static bool
+handle_openflow_reply( const uint64_t datapath_id, buffer *data ) {
+  if ( pending_openflow_requests == NULL ) {
+    return false;
+  }
+
+  struct ofp_header *header = data->data;
+  switch ( header->type ) {
+  case OFPT_ERROR:
+  case OFPT_VENDOR:
+  case OFPT_FEATURES_REPLY:
+  case OFPT_GET_CONFIG_REPLY:
+  case OFPT_STATS_REPLY:
+  case OFPT_BARRIER_REPLY:
+  case OFPT_QUEUE_GET_CONFIG_REPLY:
+    break;
+  default:
+    return false;
+  }
+
+  openflow_request_key key;
+  init_openflow_request_key( &key, datapath_id, ntohl( header->xid ) );
+  pending_openflow_request *request = lookup_hash_entry( pending_openflow_requests, &key );
+  if ( request == NULL ) {
+    return false;
+  }
+
+  bool more = false;
+  if ( header->type == OFPT_STATS_REPLY ) {
+    more = ( ntohs( ( ( struct ofp_stats_reply * ) header )->flags ) & OFPSF_REPLY_MORE ) != 0;
+  }
+  if ( !more ) {
+    delete_hash_entry( pending_openflow_requests, &key );
+  }
+
+  debug( "Calling OpenFlow reply handler ( callback = %p, user_data = %p, transaction_id = %#x ).",
+         request->reply_callback, request->user_data, key.transaction_id );
+  request->reply_callback( datapath_id, data, request->user_data );
+
+  if ( !more ) {
+    xfree( request );
+  }
+
+  return true;
+}
+
+
 static void
 handle_error( const uint64_t datapath_id, buffer *data ) {
   uint16_t type, code;
@@ -511,6 +1207,12 @@ handle_error( const uint64_t datapath_id, buffer *data ) {
   type = ntohs( error_msg->type );
   code = ntohs( error_msg->code );
 
+  if ( handle_flow_mod_batch_error( datapath_id, transaction_id, type, code ) ) {
+    debug( "An error message for a flow_mod batch is received from %#" PRIx64
+           " ( transaction_id = %#x, type = %u, code = %u ).", datapath_id, transaction_id, type, code );
+    return;
+  }
+
   body = duplicate_buffer( data );
   remove_front_buffer( body, offsetof( struct ofp_error_msg, data ) );
 
@@ -706,17 +1408,62 @@ handle_get_config_reply( const uint64_t datapath_id, buffer *data ) {
   debug( "Calling get config reply handler ( callback = %p, user_data = %p ).",
          event_handlers.get_config_reply_callback, event_handlers.get_config_reply_user_data );
 
-  event_handlers.get_config_reply_callback( datapath_id,
-                                            transaction_id,
-                                            flags,
-                                            miss_send_len,
-                                            event_handlers.get_config_reply_user_data );
+  event_handlers.get_config_reply_callback( datapath_id,
+                                            transaction_id,
+                                            flags,
+                                            miss_send_len,
+                                            event_handlers.get_config_reply_user_data );
+}
+
+
+static bool
+empty( const buffer *data ) {
+  return ( data == NULL ) || ( ( data != NULL ) && ( data->length == 0 ) );
+}
+
+
+static bool
+coalesce_packet_in( const uint64_t datapath_id, uint16_t in_port, const buffer *body ) {
+  packet_in_flow_key key;
+  memset( &key, 0, sizeof( packet_in_flow_key ) );
+  key.datapath_id = datapath_id;
+  set_match_from_packet( &key.match, in_port, 0, body );
+
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+
+  coalesced_packet_in *entry = lookup_hash_entry( coalesced_packet_ins, &key );
+  if ( entry != NULL && !timespec_passed( &entry->expires_at, &now ) ) {
+    entry->suppressed++;
+    increment_stat_counter( &packet_in_coalescing_counters, PACKET_IN_COALESCED );
+    return true;
+  }
+
+  if ( entry == NULL ) {
+    entry = xmalloc( sizeof( coalesced_packet_in ) );
+    entry->key = key;
+    insert_hash_entry( coalesced_packet_ins, &entry->key, entry );
+  }
+  entry->suppressed = 0;
+  entry->expires_at.tv_sec = now.tv_sec + packet_in_coalescing_window.tv_sec;
+  entry->expires_at.tv_nsec = now.tv_nsec + packet_in_coalescing_window.tv_nsec;
+  if ( entry->expires_at.tv_nsec >= 1000000000 ) {
+    entry->expires_at.tv_sec++;
+    entry->expires_at.tv_nsec -= 1000000000;
+  }
+
+  return false;
 }
 
 
-static bool
-empty( const buffer *data ) {
-  return ( data == NULL ) || ( ( data != NULL ) && ( data->length == 0 ) );
+static void
+release_packet_in_buffer( const uint64_t datapath_id, uint32_t buffer_id, uint16_t in_port ) {
+  // A packet_out without actions drops the packet and frees the buffer on the switch.
+  buffer *packet_out = create_packet_out( get_transaction_id(), buffer_id, in_port, NULL, NULL );
+  if ( send_openflow_message( datapath_id, packet_out ) ) {
+    increment_stat_counter( &packet_in_coalescing_counters, PACKET_IN_BUFFER_RELEASED );
+  }
+  free_buffer( packet_out );
 }
 
 
@@ -762,6 +1509,14 @@ handle_packet_in( const uint64_t datapath_id, buffer *data ) {
       free_buffer( body );
       return;
     }
+    if ( coalesced_packet_ins != NULL && coalesce_packet_in( datapath_id, in_port, body ) ) {
+      debug( "A duplicated packet_in message is suppressed." );
+      free_buffer( body );
+      if ( buffer_id != UINT32_MAX ) {
+        release_packet_in_buffer( datapath_id, buffer_id, in_port );
+      }
+      return;
+    }
   }
   else {
     body = NULL;
@@ -906,6 +1661,141 @@ handle_port_status( const uint64_t datapath_id, buffer *data ) {
 }
 
 
+static void
+init_stats_reply_iterator( stats_reply_iterator *iterator, uint16_t type, const void *body, size_t length ) {
+  iterator->type = type;
+  iterator->next = body;
+  iterator->remaining = length;
+}
+
+
+/**
+ * Returns the next entry of a stats reply in network byte order, or NULL if
+ * no entry is left. Desc, aggregate and vendor stats replies have a single
+ * entry that spans the whole body.
+ */
+const void *
+next_stats_reply_entry( stats_reply_iterator *iterator ) {
+  assert( iterator != NULL );
+
+  if ( iterator->remaining == 0 ) {
+    return NULL;
+  }
+
+  size_t length;
+  switch ( iterator->type ) {
+  case OFPST_FLOW:
+    length = 0;
+    if ( iterator->remaining >= offsetof( struct ofp_flow_stats, actions ) ) {
+      length = ntohs( ( ( const struct ofp_flow_stats * ) iterator->next )->length );
+    }
+    if ( length < offsetof( struct ofp_flow_stats, actions ) ) {
+      length = 0;
+    }
+    break;
+  case OFPST_TABLE:
+    length = sizeof( struct ofp_table_stats );
+    break;
+  case OFPST_PORT:
+    length = sizeof( struct ofp_port_stats );
+    break;
+  case OFPST_QUEUE:
+    length = sizeof( struct ofp_queue_stats );
+    break;
+  default:
+    length = iterator->remaining;
+    break;
+  }
+
+  if ( length == 0 || length > iterator->remaining ) {
+    warn( "Malformed stats reply entry ( type = %#x, length = %zu, remaining = %zu ).",
+          iterator->type, length, iterator->remaining );
+    iterator->remaining = 0;
+    return NULL;
+  }
+
+  const void *entry = iterator->next;
+  iterator->next = ( const char * ) iterator->next + length;
+  iterator->remaining -= length;
+
+  return entry;
+}
+
+
+/*
+ * Bodies are appended into a buffer that is at least doubled when it
+ * runs out, so that a reply with many parts is not copied over and over.
+ */
+static void
+append_stats_reply_body( partial_stats_reply *partial, const void *body, const uint16_t body_length ) {
+  if ( partial->body->length + body_length > partial->body_size ) {
+    size_t size = partial->body_size * 2;
+    if ( size < partial->body->length + body_length ) {
+      size = partial->body->length + body_length;
+    }
+    buffer *grown = alloc_buffer_with_length( size );
+    if ( partial->body->length > 0 ) {
+      memcpy( append_back_buffer( grown, partial->body->length ), partial->body->data, partial->body->length );
+    }
+    free_buffer( partial->body );
+    partial->body = grown;
+    partial->body_size = size;
+  }
+  memcpy( append_back_buffer( partial->body, body_length ), body, body_length );
+}
+
+
+static void
+reassemble_stats_reply( const uint64_t datapath_id, const uint32_t transaction_id, const uint16_t type,
+                        const uint16_t flags, const void *body, const uint16_t body_length ) {
+  partial_stats_reply *partial = NULL;
+  list_element *element;
+  for ( element = partial_stats_replies; element != NULL; element = element->next ) {
+    partial_stats_reply *p = element->data;
+    if ( p->datapath_id == datapath_id && p->transaction_id == transaction_id ) {
+      partial = p;
+      break;
+    }
+  }
+
+  stats_reply_iterator entries;
+  if ( partial == NULL && ( flags & OFPSF_REPLY_MORE ) == 0 ) {
+    // single part replies need not be copied
+    init_stats_reply_iterator( &entries, type, body, body_length );
+  }
+  else {
+    if ( partial == NULL ) {
+      partial = xmalloc( sizeof( partial_stats_reply ) );
+      partial->datapath_id = datapath_id;
+      partial->transaction_id = transaction_id;
+      partial->type = type;
+      partial->body = alloc_buffer();
+      partial->body_size = 0;
+      append_to_tail( &partial_stats_replies, partial );
+    }
+    if ( body_length > 0 ) {
+      append_stats_reply_body( partial, body, body_length );
+    }
+    if ( ( flags & OFPSF_REPLY_MORE ) != 0 ) {
+      return;
+    }
+    init_stats_reply_iterator( &entries, partial->type, partial->body->data, partial->body->length );
+  }
+
+  debug( "Calling stats reply completion handler ( callback = %p, user_data = %p ).",
+         event_handlers.stats_reply_completion_callback, event_handlers.stats_reply_completion_user_data );
+
+  event_handlers.stats_reply_completion_callback( datapath_id,
+                                                  transaction_id,
+                                                  type,
+                                                  &entries,
+                                                  event_handlers.stats_reply_completion_user_data );
+  if ( partial != NULL ) {
+    delete_partial_stats_reply( partial );
+  }
+}
+
+
 static void
 handle_stats_reply( const uint64_t datapath_id, buffer *data ) {
   uint16_t type, flags, body_length;
@@ -932,6 +1822,25 @@ handle_stats_reply( const uint64_t datapath_id, buffer *data ) {
          " ( transaction_id = %#x, type = %#x, flags = %#x, body length = %u ).",
          datapath_id, transaction_id, type, flags, body_length );
 
+  if ( event_handlers.stats_reply_part_callback != NULL ) {
+    stats_reply_iterator entries;
+    init_stats_reply_iterator( &entries, type, stats_reply->body, body_length );
+
+    debug( "Calling stats reply part handler ( callback = %p, user_data = %p ).",
+           event_handlers.stats_reply_part_callback, event_handlers.stats_reply_part_user_data );
+
+    event_handlers.stats_reply_part_callback( datapath_id,
+                                              transaction_id,
+                                              type,
+                                              flags,
+                                              &entries,
+                                              event_handlers.stats_reply_part_user_data );
+  }
+
+  if ( event_handlers.stats_reply_completion_callback != NULL ) {
+    reassemble_stats_reply( datapath_id, transaction_id, type, flags, stats_reply->body, body_length );
+  }
+
   if ( event_handlers.stats_reply_callback == NULL ) {
     debug( "Callback function for stats reply events is not set." );
     return;
@@ -1103,6 +2012,10 @@ handle_barrier_reply( const uint64_t datapath_id, buffer *data ) {
   debug( "A barrier reply message is received from %#" PRIx64 " ( transaction_id = %#x ).",
          datapath_id, transaction_id );
 
+  if ( complete_flow_mod_batch( datapath_id, transaction_id ) ) {
+    return;
+  }
+
   if ( event_handlers.barrier_reply_callback == NULL ) {
     debug( "Callback function for barrier reply events is not set." );
     return;
@@ -1191,49 +2104,36 @@ handle_queue_get_config_reply( const uint64_t datapath_id, buffer *data ) {
 
 static void
 update_switch_event_stats( uint16_t type, int send_receive, bool result ) {
-  char key[ STAT_KEY_LENGTH ];
-  char suffix[ 16 ];
-  char direction[ 16 ];
-  const char *prefix = "openflow_application_interface.";
-
-  memset( suffix, '\0', sizeof( suffix ) );
-
-  if ( result ) {
-    sprintf( suffix, "_succeeded" );
-  }
-  else {
-    sprintf( suffix, "_failed" );
-  }
-
-  memset( direction, '\0', sizeof( direction ) );
-
-  switch ( send_receive ) {
-  case OPENFLOW_MESSAGE_SEND:
-    sprintf( direction, "_send" );
-    break;
-  case OPENFLOW_MESSAGE_RECEIVE:
-    sprintf( direction, "_receive" );
-    break;
-  default:
+  if ( send_receive != OPENFLOW_MESSAGE_SEND && send_receive != OPENFLOW_MESSAGE_RECEIVE ) {
     return;
   }
 
+  unsigned int event;
   switch ( type ) {
   case MESSENGER_OPENFLOW_CONNECTED:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "switch_connected", direction, suffix );
+    event = SWITCH_EVENT_CONNECTED;
     break;
   case MESSENGER_OPENFLOW_READY:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "switch_ready", direction, suffix );
+    event = SWITCH_EVENT_READY;
     break;
   case MESSENGER_OPENFLOW_DISCONNECTED:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "switch_disconnected", direction, suffix );
+    event = SWITCH_EVENT_DISCONNECTED;
+    break;
+  case MESSENGER_OPENFLOW_PACKET_IN_THROTTLED:
+    event = SWITCH_EVENT_PACKET_IN_THROTTLED;
+    break;
+  case MESSENGER_OPENFLOW_LIVENESS_REQUEST:
+    event = SWITCH_EVENT_LIVENESS_REQUEST;
+    break;
+  case MESSENGER_OPENFLOW_LIVENESS_REPLY:
+    event = SWITCH_EVENT_LIVENESS_REPLY;
     break;
   default:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "undefined_switch_event", direction, suffix );
+    event = SWITCH_EVENT_UNDEFINED;
     break;
   }
 
-  increment_stat( key );
+  increment_stat_counter( &switch_event_counters, message_counter_index( event, send_receive, result ) );
 }
 
 
@@ -1282,6 +2182,9 @@ handle_switch_events( uint16_t type, void *data, size_t length ) {
     handle_switch_ready( datapath_id );
     break;
   case MESSENGER_OPENFLOW_DISCONNECTED:
+    abort_flow_mod_batches( datapath_id );
+    discard_partial_stats_replies( datapath_id );
+    abort_openflow_requests( datapath_id );
     if ( event_handlers.switch_disconnected_callback != NULL ) {
       debug( "Calling switch disconnected handler ( callback = %p, user_data = %p ).",
              event_handlers.switch_disconnected_callback, event_handlers.switch_disconnected_user_data );
@@ -1302,107 +2205,89 @@ handle_switch_events( uint16_t type, void *data, size_t length ) {
 
 
 static void
-update_openflow_stats( uint8_t type, int send_receive, bool result ) {
-  char key[ STAT_KEY_LENGTH ];
-  char suffix[ 16 ];
-  char direction[ 16 ];
-  const char *prefix = "openflow_application_interface.";
+handle_packet_in_throttled( void *data, size_t length ) {
+  assert( data != NULL );
+
+  if ( length != sizeof( openflow_service_header_t ) + sizeof( openflow_packet_in_throttled_t ) ) {
+    error( "Invalid packet_in throttled event ( length = %u ).", length );
+    update_switch_event_stats( MESSENGER_OPENFLOW_PACKET_IN_THROTTLED, OPENFLOW_MESSAGE_RECEIVE, false );
+    return;
+  }
 
-  memset( suffix, '\0', sizeof( suffix ) );
+  openflow_service_header_t *message = data;
+  uint64_t datapath_id = ntohll( message->datapath_id );
+  openflow_packet_in_throttled_t *event = ( openflow_packet_in_throttled_t * ) ( message + 1 );
 
-  if ( result ) {
-    sprintf( suffix, "_succeeded" );
+  if ( event_handlers.packet_in_throttled_callback != NULL ) {
+    debug( "Calling packet_in throttled handler ( callback = %p, user_data = %p ).",
+           event_handlers.packet_in_throttled_callback, event_handlers.packet_in_throttled_user_data );
+    event_handlers.packet_in_throttled_callback( datapath_id,
+                                                 ntohs( event->in_port ),
+                                                 event->throttled != 0,
+                                                 ntohll( event->dropped ),
+                                                 event_handlers.packet_in_throttled_user_data );
   }
   else {
-    sprintf( suffix, "_failed" );
+    debug( "Callback function for packet_in throttled events is not set." );
   }
 
-  memset( direction, '\0', sizeof( direction ) );
+  update_switch_event_stats( MESSENGER_OPENFLOW_PACKET_IN_THROTTLED, OPENFLOW_MESSAGE_RECEIVE, true );
+}
 
-  switch ( send_receive ) {
-  case OPENFLOW_MESSAGE_SEND:
-    sprintf( direction, "_send" );
-    break;
-  case OPENFLOW_MESSAGE_RECEIVE:
-    sprintf( direction, "_receive" );
-    break;
-  default:
+
+static void
+handle_switch_liveness_reply( void *data, size_t length ) {
+  assert( data != NULL );
+
+  if ( length != sizeof( openflow_service_header_t ) + sizeof( openflow_liveness_t ) ) {
+    error( "Invalid switch liveness reply ( length = %u ).", length );
+    update_switch_event_stats( MESSENGER_OPENFLOW_LIVENESS_REPLY, OPENFLOW_MESSAGE_RECEIVE, false );
     return;
   }
 
-  switch ( type ) {
-  case OFPT_HELLO:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "hello", direction, suffix );
-    break;
-  case OFPT_ERROR:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "error", direction, suffix );
-    break;
-  case OFPT_ECHO_REQUEST:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "echo_request", direction, suffix );
-    break;
-  case OFPT_ECHO_REPLY:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "echo_reply", direction, suffix );
-    break;
-  case OFPT_VENDOR:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "vendor", direction, suffix );
-    break;
-  case OFPT_FEATURES_REQUEST:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "features_request", direction, suffix );
-    break;
-  case OFPT_FEATURES_REPLY:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "features_reply", direction, suffix );
-    break;
-  case OFPT_GET_CONFIG_REQUEST:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "get_config_request", direction, suffix );
-    break;
-  case OFPT_GET_CONFIG_REPLY:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "get_config_reply", direction, suffix );
-    break;
-  case OFPT_SET_CONFIG:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "set_config", direction, suffix );
-    break;
-  case OFPT_PACKET_IN:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "packet_in", direction, suffix );
-    break;
-  case OFPT_FLOW_REMOVED:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "flow_removed", direction, suffix );
-    break;
-  case OFPT_PORT_STATUS:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "port_status", direction, suffix );
-    break;
-  case OFPT_PACKET_OUT:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "packet_out", direction, suffix );
-    break;
-  case OFPT_FLOW_MOD:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "flow_mod", direction, suffix );
-    break;
-  case OFPT_PORT_MOD:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "port_mod", direction, suffix );
-    break;
-  case OFPT_STATS_REQUEST:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "stats_request", direction, suffix );
-    break;
-  case OFPT_STATS_REPLY:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "stats_reply", direction, suffix );
-    break;
-  case OFPT_BARRIER_REQUEST:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "barrier_request", direction, suffix );
-    break;
-  case OFPT_BARRIER_REPLY:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "barrier_reply", direction, suffix );
-    break;
-  case OFPT_QUEUE_GET_CONFIG_REQUEST:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "queue_get_config_request", direction, suffix );
-    break;
-  case OFPT_QUEUE_GET_CONFIG_REPLY:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "queue_get_config_reply", direction, suffix );
-    break;
-  default:
-    snprintf( key, STAT_KEY_LENGTH, "%s%s%s%s", prefix, "undefined_message_type", direction, suffix );
-    break;
+  openflow_service_header_t *message = data;
+  uint64_t datapath_id = ntohll( message->datapath_id );
+  openflow_liveness_t *reply = ( openflow_liveness_t * ) ( message + 1 );
+
+  if ( event_handlers.switch_liveness_reply_callback != NULL ) {
+    openflow_liveness_t liveness;
+    liveness.echo_interval = ntohl( reply->echo_interval );
+    liveness.last_seen = ntohl( reply->last_seen );
+    liveness.echo_requests = ntohll( reply->echo_requests );
+    liveness.echo_replies = ntohll( reply->echo_replies );
+    liveness.echo_missed = ntohll( reply->echo_missed );
+    liveness.rtt_last = ntohl( reply->rtt_last );
+    liveness.rtt_min = ntohl( reply->rtt_min );
+    liveness.rtt_max = ntohl( reply->rtt_max );
+    liveness.rtt_smoothed = ntohl( reply->rtt_smoothed );
+    unsigned int i;
+    for ( i = 0; i < OPENFLOW_LIVENESS_RTT_BUCKETS; i++ ) {
+      liveness.rtt_histogram[ i ] = ntohl( reply->rtt_histogram[ i ] );
+    }
+
+    debug( "Calling switch liveness reply handler ( callback = %p, user_data = %p ).",
+           event_handlers.switch_liveness_reply_callback, event_handlers.switch_liveness_reply_user_data );
+    event_handlers.switch_liveness_reply_callback( datapath_id, &liveness,
+                                                   event_handlers.switch_liveness_reply_user_data );
+  }
+  else {
+    debug( "Callback function for switch liveness replies is not set." );
+  }
+
+  update_switch_event_stats( MESSENGER_OPENFLOW_LIVENESS_REPLY, OPENFLOW_MESSAGE_RECEIVE, true );
+}
+
+
+static void
+update_openflow_stats( uint8_t type, int send_receive, bool result ) {
+  if ( send_receive != OPENFLOW_MESSAGE_SEND && send_receive != OPENFLOW_MESSAGE_RECEIVE ) {
+    return;
+  }
+  if ( type > OFPT_QUEUE_GET_CONFIG_REPLY ) {
+    type = OPENFLOW_MESSAGE_UNDEFINED;
   }
 
-  increment_stat( key );
+  increment_stat_counter( &openflow_message_counters, message_counter_index( type, send_receive, result ) );
 }
 
 
@@ -1443,6 +2328,13 @@ handle_openflow_message( void *data, size_t length ) {
 
   header = ( struct ofp_header * ) buffer->data;
 
+  if ( handle_openflow_reply( datapath_id, buffer ) ) {
+    update_openflow_stats( header->type, OPENFLOW_MESSAGE_RECEIVE, true );
+    free_buffer( buffer );
+
+    return;
+  }
+
   switch ( header->type ) {
   case OFPT_ERROR:
     handle_error( datapath_id, buffer );
@@ -1499,6 +2391,10 @@ handle_message( uint16_t type, void *data, size_t length ) {
   case MESSENGER_OPENFLOW_READY:
   case MESSENGER_OPENFLOW_DISCONNECTED:
     return handle_switch_events( type, data, length );
+  case MESSENGER_OPENFLOW_PACKET_IN_THROTTLED:
+    return handle_packet_in_throttled( data, length );
+  case MESSENGER_OPENFLOW_LIVENESS_REPLY:
+    return handle_switch_liveness_reply( data, length );
   default:
     error( "Unhandled message ( type = %u ).", type );
     update_switch_event_stats( type, OPENFLOW_MESSAGE_RECEIVE, true );
@@ -1569,15 +2465,18 @@ handle_list_switches_reply( uint16_t message_type, void *data, size_t length, vo
 }
 
 
+/*
+ * The message is sent together with the service header from the stack
+ * with send_message_iov(), so that no memory is allocated per message.
+ */
 bool
 send_openflow_message( const uint64_t datapath_id, buffer *message ) {
   bool ret;
-  void *data;
   char remote_service_name[ MESSENGER_SERVICE_NAME_LENGTH ];
-  uint16_t header_length;
-  buffer *buffer;
+  char header[ sizeof( openflow_service_header_t ) + MESSENGER_SERVICE_NAME_LENGTH ];
+  openflow_service_header_t *service_header = ( openflow_service_header_t * ) header;
   struct ofp_header *ofp;
-  openflow_service_header_t header;
+  struct iovec iov[ 2 ];
 
   maybe_init_openflow_application_interface();
   assert( openflow_application_interface_initialized );
@@ -1588,21 +2487,17 @@ send_openflow_message( const uint64_t datapath_id, buffer *message ) {
   }
 
   ofp = ( struct ofp_header * ) message->data;
-  buffer = duplicate_buffer( message );
+  uint16_t tag = buffer_built_by_library( message ) ? MESSENGER_OPENFLOW_BUILT_MESSAGE : MESSENGER_OPENFLOW_MESSAGE;
 
-  assert( buffer != NULL );
-
-  header_length = ( uint16_t ) ( sizeof( openflow_service_header_t )
-                  + strlen( service_name ) + 1 );
+  size_t name_length = strlen( service_name ) + 1;
+  service_header->datapath_id = htonll( datapath_id );
+  service_header->service_name_length = htons( ( uint16_t ) name_length );
+  memcpy( header + sizeof( openflow_service_header_t ), service_name, name_length );
 
-  header.datapath_id = htonll( datapath_id );
-  header.service_name_length = htons( ( uint16_t ) ( strlen( service_name ) + 1 ) );
-
-  data = append_front_buffer( buffer, header_length );
-  memset( data, '\0', header_length );
-  memcpy( data, &header, sizeof( openflow_service_header_t ) );
-  memcpy( ( char * ) data + sizeof( openflow_service_header_t ),
-          service_name, strlen( service_name ) );
+  iov[ 0 ].iov_base = header;
+  iov[ 0 ].iov_len = sizeof( openflow_service_header_t ) + name_length;
+  iov[ 1 ].iov_base = message->data;
+  iov[ 1 ].iov_len = message->length;
 
   memset( remote_service_name, '\0', sizeof( remote_service_name ) );
   snprintf( remote_service_name, sizeof( remote_service_name ),
@@ -1614,10 +2509,7 @@ send_openflow_message( const uint64_t datapath_id, buffer *message ) {
          datapath_id, service_name, remote_service_name,
          ofp->version, ofp->type, ntohs( ofp->length ), ntohl( ofp->xid ) );
 
-  ret =  send_message( remote_service_name, MESSENGER_OPENFLOW_MESSAGE,
-                       buffer->data, buffer->length );
-
-  free_buffer( buffer );
+  ret = send_message_iov( remote_service_name, tag, iov, 2 );
 
   update_openflow_stats( ofp->type, OPENFLOW_MESSAGE_SEND, ret );
 
@@ -1625,6 +2517,247 @@ send_openflow_message( const uint64_t datapath_id, buffer *message ) {
 }
 
 
+/*
+ * Sends a request and passes its reply, or an error with the same
+ * transaction id, to reply_callback instead of the handler set for the
+ * reply type. If no reply arrives within timeout seconds, or the switch
+ * is disconnected first, timeout_callback is called instead. A timeout of
+ * zero never expires. Timeouts are checked once a second.
+ */
+bool
+send_openflow_request( const uint64_t datapath_id, buffer *message,
+                       openflow_reply_handler reply_callback,
+                       openflow_request_timeout_handler timeout_callback,
+                       const time_t timeout, void *user_data ) {
+  if ( reply_callback == NULL ) {
+    die( "Callback function ( openflow_reply_handler ) must not be NULL." );
+  }
+  assert( reply_callback != NULL );
+
+  maybe_init_openflow_application_interface();
+  assert( openflow_application_interface_initialized );
+
+  if ( ( message == NULL ) || ( ( message != NULL ) && ( message->length == 0 ) ) ) {
+    critical( "An OpenFlow message must be passed to send_openflow_request()." );
+    assert( 0 );
+  }
+
+  if ( pending_openflow_requests == NULL ) {
+    pending_openflow_requests = create_hash( compare_openflow_request_key, hash_openflow_request_key );
+    add_periodic_event_callback( OPENFLOW_REQUEST_AGING_INTERVAL, age_openflow_requests, NULL );
+  }
+
+  struct ofp_header *header = message->data;
+  openflow_request_key key;
+  init_openflow_request_key( &key, datapath_id, ntohl( header->xid ) );
+  if ( lookup_hash_entry( pending_openflow_requests, &key ) != NULL ) {
+    error( "An OpenFlow request is already pending ( datapath_id = %#" PRIx64 ", transaction_id = %#x ).",
+           datapath_id, key.transaction_id );
+    return false;
+  }
+
+  pending_openflow_request *request = xmalloc( sizeof( pending_openflow_request ) );
+  request->key = key;
+  request->expires = timeout > 0;
+  clock_gettime( CLOCK_MONOTONIC, &request->expires_at );
+  request->expires_at.tv_sec += timeout;
+  request->reply_callback = reply_callback;
+  request->timeout_callback = timeout_callback;
+  request->user_data = user_data;
+  insert_hash_entry( pending_openflow_requests, &request->key, request );
+
+  if ( !send_openflow_message( datapath_id, message ) ) {
+    delete_hash_entry( pending_openflow_requests, &request->key );
+    xfree( request );
+    return false;
+  }
+
+  return true;
+}
+
+
+/*
+ * Asks the switch daemon for echo round trip times and liveness of a
+ * switch. The reply is passed to the switch liveness reply handler.
+ */
+bool
+send_switch_liveness_request( const uint64_t datapath_id ) {
+  char remote_service_name[ MESSENGER_SERVICE_NAME_LENGTH ];
+  char header[ sizeof( openflow_service_header_t ) + MESSENGER_SERVICE_NAME_LENGTH ];
+  openflow_service_header_t *service_header = ( openflow_service_header_t * ) header;
+
+  maybe_init_openflow_application_interface();
+  assert( openflow_application_interface_initialized );
+
+  size_t name_length = strlen( service_name ) + 1;
+  service_header->datapath_id = htonll( datapath_id );
+  service_header->service_name_length = htons( ( uint16_t ) name_length );
+  memcpy( header + sizeof( openflow_service_header_t ), service_name, name_length );
+
+  snprintf( remote_service_name, sizeof( remote_service_name ), "switch.%" PRIx64, datapath_id );
+
+  debug( "Sending a switch liveness request to %#" PRIx64 " ( service_name = %s, remote_service_name = %s ).",
+         datapath_id, service_name, remote_service_name );
+
+  bool ret = send_message( remote_service_name, MESSENGER_OPENFLOW_LIVENESS_REQUEST,
+                           header, sizeof( openflow_service_header_t ) + name_length );
+  update_switch_event_stats( MESSENGER_OPENFLOW_LIVENESS_REQUEST, OPENFLOW_MESSAGE_SEND, ret );
+
+  return ret;
+}
+
+
+flow_mod_batch *
+create_flow_mod_batch( void ) {
+  flow_mod_batch *batch = xmalloc( sizeof( flow_mod_batch ) );
+  create_list( &batch->chunks );
+  batch->last_chunk = NULL;
+  batch->n_flow_mods = 0;
+  batch->built = true;
+
+  return batch;
+}
+
+
+void
+delete_flow_mod_batch( flow_mod_batch *batch ) {
+  assert( batch != NULL );
+
+  list_element *element;
+  for ( element = batch->chunks; element != NULL; element = element->next ) {
+    free_buffer( element->data );
+  }
+  delete_list( batch->chunks );
+  xfree( batch );
+}
+
+
+bool
+append_flow_mod_to_batch( flow_mod_batch *batch, const buffer *flow_mod ) {
+  assert( batch != NULL );
+
+  if ( ( flow_mod == NULL ) || ( ( flow_mod != NULL ) && ( flow_mod->length < sizeof( struct ofp_header ) ) ) ) {
+    critical( "A flow_mod message must be passed to append_flow_mod_to_batch()." );
+    assert( 0 );
+  }
+
+  struct ofp_header *header = flow_mod->data;
+  if ( header->type != OFPT_FLOW_MOD || ntohs( header->length ) != flow_mod->length ) {
+    error( "Not a flow_mod message ( type = %#x, length = %u ).", header->type, flow_mod->length );
+    return false;
+  }
+
+  // a chunk never grows, so appending costs the same however large the batch is
+  if ( batch->last_chunk == NULL || batch->last_chunk->length + flow_mod->length > FLOW_MOD_BATCH_CHUNK_LENGTH ) {
+    batch->last_chunk = alloc_buffer_with_length( FLOW_MOD_BATCH_CHUNK_LENGTH );
+    append_to_tail( &batch->chunks, batch->last_chunk );
+  }
+  memcpy( append_back_buffer( batch->last_chunk, flow_mod->length ), flow_mod->data, flow_mod->length );
+  batch->n_flow_mods++;
+  batch->built = batch->built && buffer_built_by_library( flow_mod );
+
+  return true;
+}
+
+
+/*
+ * Sends flow_mods in a batch followed by a barrier request. Transaction ids
+ * of the flow_mods are reassigned. Errors for the flow_mods are not passed
+ * to the error handler but reported together to the callback when the
+ * barrier reply is received. The batch can be reused or deleted after
+ * this call. If the messenger send queue overflows on the way, false is
+ * returned and the callback is never called, although some of the flow_mods
+ * may have been sent.
+ */
+bool
+send_flow_mod_batch( const uint64_t datapath_id, flow_mod_batch *batch,
+                     flow_mod_batch_handler callback, void *user_data ) {
+  char remote_service_name[ MESSENGER_SERVICE_NAME_LENGTH ];
+  char header[ sizeof( openflow_service_header_t ) + MESSENGER_SERVICE_NAME_LENGTH ];
+  openflow_service_header_t *service_header = ( openflow_service_header_t * ) header;
+  struct iovec iov[ 3 ];
+
+  maybe_init_openflow_application_interface();
+  assert( openflow_application_interface_initialized );
+  assert( batch != NULL );
+  assert( callback != NULL );
+
+  pending_flow_mod_batch *pending = xmalloc( sizeof( pending_flow_mod_batch ) );
+  memset( pending, 0, sizeof( pending_flow_mod_batch ) );
+  pending->datapath_id = datapath_id;
+  pending->transaction_ids = xmalloc( sizeof( uint32_t ) * ( batch->n_flow_mods + 1 ) );
+  pending->n_flow_mods = batch->n_flow_mods;
+  pending->callback = callback;
+  pending->user_data = user_data;
+
+  list_element *element;
+  unsigned int i = 0;
+  for ( element = batch->chunks; element != NULL; element = element->next ) {
+    buffer *chunk = element->data;
+    size_t offset = 0;
+    while ( offset < chunk->length ) {
+      struct ofp_header *ofp = ( struct ofp_header * ) ( ( char * ) chunk->data + offset );
+      pending->transaction_ids[ i ] = get_transaction_id();
+      ofp->xid = htonl( pending->transaction_ids[ i ] );
+      offset += ntohs( ofp->length );
+      i++;
+    }
+  }
+  pending->barrier_transaction_id = get_transaction_id();
+  buffer *barrier = create_barrier_request( pending->barrier_transaction_id );
+
+  size_t name_length = strlen( service_name ) + 1;
+  service_header->datapath_id = htonll( datapath_id );
+  service_header->service_name_length = htons( ( uint16_t ) name_length );
+  memcpy( header + sizeof( openflow_service_header_t ), service_name, name_length );
+  iov[ 0 ].iov_base = header;
+  iov[ 0 ].iov_len = sizeof( openflow_service_header_t ) + name_length;
+
+  snprintf( remote_service_name, sizeof( remote_service_name ), "switch.%" PRIx64, datapath_id );
+
+  debug( "Sending a flow_mod batch to %#" PRIx64 " ( service_name = %s, remote_service_name = %s, "
+         "n_flow_mods = %u, barrier_transaction_id = %#x ).",
+         datapath_id, service_name, remote_service_name, batch->n_flow_mods, pending->barrier_transaction_id );
+
+  // each chunk is sent as is, and the last one is followed by the barrier request
+  bool ret = true;
+  element = batch->chunks;
+  do {
+    int iovcnt = 1;
+    if ( element != NULL ) {
+      buffer *chunk = element->data;
+      iov[ iovcnt ].iov_base = chunk->data;
+      iov[ iovcnt ].iov_len = chunk->length;
+      iovcnt++;
+      element = element->next;
+    }
+    if ( element == NULL ) {
+      iov[ iovcnt ].iov_base = barrier->data;
+      iov[ iovcnt ].iov_len = barrier->length;
+      iovcnt++;
+    }
+    ret = send_message_iov( remote_service_name,
+                            batch->built ? MESSENGER_OPENFLOW_BUILT_MESSAGES : MESSENGER_OPENFLOW_MESSAGES,
+                            iov, iovcnt );
+  } while ( ret && element != NULL );
+
+  for ( i = 0; i < batch->n_flow_mods; i++ ) {
+    update_openflow_stats( OFPT_FLOW_MOD, OPENFLOW_MESSAGE_SEND, ret );
+  }
+  update_openflow_stats( OFPT_BARRIER_REQUEST, OPENFLOW_MESSAGE_SEND, ret );
+  free_buffer( barrier );
+
+  if ( !ret ) {
+    xfree( pending->transaction_ids );
+    xfree( pending );
+    return false;
+  }
+  append_to_tail( &pending_flow_mod_batches, pending );
+
+  return true;
+}
+
+
 bool
 send_list_switches_request( void *user_data ) {
   uint16_t message_type = 0;
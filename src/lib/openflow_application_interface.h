@@ -24,6 +24,7 @@
 #define OPENFLOW_APPLICATION_INTERFACE_H
 
 
+#include <time.h>
 #include "buffer.h"
 #include "linked_list.h"
 #include "openflow.h"
@@ -162,6 +163,37 @@ typedef void ( *stats_reply_handler )(
 );
 
 
+/*
+ * Walks the entries of a stats reply body where it was received. Entries
+ * are left in network byte order so that only the fields used need to be
+ * converted.
+ */
+typedef struct {
+  uint16_t type;
+  const void *next;
+  size_t remaining;
+} stats_reply_iterator;
+
+
+typedef void ( *stats_reply_part_handler )(
+  uint64_t datapath_id,
+  uint32_t transaction_id,
+  uint16_t type,
+  uint16_t flags, // OFPSF_REPLY_MORE is set if more parts follow
+  stats_reply_iterator *entries,
+  void *user_data
+);
+
+
+typedef void ( *stats_reply_completion_handler )(
+  uint64_t datapath_id,
+  uint32_t transaction_id,
+  uint16_t type,
+  stats_reply_iterator *entries, // of all parts
+  void *user_data
+);
+
+
 typedef void ( *barrier_reply_handler )(
   uint64_t datapath_id,
   uint32_t transaction_id,
@@ -184,6 +216,36 @@ typedef void ( *list_switches_reply_handler )(
 );
 
 
+typedef void ( *packet_in_throttled_handler )(
+  uint64_t datapath_id,
+  uint16_t in_port,
+  bool throttled,
+  uint64_t dropped,
+  void *user_data
+);
+
+
+typedef void ( *switch_liveness_reply_handler )(
+  uint64_t datapath_id,
+  const openflow_liveness_t *liveness, // in host byte order
+  void *user_data
+);
+
+
+typedef void ( *openflow_reply_handler )(
+  uint64_t datapath_id,
+  const buffer *reply, // whole OpenFlow message in network byte order
+  void *user_data
+);
+
+
+typedef void ( *openflow_request_timeout_handler )(
+  uint64_t datapath_id,
+  uint32_t transaction_id,
+  void *user_data
+);
+
+
 typedef struct openflow_event_handlers {
   bool simple_switch_ready_callback;
   void *switch_ready_callback;
@@ -224,6 +286,18 @@ typedef struct openflow_event_handlers {
   void *queue_get_config_reply_user_data;
 
   list_switches_reply_handler list_switches_reply_callback;
+
+  packet_in_throttled_handler packet_in_throttled_callback;
+  void *packet_in_throttled_user_data;
+
+  switch_liveness_reply_handler switch_liveness_reply_callback;
+  void *switch_liveness_reply_user_data;
+
+  stats_reply_part_handler stats_reply_part_callback;
+  void *stats_reply_part_user_data;
+
+  stats_reply_completion_handler stats_reply_completion_callback;
+  void *stats_reply_completion_user_data;
 } openflow_event_handlers_t;
 
 
@@ -270,10 +344,23 @@ bool _set_packet_in_handler( bool simple_callback, void *callback, void *user_da
 bool set_flow_removed_handler( flow_removed_handler callback, void *user_data );
 bool set_port_status_handler( port_status_handler callback, void *user_data );
 bool set_stats_reply_handler( stats_reply_handler callback, void *user_data );
+bool set_stats_reply_part_handler( stats_reply_part_handler callback, void *user_data );
+bool set_stats_reply_completion_handler( stats_reply_completion_handler callback, void *user_data );
 bool set_barrier_reply_handler( barrier_reply_handler callback, void *user_data );
 bool set_queue_get_config_reply_handler( queue_get_config_reply_handler callback, void *user_data );
 
 bool set_list_switches_reply_handler( list_switches_reply_handler callback );
+bool set_packet_in_throttled_handler( packet_in_throttled_handler callback, void *user_data );
+bool set_switch_liveness_reply_handler( switch_liveness_reply_handler callback, void *user_data );
+
+bool set_packet_in_coalescing_window( uint32_t msec );
+
+
+/********************************************************************************
+ * Function for walking the entries of a stats reply.
+ ********************************************************************************/
+
+const void *next_stats_reply_entry( stats_reply_iterator *iterator );
 
 
 /********************************************************************************
@@ -283,6 +370,44 @@ bool set_list_switches_reply_handler( list_switches_reply_handler callback );
 bool send_openflow_message( const uint64_t datapath_id, buffer *message );
 
 bool send_list_switches_request( void *user_data );
+bool send_switch_liveness_request( const uint64_t datapath_id );
+
+
+/********************************************************************************
+ * Function for sending an OpenFlow request and waiting for its reply.
+ ********************************************************************************/
+
+bool send_openflow_request( const uint64_t datapath_id, buffer *message,
+                            openflow_reply_handler reply_callback,
+                            openflow_request_timeout_handler timeout_callback,
+                            const time_t timeout, void *user_data );
+
+
+/********************************************************************************
+ * Functions for sending many flow_mod messages to an OpenFlow switch at once.
+ ********************************************************************************/
+
+typedef struct flow_mod_batch flow_mod_batch;
+
+typedef struct {
+  unsigned int index; // of the flow_mod in the batch
+  uint16_t type;
+  uint16_t code;
+} flow_mod_batch_error;
+
+typedef void ( *flow_mod_batch_handler )(
+  uint64_t datapath_id,
+  bool completed,                     // false if the switch is disconnected before completion
+  const flow_mod_batch_error *errors, // errors reported for flow_mods in the batch
+  unsigned int n_errors,
+  void *user_data
+);
+
+flow_mod_batch *create_flow_mod_batch( void );
+void delete_flow_mod_batch( flow_mod_batch *batch );
+bool append_flow_mod_to_batch( flow_mod_batch *batch, const buffer *flow_mod );
+bool send_flow_mod_batch( const uint64_t datapath_id, flow_mod_batch *batch,
+                          flow_mod_batch_handler callback, void *user_data );
 
 
 #endif // OPENFLOW_APPLICATION_INTERFACE_H
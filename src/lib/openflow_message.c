@@ -103,16 +103,15 @@ init_openflow_message( void ) {
 
 
 static buffer *
-create_header( const uint32_t transaction_id, const uint8_t type, const uint16_t length ) {
+init_header( buffer *buf, const uint32_t transaction_id, const uint8_t type, const uint16_t length ) {
   debug( "Creating an OpenFlow header ( version = %#x, type = %#x, length = %u, xid = %#x ).",
          OFP_VERSION, type, length, transaction_id );
 
+  assert( buf != NULL );
   assert( length >= sizeof( struct ofp_header ) );
 
-  buffer *buffer = alloc_buffer_with_length( length );
-  assert( buffer != NULL );
-
-  void *data = append_back_buffer( buffer, length );
+  reset_buffer( buf );
+  void *data = append_back_buffer( buf, length );
   assert( data != NULL );
   memset( data, 0, length );
 
@@ -122,7 +121,16 @@ create_header( const uint32_t transaction_id, const uint8_t type, const uint16_t
   header->length = htons( length );
   header->xid = htonl( transaction_id );
 
-  return buffer;
+  // fields are filled in place by the caller
+  mark_buffer_built_by_library( buf );
+
+  return buf;
+}
+
+
+static buffer *
+create_header( const uint32_t transaction_id, const uint8_t type, const uint16_t length ) {
+  return init_header( alloc_buffer(), transaction_id, type, length );
 }
 
 
@@ -493,18 +501,13 @@ get_actions_length( const openflow_actions *actions ) {
 }
 
 
-buffer *
-create_packet_out( const uint32_t transaction_id, const uint32_t buffer_id, const uint16_t in_port,
-                   const openflow_actions *actions, const buffer *data ) {
-  void *a, *d;
+static struct ofp_packet_out *
+init_packet_out( buffer *buf, const uint32_t transaction_id, const uint32_t buffer_id,
+                 const uint16_t in_port, const uint16_t actions_length, const buffer *data ) {
+  void *d;
   uint16_t length;
   uint16_t data_length = 0;
-  uint16_t action_length = 0;
-  uint16_t actions_length = 0;
-  buffer *buffer;
   struct ofp_packet_out *packet_out;
-  struct ofp_action_header *action_header;
-  list_element *action;
 
   if ( ( data != NULL ) && ( data->length > 0 ) ) {
     data_length = ( uint16_t ) data->length;
@@ -522,22 +525,46 @@ create_packet_out( const uint32_t transaction_id, const uint32_t buffer_id, cons
     }
   }
 
-  if ( actions != NULL ) {
-    debug( "# of actions = %d.", actions->n_actions );
-    actions_length = get_actions_length( actions );
-  }
-
   length = ( uint16_t ) ( offsetof( struct ofp_packet_out, actions ) + actions_length + data_length );
-  buffer = create_header( transaction_id, OFPT_PACKET_OUT, length );
-  assert( buffer != NULL );
+  init_header( buf, transaction_id, OFPT_PACKET_OUT, length );
 
-  packet_out = ( struct ofp_packet_out * ) buffer->data;
+  packet_out = ( struct ofp_packet_out * ) buf->data;
   packet_out->buffer_id = htonl( buffer_id );
   packet_out->in_port = htons( in_port );
   packet_out->actions_len = htons( actions_length );
 
+  if ( data_length > 0 ) {
+    d = ( void * ) ( ( char * ) buf->data
+                     + offsetof( struct ofp_packet_out, actions ) + actions_length );
+    memcpy( d, data->data, data_length );
+  }
+
+  // actions are filled in by the caller
+  return packet_out;
+}
+
+
+buffer *
+create_packet_out( const uint32_t transaction_id, const uint32_t buffer_id, const uint16_t in_port,
+                   const openflow_actions *actions, const buffer *data ) {
+  void *a;
+  uint16_t action_length = 0;
+  uint16_t actions_length = 0;
+  buffer *buffer;
+  struct ofp_packet_out *packet_out;
+  struct ofp_action_header *action_header;
+  list_element *action;
+
+  if ( actions != NULL ) {
+    debug( "# of actions = %d.", actions->n_actions );
+    actions_length = get_actions_length( actions );
+  }
+
+  buffer = alloc_buffer();
+  packet_out = init_packet_out( buffer, transaction_id, buffer_id, in_port, actions_length, data );
+
   if ( actions_length > 0 ) {
-    a = ( void * ) ( ( char * ) buffer->data + offsetof( struct ofp_packet_out, actions ) );
+    a = ( void * ) packet_out->actions;
 
     action = actions->list;
     while ( action != NULL ) {
@@ -549,33 +576,43 @@ create_packet_out( const uint32_t transaction_id, const uint32_t buffer_id, cons
     }
   }
 
-  if ( data_length > 0 ) {
-    d = ( void * ) ( ( char * ) buffer->data
-                     + offsetof( struct ofp_packet_out, actions ) + actions_length );
-    memcpy( d, data->data, data_length );
-  }
-
   return buffer;
 }
 
 
+/**
+ * Same as create_packet_out() except that the packet-out is built into buf,
+ * reusing its space, and the actions are taken from an action builder. No
+ * memory is allocated once buf has grown large enough.
+ */
 buffer *
-create_flow_mod( const uint32_t transaction_id, const struct ofp_match match,
-                 const uint64_t cookie, const uint16_t command,
-                 const uint16_t idle_timeout, const uint16_t hard_timeout,
-                 const uint16_t priority, const uint32_t buffer_id,
-                 const uint16_t out_port, const uint16_t flags,
-                 const openflow_actions *actions ) {
-  void *a;
+create_packet_out_into( buffer *buf, const uint32_t transaction_id, const uint32_t buffer_id,
+                        const uint16_t in_port, const openflow_action_builder *actions,
+                        const buffer *data ) {
+  assert( buf != NULL );
+
+  uint16_t actions_length = ( actions != NULL ) ? actions->length : 0;
+  struct ofp_packet_out *packet_out = init_packet_out( buf, transaction_id, buffer_id, in_port,
+                                                       actions_length, data );
+  if ( actions_length > 0 ) {
+    memcpy( packet_out->actions, actions->actions, actions_length );
+  }
+
+  return buf;
+}
+
+
+static struct ofp_flow_mod *
+init_flow_mod( buffer *buf, const uint32_t transaction_id, const struct ofp_match match,
+               const uint64_t cookie, const uint16_t command,
+               const uint16_t idle_timeout, const uint16_t hard_timeout,
+               const uint16_t priority, const uint32_t buffer_id,
+               const uint16_t out_port, const uint16_t flags,
+               const uint16_t actions_length ) {
   char match_str[ 1024 ];
   uint16_t length;
-  uint16_t action_length = 0;
-  uint16_t actions_length = 0;
-  buffer *buffer;
   struct ofp_match m = match;
   struct ofp_flow_mod *flow_mod;
-  struct ofp_action_header *action_header;
-  list_element *action;
 
   // Because match_to_string() is costly, we check logging_level first.
   if ( get_logging_level() >= LOG_DEBUG ) {
@@ -589,16 +626,10 @@ create_flow_mod( const uint32_t transaction_id, const struct ofp_match match,
            buffer_id, out_port, flags  );
   }
 
-  if ( actions != NULL ) {
-    debug( "# of actions = %d.", actions->n_actions );
-    actions_length = get_actions_length( actions );
-  }
-
   length = ( uint16_t ) ( offsetof( struct ofp_flow_mod, actions ) + actions_length );
-  buffer = create_header( transaction_id, OFPT_FLOW_MOD, length );
-  assert( buffer != NULL );
+  init_header( buf, transaction_id, OFPT_FLOW_MOD, length );
 
-  flow_mod = ( struct ofp_flow_mod * ) buffer->data;
+  flow_mod = ( struct ofp_flow_mod * ) buf->data;
   hton_match( &flow_mod->match, &m );
   flow_mod->cookie = htonll( cookie );
   flow_mod->command = htons( command );
@@ -609,8 +640,37 @@ create_flow_mod( const uint32_t transaction_id, const struct ofp_match match,
   flow_mod->out_port = htons( out_port );
   flow_mod->flags = htons( flags );
 
+  // actions are filled in by the caller
+  return flow_mod;
+}
+
+
+buffer *
+create_flow_mod( const uint32_t transaction_id, const struct ofp_match match,
+                 const uint64_t cookie, const uint16_t command,
+                 const uint16_t idle_timeout, const uint16_t hard_timeout,
+                 const uint16_t priority, const uint32_t buffer_id,
+                 const uint16_t out_port, const uint16_t flags,
+                 const openflow_actions *actions ) {
+  void *a;
+  uint16_t action_length = 0;
+  uint16_t actions_length = 0;
+  buffer *buffer;
+  struct ofp_flow_mod *flow_mod;
+  struct ofp_action_header *action_header;
+  list_element *action;
+
+  if ( actions != NULL ) {
+    debug( "# of actions = %d.", actions->n_actions );
+    actions_length = get_actions_length( actions );
+  }
+
+  buffer = alloc_buffer();
+  flow_mod = init_flow_mod( buffer, transaction_id, match, cookie, command, idle_timeout, hard_timeout,
+                            priority, buffer_id, out_port, flags, actions_length );
+
   if ( actions_length > 0 ) {
-    a = ( void * ) ( ( char * ) buffer->data + offsetof( struct ofp_flow_mod, actions ) );
+    a = ( void * ) flow_mod->actions;
 
     action = actions->list;
     while ( action != NULL ) {
@@ -626,6 +686,117 @@ create_flow_mod( const uint32_t transaction_id, const struct ofp_match match,
 }
 
 
+/**
+ * Same as create_flow_mod() except that the flow_mod is built into buf,
+ * reusing its space, and the actions are taken from an action builder. No
+ * memory is allocated once buf has grown large enough.
+ */
+buffer *
+create_flow_mod_into( buffer *buf, const uint32_t transaction_id, const struct ofp_match match,
+                      const uint64_t cookie, const uint16_t command,
+                      const uint16_t idle_timeout, const uint16_t hard_timeout,
+                      const uint16_t priority, const uint32_t buffer_id,
+                      const uint16_t out_port, const uint16_t flags,
+                      const openflow_action_builder *actions ) {
+  assert( buf != NULL );
+
+  uint16_t actions_length = ( actions != NULL ) ? actions->length : 0;
+  struct ofp_flow_mod *flow_mod = init_flow_mod( buf, transaction_id, match, cookie, command,
+                                                 idle_timeout, hard_timeout, priority, buffer_id,
+                                                 out_port, flags, actions_length );
+  if ( actions_length > 0 ) {
+    memcpy( flow_mod->actions, actions->actions, actions_length );
+  }
+
+  return buf;
+}
+
+
+/**
+ * Same as create_packet_out_into() except that the actions are taken from a
+ * compiled action list.
+ */
+buffer *
+create_packet_out_with_compiled_actions( buffer *buf, const uint32_t transaction_id,
+                                         const uint32_t buffer_id, const uint16_t in_port,
+                                         const compiled_actions *actions, const buffer *data ) {
+  assert( buf != NULL );
+
+  uint16_t actions_length = ( actions != NULL ) ? actions->length : 0;
+  struct ofp_packet_out *packet_out = init_packet_out( buf, transaction_id, buffer_id, in_port,
+                                                       actions_length, data );
+  if ( actions_length > 0 ) {
+    memcpy( packet_out->actions, actions->actions, actions_length );
+  }
+
+  return buf;
+}
+
+
+/**
+ * Serializes a flow_mod with a wildcard-all match into a template. The
+ * actions are copied, so they may be released right after this call. Use
+ * create_flow_mod_from_template() to fill in the per-packet fields.
+ */
+flow_mod_template *
+create_flow_mod_template( const uint64_t cookie, const uint16_t command,
+                          const uint16_t idle_timeout, const uint16_t hard_timeout,
+                          const uint16_t priority, const uint16_t out_port,
+                          const uint16_t flags, const compiled_actions *actions ) {
+  struct ofp_match match;
+  memset( &match, 0, sizeof( struct ofp_match ) );
+  match.wildcards = OFPFW_ALL;
+
+  uint16_t actions_length = ( actions != NULL ) ? actions->length : 0;
+  flow_mod_template *template = xmalloc( sizeof( flow_mod_template ) );
+  template->message = alloc_buffer();
+  struct ofp_flow_mod *flow_mod = init_flow_mod( template->message, 0, match, cookie, command,
+                                                 idle_timeout, hard_timeout, priority, UINT32_MAX,
+                                                 out_port, flags, actions_length );
+  if ( actions_length > 0 ) {
+    memcpy( flow_mod->actions, actions->actions, actions_length );
+  }
+
+  return template;
+}
+
+
+void
+delete_flow_mod_template( flow_mod_template *template ) {
+  assert( template != NULL );
+
+  free_buffer( template->message );
+  xfree( template );
+}
+
+
+/**
+ * Copies a flow_mod template into buf, reusing its space, and patches the
+ * transaction id, match and buffer_id. No action is converted and no
+ * memory is allocated once buf has grown large enough.
+ */
+buffer *
+create_flow_mod_from_template( buffer *buf, const flow_mod_template *template,
+                               const uint32_t transaction_id, const struct ofp_match match,
+                               const uint32_t buffer_id ) {
+  assert( buf != NULL );
+  assert( template != NULL );
+
+  size_t length = template->message->length;
+  reset_buffer( buf );
+  struct ofp_flow_mod *flow_mod = append_back_buffer( buf, length );
+  memcpy( flow_mod, template->message->data, length );
+
+  struct ofp_match m = match;
+  flow_mod->header.xid = htonl( transaction_id );
+  hton_match( &flow_mod->match, &m );
+  flow_mod->buffer_id = htonl( buffer_id );
+  mark_buffer_built_by_library( buf );
+
+  return buf;
+}
+
+
 buffer *
 create_port_mod( const uint32_t transaction_id, const uint16_t port_no,
                  const uint8_t hw_addr[ OFP_ETH_ALEN ], const uint32_t config,
@@ -1657,6 +1828,256 @@ append_action_vendor( openflow_actions *actions, const uint32_t vendor, const bu
 }
 
 
+/**
+ * Empties an action builder. Actions added with build_action_*() are
+ * converted to network byte order at once, and are copied as they are by
+ * create_flow_mod_into() and create_packet_out_into().
+ */
+void
+init_action_builder( openflow_action_builder *actions ) {
+  assert( actions != NULL );
+
+  actions->n_actions = 0;
+  actions->length = 0;
+}
+
+
+static bool
+build_action( openflow_action_builder *actions, const struct ofp_action_header *action ) {
+  assert( actions != NULL );
+  assert( action != NULL );
+
+  if ( ( size_t ) actions->length + action->len > sizeof( actions->actions ) ) {
+    debug( "Too many actions ( # of actions = %d, actions length = %u ).", actions->n_actions, actions->length );
+    return false;
+  }
+
+  hton_action( ( struct ofp_action_header * ) ( ( char * ) actions->actions + actions->length ), action );
+  actions->length = ( uint16_t ) ( actions->length + action->len );
+  actions->n_actions++;
+
+  return true;
+}
+
+
+bool
+build_action_output( openflow_action_builder *actions, const uint16_t port, const uint16_t max_len ) {
+  struct ofp_action_output action_output;
+
+  memset( &action_output, 0, sizeof( struct ofp_action_output ) );
+  action_output.type = OFPAT_OUTPUT;
+  action_output.len = sizeof( struct ofp_action_output );
+  action_output.port = port;
+  action_output.max_len = max_len;
+
+  return build_action( actions, ( struct ofp_action_header * ) &action_output );
+}
+
+
+bool
+build_action_set_vlan_vid( openflow_action_builder *actions, const uint16_t vlan_vid ) {
+  struct ofp_action_vlan_vid action_vlan_vid;
+
+  assert( ( vlan_vid & ~VLAN_VID_MASK ) == 0 );
+
+  memset( &action_vlan_vid, 0, sizeof( struct ofp_action_vlan_vid ) );
+  action_vlan_vid.type = OFPAT_SET_VLAN_VID;
+  action_vlan_vid.len = sizeof( struct ofp_action_vlan_vid );
+  action_vlan_vid.vlan_vid = vlan_vid;
+
+  return build_action( actions, ( struct ofp_action_header * ) &action_vlan_vid );
+}
+
+
+bool
+build_action_set_vlan_pcp( openflow_action_builder *actions, const uint8_t vlan_pcp ) {
+  struct ofp_action_vlan_pcp action_vlan_pcp;
+
+  assert( ( vlan_pcp & ~VLAN_PCP_MASK ) == 0 );
+
+  memset( &action_vlan_pcp, 0, sizeof( struct ofp_action_vlan_pcp ) );
+  action_vlan_pcp.type = OFPAT_SET_VLAN_PCP;
+  action_vlan_pcp.len = sizeof( struct ofp_action_vlan_pcp );
+  action_vlan_pcp.vlan_pcp = vlan_pcp;
+
+  return build_action( actions, ( struct ofp_action_header * ) &action_vlan_pcp );
+}
+
+
+bool
+build_action_strip_vlan( openflow_action_builder *actions ) {
+  struct ofp_action_header action_strip_vlan;
+
+  memset( &action_strip_vlan, 0, sizeof( struct ofp_action_header ) );
+  action_strip_vlan.type = OFPAT_STRIP_VLAN;
+  action_strip_vlan.len = sizeof( struct ofp_action_header );
+
+  return build_action( actions, &action_strip_vlan );
+}
+
+
+static bool
+build_action_set_dl_addr( openflow_action_builder *actions, const uint16_t type,
+                          const uint8_t hw_addr[ OFP_ETH_ALEN ] ) {
+  struct ofp_action_dl_addr action_dl_addr;
+
+  memset( &action_dl_addr, 0, sizeof( struct ofp_action_dl_addr ) );
+  action_dl_addr.type = type;
+  action_dl_addr.len = sizeof( struct ofp_action_dl_addr );
+  memcpy( action_dl_addr.dl_addr, hw_addr, OFP_ETH_ALEN );
+
+  return build_action( actions, ( struct ofp_action_header * ) &action_dl_addr );
+}
+
+
+bool
+build_action_set_dl_src( openflow_action_builder *actions, const uint8_t hw_addr[ OFP_ETH_ALEN ] ) {
+  return build_action_set_dl_addr( actions, OFPAT_SET_DL_SRC, hw_addr );
+}
+
+
+bool
+build_action_set_dl_dst( openflow_action_builder *actions, const uint8_t hw_addr[ OFP_ETH_ALEN ] ) {
+  return build_action_set_dl_addr( actions, OFPAT_SET_DL_DST, hw_addr );
+}
+
+
+static bool
+build_action_set_nw_addr( openflow_action_builder *actions, const uint16_t type, const uint32_t nw_addr ) {
+  struct ofp_action_nw_addr action_nw_addr;
+
+  memset( &action_nw_addr, 0, sizeof( struct ofp_action_nw_addr ) );
+  action_nw_addr.type = type;
+  action_nw_addr.len = sizeof( struct ofp_action_nw_addr );
+  action_nw_addr.nw_addr = nw_addr;
+
+  return build_action( actions, ( struct ofp_action_header * ) &action_nw_addr );
+}
+
+
+bool
+build_action_set_nw_src( openflow_action_builder *actions, const uint32_t nw_addr ) {
+  return build_action_set_nw_addr( actions, OFPAT_SET_NW_SRC, nw_addr );
+}
+
+
+bool
+build_action_set_nw_dst( openflow_action_builder *actions, const uint32_t nw_addr ) {
+  return build_action_set_nw_addr( actions, OFPAT_SET_NW_DST, nw_addr );
+}
+
+
+bool
+build_action_set_nw_tos( openflow_action_builder *actions, const uint8_t nw_tos ) {
+  struct ofp_action_nw_tos action_nw_tos;
+
+  assert( ( nw_tos & ~NW_TOS_MASK ) == 0 );
+
+  memset( &action_nw_tos, 0, sizeof( struct ofp_action_nw_tos ) );
+  action_nw_tos.type = OFPAT_SET_NW_TOS;
+  action_nw_tos.len = sizeof( struct ofp_action_nw_tos );
+  action_nw_tos.nw_tos = nw_tos;
+
+  return build_action( actions, ( struct ofp_action_header * ) &action_nw_tos );
+}
+
+
+static bool
+build_action_set_tp_port( openflow_action_builder *actions, const uint16_t type, const uint16_t tp_port ) {
+  struct ofp_action_tp_port action_tp_port;
+
+  memset( &action_tp_port, 0, sizeof( struct ofp_action_tp_port ) );
+  action_tp_port.type = type;
+  action_tp_port.len = sizeof( struct ofp_action_tp_port );
+  action_tp_port.tp_port = tp_port;
+
+  return build_action( actions, ( struct ofp_action_header * ) &action_tp_port );
+}
+
+
+bool
+build_action_set_tp_src( openflow_action_builder *actions, const uint16_t tp_port ) {
+  return build_action_set_tp_port( actions, OFPAT_SET_TP_SRC, tp_port );
+}
+
+
+bool
+build_action_set_tp_dst( openflow_action_builder *actions, const uint16_t tp_port ) {
+  return build_action_set_tp_port( actions, OFPAT_SET_TP_DST, tp_port );
+}
+
+
+bool
+build_action_enqueue( openflow_action_builder *actions, const uint16_t port, const uint32_t queue_id ) {
+  struct ofp_action_enqueue action_enqueue;
+
+  memset( &action_enqueue, 0, sizeof( struct ofp_action_enqueue ) );
+  action_enqueue.type = OFPAT_ENQUEUE;
+  action_enqueue.len = sizeof( struct ofp_action_enqueue );
+  action_enqueue.port = port;
+  action_enqueue.queue_id = queue_id;
+
+  return build_action( actions, ( struct ofp_action_header * ) &action_enqueue );
+}
+
+
+/**
+ * Converts an action list into an immutable, network byte order action
+ * list that can be shared between messages. The returned list holds one
+ * reference and is freed when release_compiled_actions() drops the last.
+ */
+compiled_actions *
+compile_actions( const openflow_actions *actions ) {
+  assert( actions != NULL );
+
+  compiled_actions *compiled = xmalloc( sizeof( compiled_actions ) );
+  compiled->n_actions = actions->n_actions;
+  compiled->length = get_actions_length( actions );
+  compiled->reference_count = 1;
+  compiled->actions = NULL;
+  if ( compiled->length > 0 ) {
+    compiled->actions = xmalloc( compiled->length );
+  }
+
+  char *a = compiled->actions;
+  for ( list_element *action = actions->list; action != NULL; action = action->next ) {
+    struct ofp_action_header *action_header = action->data;
+    hton_action( ( struct ofp_action_header * ) a, action_header );
+    a += action_header->len;
+  }
+
+  debug( "Actions are compiled ( # of actions = %d, length = %u ).", compiled->n_actions, compiled->length );
+
+  return compiled;
+}
+
+
+compiled_actions *
+hold_compiled_actions( compiled_actions *actions ) {
+  assert( actions != NULL );
+  assert( actions->reference_count > 0 );
+
+  actions->reference_count++;
+
+  return actions;
+}
+
+
+void
+release_compiled_actions( compiled_actions *actions ) {
+  assert( actions != NULL );
+  assert( actions->reference_count > 0 );
+
+  if ( --actions->reference_count > 0 ) {
+    return;
+  }
+  if ( actions->actions != NULL ) {
+    xfree( actions->actions );
+  }
+  xfree( actions );
+}
+
+
 static int
 validate_header( const buffer *message, const uint8_t type,
                  const uint16_t min_length, const uint16_t max_length ) {
@@ -3115,44 +3536,104 @@ validate_queue_get_config_reply( const buffer *message ) {
 }
 
 
+static int
+validate_action_output_port( const struct ofp_action_header *action ) {
+  return validate_phy_port_no( ntohs( ( ( const struct ofp_action_output * ) action )->port ) );
+}
+
+
+static int
+validate_action_vlan_vid_value( const struct ofp_action_header *action ) {
+  return validate_vlan_vid( ntohs( ( ( const struct ofp_action_vlan_vid * ) action )->vlan_vid ) );
+}
+
+
+static int
+validate_action_vlan_pcp_value( const struct ofp_action_header *action ) {
+  return validate_vlan_pcp( ( ( const struct ofp_action_vlan_pcp * ) action )->vlan_pcp );
+}
+
+
+static int
+validate_action_nw_tos_value( const struct ofp_action_header *action ) {
+  return validate_nw_tos( ( ( const struct ofp_action_nw_tos * ) action )->nw_tos );
+}
+
+
+static int
+validate_action_enqueue_port( const struct ofp_action_header *action ) {
+  return validate_phy_port_no( ntohs( ( ( const struct ofp_action_enqueue * ) action )->port ) );
+}
+
+
+/*
+ * Length and field checks for each action type, which are the same as
+ * validate_action_*() but done in place without converting byte order.
+ */
+static const struct action_validator {
+  uint16_t length;
+  int too_short;
+  int too_long;
+  int ( *validate_fields )( const struct ofp_action_header *action );
+} action_validators[] = {
+  [ OFPAT_OUTPUT ] = { sizeof( struct ofp_action_output ), ERROR_TOO_SHORT_ACTION_OUTPUT,
+                       ERROR_TOO_LONG_ACTION_OUTPUT, validate_action_output_port },
+  [ OFPAT_SET_VLAN_VID ] = { sizeof( struct ofp_action_vlan_vid ), ERROR_TOO_SHORT_ACTION_VLAN_VID,
+                             ERROR_TOO_LONG_ACTION_VLAN_VID, validate_action_vlan_vid_value },
+  [ OFPAT_SET_VLAN_PCP ] = { sizeof( struct ofp_action_vlan_pcp ), ERROR_TOO_SHORT_ACTION_VLAN_PCP,
+                             ERROR_TOO_LONG_ACTION_VLAN_PCP, validate_action_vlan_pcp_value },
+  [ OFPAT_STRIP_VLAN ] = { sizeof( struct ofp_action_header ), ERROR_TOO_SHORT_ACTION_STRIP_VLAN,
+                           ERROR_TOO_LONG_ACTION_STRIP_VLAN, NULL },
+  [ OFPAT_SET_DL_SRC ] = { sizeof( struct ofp_action_dl_addr ), ERROR_TOO_SHORT_ACTION_DL_SRC,
+                           ERROR_TOO_LONG_ACTION_DL_SRC, NULL },
+  [ OFPAT_SET_DL_DST ] = { sizeof( struct ofp_action_dl_addr ), ERROR_TOO_SHORT_ACTION_DL_DST,
+                           ERROR_TOO_LONG_ACTION_DL_DST, NULL },
+  [ OFPAT_SET_NW_SRC ] = { sizeof( struct ofp_action_nw_addr ), ERROR_TOO_SHORT_ACTION_NW_SRC,
+                           ERROR_TOO_LONG_ACTION_NW_SRC, NULL },
+  [ OFPAT_SET_NW_DST ] = { sizeof( struct ofp_action_nw_addr ), ERROR_TOO_SHORT_ACTION_NW_DST,
+                           ERROR_TOO_LONG_ACTION_NW_DST, NULL },
+  [ OFPAT_SET_NW_TOS ] = { sizeof( struct ofp_action_nw_tos ), ERROR_TOO_SHORT_ACTION_NW_TOS,
+                           ERROR_TOO_LONG_ACTION_NW_TOS, validate_action_nw_tos_value },
+  [ OFPAT_SET_TP_SRC ] = { sizeof( struct ofp_action_tp_port ), ERROR_TOO_SHORT_ACTION_TP_SRC,
+                           ERROR_TOO_LONG_ACTION_TP_SRC, NULL },
+  [ OFPAT_SET_TP_DST ] = { sizeof( struct ofp_action_tp_port ), ERROR_TOO_SHORT_ACTION_TP_DST,
+                           ERROR_TOO_LONG_ACTION_TP_DST, NULL },
+  [ OFPAT_ENQUEUE ] = { sizeof( struct ofp_action_enqueue ), ERROR_TOO_SHORT_ACTION_ENQUEUE,
+                        ERROR_TOO_LONG_ACTION_ENQUEUE, validate_action_enqueue_port },
+};
+
+
 static int
 validate_action( struct ofp_action_header *action ) {
-  if ( ntohs( action->len ) < sizeof( struct ofp_action_header ) ) {
+  uint16_t length = ntohs( action->len );
+  if ( length < sizeof( struct ofp_action_header ) ) {
     return ERROR_TOO_SHORT_ACTION;
   }
 
-  switch ( ntohs( action->type ) ) {
-  case OFPAT_OUTPUT:
-    return validate_action_output( ( struct ofp_action_output * ) action );
-  case OFPAT_SET_VLAN_VID:
-    return validate_action_set_vlan_vid( ( struct ofp_action_vlan_vid * ) action );
-  case OFPAT_SET_VLAN_PCP:
-    return validate_action_set_vlan_pcp( ( struct ofp_action_vlan_pcp * ) action );
-  case OFPAT_STRIP_VLAN:
-    return validate_action_strip_vlan( ( struct ofp_action_header * ) action );
-  case OFPAT_SET_DL_SRC:
-    return validate_action_set_dl_src( ( struct ofp_action_dl_addr * ) action );
-  case OFPAT_SET_DL_DST:
-    return validate_action_set_dl_dst( ( struct ofp_action_dl_addr * ) action );
-  case OFPAT_SET_NW_SRC:
-    return validate_action_set_nw_src( ( struct ofp_action_nw_addr * ) action );
-  case OFPAT_SET_NW_DST:
-    return validate_action_set_nw_dst( ( struct ofp_action_nw_addr * ) action );
-  case OFPAT_SET_NW_TOS:
-    return validate_action_set_nw_tos( ( struct ofp_action_nw_tos * ) action );
-  case OFPAT_SET_TP_SRC:
-    return validate_action_set_tp_src( ( struct ofp_action_tp_port * ) action );
-  case OFPAT_SET_TP_DST:
-    return validate_action_set_tp_dst( ( struct ofp_action_tp_port * ) action );
-  case OFPAT_ENQUEUE:
-    return validate_action_enqueue( ( struct ofp_action_enqueue * ) action );
-  case OFPAT_VENDOR:
-    return validate_action_vendor( ( struct ofp_action_vendor_header * ) action );
-  default:
-    break;
+  uint16_t type = ntohs( action->type );
+  if ( type == OFPAT_VENDOR ) {
+    // only the minimum length is checked for vendor actions
+    if ( length < sizeof( struct ofp_action_vendor_header ) ) {
+      return ERROR_TOO_SHORT_ACTION_VENDOR;
+    }
+    return 0;
+  }
+  if ( type >= sizeof( action_validators ) / sizeof( action_validators[ 0 ] ) ) {
+    return ERROR_UNDEFINED_ACTION_TYPE;
   }
 
-  return ERROR_UNDEFINED_ACTION_TYPE;
+  const struct action_validator *validator = &action_validators[ type ];
+  if ( length < validator->length ) {
+    return validator->too_short;
+  }
+  if ( length > validator->length ) {
+    return validator->too_long;
+  }
+  if ( validator->validate_fields != NULL ) {
+    return validator->validate_fields( action );
+  }
+
+  return 0;
 }
 
 
@@ -3469,6 +3950,32 @@ validate_action_vendor( const struct ofp_action_vendor_header *action ) {
 }
 
 
+static int ( *const message_validators[] )( const buffer *message ) = {
+  [ OFPT_HELLO ] = validate_hello,
+  [ OFPT_ERROR ] = validate_error,
+  [ OFPT_ECHO_REQUEST ] = validate_echo_request,
+  [ OFPT_ECHO_REPLY ] = validate_echo_reply,
+  [ OFPT_VENDOR ] = validate_vendor,
+  [ OFPT_FEATURES_REQUEST ] = validate_features_request,
+  [ OFPT_FEATURES_REPLY ] = validate_features_reply,
+  [ OFPT_GET_CONFIG_REQUEST ] = validate_get_config_request,
+  [ OFPT_GET_CONFIG_REPLY ] = validate_get_config_reply,
+  [ OFPT_SET_CONFIG ] = validate_set_config,
+  [ OFPT_PACKET_IN ] = validate_packet_in,
+  [ OFPT_FLOW_REMOVED ] = validate_flow_removed,
+  [ OFPT_PORT_STATUS ] = validate_port_status,
+  [ OFPT_PACKET_OUT ] = validate_packet_out,
+  [ OFPT_FLOW_MOD ] = validate_flow_mod,
+  [ OFPT_PORT_MOD ] = validate_port_mod,
+  [ OFPT_STATS_REQUEST ] = validate_stats_request,
+  [ OFPT_STATS_REPLY ] = validate_stats_reply,
+  [ OFPT_BARRIER_REQUEST ] = validate_barrier_request,
+  [ OFPT_BARRIER_REPLY ] = validate_barrier_reply,
+  [ OFPT_QUEUE_GET_CONFIG_REQUEST ] = validate_queue_get_config_request,
+  [ OFPT_QUEUE_GET_CONFIG_REPLY ] = validate_queue_get_config_reply,
+};
+
+
 int
 validate_openflow_message( const buffer *message ) {
   int ret;
@@ -3481,76 +3988,11 @@ validate_openflow_message( const buffer *message ) {
   debug( "Validating an OpenFlow message ( version = %#x, type = %#x, length = %u, xid = %#x ).",
          header->version, header->type, ntohs( header->length ), ntohl( header->xid ) );
 
-  switch ( header->type ) {
-  case OFPT_HELLO:
-    ret = validate_hello( message );
-    break;
-  case OFPT_ERROR:
-    ret = validate_error( message );
-    break;
-  case OFPT_ECHO_REQUEST:
-    ret = validate_echo_request( message );
-    break;
-  case OFPT_ECHO_REPLY:
-    ret = validate_echo_reply( message );
-    break;
-  case OFPT_VENDOR:
-    ret = validate_vendor( message );
-    break;
-  case OFPT_FEATURES_REQUEST:
-    ret = validate_features_request( message );
-    break;
-  case OFPT_FEATURES_REPLY:
-    ret = validate_features_reply( message );
-    break;
-  case OFPT_GET_CONFIG_REQUEST:
-    ret = validate_get_config_request( message );
-    break;
-  case OFPT_GET_CONFIG_REPLY:
-    ret = validate_get_config_reply( message );
-    break;
-  case OFPT_SET_CONFIG:
-    ret = validate_set_config( message );
-    break;
-  case OFPT_PACKET_IN:
-    ret = validate_packet_in( message );
-    break;
-  case OFPT_FLOW_REMOVED:
-    ret = validate_flow_removed( message );
-    break;
-  case OFPT_PORT_STATUS:
-    ret = validate_port_status( message );
-    break;
-  case OFPT_PACKET_OUT:
-    ret = validate_packet_out( message );
-    break;
-  case OFPT_FLOW_MOD:
-    ret = validate_flow_mod( message );
-    break;
-  case OFPT_PORT_MOD:
-    ret = validate_port_mod( message );
-    break;
-  case OFPT_STATS_REQUEST:
-    ret = validate_stats_request( message );
-    break;
-  case OFPT_STATS_REPLY:
-    ret = validate_stats_reply( message );
-    break;
-  case OFPT_BARRIER_REQUEST:
-    ret = validate_barrier_request( message );
-    break;
-  case OFPT_BARRIER_REPLY:
-    ret = validate_barrier_reply( message );
-    break;
-  case OFPT_QUEUE_GET_CONFIG_REQUEST:
-    ret = validate_queue_get_config_request( message );
-    break;
-  case OFPT_QUEUE_GET_CONFIG_REPLY:
-    ret = validate_queue_get_config_reply( message );
-    break;
-  default:
+  if ( header->type < sizeof( message_validators ) / sizeof( message_validators[ 0 ] ) ) {
+    ret = message_validators[ header->type ]( message );
+  }
+  else {
     ret = ERROR_UNDEFINED_TYPE;
-    break;
   }
 
   debug( "Validation completed ( ret = %d ).", ret );
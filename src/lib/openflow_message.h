@@ -38,6 +38,37 @@ typedef struct openflow_actions {
   list_element *list;
 } openflow_actions;
 
+/*
+ * A fixed-capacity list of OpenFlow actions, already in network byte
+ * order. It needs no memory allocation and can be built on the stack.
+ */
+#define OPENFLOW_ACTION_BUILDER_LENGTH 256
+typedef struct openflow_action_builder {
+  int n_actions;
+  uint16_t length;
+  uint64_t actions[ OPENFLOW_ACTION_BUILDER_LENGTH / sizeof( uint64_t ) ];
+} openflow_action_builder;
+
+/*
+ * An immutable list of OpenFlow actions, already in network byte order.
+ * Created by compile_actions() and shared by reference counting, so that a
+ * frequently used action list is converted only once.
+ */
+typedef struct compiled_actions {
+  int n_actions;
+  uint16_t length;
+  int reference_count;
+  void *actions;
+} compiled_actions;
+
+/*
+ * A flow_mod with every field but match, buffer_id and transaction id
+ * serialized in advance.
+ */
+typedef struct flow_mod_template {
+  buffer *message;
+} flow_mod_template;
+
 
 // Initialization
 bool init_openflow_message( void );
@@ -86,6 +117,40 @@ buffer *create_flow_mod(
   const uint16_t flags,
   const openflow_actions *actions
 );
+buffer *create_packet_out_into( buffer *buf, const uint32_t transaction_id,
+                                const uint32_t buffer_id, const uint16_t in_port,
+                                const openflow_action_builder *actions, const buffer *data );
+buffer *create_flow_mod_into(
+  buffer *buf,
+  const uint32_t transaction_id,
+  const struct ofp_match match,
+  const uint64_t cookie,
+  const uint16_t command,
+  const uint16_t idle_timeout,
+  const uint16_t hard_timeout,
+  const uint16_t priority,
+  const uint32_t buffer_id,
+  const uint16_t out_port,
+  const uint16_t flags,
+  const openflow_action_builder *actions
+);
+buffer *create_packet_out_with_compiled_actions( buffer *buf, const uint32_t transaction_id,
+                                                 const uint32_t buffer_id, const uint16_t in_port,
+                                                 const compiled_actions *actions, const buffer *data );
+flow_mod_template *create_flow_mod_template(
+  const uint64_t cookie,
+  const uint16_t command,
+  const uint16_t idle_timeout,
+  const uint16_t hard_timeout,
+  const uint16_t priority,
+  const uint16_t out_port,
+  const uint16_t flags,
+  const compiled_actions *actions
+);
+void delete_flow_mod_template( flow_mod_template *template );
+buffer *create_flow_mod_from_template( buffer *buf, const flow_mod_template *template,
+                                       const uint32_t transaction_id, const struct ofp_match match,
+                                       const uint32_t buffer_id );
 buffer *create_port_mod( const uint32_t transaction_id, const uint16_t port_no,
                          const uint8_t hw_addr[ OFP_ETH_ALEN ], const uint32_t config,
                          const uint32_t mask, const uint32_t advertise );
@@ -147,6 +212,23 @@ bool append_action_enqueue( openflow_actions *actions, const uint16_t port,
                             const uint32_t queue_id );
 bool append_action_vendor( openflow_actions *actions, const uint32_t vendor,
                            const buffer *data );
+void init_action_builder( openflow_action_builder *actions );
+bool build_action_output( openflow_action_builder *actions, const uint16_t port, const uint16_t max_len );
+bool build_action_set_vlan_vid( openflow_action_builder *actions, const uint16_t vlan_vid );
+bool build_action_set_vlan_pcp( openflow_action_builder *actions, const uint8_t vlan_pcp );
+bool build_action_strip_vlan( openflow_action_builder *actions );
+bool build_action_set_dl_src( openflow_action_builder *actions, const uint8_t hw_addr[ OFP_ETH_ALEN ] );
+bool build_action_set_dl_dst( openflow_action_builder *actions, const uint8_t hw_addr[ OFP_ETH_ALEN ] );
+bool build_action_set_nw_src( openflow_action_builder *actions, const uint32_t nw_addr );
+bool build_action_set_nw_dst( openflow_action_builder *actions, const uint32_t nw_addr );
+bool build_action_set_nw_tos( openflow_action_builder *actions, const uint8_t nw_tos );
+bool build_action_set_tp_src( openflow_action_builder *actions, const uint16_t tp_port );
+bool build_action_set_tp_dst( openflow_action_builder *actions, const uint16_t tp_port );
+bool build_action_enqueue( openflow_action_builder *actions, const uint16_t port,
+                           const uint32_t queue_id );
+compiled_actions *compile_actions( const openflow_actions *actions );
+compiled_actions *hold_compiled_actions( compiled_actions *actions );
+void release_compiled_actions( compiled_actions *actions );
 
 
 // Return code definitions indicating the result of OpenFlow message validation.
@@ -33,6 +33,12 @@
 #define MESSENGER_OPENFLOW_READY 3
 #define MESSENGER_OPENFLOW_DISCONNECTED 4
 #define MESSENGER_OPENFLOW_DISCONNECT_REQUEST 5
+#define MESSENGER_OPENFLOW_PACKET_IN_THROTTLED 6
+#define MESSENGER_OPENFLOW_MESSAGES 7
+#define MESSENGER_OPENFLOW_LIVENESS_REQUEST 8
+#define MESSENGER_OPENFLOW_LIVENESS_REPLY 9
+#define MESSENGER_OPENFLOW_BUILT_MESSAGE 10
+#define MESSENGER_OPENFLOW_BUILT_MESSAGES 11
 
 
 /**
@@ -40,7 +46,12 @@
  * A null-terminated service name can be provided after service_name_len
  * and an OpenFlow message must be included in the rest of part in case of
  * MESSENGER_OPENFLOW_MESSAGE. service_name_length can be zero if service
- * name notification is not necessary.
+ * name notification is not necessary. In case of MESSENGER_OPENFLOW_MESSAGES,
+ * the rest is a sequence of OpenFlow messages that are sent to the switch
+ * in the same order. MESSENGER_OPENFLOW_BUILT_MESSAGE(S) are the same as
+ * MESSENGER_OPENFLOW_MESSAGE(S) except that all OpenFlow messages have been
+ * built by the library and not resized since. A switch daemon may skip
+ * validating them if the sender is trusted.
  */
 typedef struct openflow_service_header {
   uint64_t datapath_id;
@@ -48,6 +59,50 @@ typedef struct openflow_service_header {
 } __attribute__( ( packed ) ) openflow_service_header_t;
 
 
+/**
+ * Event body that follows the header in case of
+ * MESSENGER_OPENFLOW_PACKET_IN_THROTTLED. A switch daemon sends it when it
+ * starts ( throttled = 1 ) or stops ( throttled = 0 ) dropping packet_in
+ * messages that exceed the configured rate. in_port is OFPP_NONE if the
+ * limit for the whole switch is exceeded. dropped is the number of
+ * packet_in messages dropped while being throttled. All fields are in
+ * network byte order.
+ */
+typedef struct openflow_packet_in_throttled {
+  uint16_t in_port;
+  uint8_t throttled;
+  uint64_t dropped;
+} __attribute__( ( packed ) ) openflow_packet_in_throttled_t;
+
+
+/**
+ * Reply body that follows the header in case of
+ * MESSENGER_OPENFLOW_LIVENESS_REPLY. An application sends
+ * MESSENGER_OPENFLOW_LIVENESS_REQUEST with its service name and no body,
+ * and the switch daemon replies to that service. Round trip times are
+ * measured with echo requests in microseconds. rtt_histogram[ i ] counts
+ * round trips of at most 100, 200, 500 microseconds, 1, 2, 5, 10, 20, 50,
+ * 100, 200, 500 milliseconds, 1, 2, 5 seconds respectively, and the last
+ * one counts the rest. last_seen is the number of seconds since a message
+ * was received from the switch. All fields are zero if echo requests are
+ * disabled, and are in network byte order.
+ */
+#define OPENFLOW_LIVENESS_RTT_BUCKETS 16
+
+typedef struct openflow_liveness {
+  uint32_t echo_interval;
+  uint32_t last_seen;
+  uint64_t echo_requests;
+  uint64_t echo_replies;
+  uint64_t echo_missed;
+  uint32_t rtt_last;
+  uint32_t rtt_min;
+  uint32_t rtt_max;
+  uint32_t rtt_smoothed;
+  uint32_t rtt_histogram[ OPENFLOW_LIVENESS_RTT_BUCKETS ];
+} __attribute__( ( packed ) ) openflow_liveness_t;
+
+
 #endif // OPENFLOW_SERVICE_INTERFACE_H
 
 
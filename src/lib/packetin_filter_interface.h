@@ -0,0 +1,94 @@
+/*
+ * Packet-in filter management interface.
+ *
+ * Copyright (C) 2008-2011 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef PACKETIN_FILTER_INTERFACE_H
+#define PACKETIN_FILTER_INTERFACE_H
+
+
+#include <openflow.h>
+#include "messenger.h"
+
+
+/**
+ * Message type definitions for managing packet-in filter rules at runtime.
+ * Requests must be sent to the packet-in filter service with
+ * send_request_message(). Add and delete requests carry a
+ * packetin_filter_entries and are replied with a packetin_filter_reply.
+ * A dump request carries an optional packetin_filter_dump_request and is
+ * replied with a packetin_filter_entries that holds up to
+ * PACKETIN_FILTER_DUMP_PAGE_SIZE rules, starting from the offset in the
+ * request. A reply with fewer rules than that is the last page.
+ */
+#define MESSENGER_ADD_PACKETIN_FILTER_REQUEST 0x10
+#define MESSENGER_ADD_PACKETIN_FILTER_REPLY 0x11
+#define MESSENGER_DELETE_PACKETIN_FILTER_REQUEST 0x12
+#define MESSENGER_DELETE_PACKETIN_FILTER_REPLY 0x13
+#define MESSENGER_DUMP_PACKETIN_FILTER_REQUEST 0x14
+#define MESSENGER_DUMP_PACKETIN_FILTER_REPLY 0x15
+
+
+#define PACKETIN_FILTER_OPERATION_SUCCEEDED 0
+#define PACKETIN_FILTER_OPERATION_FAILED 1
+
+#define PACKETIN_FILTER_DUMP_PAGE_SIZE 1024
+
+
+/**
+ * A rule. Packet-in messages that match the match are forwarded to the
+ * service. All fields are in network byte order and service_name must be
+ * null-terminated.
+ */
+typedef struct packetin_filter_entry {
+  struct ofp_match match;
+  uint16_t priority;
+  char service_name[ MESSENGER_SERVICE_NAME_LENGTH ];
+} __attribute__( ( packed ) ) packetin_filter_entry;
+
+
+/**
+ * A set of rules. All rules in an add or delete request are applied
+ * atomically; if any of them is invalid, nothing is applied.
+ */
+typedef struct packetin_filter_entries {
+  uint16_t n_entries;
+  packetin_filter_entry entries[ 0 ];
+} __attribute__( ( packed ) ) packetin_filter_entries;
+
+
+typedef struct packetin_filter_dump_request {
+  uint32_t offset; // number of rules to skip
+} __attribute__( ( packed ) ) packetin_filter_dump_request;
+
+
+typedef struct packetin_filter_reply {
+  uint8_t status;
+  uint16_t n_entries; // number of rules applied
+} __attribute__( ( packed ) ) packetin_filter_reply;
+
+
+#endif // PACKETIN_FILTER_INTERFACE_H
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
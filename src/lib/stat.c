@@ -62,6 +62,7 @@ void mock_error( const char *format, ... );
 
 static hash_table *stats = NULL;
 static pthread_mutex_t stats_table_mutex = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static stat_counters *counters_list = NULL;
 
 
 typedef struct {
@@ -120,6 +121,7 @@ finalize_stat() {
 
   pthread_mutex_lock( &stats_table_mutex );
   delete_stats_table();
+  counters_list = NULL;
   pthread_mutex_unlock( &stats_table_mutex );
 
   return true;
@@ -177,6 +179,107 @@ increment_stat( const char *key ) {
 }
 
 
+void
+set_stat( const char *key, uint64_t value ) {
+  assert( key != NULL );
+  assert( stats != NULL );
+
+  pthread_mutex_lock( &stats_table_mutex );
+
+  stat_entry *entry = lookup_hash_entry( stats, key );
+  if ( entry == NULL ) {
+    if ( add_stat_entry( key ) == false ) {
+      pthread_mutex_unlock( &stats_table_mutex );
+      return;
+    }
+    entry = lookup_hash_entry( stats, key );
+  }
+
+  assert( entry != NULL );
+
+  entry->value = value;
+
+  pthread_mutex_unlock( &stats_table_mutex );
+}
+
+
+void
+add_stat_counters( stat_counters *counters ) {
+  assert( counters != NULL );
+  assert( counters->values != NULL );
+  assert( counters->name != NULL );
+
+  pthread_mutex_lock( &stats_table_mutex );
+
+  stat_counters *c;
+  for ( c = counters_list; c != NULL; c = c->next ) {
+    if ( c == counters ) {
+      pthread_mutex_unlock( &stats_table_mutex );
+      return;
+    }
+  }
+  counters->next = counters_list;
+  counters_list = counters;
+
+  pthread_mutex_unlock( &stats_table_mutex );
+}
+
+
+void
+delete_stat_counters( stat_counters *counters ) {
+  assert( counters != NULL );
+
+  pthread_mutex_lock( &stats_table_mutex );
+
+  stat_counters **c;
+  for ( c = &counters_list; *c != NULL; c = &( *c )->next ) {
+    if ( *c == counters ) {
+      *c = counters->next;
+      counters->next = NULL;
+      break;
+    }
+  }
+
+  pthread_mutex_unlock( &stats_table_mutex );
+}
+
+
+void
+increment_stat_counter( stat_counters *counters, unsigned int index ) {
+  assert( counters != NULL );
+  assert( index < counters->n_values );
+
+  __sync_fetch_and_add( &counters->values[ index ], 1 );
+}
+
+
+/*
+ * Copies non-zero counters to named statistics. Called by dump_stats(),
+ * and by anything else that reads statistics by name.
+ */
+void
+publish_stat_counters() {
+  assert( stats != NULL );
+
+  pthread_mutex_lock( &stats_table_mutex );
+
+  char key[ STAT_KEY_LENGTH ];
+  stat_counters *c;
+  for ( c = counters_list; c != NULL; c = c->next ) {
+    unsigned int i;
+    for ( i = 0; i < c->n_values; i++ ) {
+      if ( c->values[ i ] == 0 ) {
+        continue;
+      }
+      c->name( i, key, sizeof( key ) );
+      set_stat( key, c->values[ i ] );
+    }
+  }
+
+  pthread_mutex_unlock( &stats_table_mutex );
+}
+
+
 void
 dump_stats() {
   assert( stats != NULL );
@@ -185,6 +288,8 @@ dump_stats() {
   hash_iterator iter;
   hash_entry *e;
 
+  publish_stat_counters();
+
   pthread_mutex_lock( &stats_table_mutex );
 
   info( "Statistics:" );
@@ -21,16 +21,40 @@
 
 
 #ifndef STAT_H
+#define STAT_H
+
+
+#include <stddef.h>
+#include <stdint.h>
 
 
 #define STAT_KEY_LENGTH 256
 
 
+/*
+ * A fixed array of counters owned by a module. A counter is incremented by
+ * index, without a lock or a key lookup, and is published under the name
+ * given by name() only when statistics are dumped. Counters that are
+ * still zero are not published.
+ */
+typedef struct stat_counters {
+  uint64_t *values;
+  unsigned int n_values;
+  void ( *name )( unsigned int index, char *name, size_t length );
+  struct stat_counters *next;
+} stat_counters;
+
+
 bool init_stat( void );
 bool finalize_stat( void );
 bool add_stat_entry( const char *key );
 void increment_stat( const char *key );
+void set_stat( const char *key, uint64_t value );
 void dump_stats();
+void add_stat_counters( stat_counters *counters );
+void delete_stat_counters( stat_counters *counters );
+void increment_stat_counter( stat_counters *counters, unsigned int index );
+void publish_stat_counters( void );
 
 
 #endif // STAT_H
@@ -358,7 +358,7 @@ parse_argv( int *argc, char ***argv ) {
   assert( argv != NULL );
 
   int argc_tmp = *argc;
-  char *new_argv[ *argc ];
+  char *new_argv[ *argc + 1 ];
 
   run_as_daemon = false;
 
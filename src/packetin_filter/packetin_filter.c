@@ -22,9 +22,11 @@
 
 #include <getopt.h>
 #include <openflow.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <unistd.h>
 #include "etherip.h"
+#include "packetin_filter_interface.h"
 #include "trema.h"
 
 
@@ -80,6 +82,28 @@ match_entry *mock_lookup_match_entry( struct ofp_match *match );
 bool mock_send_message( const char *service_name, const uint16_t tag, const void *data,
                         size_t len );
 
+#ifdef add_message_received_callback
+#undef add_message_received_callback
+#endif
+#define add_message_received_callback mock_add_message_received_callback
+bool mock_add_message_received_callback( const char *service_name,
+                                         void ( *callback )( uint16_t tag, void *data, size_t len ) );
+
+#ifdef add_message_requested_callback
+#undef add_message_requested_callback
+#endif
+#define add_message_requested_callback mock_add_message_requested_callback
+bool mock_add_message_requested_callback( const char *service_name,
+                                          void ( *callback )( const messenger_context_handle *handle,
+                                                              uint16_t tag, void *data, size_t len ) );
+
+#ifdef send_reply_message
+#undef send_reply_message
+#endif
+#define send_reply_message mock_send_reply_message
+bool mock_send_reply_message( const messenger_context_handle *handle, const uint16_t tag,
+                              const void *data, size_t len );
+
 #ifdef init_trema
 #undef init_trema
 #endif
@@ -104,9 +128,92 @@ void mock_start_trema( void );
 #define get_executable_name mock_get_executable_name
 const char *mock_get_executable_name( void );
 
+#ifdef get_trema_name
+#undef get_trema_name
+#endif
+#define get_trema_name mock_get_trema_name
+const char *mock_get_trema_name( void );
+
+#ifdef exit
+#undef exit
+#endif
+#define exit mock_exit
+void mock_exit( int status );
+
 #endif // UNIT_TESTING
 
 
+static struct option long_options[] = {
+  { "pass-through", 0, NULL, 'p' },
+  { "workers", 1, NULL, 'w' },
+  { "worker-queue-length", 1, NULL, 'q' },
+  { NULL, 0, NULL, 0  },
+};
+
+static char short_options[] = "pw:q:";
+
+static bool pass_through = false;
+
+
+#define MAX_WORKERS 64
+#define DEFAULT_WORKER_QUEUE_LENGTH 1024
+#define MAX_WORKER_QUEUE_LENGTH 1048576
+
+static const time_t WORKER_STATS_INTERVAL = 1;
+static const time_t WORKER_CHANNEL_RETRY_INTERVAL = 1;
+
+
+typedef struct packet_in_job {
+  struct packet_in_job *next;
+  size_t length;
+  uint8_t data[ 0 ]; // received message including service header
+} packet_in_job;
+
+
+typedef struct {
+  packet_in_job *head;
+  packet_in_job *tail;
+  unsigned int length;
+} job_queue;
+
+
+// a connection from a worker to a destination service
+typedef struct {
+  char *service_name;
+  messenger_channel *channel; // NULL while not connected
+  time_t retry_at;
+} worker_channel;
+
+
+typedef struct {
+  unsigned int id;
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  job_queue pending;
+  list_element *channels; // only used by the worker thread
+  // followings are protected by mutex
+  uint64_t received;
+  uint64_t overflowed; // not queued since the queue was full
+  uint64_t forwarded;
+  uint64_t dropped;
+  unsigned int max_queue_depth;
+} worker;
+
+
+static unsigned int n_workers = 0;
+static unsigned int worker_queue_length = DEFAULT_WORKER_QUEUE_LENGTH;
+static worker *workers = NULL;
+static bool workers_running = false;
+
+/*
+ * Workers look up the match table and send to services concurrently.
+ * Rule management requests are served on the main thread, which is the
+ * only writer, and apply a request with the lock held for writing.
+ */
+static pthread_rwlock_t rules_lock = PTHREAD_RWLOCK_INITIALIZER;
+
+
 void
 usage() {
   printf(
@@ -116,6 +223,10 @@ usage() {
 	 "  -n, --name=SERVICE_NAME     service name\n"
 	 "  -d, --daemonize             run in the background\n"
 	 "  -l, --logging_level=LEVEL   set logging level\n"
+	 "  -p, --pass-through          forward received packet_in messages as is\n"
+	 "  -w, --workers=N             classify packets in N threads ( implies -p )\n"
+	 "  -q, --worker-queue-length=N drop packets when N packets are queued to a\n"
+	 "                              worker ( default 1024 )\n"
 	 "  -h, --help                  display this help and exit\n"
 	 "\n"
 	 "PACKETIN-FILTER-RULE:\n"
@@ -131,38 +242,102 @@ usage() {
 }
 
 
-static buffer *
-parse_etherip( const buffer *data ) {
+/*
+ * Parses a frame that lies in memory owned by someone else, with a buffer
+ * on the caller's stack. release_frame() frees what parse_packet() attached.
+ */
+static bool
+parse_frame_in_place( buffer *frame, const void *data, size_t length ) {
+  frame->data = ( void * ) ( uintptr_t ) data;
+  frame->length = length;
+  frame->user_data = NULL;
+  frame->user_data_free_function = NULL;
+
+  return parse_packet( frame );
+}
+
+
+static void
+release_frame( buffer *frame ) {
+  if ( frame->user_data != NULL && frame->user_data_free_function != NULL ) {
+    ( *frame->user_data_free_function )( frame );
+  }
+}
+
+
+static bool
+parse_etherip( const buffer *data, buffer *inner ) {
   uint32_t hdr_len = ( uint32_t ) packet_info( data )->l3_data.ipv4->ihl * 4;
   if ( data->length < hdr_len + sizeof( etherip_header ) ) {
     debug( "too short etherip message" );
-    return NULL;
+    return false;
   }
 
   etherip_header *etherip = ( etherip_header * ) packet_info( data )->l4_data.l4;
   if ( etherip->version != htons( ETHERIP_VERSION ) ) {
     error( "invalid etherip version 0x%04x.", ntohs( etherip->version ) );
-    return NULL;
+    return false;
   }
-  buffer *copy = duplicate_buffer( data );
-  if ( copy == NULL ) {
-    error( "duplicate_buffer failed." );
-    return NULL;
+  size_t offset = ( size_t ) ( ( char * ) etherip - ( char * ) data->data );
+  offset += sizeof( etherip_header );
+  if ( offset >= data->length ) {
+    debug( "too short etherip message" );
+    return false;
   }
-  copy->user_data = NULL;
-  uint32_t offset = ( uint32_t ) ( ( char * ) etherip - ( char *) data->data );
-  offset += ( uint32_t ) sizeof( etherip_header );
-  remove_front_buffer( copy, offset );
 
-  if ( !parse_packet( copy ) ) {
+  // the encapsulated frame is parsed where it lies
+  if ( !parse_frame_in_place( inner, ( char * ) data->data + offset, data->length - offset ) ) {
     error( "parse_packet failed." );
-    free_buffer( copy );
-    return NULL;
+    release_frame( inner );
+    return false;
   }
 
   debug( "Receive EtherIP packet." );
 
-  return copy;
+  return true;
+}
+
+
+static void
+extract_match( struct ofp_match *ofp_match, uint16_t in_port, const buffer *data ) {
+  buffer inner;
+  bool encapsulated = false;
+  debug( "Receive packet. ethertype=%d, ipproto=%d", packet_info( data )->ethtype, packet_info( data )->ipproto );
+  if ( packet_info( data )->ethtype == ETH_ETHTYPE_IPV4
+       && packet_info( data )->ipproto == IPPROTO_ETHERIP ) {
+    encapsulated = parse_etherip( data, &inner );
+  }
+  set_match_from_packet( ofp_match, in_port, 0, encapsulated ? &inner : data );
+  if ( encapsulated ) {
+    release_frame( &inner );
+  }
+}
+
+
+static void
+send_to_services( match_entry *match_entry, struct ofp_match *ofp_match, const void *data, size_t length ) {
+  char match_str[ 1024 ];
+  bool debug_enabled = ( get_logging_level() >= LOG_DEBUG );
+
+  if ( debug_enabled ) {
+    match_to_string( ofp_match, match_str, sizeof( match_str ) );
+  }
+
+  list_element *element;
+  for ( element = match_entry->services_name; element != NULL; element = element->next ) {
+    const char *service_name = element->data;
+    if ( !send_message( service_name, MESSENGER_OPENFLOW_MESSAGE, data, length ) ) {
+      if ( !debug_enabled ) {
+        match_to_string( ofp_match, match_str, sizeof( match_str ) );
+      }
+      error( "Failed to send a message to %s ( match = %s ).", service_name, match_str );
+      return;
+    }
+
+    if ( debug_enabled ) {
+      debug( "Sending a message to %s ( match = %s ).", service_name, match_str );
+    }
+  }
 }
 
 
@@ -173,21 +348,8 @@ handle_packet_in( uint64_t datapath_id, uint32_t transaction_id,
                   void *user_data ) {
   UNUSED( user_data );
 
-  char match_str[ 1024 ];
   struct ofp_match ofp_match;   // host order
-
-  buffer *copy = NULL;
-  debug( "Receive packet. ethertype=%d, ipproto=%d", packet_info( data )->ethtype, packet_info( data )->ipproto );
-  if ( packet_info( data )->ethtype == ETH_ETHTYPE_IPV4
-       && packet_info( data )->ipproto == IPPROTO_ETHERIP ) {
-    copy = parse_etherip( data );
-  }
-  set_match_from_packet( &ofp_match, in_port, 0, copy != NULL ? copy : data );
-  if ( copy != NULL ) {
-    free_buffer( copy );
-    copy = NULL;
-  }
-  match_to_string( &ofp_match, match_str, sizeof( match_str ) );
+  extract_match( &ofp_match, in_port, data );
 
   match_entry *match_entry = lookup_match_entry( &ofp_match );
   if ( match_entry == NULL ) {
@@ -202,20 +364,587 @@ handle_packet_in( uint64_t datapath_id, uint32_t transaction_id,
   message = append_front_buffer( buf, sizeof( openflow_service_header_t ) );
   message->datapath_id = htonll( datapath_id );
   message->service_name_length = htons( 0 );
+
+  send_to_services( match_entry, &ofp_match, buf->data, buf->length );
+
+  free_buffer( buf );
+}
+
+
+/*
+ * Extracts a match from a packet_in message received from a switch daemon.
+ * The received bytes are never modified so that they can be forwarded
+ * as is.
+ */
+static bool
+classify_packet_in_message( const void *data, size_t length, struct ofp_match *ofp_match ) {
+  const openflow_service_header_t *message = data;
+  size_t header_length = sizeof( openflow_service_header_t ) + ntohs( message->service_name_length );
+  if ( length < header_length + offsetof( struct ofp_packet_in, data ) ) {
+    error( "Too short openflow application message ( length = %u ).", length );
+    return false;
+  }
+
+  const struct ofp_packet_in *packet_in = ( const struct ofp_packet_in * ) ( ( const char * ) data + header_length );
+  if ( packet_in->header.type != OFPT_PACKET_IN ) {
+    debug( "Unhandled OpenFlow message ( type = %u ).", packet_in->header.type );
+    return false;
+  }
+
+  size_t frame_length = length - header_length - offsetof( struct ofp_packet_in, data );
+  if ( frame_length == 0 ) {
+    debug( "Empty packet_in message." );
+    return false;
+  }
+
+  // parse the frame where it lies; the parser only reads it
+  buffer frame;
+  if ( !parse_frame_in_place( &frame, packet_in->data, frame_length ) ) {
+    error( "Failed to parse a packet." );
+    release_frame( &frame );
+    return false;
+  }
+
+  extract_match( ofp_match, ntohs( packet_in->in_port ), &frame );
+  release_frame( &frame );
+
+  return true;
+}
+
+
+static bool
+forward_packet_in_message( struct ofp_match *ofp_match, const void *data, size_t length ) {
+  match_entry *match_entry = lookup_match_entry( ofp_match );
+  if ( match_entry == NULL ) {
+    debug( "No match entry found." );
+    return false;
+  }
+
+  send_to_services( match_entry, ofp_match, data, length );
+
+  return true;
+}
+
+
+static void
+push_job( job_queue *queue, packet_in_job *job ) {
+  job->next = NULL;
+  if ( queue->head == NULL ) {
+    queue->head = job;
+  }
+  else {
+    queue->tail->next = job;
+  }
+  queue->tail = job;
+  queue->length++;
+}
+
+
+static packet_in_job *
+pop_job( job_queue *queue ) {
+  packet_in_job *job = queue->head;
+  if ( job == NULL ) {
+    return NULL;
+  }
+
+  queue->head = job->next;
+  if ( queue->head == NULL ) {
+    queue->tail = NULL;
+  }
+  queue->length--;
+
+  return job;
+}
+
+
+static worker_channel *
+lookup_worker_channel( worker *w, const char *service_name ) {
   list_element *element;
-  for ( element = match_entry->services_name; element != NULL; element = element->next ) {
-    const char *service_name = element->data;
-    if ( !send_message( service_name, MESSENGER_OPENFLOW_MESSAGE,
-                        buf->data, buf->length ) ) {
-      error( "Failed to send a message to %s ( match = %s ).", service_name, match_str );
-      free_buffer( buf );
-      return;
+  for ( element = w->channels; element != NULL; element = element->next ) {
+    worker_channel *wc = element->data;
+    if ( strcmp( wc->service_name, service_name ) == 0 ) {
+      return wc;
     }
-  
-    debug( "Sending a message to %s ( match = %s ).", service_name, match_str );
   }
 
-  free_buffer( buf );
+  worker_channel *wc = xmalloc( sizeof( worker_channel ) );
+  wc->service_name = xstrdup( service_name );
+  wc->channel = NULL;
+  wc->retry_at = 0;
+  insert_in_front( &w->channels, wc );
+
+  return wc;
+}
+
+
+/*
+ * Sends a message to a service over the worker's own connection, since
+ * the messenger send queues belong to the main thread. A service that
+ * refuses the connection is retried after a second.
+ */
+static bool
+send_from_worker( worker *w, const char *service_name, const void *data, size_t length ) {
+  worker_channel *wc = lookup_worker_channel( w, service_name );
+  if ( wc->channel == NULL ) {
+    time_t now = time( NULL );
+    if ( now < wc->retry_at ) {
+      return false;
+    }
+    wc->channel = open_messenger_channel( service_name );
+    if ( wc->channel == NULL ) {
+      wc->retry_at = now + WORKER_CHANNEL_RETRY_INTERVAL;
+      return false;
+    }
+  }
+
+  int ret = send_message_to_channel( wc->channel, MESSENGER_OPENFLOW_MESSAGE, data, length );
+  if ( ret < 0 ) {
+    close_messenger_channel( wc->channel );
+    wc->channel = NULL;
+  }
+
+  return ret > 0;
+}
+
+
+static bool
+forward_from_worker( worker *w, const void *data, size_t length ) {
+  struct ofp_match ofp_match;   // host order
+  if ( !classify_packet_in_message( data, length, &ofp_match ) ) {
+    return false;
+  }
+
+  bool forwarded = true;
+  pthread_rwlock_rdlock( &rules_lock );
+  match_entry *match_entry = lookup_match_entry( &ofp_match );
+  if ( match_entry == NULL ) {
+    debug( "No match entry found." );
+    forwarded = false;
+  }
+  else {
+    list_element *element;
+    for ( element = match_entry->services_name; element != NULL; element = element->next ) {
+      if ( !send_from_worker( w, element->data, data, length ) ) {
+        debug( "Failed to send a message to %s.", ( const char * ) element->data );
+        forwarded = false;
+      }
+    }
+  }
+  pthread_rwlock_unlock( &rules_lock );
+
+  return forwarded;
+}
+
+
+static void
+delete_worker_channels( worker *w ) {
+  while ( w->channels != NULL ) {
+    worker_channel *wc = w->channels->data;
+    delete_element( &w->channels, wc );
+    if ( wc->channel != NULL ) {
+      close_messenger_channel( wc->channel );
+    }
+    xfree( wc->service_name );
+    xfree( wc );
+  }
+}
+
+
+static void *
+worker_main( void *args ) {
+  worker *w = args;
+
+  debug( "Starting worker %u.", w->id );
+
+  create_list( &w->channels );
+  pthread_mutex_lock( &w->mutex );
+  for ( ;; ) {
+    while ( w->pending.head == NULL && workers_running ) {
+      pthread_cond_wait( &w->cond, &w->mutex );
+    }
+    packet_in_job *job = pop_job( &w->pending );
+    if ( job == NULL ) {
+      break;
+    }
+    pthread_mutex_unlock( &w->mutex );
+
+    bool forwarded = forward_from_worker( w, job->data, job->length );
+    xfree( job );
+
+    pthread_mutex_lock( &w->mutex );
+    if ( forwarded ) {
+      w->forwarded++;
+    }
+    else {
+      w->dropped++;
+    }
+  }
+  pthread_mutex_unlock( &w->mutex );
+  delete_worker_channels( w );
+
+  debug( "Worker %u stopped.", w->id );
+
+  return NULL;
+}
+
+
+/*
+ * Hands a packet_in message to a worker. Messages from the same datapath
+ * always go to the same worker so that per-switch ordering is preserved.
+ * A message is dropped if the worker already has worker_queue_length
+ * messages queued.
+ */
+static void
+dispatch_packet_in_message( const void *data, size_t length ) {
+  if ( length < sizeof( openflow_service_header_t ) ) {
+    error( "Too short openflow application message ( length = %u ).", length );
+    return;
+  }
+
+  const openflow_service_header_t *message = data;
+  worker *w = &workers[ ntohll( message->datapath_id ) % n_workers ];
+
+  // only the main thread adds jobs, so the queue cannot fill up meanwhile
+  pthread_mutex_lock( &w->mutex );
+  w->received++;
+  bool full = ( w->pending.length >= worker_queue_length );
+  if ( full ) {
+    w->overflowed++;
+  }
+  pthread_mutex_unlock( &w->mutex );
+  if ( full ) {
+    return;
+  }
+
+  packet_in_job *job = xmalloc( sizeof( packet_in_job ) + length );
+  job->length = length;
+  memcpy( job->data, data, length );
+
+  pthread_mutex_lock( &w->mutex );
+  push_job( &w->pending, job );
+  if ( w->pending.length > w->max_queue_depth ) {
+    w->max_queue_depth = w->pending.length;
+  }
+  pthread_cond_signal( &w->cond );
+  pthread_mutex_unlock( &w->mutex );
+}
+
+
+static void
+publish_worker_stats( void *user_data ) {
+  UNUSED( user_data );
+
+  char key[ STAT_KEY_LENGTH ];
+  for ( unsigned int i = 0; i < n_workers; i++ ) {
+    worker *w = &workers[ i ];
+
+    pthread_mutex_lock( &w->mutex );
+    uint64_t received = w->received;
+    uint64_t overflowed = w->overflowed;
+    uint64_t forwarded = w->forwarded;
+    uint64_t dropped = w->dropped;
+    unsigned int queue_depth = w->pending.length;
+    unsigned int max_queue_depth = w->max_queue_depth;
+    pthread_mutex_unlock( &w->mutex );
+
+    snprintf( key, sizeof( key ), "packetin_filter.worker.%u.received", w->id );
+    set_stat( key, received );
+    snprintf( key, sizeof( key ), "packetin_filter.worker.%u.overflowed", w->id );
+    set_stat( key, overflowed );
+    snprintf( key, sizeof( key ), "packetin_filter.worker.%u.forwarded", w->id );
+    set_stat( key, forwarded );
+    snprintf( key, sizeof( key ), "packetin_filter.worker.%u.dropped", w->id );
+    set_stat( key, dropped );
+    snprintf( key, sizeof( key ), "packetin_filter.worker.%u.queue_depth", w->id );
+    set_stat( key, queue_depth );
+    snprintf( key, sizeof( key ), "packetin_filter.worker.%u.max_queue_depth", w->id );
+    set_stat( key, max_queue_depth );
+  }
+}
+
+
+static void
+start_workers( void ) {
+  workers = xcalloc( n_workers, sizeof( worker ) );
+  workers_running = true;
+  for ( unsigned int i = 0; i < n_workers; i++ ) {
+    worker *w = &workers[ i ];
+    w->id = i;
+    pthread_mutex_init( &w->mutex, NULL );
+    pthread_cond_init( &w->cond, NULL );
+    if ( pthread_create( &w->thread, NULL, worker_main, w ) != 0 ) {
+      die( "Failed to create a worker thread." );
+    }
+  }
+
+  add_periodic_event_callback( WORKER_STATS_INTERVAL, publish_worker_stats, NULL );
+}
+
+
+static void
+stop_workers( void ) {
+  for ( unsigned int i = 0; i < n_workers; i++ ) {
+    pthread_mutex_lock( &workers[ i ].mutex );
+  }
+  workers_running = false;
+  for ( unsigned int i = 0; i < n_workers; i++ ) {
+    pthread_cond_signal( &workers[ i ].cond );
+    pthread_mutex_unlock( &workers[ i ].mutex );
+  }
+
+  for ( unsigned int i = 0; i < n_workers; i++ ) {
+    worker *w = &workers[ i ];
+    pthread_join( w->thread, NULL );
+
+    packet_in_job *job;
+    while ( ( job = pop_job( &w->pending ) ) != NULL ) {
+      xfree( job );
+    }
+    pthread_cond_destroy( &w->cond );
+    pthread_mutex_destroy( &w->mutex );
+  }
+  xfree( workers );
+  workers = NULL;
+}
+
+
+/*
+ * Classifies a packet_in message received from a switch daemon and
+ * forwards the received bytes, including the service header, to the
+ * destination services without re-serialization.
+ */
+static void
+handle_packet_in_message( uint16_t tag, void *data, size_t length ) {
+  if ( tag != MESSENGER_OPENFLOW_MESSAGE ) {
+    debug( "Unhandled message ( tag = %u ).", tag );
+    return;
+  }
+
+  if ( n_workers > 0 ) {
+    dispatch_packet_in_message( data, length );
+    return;
+  }
+
+  struct ofp_match ofp_match;   // host order
+  if ( classify_packet_in_message( data, length, &ofp_match ) ) {
+    forward_packet_in_message( &ofp_match, data, length );
+  }
+}
+
+
+typedef struct {
+  struct ofp_match ofp_match; // host byte order
+  uint16_t priority;
+  const char *service_name;
+} filter_rule;
+
+
+static bool
+same_filter_rule( const filter_rule *x, const filter_rule *y ) {
+  if ( x->ofp_match.wildcards != y->ofp_match.wildcards ) {
+    return false;
+  }
+  if ( x->ofp_match.wildcards && x->priority != y->priority ) {
+    return false;
+  }
+
+  return compare_match( &x->ofp_match, &y->ofp_match ) && strcmp( x->service_name, y->service_name ) == 0;
+}
+
+
+static bool
+filter_rule_installed( filter_rule *rule ) {
+  match_entry *entry = lookup_match_strict_entry( &rule->ofp_match, rule->priority );
+  if ( entry == NULL ) {
+    return false;
+  }
+
+  list_element *element;
+  for ( element = entry->services_name; element != NULL; element = element->next ) {
+    if ( strcmp( element->data, rule->service_name ) == 0 ) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+/*
+ * Converts rules in a request into host byte order. Returns the number of
+ * rules or -1 if the request is malformed. Service names point into data.
+ */
+static int
+parse_filter_rules( void *data, size_t length, filter_rule **rules ) {
+  if ( length < offsetof( packetin_filter_entries, entries ) ) {
+    error( "Too short packetin filter request ( length = %u ).", length );
+    return -1;
+  }
+
+  packetin_filter_entries *entries = data;
+  uint16_t n_entries = ntohs( entries->n_entries );
+  if ( length != offsetof( packetin_filter_entries, entries ) + sizeof( packetin_filter_entry ) * n_entries ) {
+    error( "Invalid packetin filter request ( length = %u, n_entries = %u ).", length, n_entries );
+    return -1;
+  }
+
+  *rules = xmalloc( sizeof( filter_rule ) * ( n_entries > 0 ? n_entries : 1 ) );
+  for ( int i = 0; i < n_entries; i++ ) {
+    packetin_filter_entry entry;
+    memcpy( &entry, &entries->entries[ i ], sizeof( packetin_filter_entry ) );
+    if ( memchr( entry.service_name, '\0', sizeof( entry.service_name ) ) == NULL || entry.service_name[ 0 ] == '\0' ) {
+      error( "Invalid service name in packetin filter request ( index = %d ).", i );
+      xfree( *rules );
+      *rules = NULL;
+      return -1;
+    }
+
+    filter_rule *rule = &( *rules )[ i ];
+    struct ofp_match match;
+    memcpy( &match, &entry.match, sizeof( struct ofp_match ) );
+    ntoh_match( &rule->ofp_match, &match );
+    rule->ofp_match.wildcards &= OFPFW_ALL;
+    rule->priority = ntohs( entry.priority );
+    rule->service_name = entries->entries[ i ].service_name;
+  }
+
+  return n_entries;
+}
+
+
+/*
+ * Checks all rules before touching the match table so that a request is
+ * applied entirely or not at all. A request is applied with rules_lock
+ * held, so workers never see a partially applied rule set.
+ */
+static bool
+validate_filter_rules( filter_rule *rules, int n_rules, bool installed ) {
+  char match_str[ 1024 ];
+
+  for ( int i = 0; i < n_rules; i++ ) {
+    if ( filter_rule_installed( &rules[ i ] ) != installed ) {
+      match_to_string( &rules[ i ].ofp_match, match_str, sizeof( match_str ) );
+      error( "Filter rule %s ( match = [%s], priority = %u, service_name = %s ).",
+             installed ? "not found" : "already exists", match_str, rules[ i ].priority, rules[ i ].service_name );
+      return false;
+    }
+    for ( int j = 0; j < i; j++ ) {
+      if ( same_filter_rule( &rules[ i ], &rules[ j ] ) ) {
+        error( "Duplicated filter rule in a request ( index = %d, %d ).", j, i );
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+
+static void
+handle_filter_rules_request( const messenger_context_handle *handle, uint16_t reply_tag, bool add, void *data, size_t length ) {
+  packetin_filter_reply reply;
+  reply.status = PACKETIN_FILTER_OPERATION_FAILED;
+  reply.n_entries = 0;
+
+  filter_rule *rules = NULL;
+  int n_rules = parse_filter_rules( data, length, &rules );
+  if ( n_rules >= 0 && validate_filter_rules( rules, n_rules, !add ) ) {
+    char match_str[ 1024 ];
+    pthread_rwlock_wrlock( &rules_lock );
+    for ( int i = 0; i < n_rules; i++ ) {
+      if ( add ) {
+        insert_match_entry( &rules[ i ].ofp_match, rules[ i ].priority, rules[ i ].service_name );
+      }
+      else {
+        delete_match_entry( &rules[ i ].ofp_match, rules[ i ].priority, rules[ i ].service_name );
+      }
+      match_to_string( &rules[ i ].ofp_match, match_str, sizeof( match_str ) );
+      info( "Filter rule %s ( match = [%s], priority = %u, service_name = %s ).",
+            add ? "added" : "deleted", match_str, rules[ i ].priority, rules[ i ].service_name );
+    }
+    pthread_rwlock_unlock( &rules_lock );
+    reply.status = PACKETIN_FILTER_OPERATION_SUCCEEDED;
+    reply.n_entries = htons( ( uint16_t ) n_rules );
+  }
+  if ( rules != NULL ) {
+    xfree( rules );
+  }
+
+  send_reply_message( handle, reply_tag, &reply, sizeof( packetin_filter_reply ) );
+}
+
+
+typedef struct {
+  buffer *reply;
+  uint32_t skip;
+  uint16_t n_entries;
+} dump_filter_param;
+
+
+static void
+append_filter_entry( struct ofp_match match, uint16_t priority, const char *service_name, void *user_data ) {
+  dump_filter_param *param = user_data;
+  if ( param->skip > 0 ) {
+    param->skip--;
+    return;
+  }
+  if ( param->n_entries >= PACKETIN_FILTER_DUMP_PAGE_SIZE ) {
+    return;
+  }
+  param->n_entries++;
+
+  packetin_filter_entry entry;
+  memset( &entry, 0, sizeof( packetin_filter_entry ) );
+  hton_match( &match, &match );
+  memcpy( &entry.match, &match, sizeof( struct ofp_match ) );
+  entry.priority = htons( priority );
+  strncpy( entry.service_name, service_name, sizeof( entry.service_name ) - 1 );
+  memcpy( append_back_buffer( param->reply, sizeof( packetin_filter_entry ) ), &entry, sizeof( packetin_filter_entry ) );
+}
+
+
+/*
+ * Replies with a page of installed rules so that n_entries never
+ * overflows and the reply fits into a messenger message.
+ */
+static void
+handle_dump_filter_request( const messenger_context_handle *handle, void *data, size_t length ) {
+  dump_filter_param param = { NULL, 0, 0 };
+  if ( length >= sizeof( packetin_filter_dump_request ) ) {
+    packetin_filter_dump_request *request = data;
+    param.skip = ntohl( request->offset );
+  }
+
+  param.reply = alloc_buffer_with_length( offsetof( packetin_filter_entries, entries ) +
+                                          sizeof( packetin_filter_entry ) * PACKETIN_FILTER_DUMP_PAGE_SIZE );
+  buffer *reply = param.reply;
+  append_back_buffer( reply, offsetof( packetin_filter_entries, entries ) );
+  foreach_match_table( append_filter_entry, &param );
+
+  packetin_filter_entries *entries = reply->data;
+  entries->n_entries = htons( param.n_entries );
+
+  send_reply_message( handle, MESSENGER_DUMP_PACKETIN_FILTER_REPLY, reply->data, reply->length );
+  free_buffer( reply );
+}
+
+
+static void
+handle_request( const messenger_context_handle *handle, uint16_t tag, void *data, size_t length ) {
+  switch ( tag ) {
+    case MESSENGER_ADD_PACKETIN_FILTER_REQUEST:
+      handle_filter_rules_request( handle, MESSENGER_ADD_PACKETIN_FILTER_REPLY, true, data, length );
+      break;
+    case MESSENGER_DELETE_PACKETIN_FILTER_REQUEST:
+      handle_filter_rules_request( handle, MESSENGER_DELETE_PACKETIN_FILTER_REPLY, false, data, length );
+      break;
+    case MESSENGER_DUMP_PACKETIN_FILTER_REQUEST:
+      handle_dump_filter_request( handle, data, length );
+      break;
+    default:
+      error( "Undefined request tag ( tag = %#x ).", tag );
+      break;
+  }
 }
 
 
@@ -255,11 +984,58 @@ match_type( const char *type, char *name ) {
 static const char LLDP_PACKET_IN[] = "lldp::";
 static const char ANY_PACKET_IN[] = "packet_in::";
 
+static void
+option_parser( int argc, char *argv[] ) {
+  int c;
+
+  pass_through = false;
+  n_workers = 0;
+  worker_queue_length = DEFAULT_WORKER_QUEUE_LENGTH;
+  while ( ( c = getopt_long( argc, argv, short_options, long_options, NULL ) ) != -1 ) {
+    switch ( c ) {
+      case 'p':
+        pass_through = true;
+        break;
+
+      case 'w':
+        {
+          char *ep;
+          long l = strtol( optarg, &ep, 0 );
+          if ( l < 0 || l > MAX_WORKERS || *ep != '\0' ) {
+            die( "Invalid number of workers (%s).", optarg );
+          }
+          n_workers = ( unsigned int ) l;
+          if ( n_workers > 0 ) {
+            pass_through = true;
+          }
+        }
+        break;
+
+      case 'q':
+        {
+          char *ep;
+          long l = strtol( optarg, &ep, 0 );
+          if ( l <= 0 || l > MAX_WORKER_QUEUE_LENGTH || *ep != '\0' ) {
+            die( "Invalid worker queue length (%s).", optarg );
+          }
+          worker_queue_length = ( unsigned int ) l;
+        }
+        break;
+
+      default:
+        usage();
+        exit( EXIT_SUCCESS );
+        return;
+    }
+  }
+}
+
+
 static bool
 set_match_type( int argc, char *argv[] ) {
   int i;
   const char *service_name;
-  for ( i = 1; i < argc; i++ ) {
+  for ( i = optind; i < argc; i++ ) {
     if ( ( service_name = match_type( LLDP_PACKET_IN, argv[ i ] ) ) != NULL ) {
       register_dl_type_filter( ETH_ETHTYPE_LLDP, OFP_DEFAULT_PRIORITY, service_name );
     }
@@ -278,6 +1054,7 @@ set_match_type( int argc, char *argv[] ) {
 int
 main( int argc, char *argv[] ) {
   init_trema( &argc, &argv );
+  option_parser( argc, argv );
 
   init_match_table();
 
@@ -288,10 +1065,23 @@ main( int argc, char *argv[] ) {
     exit( EXIT_FAILURE );
   }
 
-  set_packet_in_handler( handle_packet_in, NULL );
+  if ( pass_through ) {
+    add_message_received_callback( get_trema_name(), handle_packet_in_message );
+  }
+  else {
+    set_packet_in_handler( handle_packet_in, NULL );
+  }
+  add_message_requested_callback( get_trema_name(), handle_request );
+  if ( n_workers > 0 ) {
+    start_workers();
+  }
 
   start_trema();
 
+  if ( n_workers > 0 ) {
+    stop_workers();
+  }
+
   finalize_match_table();
 
   return 0;
@@ -18,6 +18,7 @@
  */
 
 
+#include <assert.h>
 #include <inttypes.h>
 #include <openflow.h>
 #include <string.h>
@@ -25,17 +26,25 @@
 #include "trema.h"
 
 
-static cookie_table_t cookie_table;
+/*
+ * A switch daemon keeps a cookie table for each secure channel. An entry
+ * holds a reference for each flow installed with its cookie, and is
+ * deleted when all of them are reported as removed. Entries that are
+ * left behind (e.g. flow_removed messages lost) are aged out in the
+ * order of their lifetimes, which are renewed whenever a flow is added.
+ */
+static list_element *cookie_tables = NULL;
 static uint64_t cookie_dough = 0;
 static uint64_t INVALID_COOKIE = UINT64_MAX;
 static const time_t COOKIE_ENTRY_LIFETIME = 86400 * 30;
+static const time_t COOKIE_TABLE_STATS_INTERVAL = 1;
 
 
 static uint64_t
-generate_cookie( void ) {
+generate_cookie( cookie_table_t *table ) {
   uint64_t initial_value = ( cookie_dough != ( INVALID_COOKIE - 1 ) ) ? ++cookie_dough : 1;
 
-  while ( lookup_cookie_entry_by_cookie( &cookie_dough ) != NULL ) {
+  while ( lookup_hash_entry( table->global, &cookie_dough ) != NULL ) {
     if ( cookie_dough != ( INVALID_COOKIE - 1 ) ) {
       cookie_dough++;
     }
@@ -71,14 +80,54 @@ compare_application( const void *x, const void *y ) {
 }
 
 
+static void
+append_to_expiry_list( cookie_table_t *table, cookie_entry_t *entry ) {
+  entry->next = NULL;
+  entry->prev = table->newest;
+  if ( table->newest != NULL ) {
+    table->newest->next = entry;
+  }
+  else {
+    table->oldest = entry;
+  }
+  table->newest = entry;
+}
+
+
+static void
+remove_from_expiry_list( cookie_table_t *table, cookie_entry_t *entry ) {
+  if ( entry->prev != NULL ) {
+    entry->prev->next = entry->next;
+  }
+  else {
+    table->oldest = entry->next;
+  }
+  if ( entry->next != NULL ) {
+    entry->next->prev = entry->prev;
+  }
+  else {
+    table->newest = entry->prev;
+  }
+  entry->prev = entry->next = NULL;
+}
+
+
+static void
+renew_cookie_entry( cookie_table_t *table, cookie_entry_t *entry ) {
+  remove_from_expiry_list( table, entry );
+  entry->expire_at = time( NULL ) + COOKIE_ENTRY_LIFETIME;
+  append_to_expiry_list( table, entry );
+}
+
+
 static cookie_entry_t *
-allocate_cookie_entry( uint64_t *original_cookie, char *service_name, uint16_t flags ) {
+allocate_cookie_entry( cookie_table_t *table, uint64_t *original_cookie, char *service_name, uint16_t flags ) {
   cookie_entry_t *new_entry;
 
   new_entry = xmalloc( sizeof ( cookie_entry_t ) );
   memset( new_entry, 0, sizeof( cookie_entry_t ) );
 
-  new_entry->cookie = generate_cookie();
+  new_entry->cookie = generate_cookie( table );
   new_entry->application.cookie = *original_cookie;
 
   if ( strlen( service_name ) + 1 > MESSENGER_SERVICE_NAME_LENGTH ) {
@@ -102,140 +151,248 @@ free_cookie_entry( cookie_entry_t *free_entry ) {
 
 
 static void
-free_cookie_table_walker( void *key, void *value, void *user_data ) {
-  cookie_entry_t *entry = value;
+set_cookie_table_stats( cookie_table_t *table ) {
+  char stat_key[ STAT_KEY_LENGTH ];
+  uint64_t datapath_id = table->switch_info->datapath_id;
+
+  snprintf( stat_key, sizeof( stat_key ), "cookie_table.%" PRIx64 ".entries", datapath_id );
+  set_stat( stat_key, table->n_entries );
+  // an entry and its two hash table entries
+  snprintf( stat_key, sizeof( stat_key ), "cookie_table.%" PRIx64 ".bytes", datapath_id );
+  set_stat( stat_key, table->n_entries * ( sizeof( cookie_entry_t ) + 2 * sizeof( hash_entry ) ) );
+}
+
 
-  UNUSED( key );
+static void
+update_cookie_table_stats( void *user_data ) {
   UNUSED( user_data );
 
-  free_cookie_entry( entry );
+  list_element *element;
+  for ( element = cookie_tables; element != NULL; element = element->next ) {
+    set_cookie_table_stats( element->data );
+  }
 }
 
 
 void
 init_cookie_table( void ) {
-  cookie_table.global = create_hash( compare_cookie, hash_cookie_entry );
-  cookie_table.application = create_hash( compare_application, hash_cookie_entry );
+  create_list( &cookie_tables );
+  add_periodic_event_callback( COOKIE_TABLE_STATS_INTERVAL, update_cookie_table_stats, NULL );
+}
+
+
+static void
+delete_cookie_table( cookie_table_t *table ) {
+  delete_element( &cookie_tables, table );
+  while ( table->oldest != NULL ) {
+    cookie_entry_t *entry = table->oldest;
+    remove_from_expiry_list( table, entry );
+    free_cookie_entry( entry );
+  }
+  delete_hash( table->global );
+  delete_hash( table->application );
+  table->switch_info->cookie_table = NULL;
+  xfree( table );
 }
 
 
 void
 finalize_cookie_table( void ) {
-  foreach_hash( cookie_table.global, free_cookie_table_walker, NULL );
-  delete_hash( cookie_table.global );
-  delete_hash( cookie_table.application );
-  cookie_table.global = NULL;
-  cookie_table.application = NULL;
+  delete_periodic_event_callback( update_cookie_table_stats );
+  // stats may have been finalized already
+  while ( cookie_tables != NULL ) {
+    delete_cookie_table( cookie_tables->data );
+  }
+}
+
+
+void
+attach_cookie_table( struct switch_info *sw_info ) {
+  assert( sw_info != NULL );
+
+  if ( sw_info->cookie_table != NULL ) {
+    return;
+  }
+
+  cookie_table_t *table = xmalloc( sizeof( cookie_table_t ) );
+  memset( table, 0, sizeof( cookie_table_t ) );
+  table->switch_info = sw_info;
+  table->global = create_hash( compare_cookie, hash_cookie_entry );
+  table->application = create_hash( compare_application, hash_cookie_entry );
+  insert_in_front( &cookie_tables, table );
+  sw_info->cookie_table = table;
+}
+
+
+void
+detach_cookie_table( struct switch_info *sw_info ) {
+  assert( sw_info != NULL );
+
+  cookie_table_t *table = sw_info->cookie_table;
+  if ( table == NULL ) {
+    return;
+  }
+
+  table->n_entries = 0;
+  set_cookie_table_stats( table );
+  delete_cookie_table( table );
 }
 
 
 uint64_t *
-insert_cookie_entry( uint64_t *original_cookie, char *service_name, uint16_t flags ) {
+insert_cookie_entry( struct switch_info *sw_info, uint64_t *original_cookie, char *service_name, uint16_t flags ) {
+  cookie_table_t *table = sw_info->cookie_table;
   cookie_entry_t *new_entry, *conflict_entry;
 
   debug( "Inserting cookie entry ( original_cookie = %#" PRIx64 ", service_name = %s, flags = %#x ).",
          *original_cookie, service_name, flags );
 
-  new_entry = lookup_cookie_entry_by_application( original_cookie, service_name );
+  if ( table == NULL ) {
+    return NULL;
+  }
+
+  new_entry = lookup_cookie_entry_by_application( sw_info, original_cookie, service_name );
   if ( new_entry != NULL ) {
     new_entry->reference_count++;
-    new_entry->expire_at = time( NULL ) + COOKIE_ENTRY_LIFETIME;
+    renew_cookie_entry( table, new_entry );
     new_entry->application.flags |= flags; // FIXME: save flags for each flow individually
 
     return &new_entry->cookie;
   }
 
-  new_entry = allocate_cookie_entry( original_cookie, service_name, flags );
-  conflict_entry = insert_hash_entry( cookie_table.global, &new_entry->cookie, new_entry );
+  new_entry = allocate_cookie_entry( table, original_cookie, service_name, flags );
+  conflict_entry = insert_hash_entry( table->global, &new_entry->cookie, new_entry );
   if ( conflict_entry != NULL ) {
     warn( "Conflicted cookie ( cookie = %#" PRIx64 " ).", new_entry->cookie );
     // TODO: delete conflicted cookie entry
   }
 
-  conflict_entry = insert_hash_entry( cookie_table.application, &new_entry->application, new_entry );
+  conflict_entry = insert_hash_entry( table->application, &new_entry->application, new_entry );
   if ( conflict_entry != NULL ) {
     warn( "Conflicted cookie ( cookie = %#" PRIx64 ", service_name = %s ).",
           new_entry->application.cookie, new_entry->application.service_name );
     // TODO: delete conflicted cookie entry
   }
 
+  append_to_expiry_list( table, new_entry );
+  table->n_entries++;
+
   return &new_entry->cookie;
 }
 
 
+/*
+ * Adds a reference to a cookie found in a flow left in the switch. The
+ * application that installed the flow is not known, so the cookie is
+ * translated to itself and owned by no service.
+ */
 void
-delete_cookie_entry( cookie_entry_t *entry ) {
-  debug( "Deleting cookie entry ( cookie = %#" PRIx64 ", application = [ cookie = %#" PRIx64 ", service_name = %s, "
-         "flags = %#x ], reference_count = %d, expire_at = %u ).",
-         entry->cookie, entry->application.cookie, entry->application.service_name,
-         entry->application.flags, entry->reference_count, entry->expire_at );
+restore_cookie_entry( struct switch_info *sw_info, uint64_t *cookie ) {
+  cookie_table_t *table = sw_info->cookie_table;
 
-  if ( entry->reference_count > 1 ) {
-    debug( "Decrementing reference counter ( reference_count = %d ).", entry->reference_count );
-    entry->reference_count--;
+  debug( "Restoring cookie entry ( cookie = %#" PRIx64 " ).", *cookie );
+
+  if ( table == NULL ) {
     return;
   }
 
-  cookie_entry_t *delete_entry_global = delete_hash_entry( cookie_table.global, &entry->cookie );
+  cookie_entry_t *entry = lookup_hash_entry( table->global, cookie );
+  if ( entry != NULL ) {
+    entry->reference_count++;
+    renew_cookie_entry( table, entry );
+    return;
+  }
+
+  entry = xmalloc( sizeof( cookie_entry_t ) );
+  memset( entry, 0, sizeof( cookie_entry_t ) );
+  entry->cookie = *cookie;
+  entry->application.cookie = *cookie;
+  entry->reference_count = 1;
+  entry->expire_at = time( NULL ) + COOKIE_ENTRY_LIFETIME;
+  insert_hash_entry( table->global, &entry->cookie, entry );
+  insert_hash_entry( table->application, &entry->application, entry );
+  append_to_expiry_list( table, entry );
+  table->n_entries++;
+}
+
+
+static void
+remove_cookie_entry( cookie_table_t *table, cookie_entry_t *entry ) {
+  cookie_entry_t *delete_entry_global = delete_hash_entry( table->global, &entry->cookie );
   if ( delete_entry_global == NULL ) {
     error( "No cookie entry found ( cookie = %#" PRIx64 " ).", entry->cookie );
   }
-  cookie_entry_t *delete_entry_application = delete_hash_entry( cookie_table.application, &entry->application );
+  cookie_entry_t *delete_entry_application = delete_hash_entry( table->application, &entry->application );
   if ( delete_entry_application == NULL ) {
     error( "No cookie entry found ( cookie = %#" PRIx64 ", service_name = %s ).",
            entry->application.cookie, entry->application.service_name );
   }
 
-  if ( delete_entry_global == delete_entry_application ) {
-    if ( delete_entry_application != NULL ) {
-      free_cookie_entry( delete_entry_application );
-    }
-  }
-  else {
-    if ( delete_entry_global != NULL ) {
-      free_cookie_entry( delete_entry_global );
-    }
-    if ( delete_entry_application != NULL ) {
-      free_cookie_entry( delete_entry_application );
-    }
+  remove_from_expiry_list( table, entry );
+  table->n_entries--;
+  free_cookie_entry( entry );
+}
+
+
+void
+delete_cookie_entry( struct switch_info *sw_info, cookie_entry_t *entry ) {
+  debug( "Deleting cookie entry ( cookie = %#" PRIx64 ", application = [ cookie = %#" PRIx64 ", service_name = %s, "
+         "flags = %#x ], reference_count = %d, expire_at = %u ).",
+         entry->cookie, entry->application.cookie, entry->application.service_name,
+         entry->application.flags, entry->reference_count, entry->expire_at );
+
+  if ( entry->reference_count > 1 ) {
+    debug( "Decrementing reference counter ( reference_count = %d ).", entry->reference_count );
+    entry->reference_count--;
+    return;
   }
+
+  remove_cookie_entry( sw_info->cookie_table, entry );
 }
 
 
 cookie_entry_t *
-lookup_cookie_entry_by_cookie( uint64_t *cookie ) {
-  return lookup_hash_entry( cookie_table.global, cookie );
+lookup_cookie_entry_by_cookie( struct switch_info *sw_info, uint64_t *cookie ) {
+  if ( sw_info->cookie_table == NULL ) {
+    return NULL;
+  }
+
+  return lookup_hash_entry( sw_info->cookie_table->global, cookie );
 }
 
 
 cookie_entry_t *
-lookup_cookie_entry_by_application( uint64_t *cookie, char *service_name ) {
+lookup_cookie_entry_by_application( struct switch_info *sw_info, uint64_t *cookie, char *service_name ) {
   cookie_entry_t key;
   cookie_entry_t *entry;
 
+  if ( sw_info->cookie_table == NULL ) {
+    return NULL;
+  }
+
   memset( &key, 0, sizeof( cookie_entry_t ) );
   key.application.cookie = *cookie;
   strncpy( key.application.service_name, service_name, MESSENGER_SERVICE_NAME_LENGTH );
   key.application.service_name[ MESSENGER_SERVICE_NAME_LENGTH - 1 ] = '\0';
 
-  entry = lookup_hash_entry( cookie_table.application, &key );
+  entry = lookup_hash_entry( sw_info->cookie_table->application, &key );
 
   return entry;
 }
 
 
 static void
-age_cookie_entry( cookie_entry_t *entry ) {
-  if ( entry->expire_at < time( NULL ) ) {
+age_cookie_entries( cookie_table_t *table, time_t now ) {
+  while ( table->oldest != NULL && table->oldest->expire_at < now ) {
+    cookie_entry_t *entry = table->oldest;
     // TODO: check if the target flow is still alive or not
     warn( "Aging out cookie entry ( cookie = %#" PRIx64 ", application = [ cookie = %#" PRIx64 ", service_name = %s, "
           "flags = %#x ], reference_count = %d, expire_at = %u ).",
           entry->cookie, entry->application.cookie, entry->application.service_name,
           entry->application.flags, entry->reference_count, entry->expire_at );
 
-    delete_hash_entry( cookie_table.global, &entry->cookie );
-    delete_hash_entry( cookie_table.application, &entry->application );
-    free_cookie_entry( entry );
+    remove_cookie_entry( table, entry );
+    increment_stat( "cookie_table.aged_out" );
   }
 }
 
@@ -244,12 +401,10 @@ void
 age_cookie_table( void *user_data ) {
   UNUSED( user_data );
 
-  hash_iterator iter;
-  hash_entry *e;
-
-  init_hash_iterator( cookie_table.global, &iter );
-  while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
-    age_cookie_entry( e->value );
+  time_t now = time( NULL );
+  list_element *element;
+  for ( element = cookie_tables; element != NULL; element = element->next ) {
+    age_cookie_entries( element->data, now );
   }
 }
 
@@ -269,16 +424,21 @@ dump_cookie_table( void ) {
   hash_entry *e;
 
   info( "#### COOKIE TABLE ####" );
-  info( "[global]" );
-  init_hash_iterator( cookie_table.global, &iter );
-  while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
-    dump_cookie_entry( e->value );
-  }
+  list_element *element;
+  for ( element = cookie_tables; element != NULL; element = element->next ) {
+    cookie_table_t *table = element->data;
+    info( "[datapath_id = %#" PRIx64 ", entries = %u]", table->switch_info->datapath_id, table->n_entries );
+    info( "[global]" );
+    init_hash_iterator( table->global, &iter );
+    while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
+      dump_cookie_entry( e->value );
+    }
 
-  info( "[application]" );
-  init_hash_iterator( cookie_table.application, &iter );
-  while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
-    dump_cookie_entry( e->value );
+    info( "[application]" );
+    init_hash_iterator( table->application, &iter );
+    while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
+      dump_cookie_entry( e->value );
+    }
   }
   info( "#### END ####" );
 }
@@ -27,6 +27,7 @@
 #include <limits.h>
 #include <time.h>
 #include "trema.h"
+#include "switchinfo.h"
 
 
 #define RESERVED_COOKIE 0
@@ -41,22 +42,31 @@ typedef struct application_entry {
 typedef struct cookie_entry {
   uint64_t cookie;
   application_entry_t application;
-  int reference_count;
+  int reference_count;          // flows installed with the cookie
   time_t expire_at;
+  struct cookie_entry *prev;    // in the order of expire_at
+  struct cookie_entry *next;
 } cookie_entry_t;
 
 typedef struct cookie_table {
+  struct switch_info *switch_info;
   hash_table *global;
   hash_table *application;
+  cookie_entry_t *oldest;
+  cookie_entry_t *newest;
+  unsigned int n_entries;
 } cookie_table_t;
 
 
 void init_cookie_table( void );
 void finalize_cookie_table( void );
-uint64_t *insert_cookie_entry( uint64_t *original_cookie, char *service_name, uint16_t flags );
-void delete_cookie_entry( cookie_entry_t *entry );
-cookie_entry_t *lookup_cookie_entry_by_cookie( uint64_t *cookie );
-cookie_entry_t *lookup_cookie_entry_by_application( uint64_t *cookie, char *service_name );
+void attach_cookie_table( struct switch_info *sw_info );
+void detach_cookie_table( struct switch_info *sw_info );
+uint64_t *insert_cookie_entry( struct switch_info *sw_info, uint64_t *original_cookie, char *service_name, uint16_t flags );
+void restore_cookie_entry( struct switch_info *sw_info, uint64_t *cookie );
+void delete_cookie_entry( struct switch_info *sw_info, cookie_entry_t *entry );
+cookie_entry_t *lookup_cookie_entry_by_cookie( struct switch_info *sw_info, uint64_t *cookie );
+cookie_entry_t *lookup_cookie_entry_by_application( struct switch_info *sw_info, uint64_t *cookie, char *service_name );
 void age_cookie_table( void *user_data );
 void dump_cookie_table( void );
 
@@ -20,11 +20,18 @@
 
 #include <assert.h>
 #include <string.h>
+#include <time.h>
 #include <inttypes.h>
 #include "trema.h"
 #include "dpid_table.h"
 
 
+typedef struct {
+  uint64_t datapath_id;
+  messenger_context_handle *claim; // waiting for the datapath id to be released
+  time_t claimed_at;
+} dpid_entry;
+
 static hash_table *dpid_table = NULL;
 
 
@@ -35,11 +42,20 @@ init_dpid_table( void ) {
 }
 
 
+static void
+free_dpid_entry( dpid_entry *entry ) {
+  if ( entry->claim != NULL ) {
+    xfree( entry->claim );
+  }
+  xfree( entry );
+}
+
+
 static void
 free_dpid_table_walker( void *key, void *value, void *user_data ) {
   UNUSED( key );
   UNUSED( user_data );
-  xfree( value );
+  free_dpid_entry( value );
 }
 
 
@@ -63,9 +79,11 @@ insert_dpid_entry( uint64_t *dpid ) {
     return;
   }
 
-  uint64_t *new_entry = xmalloc( sizeof ( uint64_t ) );
-  *new_entry = *dpid;
-  insert_hash_entry( dpid_table, new_entry, new_entry );
+  dpid_entry *new_entry = xmalloc( sizeof( dpid_entry ) );
+  new_entry->datapath_id = *dpid;
+  new_entry->claim = NULL;
+  new_entry->claimed_at = 0;
+  insert_hash_entry( dpid_table, &new_entry->datapath_id, new_entry );
 }
 
 
@@ -74,13 +92,82 @@ delete_dpid_entry( uint64_t *dpid ) {
   assert( dpid_table != NULL );
   assert( dpid != NULL );
 
-  uint64_t *deleted_entry = delete_hash_entry( dpid_table, dpid );
+  dpid_entry *deleted_entry = delete_hash_entry( dpid_table, dpid );
   if ( deleted_entry == NULL ) {
     warn( "datapath %#" PRIx64 " is not found.", *dpid );
     return;
   }
 
-  xfree( deleted_entry );
+  free_dpid_entry( deleted_entry );
+}
+
+
+bool
+lookup_dpid_entry( uint64_t *dpid ) {
+  assert( dpid_table != NULL );
+  assert( dpid != NULL );
+
+  return lookup_hash_entry( dpid_table, dpid ) != NULL;
+}
+
+
+/*
+ * Keeps a copy of the claim for a registered datapath id until the datapath
+ * id is released. Returns the claim it supersedes, if any.
+ */
+messenger_context_handle *
+hold_dpid_claim( uint64_t *dpid, const messenger_context_handle *handle ) {
+  assert( dpid_table != NULL );
+  assert( dpid != NULL );
+  assert( handle != NULL );
+
+  dpid_entry *entry = lookup_hash_entry( dpid_table, dpid );
+  assert( entry != NULL );
+
+  messenger_context_handle *superseded = entry->claim;
+  size_t length = sizeof( messenger_context_handle ) + handle->service_name_len;
+  entry->claim = xmalloc( length );
+  memcpy( entry->claim, handle, length );
+  entry->claimed_at = time( NULL );
+
+  return superseded;
+}
+
+
+messenger_context_handle *
+take_dpid_claim( uint64_t *dpid ) {
+  assert( dpid_table != NULL );
+  assert( dpid != NULL );
+
+  dpid_entry *entry = lookup_hash_entry( dpid_table, dpid );
+  if ( entry == NULL ) {
+    return NULL;
+  }
+
+  messenger_context_handle *claim = entry->claim;
+  entry->claim = NULL;
+
+  return claim;
+}
+
+
+void
+age_dpid_claims( time_t timeout, void ( *expired )( uint64_t dpid, messenger_context_handle *handle ) ) {
+  assert( dpid_table != NULL );
+  assert( expired != NULL );
+
+  time_t now = time( NULL );
+  hash_iterator iter;
+  hash_entry *e;
+  init_hash_iterator( dpid_table, &iter );
+  while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
+    dpid_entry *entry = e->value;
+    if ( entry->claim != NULL && entry->claimed_at + timeout <= now ) {
+      messenger_context_handle *claim = entry->claim;
+      entry->claim = NULL;
+      expired( entry->datapath_id, claim );
+    }
+  }
 }
 
 
@@ -95,7 +182,7 @@ get_switches( void ) {
   init_hash_iterator( dpid_table, &iter );
   while ( ( entry = iterate_hash_next( &iter ) ) != NULL ) {
     uint64_t *dpid = append_back_buffer( buf, sizeof( uint64_t ) );
-    *dpid = htonll( *( uint64_t * )( entry->value ) );
+    *dpid = htonll( ( ( dpid_entry * ) entry->value )->datapath_id );
   }
 
   return buf;
@@ -27,10 +27,32 @@
 #include "trema.h"
 
 
+/*
+ * A switch daemon started by the switch manager claims the datapath id of a
+ * switch before it takes the switch.<datapath id> service name over. The
+ * request body is the datapath id in network byte order. If another secure
+ * channel holds the datapath id, the switch manager asks its switch daemon
+ * to disconnect it and grants the claim when it is disconnected, or after
+ * DPID_CLAIM_TIMEOUT seconds. A claim superseded by a newer one for the same
+ * datapath id is refused.
+ */
+#define DPID_CLAIM_REQUEST 1
+#define DPID_CLAIM_TIMEOUT 5
+
+typedef struct {
+  uint64_t datapath_id; // network byte order
+  uint8_t granted;
+} __attribute__( ( packed ) ) dpid_claim_reply;
+
+
 void init_dpid_table( void );
 void finalize_dpid_table( void );
 void insert_dpid_entry( uint64_t *dpid );
 void delete_dpid_entry( uint64_t *dpid );
+bool lookup_dpid_entry( uint64_t *dpid );
+messenger_context_handle *hold_dpid_claim( uint64_t *dpid, const messenger_context_handle *handle );
+messenger_context_handle *take_dpid_claim( uint64_t *dpid );
+void age_dpid_claims( time_t timeout, void ( *expired )( uint64_t dpid, messenger_context_handle *handle ) );
 buffer *get_switches( void );
 
 
@@ -0,0 +1,351 @@
+/*
+ * Copyright (C) 2008-2011 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <assert.h>
+#include <inttypes.h>
+#include <openflow.h>
+#include <string.h>
+#include <time.h>
+#include "echo_monitor.h"
+#include "switch.h"
+#include "xid_table.h"
+
+
+#define ECHO_MONITOR_MAGIC 0x7472656d61656368ULL // "tremaech"
+
+/*
+ * Body of echo requests sent by echo monitor. A switch returns it
+ * unchanged in the echo reply, so it is kept in host byte order.
+ */
+typedef struct echo_monitor_body {
+  uint64_t magic;
+  uint64_t sec;
+  uint64_t nsec;
+} echo_monitor_body;
+
+
+// upper bounds of round trip time buckets in microseconds
+static const uint32_t RTT_BUCKETS[ OPENFLOW_LIVENESS_RTT_BUCKETS - 1 ] = {
+  100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000,
+  100000, 200000, 500000, 1000000, 2000000, 5000000
+};
+
+
+/*
+ * Echo round trip times and liveness of a secure channel. A switch daemon
+ * that handles many secure channels has one for each of them.
+ */
+struct echo_monitor {
+  struct switch_info *switch_info;
+  struct timespec last_seen;  // when a message was received last
+  bool outstanding;           // an echo request is waiting for its reply
+  uint32_t outstanding_xid;
+  unsigned int consecutive_missed;
+  uint64_t requests;
+  uint64_t replies;
+  uint64_t missed;
+  uint32_t rtt_last;          // microseconds
+  uint32_t rtt_min;
+  uint32_t rtt_max;
+  uint32_t rtt_smoothed;
+  uint32_t rtt_histogram[ OPENFLOW_LIVENESS_RTT_BUCKETS ];
+};
+
+
+static time_t echo_interval = 0;
+static list_element *monitors = NULL;
+
+
+static buffer *
+create_timestamped_echo_request( struct echo_monitor *monitor ) {
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+
+  buffer *body = alloc_buffer_with_length( sizeof( echo_monitor_body ) );
+  echo_monitor_body *echo = append_back_buffer( body, sizeof( echo_monitor_body ) );
+  echo->magic = ECHO_MONITOR_MAGIC;
+  echo->sec = ( uint64_t ) now.tv_sec;
+  echo->nsec = ( uint64_t ) now.tv_nsec;
+
+  uint32_t xid = generate_xid();
+  buffer *buf = create_echo_request( xid, body );
+  free_buffer( body );
+
+  monitor->outstanding = true;
+  monitor->outstanding_xid = xid;
+  monitor->requests++;
+
+  return buf;
+}
+
+
+static void
+update_liveness_stats( struct echo_monitor *monitor, const struct timespec *now ) {
+  char key[ STAT_KEY_LENGTH ];
+  uint64_t datapath_id = monitor->switch_info->datapath_id;
+
+  snprintf( key, sizeof( key ), "echo_monitor.%" PRIx64 ".requests", datapath_id );
+  set_stat( key, monitor->requests );
+  snprintf( key, sizeof( key ), "echo_monitor.%" PRIx64 ".missed", datapath_id );
+  set_stat( key, monitor->missed );
+  snprintf( key, sizeof( key ), "echo_monitor.%" PRIx64 ".last_seen", datapath_id );
+  set_stat( key, ( uint64_t ) ( now->tv_sec - monitor->last_seen.tv_sec ) );
+}
+
+
+static void
+update_rtt_stats( struct echo_monitor *monitor ) {
+  char key[ STAT_KEY_LENGTH ];
+  uint64_t datapath_id = monitor->switch_info->datapath_id;
+
+  snprintf( key, sizeof( key ), "echo_monitor.%" PRIx64 ".replies", datapath_id );
+  set_stat( key, monitor->replies );
+  snprintf( key, sizeof( key ), "echo_monitor.%" PRIx64 ".rtt.last_usec", datapath_id );
+  set_stat( key, monitor->rtt_last );
+  snprintf( key, sizeof( key ), "echo_monitor.%" PRIx64 ".rtt.min_usec", datapath_id );
+  set_stat( key, monitor->rtt_min );
+  snprintf( key, sizeof( key ), "echo_monitor.%" PRIx64 ".rtt.max_usec", datapath_id );
+  set_stat( key, monitor->rtt_max );
+  snprintf( key, sizeof( key ), "echo_monitor.%" PRIx64 ".rtt.smoothed_usec", datapath_id );
+  set_stat( key, monitor->rtt_smoothed );
+
+  // cumulative counts as in "le" buckets
+  uint64_t count = 0;
+  unsigned int i;
+  for ( i = 0; i < OPENFLOW_LIVENESS_RTT_BUCKETS - 1; i++ ) {
+    count += monitor->rtt_histogram[ i ];
+    snprintf( key, sizeof( key ), "echo_monitor.%" PRIx64 ".rtt.le_%uus", datapath_id, RTT_BUCKETS[ i ] );
+    set_stat( key, count );
+  }
+  count += monitor->rtt_histogram[ OPENFLOW_LIVENESS_RTT_BUCKETS - 1 ];
+  snprintf( key, sizeof( key ), "echo_monitor.%" PRIx64 ".rtt.le_inf", datapath_id );
+  set_stat( key, count );
+}
+
+
+static void
+update_rtt( struct echo_monitor *monitor, uint32_t rtt ) {
+  monitor->rtt_last = rtt;
+  if ( monitor->replies == 0 ) {
+    monitor->rtt_min = rtt;
+    monitor->rtt_max = rtt;
+    monitor->rtt_smoothed = rtt;
+  }
+  else {
+    if ( rtt < monitor->rtt_min ) {
+      monitor->rtt_min = rtt;
+    }
+    if ( rtt > monitor->rtt_max ) {
+      monitor->rtt_max = rtt;
+    }
+    // same gain as the smoothed round trip time of TCP
+    monitor->rtt_smoothed = ( uint32_t ) ( ( ( uint64_t ) monitor->rtt_smoothed * 7 + rtt ) / 8 );
+  }
+  monitor->replies++;
+
+  unsigned int i;
+  for ( i = 0; i < OPENFLOW_LIVENESS_RTT_BUCKETS - 1; i++ ) {
+    if ( rtt <= RTT_BUCKETS[ i ] ) {
+      break;
+    }
+  }
+  monitor->rtt_histogram[ i ]++;
+}
+
+
+static void
+probe_switches( void *user_data ) {
+  UNUSED( user_data );
+
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+
+  list_element *element = monitors;
+  while ( element != NULL ) {
+    struct echo_monitor *monitor = element->data;
+    element = element->next;
+    if ( monitor->switch_info->state != SWITCH_STATE_COMPLETED ) {
+      continue;
+    }
+    if ( monitor->outstanding ) {
+      monitor->missed++;
+      if ( monitor->consecutive_missed++ == 0 ) {
+        warn( "No echo reply from a switch %#" PRIx64 " in %d seconds ( last seen %d seconds ago ).",
+              monitor->switch_info->datapath_id, ( int ) echo_interval,
+              ( int ) ( now.tv_sec - monitor->last_seen.tv_sec ) );
+      }
+    }
+    buffer *buf = create_timestamped_echo_request( monitor );
+    update_liveness_stats( monitor, &now );
+    debug( "Send 'echo request' to a switch %#" PRIx64 ".", monitor->switch_info->datapath_id );
+    // the switch may be disconnected and monitor freed on failure
+    switch_event_send_to_secure_channel( monitor->switch_info, buf );
+  }
+}
+
+
+/*
+ * Returns true if buf is a reply to an echo request sent by echo monitor.
+ * buf is freed in that case.
+ */
+bool
+echo_monitor_handle_reply( struct switch_info *sw_info, buffer *buf ) {
+  assert( sw_info != NULL );
+  assert( buf != NULL );
+
+  struct echo_monitor *monitor = sw_info->echo_monitor;
+  if ( monitor == NULL || buf->length != sizeof( struct ofp_header ) + sizeof( echo_monitor_body ) ) {
+    return false;
+  }
+  struct ofp_header *header = buf->data;
+  echo_monitor_body *echo = ( echo_monitor_body * ) ( header + 1 );
+  if ( echo->magic != ECHO_MONITOR_MAGIC ) {
+    return false;
+  }
+
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  int64_t elapsed = ( ( int64_t ) now.tv_sec - ( int64_t ) echo->sec ) * 1000000;
+  elapsed += ( ( int64_t ) now.tv_nsec - ( int64_t ) echo->nsec ) / 1000;
+  if ( elapsed >= 0 && elapsed <= UINT32_MAX ) {
+    update_rtt( monitor, ( uint32_t ) elapsed );
+    update_rtt_stats( monitor );
+  }
+  if ( monitor->outstanding && monitor->outstanding_xid == ntohl( header->xid ) ) {
+    monitor->outstanding = false;
+  }
+  monitor->consecutive_missed = 0;
+  free_buffer( buf );
+
+  return true;
+}
+
+
+void
+echo_monitor_seen( struct switch_info *sw_info, const struct timespec *now ) {
+  assert( sw_info != NULL );
+  assert( now != NULL );
+
+  if ( sw_info->echo_monitor != NULL ) {
+    sw_info->echo_monitor->last_seen = *now;
+  }
+}
+
+
+/*
+ * Fills liveness in network byte order. All fields are zero if echo
+ * monitor is disabled.
+ */
+void
+get_switch_liveness( struct switch_info *sw_info, openflow_liveness_t *liveness ) {
+  assert( sw_info != NULL );
+  assert( liveness != NULL );
+
+  memset( liveness, 0, sizeof( openflow_liveness_t ) );
+  struct echo_monitor *monitor = sw_info->echo_monitor;
+  if ( monitor == NULL ) {
+    return;
+  }
+
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  liveness->echo_interval = htonl( ( uint32_t ) echo_interval );
+  liveness->last_seen = htonl( ( uint32_t ) ( now.tv_sec - monitor->last_seen.tv_sec ) );
+  liveness->echo_requests = htonll( monitor->requests );
+  liveness->echo_replies = htonll( monitor->replies );
+  liveness->echo_missed = htonll( monitor->missed );
+  liveness->rtt_last = htonl( monitor->rtt_last );
+  liveness->rtt_min = htonl( monitor->rtt_min );
+  liveness->rtt_max = htonl( monitor->rtt_max );
+  liveness->rtt_smoothed = htonl( monitor->rtt_smoothed );
+  unsigned int i;
+  for ( i = 0; i < OPENFLOW_LIVENESS_RTT_BUCKETS; i++ ) {
+    liveness->rtt_histogram[ i ] = htonl( monitor->rtt_histogram[ i ] );
+  }
+}
+
+
+/*
+ * Sends an echo request to each switch every interval seconds. Zero
+ * disables echo monitor.
+ */
+void
+init_echo_monitor( time_t interval ) {
+  if ( interval == 0 ) {
+    return;
+  }
+
+  echo_interval = interval;
+  create_list( &monitors );
+  add_periodic_event_callback( echo_interval, probe_switches, NULL );
+}
+
+
+void
+attach_echo_monitor( struct switch_info *sw_info ) {
+  assert( sw_info != NULL );
+
+  if ( echo_interval == 0 || sw_info->echo_monitor != NULL ) {
+    return;
+  }
+
+  struct echo_monitor *monitor = xmalloc( sizeof( struct echo_monitor ) );
+  memset( monitor, 0, sizeof( struct echo_monitor ) );
+  monitor->switch_info = sw_info;
+  clock_gettime( CLOCK_MONOTONIC, &monitor->last_seen );
+  insert_in_front( &monitors, monitor );
+  sw_info->echo_monitor = monitor;
+}
+
+
+void
+detach_echo_monitor( struct switch_info *sw_info ) {
+  assert( sw_info != NULL );
+
+  struct echo_monitor *monitor = sw_info->echo_monitor;
+  if ( monitor == NULL ) {
+    return;
+  }
+
+  delete_element( &monitors, monitor );
+  xfree( monitor );
+  sw_info->echo_monitor = NULL;
+}
+
+
+void
+finalize_echo_monitor( void ) {
+  if ( echo_interval == 0 ) {
+    return;
+  }
+
+  delete_periodic_event_callback( probe_switches );
+  while ( monitors != NULL ) {
+    struct echo_monitor *monitor = monitors->data;
+    detach_echo_monitor( monitor->switch_info );
+  }
+  echo_interval = 0;
+}
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
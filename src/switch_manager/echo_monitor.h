@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2008-2011 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef ECHO_MONITOR_H
+#define ECHO_MONITOR_H
+
+
+#include "openflow_service_interface.h"
+#include "trema.h"
+#include "switchinfo.h"
+
+
+void init_echo_monitor( time_t interval );
+void finalize_echo_monitor( void );
+void attach_echo_monitor( struct switch_info *sw_info );
+void detach_echo_monitor( struct switch_info *sw_info );
+void echo_monitor_seen( struct switch_info *sw_info, const struct timespec *now );
+bool echo_monitor_handle_reply( struct switch_info *sw_info, buffer *buf );
+void get_switch_liveness( struct switch_info *sw_info, openflow_liveness_t *liveness );
+
+
+#endif // ECHO_MONITOR_H
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
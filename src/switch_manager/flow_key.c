@@ -0,0 +1,105 @@
+/*
+ * Copyright (C) 2008-2011 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <string.h>
+#include "flow_key.h"
+
+
+bool
+compare_flow_key( const void *x, const void *y ) {
+  return ( ( memcmp( x, y, sizeof( flow_key ) ) == 0 ) ? true : false );
+}
+
+
+unsigned int
+hash_flow_key( const void *key ) {
+  return hash_core( key, ( int ) sizeof( flow_key ) );
+}
+
+
+/*
+ * Values of wildcarded fields are not significant and a switch may report
+ * them differently from what was added, so they are cleared.
+ */
+void
+make_flow_key( flow_key *key, const struct ofp_match *match, uint16_t priority ) {
+  memset( key, 0, sizeof( flow_key ) );
+
+  struct ofp_match m;
+  ntoh_match( &m, match );
+  uint32_t wildcards = m.wildcards & OFPFW_ALL;
+  uint32_t nw_src_shift = ( wildcards & OFPFW_NW_SRC_MASK ) >> OFPFW_NW_SRC_SHIFT;
+  uint32_t nw_dst_shift = ( wildcards & OFPFW_NW_DST_MASK ) >> OFPFW_NW_DST_SHIFT;
+  if ( nw_src_shift > 32 ) {
+    wildcards = ( wildcards & ~( uint32_t ) OFPFW_NW_SRC_MASK ) | OFPFW_NW_SRC_ALL;
+    nw_src_shift = 32;
+  }
+  if ( nw_dst_shift > 32 ) {
+    wildcards = ( wildcards & ~( uint32_t ) OFPFW_NW_DST_MASK ) | OFPFW_NW_DST_ALL;
+    nw_dst_shift = 32;
+  }
+
+  key->match.wildcards = wildcards;
+  if ( !( wildcards & OFPFW_IN_PORT ) ) {
+    key->match.in_port = m.in_port;
+  }
+  if ( !( wildcards & OFPFW_DL_SRC ) ) {
+    memcpy( key->match.dl_src, m.dl_src, OFP_ETH_ALEN );
+  }
+  if ( !( wildcards & OFPFW_DL_DST ) ) {
+    memcpy( key->match.dl_dst, m.dl_dst, OFP_ETH_ALEN );
+  }
+  if ( !( wildcards & OFPFW_DL_VLAN ) ) {
+    key->match.dl_vlan = m.dl_vlan;
+  }
+  if ( !( wildcards & OFPFW_DL_VLAN_PCP ) ) {
+    key->match.dl_vlan_pcp = m.dl_vlan_pcp;
+  }
+  if ( !( wildcards & OFPFW_DL_TYPE ) ) {
+    key->match.dl_type = m.dl_type;
+  }
+  if ( !( wildcards & OFPFW_NW_TOS ) ) {
+    key->match.nw_tos = m.nw_tos;
+  }
+  if ( !( wildcards & OFPFW_NW_PROTO ) ) {
+    key->match.nw_proto = m.nw_proto;
+  }
+  if ( nw_src_shift < 32 ) {
+    key->match.nw_src = m.nw_src & ( 0xffffffff << nw_src_shift );
+  }
+  if ( nw_dst_shift < 32 ) {
+    key->match.nw_dst = m.nw_dst & ( 0xffffffff << nw_dst_shift );
+  }
+  if ( !( wildcards & OFPFW_TP_SRC ) ) {
+    key->match.tp_src = m.tp_src;
+  }
+  if ( !( wildcards & OFPFW_TP_DST ) ) {
+    key->match.tp_dst = m.tp_dst;
+  }
+
+  // exact-match flows always take precedence over others
+  key->priority = ( wildcards == 0 ) ? 0 : priority;
+}
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2008-2011 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef FLOW_KEY_H
+#define FLOW_KEY_H
+
+
+#include <openflow.h>
+#include "trema.h"
+
+
+/*
+ * Identifies a flow in a switch table by its match and priority, as an
+ * OpenFlow 1.0 switch does when adding, strictly modifying or deleting it
+ * and when reporting it as removed.
+ */
+typedef struct flow_key {
+  struct ofp_match match;   // host byte order, fields not matched are zero
+  uint16_t priority;        // zero for exact-match flows
+  uint8_t pad[ 6 ];
+} flow_key;
+
+
+void make_flow_key( flow_key *key, const struct ofp_match *match, uint16_t priority );
+bool compare_flow_key( const void *x, const void *y );
+unsigned int hash_flow_key( const void *key );
+
+
+#endif // FLOW_KEY_H
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,373 @@
+/*
+ * Copyright (C) 2008-2011 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <assert.h>
+#include <inttypes.h>
+#include <openflow.h>
+#include <string.h>
+#include <time.h>
+#include "cookie_table.h"
+#include "flow_key.h"
+#include "flow_reconciler.h"
+#include "secure_channel_sender.h"
+#include "switch.h"
+#include "xid_table.h"
+
+
+/*
+ * In warm-restart mode a switch daemon does not delete the flows left in
+ * a switch. Instead it takes a snapshot of them with a flow stats request
+ * before notifying applications that the switch is ready, and restores
+ * the cookie table from their cookies. Applications then reconcile by
+ * adding the flows they want; a flow in the snapshot that is added again
+ * with the same match and priority is replaced in place by the switch,
+ * and is claimed. Flows left unclaimed at the end of the claim period
+ * are deleted.
+ */
+typedef struct restored_flow {
+  flow_key key;
+  uint16_t priority;
+  uint64_t cookie;
+} restored_flow;
+
+struct flow_reconciler {
+  struct switch_info *switch_info;
+  hash_table *flows;        // flow_key -> restored_flow
+  bool taking_snapshot;     // waiting for the last flow stats reply
+  uint32_t snapshot_xid;
+  time_t deadline;          // of the snapshot or the claim period
+  uint64_t restored;
+  uint64_t claimed;
+  uint64_t deleted;
+};
+
+
+static bool enabled = false;
+static time_t claim_period = 0;
+static list_element *reconcilers = NULL;
+
+static const time_t FLOW_RECONCILER_CHECK_INTERVAL = 1;
+static const time_t FLOW_SNAPSHOT_TIMEOUT = 10;
+
+
+static void
+set_flow_reconciler_stats( struct flow_reconciler *reconciler ) {
+  char key[ STAT_KEY_LENGTH ];
+  uint64_t datapath_id = reconciler->switch_info->datapath_id;
+
+  snprintf( key, sizeof( key ), "flow_reconciler.%" PRIx64 ".restored", datapath_id );
+  set_stat( key, reconciler->restored );
+  snprintf( key, sizeof( key ), "flow_reconciler.%" PRIx64 ".claimed", datapath_id );
+  set_stat( key, reconciler->claimed );
+  snprintf( key, sizeof( key ), "flow_reconciler.%" PRIx64 ".deleted", datapath_id );
+  set_stat( key, reconciler->deleted );
+}
+
+
+static void
+delete_restored_flows( hash_table *flows ) {
+  hash_iterator iter;
+  hash_entry *e;
+
+  init_hash_iterator( flows, &iter );
+  while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
+    xfree( e->value );
+  }
+  delete_hash( flows );
+}
+
+
+static void
+restore_flow( struct flow_reconciler *reconciler, const struct ofp_flow_stats *flow_stats ) {
+  restored_flow *flow = xmalloc( sizeof( restored_flow ) );
+  flow->priority = ntohs( flow_stats->priority );
+  make_flow_key( &flow->key, &flow_stats->match, flow->priority );
+  flow->cookie = ntohll( flow_stats->cookie );
+
+  restored_flow *old = insert_hash_entry( reconciler->flows, &flow->key, flow );
+  if ( old != NULL ) {
+    // the same flow in another table
+    xfree( old );
+  }
+  if ( flow->cookie != RESERVED_COOKIE ) {
+    restore_cookie_entry( reconciler->switch_info, &flow->cookie );
+  }
+  reconciler->restored++;
+}
+
+
+static void
+complete_flow_snapshot( struct flow_reconciler *reconciler ) {
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+
+  reconciler->taking_snapshot = false;
+  reconciler->deadline = now.tv_sec + claim_period;
+  set_flow_reconciler_stats( reconciler );
+  info( "Restored %" PRIu64 " flows from a switch %#" PRIx64 ".",
+        reconciler->restored, reconciler->switch_info->datapath_id );
+
+  switch_event_flow_snapshot_completed( reconciler->switch_info );
+}
+
+
+/*
+ * Sends a flow stats request for all flows in the switch. Applications are
+ * notified that the switch is ready when the last reply arrives.
+ */
+int
+start_flow_reconciliation( struct switch_info *sw_info ) {
+  assert( sw_info != NULL );
+
+  struct flow_reconciler *reconciler = sw_info->flow_reconciler;
+  if ( reconciler == NULL ) {
+    return -1;
+  }
+
+  struct ofp_match match;
+  memset( &match, 0, sizeof( match ) );
+  match.wildcards = OFPFW_ALL;
+  uint32_t xid = generate_xid();
+  buffer *buf = create_flow_stats_request( xid, 0, match, 0xff, OFPP_NONE );
+  if ( send_to_secure_channel( sw_info, buf ) < 0 ) {
+    free_buffer( buf );
+    return -1;
+  }
+  debug( "Send 'flow stats request' to a switch %#" PRIx64 ".", sw_info->datapath_id );
+
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  reconciler->taking_snapshot = true;
+  reconciler->snapshot_xid = xid;
+  reconciler->deadline = now.tv_sec + FLOW_SNAPSHOT_TIMEOUT;
+
+  return 0;
+}
+
+
+/*
+ * Returns true if buf is a reply to the flow stats request sent by
+ * start_flow_reconciliation(). buf is freed in that case.
+ */
+bool
+flow_reconciler_handle_reply( struct switch_info *sw_info, buffer *buf ) {
+  assert( sw_info != NULL );
+  assert( buf != NULL );
+
+  struct flow_reconciler *reconciler = sw_info->flow_reconciler;
+  struct ofp_stats_reply *stats_reply = buf->data;
+  if ( reconciler == NULL || !reconciler->taking_snapshot
+       || ntohl( stats_reply->header.xid ) != reconciler->snapshot_xid ) {
+    return false;
+  }
+
+  if ( ntohs( stats_reply->type ) == OFPST_FLOW ) {
+    size_t body_offset = offsetof( struct ofp_stats_reply, body );
+    size_t body_length = ntohs( stats_reply->header.length ) - body_offset;
+    struct ofp_flow_stats *flow_stats = ( void * ) ( ( char * ) stats_reply + body_offset );
+    while ( body_length >= sizeof( struct ofp_flow_stats ) ) {
+      uint16_t length = ntohs( flow_stats->length );
+      if ( length < sizeof( struct ofp_flow_stats ) || length > body_length ) {
+        warn( "Invalid flow stats length ( length = %u ).", length );
+        break;
+      }
+      restore_flow( reconciler, flow_stats );
+      body_length -= length;
+      flow_stats = ( void * ) ( ( char * ) flow_stats + length );
+    }
+  }
+
+  if ( ( ntohs( stats_reply->flags ) & OFPSF_REPLY_MORE ) == 0 ) {
+    complete_flow_snapshot( reconciler );
+  }
+  free_buffer( buf );
+
+  return true;
+}
+
+
+/*
+ * Called before a flow_mod from an application is sent. An added flow
+ * replaces the flow in the snapshot with the same match and priority, and
+ * the cookie restored for the replaced flow is released.
+ */
+void
+flow_reconciler_claim( struct switch_info *sw_info, const struct ofp_flow_mod *flow_mod ) {
+  assert( sw_info != NULL );
+  assert( flow_mod != NULL );
+
+  struct flow_reconciler *reconciler = sw_info->flow_reconciler;
+  if ( reconciler == NULL || reconciler->flows->length == 0 || ntohs( flow_mod->command ) != OFPFC_ADD ) {
+    return;
+  }
+
+  flow_key key;
+  make_flow_key( &key, &flow_mod->match, ntohs( flow_mod->priority ) );
+  restored_flow *flow = delete_hash_entry( reconciler->flows, &key );
+  if ( flow == NULL ) {
+    return;
+  }
+
+  if ( flow->cookie != RESERVED_COOKIE ) {
+    cookie_entry_t *entry = lookup_cookie_entry_by_cookie( sw_info, &flow->cookie );
+    if ( entry != NULL ) {
+      delete_cookie_entry( sw_info, entry );
+    }
+  }
+  xfree( flow );
+  reconciler->claimed++;
+  set_flow_reconciler_stats( reconciler );
+}
+
+
+static void
+delete_unclaimed_flows( struct flow_reconciler *reconciler ) {
+  struct switch_info *sw_info = reconciler->switch_info;
+  hash_table *unclaimed = reconciler->flows;
+  reconciler->flows = create_hash( compare_flow_key, hash_flow_key );
+
+  list_element *bufs;
+  create_list( &bufs );
+  hash_iterator iter;
+  hash_entry *e;
+  init_hash_iterator( unclaimed, &iter );
+  while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
+    restored_flow *flow = e->value;
+    // flow_removed for the flow releases its restored cookie
+    append_to_tail( &bufs, create_flow_mod( generate_xid(), flow->key.match, RESERVED_COOKIE, OFPFC_DELETE_STRICT,
+                                            0, 0, flow->priority, 0, OFPP_NONE, 0, NULL ) );
+    reconciler->deleted++;
+  }
+  delete_restored_flows( unclaimed );
+  set_flow_reconciler_stats( reconciler );
+  info( "Deleting %" PRIu64 " unclaimed flows from a switch %#" PRIx64 ".",
+        reconciler->deleted, sw_info->datapath_id );
+
+  // the switch may be disconnected and reconciler freed on failure
+  list_element *element;
+  bool failed = false;
+  for ( element = bufs; element != NULL; element = element->next ) {
+    if ( failed ) {
+      free_buffer( element->data );
+      continue;
+    }
+    if ( switch_event_send_to_secure_channel( sw_info, element->data ) < 0 ) {
+      failed = true;
+    }
+  }
+  delete_list( bufs );
+}
+
+
+static void
+check_flow_reconcilers( void *user_data ) {
+  UNUSED( user_data );
+
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+
+  list_element *element = reconcilers;
+  while ( element != NULL ) {
+    struct flow_reconciler *reconciler = element->data;
+    element = element->next;
+    if ( reconciler->switch_info->state != SWITCH_STATE_COMPLETED || reconciler->deadline == 0
+         || now.tv_sec < reconciler->deadline ) {
+      continue;
+    }
+    if ( reconciler->taking_snapshot ) {
+      warn( "No flow stats reply from a switch %#" PRIx64 " in %d seconds.",
+            reconciler->switch_info->datapath_id, ( int ) FLOW_SNAPSHOT_TIMEOUT );
+      complete_flow_snapshot( reconciler );
+      continue;
+    }
+    reconciler->deadline = 0;
+    if ( claim_period > 0 && reconciler->flows->length > 0 ) {
+      delete_unclaimed_flows( reconciler );
+    }
+  }
+}
+
+
+/*
+ * Enables warm-restart mode. Flows not claimed by applications in
+ * claim_period seconds after the switch gets ready are deleted. Zero
+ * keeps them.
+ */
+void
+init_flow_reconciler( time_t period ) {
+  enabled = true;
+  claim_period = period;
+  create_list( &reconcilers );
+  add_periodic_event_callback( FLOW_RECONCILER_CHECK_INTERVAL, check_flow_reconcilers, NULL );
+}
+
+
+void
+attach_flow_reconciler( struct switch_info *sw_info ) {
+  assert( sw_info != NULL );
+
+  if ( !enabled || sw_info->flow_reconciler != NULL ) {
+    return;
+  }
+
+  struct flow_reconciler *reconciler = xmalloc( sizeof( struct flow_reconciler ) );
+  memset( reconciler, 0, sizeof( struct flow_reconciler ) );
+  reconciler->switch_info = sw_info;
+  reconciler->flows = create_hash( compare_flow_key, hash_flow_key );
+  insert_in_front( &reconcilers, reconciler );
+  sw_info->flow_reconciler = reconciler;
+}
+
+
+void
+detach_flow_reconciler( struct switch_info *sw_info ) {
+  assert( sw_info != NULL );
+
+  struct flow_reconciler *reconciler = sw_info->flow_reconciler;
+  if ( reconciler == NULL ) {
+    return;
+  }
+
+  delete_element( &reconcilers, reconciler );
+  delete_restored_flows( reconciler->flows );
+  xfree( reconciler );
+  sw_info->flow_reconciler = NULL;
+}
+
+
+void
+finalize_flow_reconciler( void ) {
+  if ( !enabled ) {
+    return;
+  }
+
+  delete_periodic_event_callback( check_flow_reconcilers );
+  while ( reconcilers != NULL ) {
+    struct flow_reconciler *reconciler = reconcilers->data;
+    detach_flow_reconciler( reconciler->switch_info );
+  }
+  enabled = false;
+}
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,46 @@
+/*
+ * Copyright (C) 2008-2011 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef FLOW_RECONCILER_H
+#define FLOW_RECONCILER_H
+
+
+#include <openflow.h>
+#include <time.h>
+#include "trema.h"
+#include "switchinfo.h"
+
+
+void init_flow_reconciler( time_t claim_period );
+void finalize_flow_reconciler( void );
+void attach_flow_reconciler( struct switch_info *sw_info );
+void detach_flow_reconciler( struct switch_info *sw_info );
+int start_flow_reconciliation( struct switch_info *sw_info );
+bool flow_reconciler_handle_reply( struct switch_info *sw_info, buffer *buf );
+void flow_reconciler_claim( struct switch_info *sw_info, const struct ofp_flow_mod *flow_mod );
+
+
+#endif // FLOW_RECONCILER_H
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,376 @@
+/*
+ * Copyright (C) 2008-2011 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <assert.h>
+#include <inttypes.h>
+#include <openflow.h>
+#include <string.h>
+#include <time.h>
+#include "flow_key.h"
+#include "flow_shadow.h"
+
+
+/*
+ * A flow shadow holds the flows added by applications to a switch, which
+ * the switch daemon always asks to report as removed. An ADD identical to
+ * a flow in the shadow, i.e. from the same application with the same
+ * match, priority, cookie, timeouts, flags and actions, need not be sent
+ * to the switch. Flows with a hard timeout are only regarded as identical
+ * while the ADD may still be pending, since an ADD sent later would
+ * restart the timeout. A flow is deleted from the shadow when it is
+ * reported as removed, when an ADD of it fails, and when it may have been
+ * modified or deleted by an application.
+ *
+ * Instead of the actions and the application's name, a flow keeps a
+ * fixed-size digest of all that makes ADDs identical, so that it takes the
+ * same memory however long its actions are.
+ */
+#define SHADOW_FLOW_DIGEST_WORDS 2
+
+typedef struct shadow_flow {
+  flow_key key;
+  uint64_t digest[ SHADOW_FLOW_DIGEST_WORDS ];
+  uint16_t hard_timeout;
+  uint32_t xid;             // of the ADD sent to the switch
+  time_t sent_at;
+} shadow_flow;
+
+struct flow_shadow {
+  struct switch_info *switch_info;
+  hash_table *flows;        // flow_key -> shadow_flow
+  uint64_t n_flows;
+  uint64_t suppressed;      // ADDs not sent
+  uint64_t merged;          // ADDs sent as packet_out to release a buffered packet
+};
+
+
+static bool enabled = false;
+static list_element *shadows = NULL;
+
+static const time_t FLOW_SHADOW_STATS_INTERVAL = 1;
+static const time_t FLOW_ADD_PENDING_PERIOD = 1;
+
+
+static void
+set_flow_shadow_stats( struct flow_shadow *shadow ) {
+  char key[ STAT_KEY_LENGTH ];
+  uint64_t datapath_id = shadow->switch_info->datapath_id;
+
+  snprintf( key, sizeof( key ), "flow_shadow.%" PRIx64 ".flows", datapath_id );
+  set_stat( key, shadow->n_flows );
+  snprintf( key, sizeof( key ), "flow_shadow.%" PRIx64 ".suppressed", datapath_id );
+  set_stat( key, shadow->suppressed );
+  snprintf( key, sizeof( key ), "flow_shadow.%" PRIx64 ".merged", datapath_id );
+  set_stat( key, shadow->merged );
+}
+
+
+static void
+update_flow_shadow_stats( void *user_data ) {
+  UNUSED( user_data );
+
+  list_element *element;
+  for ( element = shadows; element != NULL; element = element->next ) {
+    set_flow_shadow_stats( element->data );
+  }
+}
+
+
+static void
+free_shadow_flow( shadow_flow *flow ) {
+  xfree( flow );
+}
+
+
+static void
+delete_shadow_flow( struct flow_shadow *shadow, const flow_key *key ) {
+  shadow_flow *flow = delete_hash_entry( shadow->flows, key );
+  if ( flow != NULL ) {
+    free_shadow_flow( flow );
+    shadow->n_flows--;
+  }
+}
+
+
+static void
+delete_shadow_flows( hash_table *flows ) {
+  hash_iterator iter;
+  hash_entry *e;
+
+  init_hash_iterator( flows, &iter );
+  while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
+    free_shadow_flow( e->value );
+  }
+  delete_hash( flows );
+}
+
+
+static uint64_t
+fnv1a( uint64_t hash, const void *data, size_t length ) {
+  const uint8_t *p = data;
+
+  for ( size_t i = 0; i < length; i++ ) {
+    hash ^= p[ i ];
+    hash *= UINT64_C( 0x100000001b3 );
+  }
+
+  return hash;
+}
+
+
+/*
+ * Digests the key, the application's name and the cookie, timeouts, flags
+ * and actions of an ADD with two FNV-1a hashes of different offset bases.
+ */
+static void
+make_shadow_flow_digest( uint64_t digest[ SHADOW_FLOW_DIGEST_WORDS ], const flow_key *key,
+                         const struct ofp_flow_mod *flow_mod, const char *service_name ) {
+  static const uint64_t offset_basis[ SHADOW_FLOW_DIGEST_WORDS ] = {
+    UINT64_C( 0xcbf29ce484222325 ), UINT64_C( 0x84222325cbf29ce4 )
+  };
+  size_t actions_length = ntohs( flow_mod->header.length ) - offsetof( struct ofp_flow_mod, actions );
+
+  for ( int i = 0; i < SHADOW_FLOW_DIGEST_WORDS; i++ ) {
+    uint64_t hash = offset_basis[ i ];
+    hash = fnv1a( hash, key, sizeof( flow_key ) );
+    hash = fnv1a( hash, service_name, strlen( service_name ) + 1 );
+    hash = fnv1a( hash, &flow_mod->cookie, sizeof( flow_mod->cookie ) );
+    hash = fnv1a( hash, &flow_mod->idle_timeout, sizeof( flow_mod->idle_timeout ) );
+    hash = fnv1a( hash, &flow_mod->hard_timeout, sizeof( flow_mod->hard_timeout ) );
+    hash = fnv1a( hash, &flow_mod->flags, sizeof( flow_mod->flags ) );
+    digest[ i ] = fnv1a( hash, flow_mod->actions, actions_length );
+  }
+}
+
+
+static bool
+add_shadow_flow( struct flow_shadow *shadow, const flow_key *key, const struct ofp_flow_mod *flow_mod,
+                 const char *service_name ) {
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+
+  uint64_t digest[ SHADOW_FLOW_DIGEST_WORDS ];
+  make_shadow_flow_digest( digest, key, flow_mod, service_name );
+
+  shadow_flow *flow = lookup_hash_entry( shadow->flows, key );
+  if ( flow != NULL && memcmp( flow->digest, digest, sizeof( digest ) ) == 0 ) {
+    if ( flow->hard_timeout == 0 || now.tv_sec - flow->sent_at < FLOW_ADD_PENDING_PERIOD ) {
+      return true;
+    }
+  }
+
+  // replaces the flow with the same match and priority in the switch
+  delete_shadow_flow( shadow, key );
+
+  flow = xmalloc( sizeof( shadow_flow ) );
+  flow->key = *key;
+  memcpy( flow->digest, digest, sizeof( digest ) );
+  flow->hard_timeout = ntohs( flow_mod->hard_timeout );
+  flow->xid = ntohl( flow_mod->header.xid );
+  flow->sent_at = now.tv_sec;
+  insert_hash_entry( shadow->flows, &flow->key, flow );
+  shadow->n_flows++;
+
+  return false;
+}
+
+
+/*
+ * Called before a flow_mod from an application is sent. Returns true if
+ * it is an ADD of a flow in the shadow, which need not be sent to the
+ * switch except for releasing the buffered packet it refers to.
+ */
+bool
+flow_shadow_handle_flow_mod( struct switch_info *sw_info, const struct ofp_flow_mod *flow_mod, const char *service_name ) {
+  assert( sw_info != NULL );
+  assert( flow_mod != NULL );
+  assert( service_name != NULL );
+
+  struct flow_shadow *shadow = sw_info->flow_shadow;
+  if ( shadow == NULL || ( ntohs( flow_mod->flags ) & OFPFF_EMERG ) != 0 ) {
+    return false;
+  }
+
+  flow_key key;
+  make_flow_key( &key, &flow_mod->match, ntohs( flow_mod->priority ) );
+
+  switch ( ntohs( flow_mod->command ) ) {
+  case OFPFC_ADD:
+  {
+    // the switch is asked to report an overlap in that case
+    if ( ( ntohs( flow_mod->flags ) & OFPFF_CHECK_OVERLAP ) != 0 ) {
+      delete_shadow_flow( shadow, &key );
+      return false;
+    }
+    if ( !add_shadow_flow( shadow, &key, flow_mod, service_name ) ) {
+      return false;
+    }
+    if ( ntohl( flow_mod->buffer_id ) != UINT32_MAX ) {
+      shadow->merged++;
+    }
+    else {
+      shadow->suppressed++;
+    }
+    debug( "Redundant flow_mod from %s to a switch %#" PRIx64 " ( xid = %#x, buffer_id = %#x ).",
+           service_name, sw_info->datapath_id, ntohl( flow_mod->header.xid ), ntohl( flow_mod->buffer_id ) );
+  }
+  return true;
+
+  case OFPFC_MODIFY_STRICT:
+  case OFPFC_DELETE_STRICT:
+    delete_shadow_flow( shadow, &key );
+    break;
+
+  default:
+    // may modify or delete any flows
+    if ( shadow->n_flows > 0 ) {
+      delete_shadow_flows( shadow->flows );
+      shadow->flows = create_hash( compare_flow_key, hash_flow_key );
+      shadow->n_flows = 0;
+    }
+    break;
+  }
+
+  return false;
+}
+
+
+void
+flow_shadow_handle_flow_removed( struct switch_info *sw_info, const struct ofp_flow_removed *flow_removed ) {
+  assert( sw_info != NULL );
+  assert( flow_removed != NULL );
+
+  struct flow_shadow *shadow = sw_info->flow_shadow;
+  if ( shadow == NULL ) {
+    return;
+  }
+
+  flow_key key;
+  make_flow_key( &key, &flow_removed->match, ntohs( flow_removed->priority ) );
+  delete_shadow_flow( shadow, &key );
+}
+
+
+/*
+ * Called when a flow_mod sent to the switch failed. A switch returns at
+ * least 64 bytes of it, which may not include the priority, so the flow
+ * is looked up by the transaction id in that case.
+ */
+void
+flow_shadow_handle_error( struct switch_info *sw_info, const struct ofp_flow_mod *flow_mod, size_t length ) {
+  assert( sw_info != NULL );
+  assert( flow_mod != NULL );
+
+  struct flow_shadow *shadow = sw_info->flow_shadow;
+  if ( shadow == NULL || shadow->n_flows == 0 ) {
+    return;
+  }
+
+  uint32_t xid = ntohl( flow_mod->header.xid );
+  if ( length >= offsetof( struct ofp_flow_mod, buffer_id ) ) {
+    flow_key key;
+    make_flow_key( &key, &flow_mod->match, ntohs( flow_mod->priority ) );
+    shadow_flow *flow = lookup_hash_entry( shadow->flows, &key );
+    if ( flow != NULL && flow->xid == xid ) {
+      delete_shadow_flow( shadow, &key );
+    }
+    return;
+  }
+
+  hash_iterator iter;
+  hash_entry *e;
+  init_hash_iterator( shadow->flows, &iter );
+  while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
+    shadow_flow *flow = e->value;
+    if ( flow->xid == xid ) {
+      delete_shadow_flow( shadow, &flow->key );
+      return;
+    }
+  }
+}
+
+
+void
+init_flow_shadow( void ) {
+  enabled = true;
+  create_list( &shadows );
+  add_periodic_event_callback( FLOW_SHADOW_STATS_INTERVAL, update_flow_shadow_stats, NULL );
+}
+
+
+void
+attach_flow_shadow( struct switch_info *sw_info ) {
+  assert( sw_info != NULL );
+
+  if ( !enabled || sw_info->flow_shadow != NULL ) {
+    return;
+  }
+
+  struct flow_shadow *shadow = xmalloc( sizeof( struct flow_shadow ) );
+  memset( shadow, 0, sizeof( struct flow_shadow ) );
+  shadow->switch_info = sw_info;
+  shadow->flows = create_hash( compare_flow_key, hash_flow_key );
+  insert_in_front( &shadows, shadow );
+  sw_info->flow_shadow = shadow;
+}
+
+
+static void
+delete_flow_shadow( struct flow_shadow *shadow ) {
+  delete_element( &shadows, shadow );
+  delete_shadow_flows( shadow->flows );
+  shadow->switch_info->flow_shadow = NULL;
+  xfree( shadow );
+}
+
+
+void
+detach_flow_shadow( struct switch_info *sw_info ) {
+  assert( sw_info != NULL );
+
+  struct flow_shadow *shadow = sw_info->flow_shadow;
+  if ( shadow == NULL ) {
+    return;
+  }
+
+  set_flow_shadow_stats( shadow );
+  delete_flow_shadow( shadow );
+}
+
+
+void
+finalize_flow_shadow( void ) {
+  if ( !enabled ) {
+    return;
+  }
+
+  delete_periodic_event_callback( update_flow_shadow_stats );
+  // stats may have been finalized already
+  while ( shadows != NULL ) {
+    delete_flow_shadow( shadows->data );
+  }
+  enabled = false;
+}
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2008-2011 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef FLOW_SHADOW_H
+#define FLOW_SHADOW_H
+
+
+#include <openflow.h>
+#include "trema.h"
+#include "switchinfo.h"
+
+
+void init_flow_shadow( void );
+void finalize_flow_shadow( void );
+void attach_flow_shadow( struct switch_info *sw_info );
+void detach_flow_shadow( struct switch_info *sw_info );
+bool flow_shadow_handle_flow_mod( struct switch_info *sw_info, const struct ofp_flow_mod *flow_mod, const char *service_name );
+void flow_shadow_handle_flow_removed( struct switch_info *sw_info, const struct ofp_flow_removed *flow_removed );
+void flow_shadow_handle_error( struct switch_info *sw_info, const struct ofp_flow_mod *flow_mod, size_t length );
+
+
+#endif // FLOW_SHADOW_H
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
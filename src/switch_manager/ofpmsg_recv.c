@@ -23,8 +23,12 @@
 #include <openflow.h>
 #include "openflow_message.h"
 #include "cookie_table.h"
+#include "echo_monitor.h"
+#include "flow_reconciler.h"
+#include "flow_shadow.h"
 #include "ofpmsg_recv.h"
 #include "ofpmsg_send.h"
+#include "packetin_policer.h"
 #include "service_interface.h"
 #include "switch.h"
 #include "xid_table.h"
@@ -120,6 +124,7 @@ ofpmsg_recv_error( struct switch_info *sw_info, buffer *buf ) {
     size_t length = ntohs( error_msg->header.length ) - offsetof( struct ofp_error_msg, data );
     if ( length >= offsetof( struct ofp_flow_mod, command ) ) {
       struct ofp_flow_mod *flow_mod = ( struct ofp_flow_mod * ) error_msg->data;
+      flow_shadow_handle_error( sw_info, flow_mod, length );
       uint32_t xid = ntohl( flow_mod->header.xid );
       xid_entry_t *xid_entry = lookup_xid_entry( xid );
       if ( xid_entry != NULL ) {
@@ -130,7 +135,7 @@ ofpmsg_recv_error( struct switch_info *sw_info, buffer *buf ) {
         free_buffer( buf );
         return 0;
       }
-      cookie_entry_t *entry = lookup_cookie_entry_by_cookie( &cookie );
+      cookie_entry_t *entry = lookup_cookie_entry_by_cookie( sw_info, &cookie );
       if ( entry != NULL ) {
         flow_mod->cookie = htonll( entry->application.cookie );
         if ( length >= offsetof( struct ofp_flow_mod, actions ) ) {
@@ -144,7 +149,7 @@ ofpmsg_recv_error( struct switch_info *sw_info, buffer *buf ) {
         case OFPFC_ADD:
         {
           if ( entry != NULL ) {
-            delete_cookie_entry( entry );
+            delete_cookie_entry( sw_info, entry );
           }
           else {
             error( "No cookie entry found ( cookie = %#" PRIx64 " ).", cookie );
@@ -190,7 +195,9 @@ int
 ofpmsg_recv_echoreply( struct switch_info *sw_info,  buffer *buf ) {
   ofpmsg_debug( "Receive 'echo reply' from a switch." );
 
-  // TODO: implement keepalive mechanism
+  if ( echo_monitor_handle_reply( sw_info, buf ) ) {
+    return 0;
+  }
 
   free_buffer( buf );
 
@@ -249,9 +256,21 @@ int
 ofpmsg_recv_packetin( struct switch_info *sw_info, buffer *buf ) {
   ofpmsg_debug( "Receive 'packet in' from a switch." );
 
-  service_send_to_application( sw_info->packetin_service_name_list,
-                               MESSENGER_OPENFLOW_MESSAGE,
-                               &sw_info->datapath_id, buf );
+  struct ofp_packet_in *packet_in = buf->data;
+  if ( !police_packetin( sw_info, ntohs( packet_in->in_port ) ) ) {
+    free_buffer( buf );
+    return 0;
+  }
+
+  // shed packet_in messages rather than filling up the send queue to a
+  // slow application, which is shared with more important messages
+  int skipped = service_send_to_uncongested_application( sw_info->packetin_service_name_list,
+                                                         MESSENGER_OPENFLOW_MESSAGE,
+                                                         &sw_info->datapath_id, buf,
+                                                         sw_info->packetin_congestion_threshold );
+  if ( skipped > 0 ) {
+    increment_stat( "switch.packet_in.congestion_dropped" );
+  }
   free_buffer( buf );
 
   return 0;
@@ -267,6 +286,7 @@ ofpmsg_recv_flowremoved( struct switch_info *sw_info, buffer *buf ) {
   ofpmsg_debug( "Receive 'flow removed' from a switch." );
 
   flow_removed = buf->data;
+  flow_shadow_handle_flow_removed( sw_info, flow_removed );
 
   cookie = ntohll( flow_removed->cookie );
   if ( cookie == RESERVED_COOKIE ) {
@@ -274,7 +294,7 @@ ofpmsg_recv_flowremoved( struct switch_info *sw_info, buffer *buf ) {
     return 0;
   }
 
-  entry = lookup_cookie_entry_by_cookie( &cookie );
+  entry = lookup_cookie_entry_by_cookie( sw_info, &cookie );
   if ( entry == NULL ) {
     error( "No cookie entry found ( cookie = %#" PRIx64 " ).", cookie );
     free_buffer( buf );
@@ -292,7 +312,7 @@ ofpmsg_recv_flowremoved( struct switch_info *sw_info, buffer *buf ) {
                            &sw_info->datapath_id, buf );
   }
 
-  delete_cookie_entry( entry );
+  delete_cookie_entry( sw_info, entry );
   free_buffer( buf );
 
   return 0;
@@ -319,13 +339,17 @@ ofpmsg_recv_statsreply( struct switch_info *sw_info, buffer *buf ) {
 
   ofpmsg_debug( "Receive 'statistics reply' from a switch." );
 
+  if ( flow_reconciler_handle_reply( sw_info, buf ) ) {
+    return 0;
+  }
+
   if ( type == OFPST_FLOW ) {
     size_t body_offset = offsetof( struct ofp_stats_reply, body );
     int body_length = ntohs( stats_reply->header.length ) - ( int ) body_offset;
     struct ofp_flow_stats *flow_stats = ( void * ) ( ( char * ) stats_reply + body_offset );
     while ( body_length > 0 ) {
       uint64_t cookie = ntohll( flow_stats->cookie );
-      cookie_entry_t *entry = lookup_cookie_entry_by_cookie( &cookie );
+      cookie_entry_t *entry = lookup_cookie_entry_by_cookie( sw_info, &cookie );
       if ( entry != NULL ) {
         debug( "Cookie entry found ( cookie = %#" PRIx64 ", application = [ cookie = %#" PRIx64 ", service name = %s ] ).",
                cookie, entry->application.cookie, entry->application.service_name );
@@ -355,6 +379,9 @@ ofpmsg_recv_statsreply( struct switch_info *sw_info, buffer *buf ) {
   if ( ( ntohs( stats_reply->flags ) & OFPSF_REPLY_MORE ) == 0 ) {
     delete_xid_entry( xid_entry );
   }
+  else {
+    refresh_xid_entry( xid_entry );
+  }
   free_buffer( buf );
 
   return 0;
@@ -23,6 +23,8 @@
 #include <stdio.h>
 #include <string.h>
 #include "cookie_table.h"
+#include "flow_reconciler.h"
+#include "flow_shadow.h"
 #include "ofpmsg_send.h"
 #include "secure_channel_sender.h"
 #include "switch.h"
@@ -118,7 +120,7 @@ ofpmsg_send_error_msg( struct switch_info *sw_info, uint16_t type, uint16_t code
 
 
 static int
-update_flowmod_cookie( buffer *buf, char *service_name ) {
+update_flowmod_cookie( struct switch_info *sw_info, buffer *buf, char *service_name ) {
   struct ofp_flow_mod *flow_mod = buf->data;
   uint16_t command = ntohs( flow_mod->command );
   uint16_t flags = ntohs( flow_mod->flags );
@@ -127,7 +129,7 @@ update_flowmod_cookie( buffer *buf, char *service_name ) {
   switch ( command ) {
   case OFPFC_ADD:
   {
-    uint64_t *new_cookie = insert_cookie_entry( &cookie, service_name, flags );
+    uint64_t *new_cookie = insert_cookie_entry( sw_info, &cookie, service_name, flags );
     if ( new_cookie == NULL ) {
       return -1;
     }
@@ -139,12 +141,12 @@ update_flowmod_cookie( buffer *buf, char *service_name ) {
   case OFPFC_MODIFY:
   case OFPFC_MODIFY_STRICT:
   {
-    cookie_entry_t *entry = lookup_cookie_entry_by_application( &cookie, service_name );
+    cookie_entry_t *entry = lookup_cookie_entry_by_application( sw_info, &cookie, service_name );
     if ( entry != NULL ) {
       flow_mod->cookie = htonll( entry->cookie );
     }
     else {
-      uint64_t *new_cookie = insert_cookie_entry( &cookie, service_name, flags );
+      uint64_t *new_cookie = insert_cookie_entry( sw_info, &cookie, service_name, flags );
       if ( new_cookie == NULL ) {
         return -1;
       }
@@ -157,7 +159,7 @@ update_flowmod_cookie( buffer *buf, char *service_name ) {
   case OFPFC_DELETE:
   case OFPFC_DELETE_STRICT:
   {
-    cookie_entry_t *entry = lookup_cookie_entry_by_application( &cookie, service_name );
+    cookie_entry_t *entry = lookup_cookie_entry_by_application( sw_info, &cookie, service_name );
     if ( entry != NULL ) {
       flow_mod->cookie = htonll( entry->cookie );
     }
@@ -176,6 +178,51 @@ update_flowmod_cookie( buffer *buf, char *service_name ) {
 }
 
 
+/*
+ * A redundant flow_mod is not sent, but its actions are applied to the
+ * buffered packet it refers to with a packet_out instead.
+ */
+static int
+send_buffered_packet( struct switch_info *sw_info, buffer *buf ) {
+  struct ofp_flow_mod *flow_mod = buf->data;
+
+  if ( ntohl( flow_mod->buffer_id ) == UINT32_MAX ) {
+    xid_entry_t *xid_entry = lookup_xid_entry( ntohl( flow_mod->header.xid ) );
+    if ( xid_entry != NULL ) {
+      delete_xid_entry( xid_entry );
+    }
+    free_buffer( buf );
+    return 0;
+  }
+
+  uint16_t actions_length = ( uint16_t ) ( ntohs( flow_mod->header.length ) - offsetof( struct ofp_flow_mod, actions ) );
+  uint16_t length = ( uint16_t ) ( offsetof( struct ofp_packet_out, actions ) + actions_length );
+  buffer *packet_out_buf = alloc_buffer_with_length( length );
+  struct ofp_packet_out *packet_out = append_back_buffer( packet_out_buf, length );
+  packet_out->header.version = OFP_VERSION;
+  packet_out->header.type = OFPT_PACKET_OUT;
+  packet_out->header.length = htons( length );
+  packet_out->header.xid = flow_mod->header.xid;
+  packet_out->buffer_id = flow_mod->buffer_id;
+  if ( ( ntohl( flow_mod->match.wildcards ) & OFPFW_IN_PORT ) != 0 ) {
+    packet_out->in_port = htons( OFPP_NONE );
+  }
+  else {
+    packet_out->in_port = flow_mod->match.in_port;
+  }
+  packet_out->actions_len = htons( actions_length );
+  memcpy( packet_out->actions, flow_mod->actions, actions_length );
+  free_buffer( buf );
+
+  int ret = send_to_secure_channel( sw_info, packet_out_buf );
+  if ( ret == 0 ) {
+    debug( "Send 'packet out' instead of a redundant flow_mod to a switch %#" PRIx64 ".", sw_info->datapath_id );
+  }
+
+  return ret;
+}
+
+
 int
 ofpmsg_send( struct switch_info *sw_info, buffer *buf, char *service_name ) {
   int ret;
@@ -184,11 +231,15 @@ ofpmsg_send( struct switch_info *sw_info, buffer *buf, char *service_name ) {
 
   ofp_header = buf->data;
 
-  new_xid = insert_xid_entry( ntohl( ofp_header->xid ), service_name );
+  new_xid = insert_xid_entry( ntohl( ofp_header->xid ), service_name, ofp_header->type );
   ofp_header->xid = htonl( new_xid );
 
   if ( ofp_header->type == OFPT_FLOW_MOD ) {
-    ret = update_flowmod_cookie( buf, service_name );
+    if ( flow_shadow_handle_flow_mod( sw_info, buf->data, service_name ) ) {
+      return send_buffered_packet( sw_info, buf );
+    }
+    flow_reconciler_claim( sw_info, buf->data );
+    ret = update_flowmod_cookie( sw_info, buf, service_name );
     if ( ret < 0 ) {
       error( "Failed to update cookie value ( ret = %d ).", ret );
       free_buffer( buf );
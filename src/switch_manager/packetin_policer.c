@@ -0,0 +1,344 @@
+/*
+ * Copyright (C) 2008-2011 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <assert.h>
+#include <inttypes.h>
+#include <openflow.h>
+#include <string.h>
+#include <time.h>
+#include "openflow_service_interface.h"
+#include "packetin_policer.h"
+#include "service_interface.h"
+#include "trema.h"
+
+
+#define NSEC_PER_SEC 1000000000ULL
+
+
+/*
+ * Token bucket. tokens are scaled by NSEC_PER_SEC so that refilling is
+ * done with integer arithmetic at nanosecond resolution.
+ */
+typedef struct token_bucket {
+  uint32_t in_port; // OFPP_NONE for the switch-wide bucket
+  uint64_t tokens;
+  uint64_t capacity;
+  uint32_t rate;
+  struct timespec updated_at;
+  bool throttled;
+  uint64_t dropped_while_throttled;
+  uint64_t dropped;
+} token_bucket;
+
+
+/*
+ * Policer state of a secure channel. A switch daemon that handles many
+ * secure channels has one for each of them.
+ */
+struct packetin_policer {
+  struct switch_info *switch_info;
+  token_bucket switch_bucket;
+  hash_table *port_buckets;
+};
+
+
+static bool policer_enabled = false;
+static packetin_policer_config_t policer_config;
+static list_element *policers = NULL;
+static const time_t PACKETIN_POLICER_AGING_INTERVAL = 1;
+
+
+static void
+init_token_bucket( token_bucket *bucket, uint32_t in_port, uint32_t rate, uint32_t burst ) {
+  memset( bucket, 0, sizeof( token_bucket ) );
+  bucket->in_port = in_port;
+  bucket->rate = rate;
+  bucket->capacity = ( uint64_t ) ( burst > 0 ? burst : rate ) * NSEC_PER_SEC;
+  bucket->tokens = bucket->capacity;
+  clock_gettime( CLOCK_MONOTONIC, &bucket->updated_at );
+}
+
+
+static void
+refill_token_bucket( token_bucket *bucket, const struct timespec *now ) {
+  if ( now->tv_sec < bucket->updated_at.tv_sec ) {
+    return;
+  }
+  uint64_t elapsed = ( uint64_t ) ( now->tv_sec - bucket->updated_at.tv_sec ) * NSEC_PER_SEC;
+  elapsed += ( uint64_t ) now->tv_nsec;
+  if ( elapsed < ( uint64_t ) bucket->updated_at.tv_nsec ) {
+    return;
+  }
+  elapsed -= ( uint64_t ) bucket->updated_at.tv_nsec;
+  bucket->updated_at = *now;
+
+  // compared by time first so that elapsed * rate cannot overflow
+  uint64_t deficit = bucket->capacity - bucket->tokens;
+  if ( elapsed >= deficit / bucket->rate ) {
+    bucket->tokens = bucket->capacity;
+  }
+  else {
+    bucket->tokens += elapsed * bucket->rate;
+  }
+}
+
+
+static void
+send_throttled_event( struct switch_info *sw_info, token_bucket *bucket, bool throttled ) {
+  openflow_packet_in_throttled_t event;
+  event.in_port = htons( ( uint16_t ) bucket->in_port );
+  event.throttled = throttled ? 1 : 0;
+  event.dropped = htonll( bucket->dropped_while_throttled );
+
+  buffer *data = alloc_buffer_with_length( sizeof( openflow_packet_in_throttled_t ) );
+  memcpy( append_back_buffer( data, sizeof( openflow_packet_in_throttled_t ) ), &event, sizeof( openflow_packet_in_throttled_t ) );
+  service_send_to_application( sw_info->state_service_name_list, MESSENGER_OPENFLOW_PACKET_IN_THROTTLED,
+                               &sw_info->datapath_id, data );
+  free_buffer( data );
+}
+
+
+static void
+drop_by_token_bucket( struct switch_info *sw_info, token_bucket *bucket ) {
+  bucket->dropped++;
+  bucket->dropped_while_throttled++;
+  if ( !bucket->throttled ) {
+    bucket->throttled = true;
+    warn( "Throttling packet_in messages ( dpid = %#" PRIx64 ", in_port = %#x, rate = %u ).",
+          sw_info->datapath_id, bucket->in_port, bucket->rate );
+    send_throttled_event( sw_info, bucket, true );
+  }
+}
+
+
+/*
+ * Throttling ends once the bucket has been refilled completely, i.e. the
+ * arrival rate stayed below the limit for the whole burst period. This
+ * keeps a switch sending right at the limit from flapping.
+ */
+static void
+release_token_bucket( struct switch_info *sw_info, token_bucket *bucket ) {
+  if ( !bucket->throttled || bucket->tokens < bucket->capacity ) {
+    return;
+  }
+
+  info( "Stopped throttling packet_in messages ( dpid = %#" PRIx64 ", in_port = %#x, dropped = %" PRIu64 " ).",
+        sw_info->datapath_id, bucket->in_port, bucket->dropped_while_throttled );
+  send_throttled_event( sw_info, bucket, false );
+  bucket->throttled = false;
+  bucket->dropped_while_throttled = 0;
+}
+
+
+static token_bucket *
+lookup_port_bucket( struct packetin_policer *policer, uint16_t in_port ) {
+  uint32_t key = in_port;
+  token_bucket *bucket = lookup_hash_entry( policer->port_buckets, &key );
+  if ( bucket == NULL ) {
+    bucket = xmalloc( sizeof( token_bucket ) );
+    init_token_bucket( bucket, key, policer_config.port_rate, policer_config.port_burst );
+    insert_hash_entry( policer->port_buckets, &bucket->in_port, bucket );
+  }
+
+  return bucket;
+}
+
+
+/*
+ * Returns true if a packet_in message received on in_port conforms to
+ * the configured rates. Tokens are consumed only if the message conforms
+ * to both the per-port and the switch-wide limits.
+ */
+bool
+police_packetin( struct switch_info *sw_info, uint16_t in_port ) {
+  assert( sw_info != NULL );
+
+  struct packetin_policer *policer = sw_info->packetin_policer;
+  if ( policer == NULL ) {
+    return true;
+  }
+
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+
+  token_bucket *port_bucket = NULL;
+  if ( policer->port_buckets != NULL ) {
+    port_bucket = lookup_port_bucket( policer, in_port );
+    refill_token_bucket( port_bucket, &now );
+    if ( port_bucket->tokens < NSEC_PER_SEC ) {
+      drop_by_token_bucket( sw_info, port_bucket );
+      return false;
+    }
+  }
+  if ( policer_config.switch_rate > 0 ) {
+    refill_token_bucket( &policer->switch_bucket, &now );
+    if ( policer->switch_bucket.tokens < NSEC_PER_SEC ) {
+      drop_by_token_bucket( sw_info, &policer->switch_bucket );
+      return false;
+    }
+    policer->switch_bucket.tokens -= NSEC_PER_SEC;
+  }
+  if ( port_bucket != NULL ) {
+    port_bucket->tokens -= NSEC_PER_SEC;
+  }
+
+  return true;
+}
+
+
+static void
+age_port_bucket( void *key, void *value, void *user_data ) {
+  UNUSED( key );
+
+  token_bucket *bucket = value;
+  struct packetin_policer *policer = user_data;
+  char stat_key[ STAT_KEY_LENGTH ];
+  struct timespec now;
+
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  refill_token_bucket( bucket, &now );
+  release_token_bucket( policer->switch_info, bucket );
+  if ( bucket->dropped > 0 ) {
+    snprintf( stat_key, sizeof( stat_key ), "packetin_policer.%" PRIx64 ".port.%u.dropped",
+              policer->switch_info->datapath_id, bucket->in_port );
+    set_stat( stat_key, bucket->dropped );
+  }
+}
+
+
+static void
+age_switch_bucket( struct packetin_policer *policer ) {
+  char stat_key[ STAT_KEY_LENGTH ];
+  struct timespec now;
+
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  refill_token_bucket( &policer->switch_bucket, &now );
+  release_token_bucket( policer->switch_info, &policer->switch_bucket );
+  snprintf( stat_key, sizeof( stat_key ), "packetin_policer.%" PRIx64 ".switch.dropped",
+            policer->switch_info->datapath_id );
+  set_stat( stat_key, policer->switch_bucket.dropped );
+}
+
+
+static void
+age_packetin_policer( void *user_data ) {
+  UNUSED( user_data );
+
+  list_element *element;
+  for ( element = policers; element != NULL; element = element->next ) {
+    struct packetin_policer *policer = element->data;
+    if ( policer_config.switch_rate > 0 ) {
+      age_switch_bucket( policer );
+    }
+    if ( policer->port_buckets != NULL ) {
+      foreach_hash( policer->port_buckets, age_port_bucket, policer );
+    }
+  }
+}
+
+
+void
+init_packetin_policer( const packetin_policer_config_t *config ) {
+  assert( config != NULL );
+
+  if ( config->switch_rate == 0 && config->port_rate == 0 ) {
+    return;
+  }
+
+  policer_config = *config;
+  create_list( &policers );
+  add_periodic_event_callback( PACKETIN_POLICER_AGING_INTERVAL, age_packetin_policer, NULL );
+  policer_enabled = true;
+}
+
+
+/*
+ * Starts policing packet_in messages from a secure channel. Does nothing
+ * unless rates are configured with init_packetin_policer().
+ */
+void
+attach_packetin_policer( struct switch_info *sw_info ) {
+  assert( sw_info != NULL );
+
+  if ( !policer_enabled || sw_info->packetin_policer != NULL ) {
+    return;
+  }
+
+  struct packetin_policer *policer = xmalloc( sizeof( struct packetin_policer ) );
+  memset( policer, 0, sizeof( struct packetin_policer ) );
+  policer->switch_info = sw_info;
+  if ( policer_config.switch_rate > 0 ) {
+    init_token_bucket( &policer->switch_bucket, OFPP_NONE, policer_config.switch_rate, policer_config.switch_burst );
+  }
+  if ( policer_config.port_rate > 0 ) {
+    policer->port_buckets = create_hash( compare_uint32, hash_uint32 );
+  }
+  insert_in_front( &policers, policer );
+  sw_info->packetin_policer = policer;
+}
+
+
+static void
+free_port_bucket( void *key, void *value, void *user_data ) {
+  UNUSED( key );
+  UNUSED( user_data );
+
+  xfree( value );
+}
+
+
+void
+detach_packetin_policer( struct switch_info *sw_info ) {
+  assert( sw_info != NULL );
+
+  struct packetin_policer *policer = sw_info->packetin_policer;
+  if ( policer == NULL ) {
+    return;
+  }
+
+  delete_element( &policers, policer );
+  if ( policer->port_buckets != NULL ) {
+    foreach_hash( policer->port_buckets, free_port_bucket, NULL );
+    delete_hash( policer->port_buckets );
+  }
+  xfree( policer );
+  sw_info->packetin_policer = NULL;
+}
+
+
+void
+finalize_packetin_policer( void ) {
+  if ( !policer_enabled ) {
+    return;
+  }
+
+  delete_periodic_event_callback( age_packetin_policer );
+  while ( policers != NULL ) {
+    struct packetin_policer *policer = policers->data;
+    detach_packetin_policer( policer->switch_info );
+  }
+  policer_enabled = false;
+}
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,50 @@
+/*
+ * Copyright (C) 2008-2011 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef PACKETIN_POLICER_H
+#define PACKETIN_POLICER_H
+
+
+#include "trema.h"
+#include "switchinfo.h"
+
+
+typedef struct packetin_policer_config {
+  uint32_t switch_rate;  // packet_in messages per second. zero means unlimited
+  uint32_t switch_burst; // bucket depth in packet_in messages
+  uint32_t port_rate;    // same as above but for each in_port
+  uint32_t port_burst;
+} packetin_policer_config_t;
+
+
+void init_packetin_policer( const packetin_policer_config_t *config );
+void finalize_packetin_policer( void );
+void attach_packetin_policer( struct switch_info *sw_info );
+void detach_packetin_policer( struct switch_info *sw_info );
+bool police_packetin( struct switch_info *sw_info, uint16_t in_port );
+
+
+#endif // PACKETIN_POLICER_H
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
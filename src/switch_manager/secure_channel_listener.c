@@ -28,10 +28,12 @@
 #include <string.h>
 #include <sys/socket.h>
 #include <sys/types.h>
+#include <time.h>
 #include <unistd.h>
 #include "trema.h"
 #include "secure_channel_listener.h"
 #include "switch_manager.h"
+#include "switch_pool.h"
 
 
 const int LISTEN_SOCK_MAX = 128;
@@ -167,27 +169,25 @@ secure_channel_listen_start( struct listener_info *listener_info ) {
 
 
 static char **
-make_switch_daemon_args( struct listener_info *listener_info, struct sockaddr_in *addr, int accept_fd ) {
+make_switch_daemon_args( struct listener_info *listener_info, const char *name, const char *fd_option, int fd ) {
   int argc = SWITCH_MANAGER_DEFAULT_ARGC + listener_info->switch_daemon_argc + 1;
   char **argv = xcalloc( ( size_t ) argc, sizeof( char * ) );
-  char *command_name = xasprintf( "%s%s:%u", SWITCH_MANAGER_COMMAND_PREFIX,
-                                  inet_ntoa( addr->sin_addr ),
-                                   ntohs( addr->sin_port ) );
-  char *service_name = xasprintf( "%s%s%s:%u", SWITCH_MANAGER_NAME_OPTION,
-                                  SWITCH_MANAGER_PREFIX,
-                                  inet_ntoa( addr->sin_addr ),
-                                  ntohs( addr->sin_port ) );
-  char *socket_opt = xasprintf( "%s%d", SWITCH_MANAGER_SOCKET_OPTION,
-                                accept_fd );
+  char *command_name = xasprintf( "%s%s", SWITCH_MANAGER_COMMAND_PREFIX, name );
+  char *service_name = xasprintf( "%s%s%s", SWITCH_MANAGER_NAME_OPTION,
+                                  SWITCH_MANAGER_PREFIX, name );
+  char *socket_opt = xasprintf( "%s%d", fd_option, fd );
   char *daemonize_opt = xstrdup( SWITCH_MANAGER_DAEMONIZE_OPTION );
   char *notify_opt = xasprintf( "%s%s", SWITCH_MANAGER_STATE_PREFIX,
                                 get_trema_name() );
+  char *registry_opt = xasprintf( "%s%s", SWITCH_MANAGER_REGISTRY_OPTION,
+                                  get_trema_name() );
 
   int i = 0;
   argv[ i++ ] = command_name;
   argv[ i++ ] = service_name;
   argv[ i++ ] = socket_opt;
   argv[ i++ ] = daemonize_opt;
+  argv[ i++ ] = registry_opt;
   argv[ i++ ] = notify_opt;
   int j;
   for ( j = 0; j < listener_info->switch_daemon_argc; i++, j++ ) {
@@ -211,6 +211,45 @@ free_switch_daemon_args( char **argv ) {
 static const int ACCEPT_FD = 3;
 
 
+static void
+exec_switch_daemon( struct listener_info *listener_info, const char *name, const char *fd_option, int fd ) {
+  if ( fd < ACCEPT_FD ) {
+    dup2( fd, ACCEPT_FD );
+    close( fd );
+    fd = ACCEPT_FD;
+  }
+  // the fd may be marked close-on-exec for daemons started by the pool
+  fcntl( fd, F_SETFD, 0 );
+
+  char **argv = make_switch_daemon_args( listener_info, name, fd_option, fd );
+
+  int in_fd = open( "/dev/null", O_RDONLY );
+  if ( in_fd != 0 ) {
+    dup2( in_fd, 0 );
+    close( in_fd );
+  }
+  int out_fd = open( "/dev/null", O_WRONLY );
+  if ( out_fd != 1 ) {
+    dup2( out_fd, 1 );
+    close( out_fd );
+  }
+  int err_fd = open( "/dev/null", O_WRONLY );
+  if ( err_fd != 2 ) {
+    dup2( err_fd, 2 );
+    close( err_fd );
+  }
+
+  execvp( listener_info->switch_daemon, argv );
+  error( "Failed to execvp: %s(%s) %s %s. %s.",
+    argv[ 0 ], listener_info->switch_daemon,
+    argv[ 1 ], argv[ 2 ], strerror( errno ) );
+
+  free_switch_daemon_args( argv );
+
+  UNREACHABLE();
+}
+
+
 void
 secure_channel_accept( struct listener_info *listener_info ) {
   struct sockaddr_in addr;
@@ -225,6 +264,16 @@ secure_channel_accept( struct listener_info *listener_info ) {
     error( "Failed to accept from switch. :%s.", strerror( errno )  );
     return;
   }
+  if ( switch_pool_enabled() ) {
+    // daemons started later must not hold the secure channel
+    fcntl( accept_fd, F_SETFD, FD_CLOEXEC );
+    struct timespec accepted_at;
+    clock_gettime( CLOCK_MONOTONIC, &accepted_at );
+    if ( switch_pool_hand_over( accept_fd, &accepted_at ) ) {
+      close( accept_fd );
+      return;
+    }
+  }
   pid = fork();
   if ( pid < 0 ) {
     error( "Failed to fork. %s.", strerror( errno ) );
@@ -232,43 +281,76 @@ secure_channel_accept( struct listener_info *listener_info ) {
     return;
   }
   if ( pid == 0 ) {
-    if ( accept_fd < ACCEPT_FD ) {
-      dup2( accept_fd, ACCEPT_FD );
-      close( accept_fd );
-      accept_fd = ACCEPT_FD;
-    }
+    char name[ SWITCH_MANAGER_ADDR_STR_LEN ];
+    snprintf( name, sizeof( name ), "%s:%u", inet_ntoa( addr.sin_addr ), ntohs( addr.sin_port ) );
+    exec_switch_daemon( listener_info, name, SWITCH_MANAGER_SOCKET_OPTION, accept_fd );
+  }
+  else {
+    /* parent */
+    close( accept_fd );
+  }
+}
 
-    char **argv = make_switch_daemon_args( listener_info, &addr, accept_fd );
 
-    int in_fd = open( "/dev/null", O_RDONLY );
-    if ( in_fd != 0 ) {
-      dup2( in_fd, 0 );
-      close( in_fd );
-    }
-    int out_fd = open( "/dev/null", O_WRONLY );
-    if ( out_fd != 1 ) {
-      dup2( out_fd, 1 );
-      close( out_fd );
-    }
-    int err_fd = open( "/dev/null", O_WRONLY );
-    if ( err_fd != 2 ) {
-      dup2( err_fd, 2 );
-      close( err_fd );
-    }
+/*
+ * Starts a switch process that waits for a secure channel passed over a
+ * socket pair. Returns our end of the socket pair.
+ */
+int
+secure_channel_start_pooled_switch_daemon( struct listener_info *listener_info ) {
+  static unsigned int sequence = 0;
+  int fds[ 2 ];
+  int pid;
 
-    execvp( listener_info->switch_daemon, argv );
-    error( "Failed to execvp: %s(%s) %s %s. %s.",
-      argv[ 0 ], listener_info->switch_daemon,
-      argv[ 1 ], argv[ 2 ], strerror( errno ) );
+  if ( socketpair( AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, fds ) < 0 ) {
+    error( "Failed to create socket pair. %s.", strerror( errno ) );
+    return -1;
+  }
+  sequence++;
 
-    free_switch_daemon_args( argv );
+  pid = fork();
+  if ( pid < 0 ) {
+    error( "Failed to fork. %s.", strerror( errno ) );
+    close( fds[ 0 ] );
+    close( fds[ 1 ] );
+    return -1;
+  }
+  if ( pid == 0 ) {
+    // the daemon may outlive us, so it must not keep the listening socket
+    close( listener_info->listen_fd );
 
-    UNREACHABLE();
+    char name[ sizeof( SWITCH_MANAGER_POOL_PREFIX ) + SWITCH_MANAGER_SOCKET_STR_LEN ];
+    snprintf( name, sizeof( name ), "%s%u", SWITCH_MANAGER_POOL_PREFIX, sequence );
+    exec_switch_daemon( listener_info, name, SWITCH_MANAGER_POOL_OPTION, fds[ 1 ] );
   }
-  else {
-    /* parent */
-    close( accept_fd );
+
+  close( fds[ 1 ] );
+
+  return fds[ 0 ];
+}
+
+
+/*
+ * Starts a switch process that accepts secure channels from the listening
+ * socket by itself and handles all of them, instead of forking a switch
+ * process for each secure channel.
+ */
+bool
+secure_channel_start_multi_switch_daemon( struct listener_info *listener_info, int index ) {
+  int pid;
+
+  pid = fork();
+  if ( pid < 0 ) {
+    error( "Failed to fork. %s.", strerror( errno ) );
+    return false;
   }
+  if ( pid == 0 ) {
+    char name[ sizeof( SWITCH_MANAGER_MULTI_SWITCH_PREFIX ) + SWITCH_MANAGER_SOCKET_STR_LEN ];
+    snprintf( name, sizeof( name ), "%s%d", SWITCH_MANAGER_MULTI_SWITCH_PREFIX, index );
+    exec_switch_daemon( listener_info, name, SWITCH_MANAGER_LISTEN_OPTION, listener_info->listen_fd );
+  }
+
+  return true;
 }
 
 
@@ -29,6 +29,8 @@
 
 bool secure_channel_listen_start( struct listener_info *listener_info );
 void secure_channel_accept( struct listener_info *listener_info );
+bool secure_channel_start_multi_switch_daemon( struct listener_info *listener_info, int index );
+int secure_channel_start_pooled_switch_daemon( struct listener_info *listener_info );
 
 
 #endif // SECURE_CANNEL_LISTENER_H
@@ -21,34 +21,161 @@
 #include <assert.h>
 #include <errno.h>
 #include <openflow.h>
+#include <stdint.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/uio.h>
 #include "trema.h"
+#include "echo_monitor.h"
 #include "message_queue.h"
 #include "ofpmsg_recv.h"
 #include "ofpmsg_send.h"
 #include "secure_channel_receiver.h"
 
 
-int
-recv_from_secure_channel( struct switch_info *sw_info ) {
-  assert( sw_info != NULL );
-  assert( sw_info->recv_queue != NULL );
+/*
+ * Received bytes are kept in reference counted chunks. Every complete
+ * message is queued as a buffer that points into its chunk and drops a
+ * reference when freed, so such buffers must not be resized. A chunk has
+ * headroom in front of its body where a partial message left at the end
+ * of the preceding chunk is completed.
+ */
+
+#define RECV_CHUNK_HEADROOM ( UINT16_MAX + 1 ) // longer than any partial message
+#define RECV_CHUNK_BODY_SIZE ( 64 * 1024 )
+
+// stop reading from the secure channel while this many messages are queued
+#define RECV_QUEUE_HIGH_WATERMARK 1024
+
+
+typedef struct recv_chunk {
+  unsigned int refcount;  // held by the ring and by each queued message
+  char *begin;            // first byte that is not framed yet
+  char *end;              // end of received bytes
+  char data[ RECV_CHUNK_HEADROOM + RECV_CHUNK_BODY_SIZE ];
+} recv_chunk;
+
+
+struct recv_ring {
+  recv_chunk *current;
+  recv_chunk *spare;      // read into when current runs out of space
+};
+
+
+static char *
+body_of( recv_chunk *chunk ) {
+  return chunk->data + RECV_CHUNK_HEADROOM;
+}
+
+
+static char *
+tail_of( recv_chunk *chunk ) {
+  return chunk->data + sizeof( chunk->data );
+}
+
+
+static recv_chunk *
+alloc_recv_chunk( void ) {
+  recv_chunk *chunk = xmalloc( sizeof( recv_chunk ) );
+  chunk->refcount = 1;
+  chunk->begin = body_of( chunk );
+  chunk->end = body_of( chunk );
+
+  return chunk;
+}
+
+
+static void
+release_recv_chunk( recv_chunk *chunk ) {
+  assert( chunk->refcount > 0 );
+
+  if ( --chunk->refcount == 0 ) {
+    xfree( chunk );
+  }
+}
+
+
+static void
+free_message_slice( buffer *message ) {
+  release_recv_chunk( message->user_data );
+  message->user_data = NULL;
+  message->user_data_free_function = NULL;
+}
+
+
+static buffer *
+slice_recv_chunk( recv_chunk *chunk, size_t length ) {
+  buffer *message = alloc_buffer();
+  message->data = chunk->begin;
+  message->length = length;
+  message->user_data = chunk;
+  message->user_data_free_function = free_message_slice;
+  chunk->refcount++;
+  chunk->begin += length;
+
+  return message;
+}
+
+
+static int
+frame_messages( struct switch_info *sw_info, recv_chunk *chunk ) {
+  while ( ( size_t ) ( chunk->end - chunk->begin ) >= sizeof( struct ofp_header ) ) {
+    struct ofp_header *header = ( void * ) chunk->begin;
+    if ( header->version != OFP_VERSION ) {
+      error( "Receive error: invalid version (version %d)", header->version );
+      buffer *data = slice_recv_chunk( chunk, ( size_t ) ( chunk->end - chunk->begin ) );
+      ofpmsg_send_error_msg( sw_info, OFPET_BAD_REQUEST, OFPBRC_BAD_VERSION, data );
+      free_buffer( data );
+      return -1;
+    }
+    uint16_t message_length = ntohs( header->length );
+    if ( message_length < sizeof( struct ofp_header ) ) {
+      error( "Receive error: invalid length (length %u)", message_length );
+      return -1;
+    }
+    if ( message_length > chunk->end - chunk->begin ) {
+      break;
+    }
+    enqueue_message( sw_info->recv_queue, slice_recv_chunk( chunk, message_length ) );
+  }
+
+  return 0;
+}
+
 
-  // all queued messages should be processed before receiving new messages from remote
-  if ( sw_info->recv_queue->length > 0 ) {
-    return 0;
+// returns the number of bytes read, or -1 if the secure channel has failed
+static ssize_t
+read_secure_channel( struct switch_info *sw_info, bool *drained ) {
+  if ( sw_info->recv_ring == NULL ) {
+    sw_info->recv_ring = xmalloc( sizeof( struct recv_ring ) );
+    sw_info->recv_ring->current = alloc_recv_chunk();
+    sw_info->recv_ring->spare = NULL;
   }
+  struct recv_ring *ring = sw_info->recv_ring;
+  recv_chunk *current = ring->current;
 
-  if ( sw_info->fragment_buf == NULL ) {
-    sw_info->fragment_buf = alloc_buffer_with_length( UINT16_MAX );
+  // rewind if no queued message refers to the chunk
+  if ( current->refcount == 1 && current->end != body_of( current ) ) {
+    size_t fragment_length = ( size_t ) ( current->end - current->begin );
+    assert( fragment_length <= RECV_CHUNK_HEADROOM );
+    memmove( body_of( current ) - fragment_length, current->begin, fragment_length );
+    current->begin = body_of( current ) - fragment_length;
+    current->end = body_of( current );
+  }
+  if ( ring->spare == NULL ) {
+    ring->spare = alloc_recv_chunk();
   }
 
-  size_t remaining_length = UINT16_MAX - sw_info->fragment_buf->length;
-  char *recv_buf = ( char * ) sw_info->fragment_buf->data + sw_info->fragment_buf->length;
-  ssize_t recv_length = read( sw_info->secure_channel_fd, recv_buf, remaining_length );
+  struct iovec iov[ 2 ];
+  iov[ 0 ].iov_base = current->end;
+  iov[ 0 ].iov_len = ( size_t ) ( tail_of( current ) - current->end );
+  iov[ 1 ].iov_base = body_of( ring->spare );
+  iov[ 1 ].iov_len = RECV_CHUNK_BODY_SIZE;
+  ssize_t recv_length = readv( sw_info->secure_channel_fd, iov, 2 );
   if ( recv_length < 0 ) {
     if ( errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK ) {
+      *drained = true;
       return 0;
     }
     error( "Receive error:%s(%d)", strerror( errno ), errno );
@@ -58,58 +185,119 @@ recv_from_secure_channel( struct switch_info *sw_info ) {
     debug( "Connection closed by peer." );
     return -1;
   }
-  sw_info->fragment_buf->length += ( size_t ) recv_length;
 
-  size_t read_total = 0;
-  while ( sw_info->fragment_buf->length >= sizeof( struct ofp_header ) ) {
-    struct ofp_header *header = sw_info->fragment_buf->data;
-    if ( header->version != OFP_VERSION ) {
-      error( "Receive error: invalid version (version %d)", header->version );
-      ofpmsg_send_error_msg( sw_info,
-                             OFPET_BAD_REQUEST, OFPBRC_BAD_VERSION, sw_info->fragment_buf );
+  *drained = ( size_t ) recv_length < iov[ 0 ].iov_len + iov[ 1 ].iov_len;
+
+  if ( ( size_t ) recv_length <= iov[ 0 ].iov_len ) {
+    current->end += recv_length;
+    return frame_messages( sw_info, current ) < 0 ? -1 : recv_length;
+  }
+
+  current->end = tail_of( current );
+  if ( frame_messages( sw_info, current ) < 0 ) {
+    return -1;
+  }
+
+  // the spare chunk takes over, starting with the partial message left
+  recv_chunk *next = ring->spare;
+  size_t fragment_length = ( size_t ) ( current->end - current->begin );
+  assert( fragment_length <= RECV_CHUNK_HEADROOM );
+  next->begin = body_of( next ) - fragment_length;
+  memcpy( next->begin, current->begin, fragment_length );
+  next->end = body_of( next ) + ( ( size_t ) recv_length - iov[ 0 ].iov_len );
+  ring->current = next;
+  ring->spare = NULL;
+  if ( current->refcount == 1 ) {
+    current->begin = body_of( current );
+    current->end = body_of( current );
+    ring->spare = current;
+  }
+  else {
+    release_recv_chunk( current );
+  }
+
+  return frame_messages( sw_info, next ) < 0 ? -1 : recv_length;
+}
+
+
+/*
+ * Reads from the secure channel until it is drained or recv_budget bytes
+ * have been read. Nothing is read while too many messages are queued, so
+ * that a switch that sends faster than its messages are handled is
+ * slowed down by TCP flow control.
+ */
+int
+recv_from_secure_channel( struct switch_info *sw_info ) {
+  assert( sw_info != NULL );
+  assert( sw_info->recv_queue != NULL );
+
+  size_t received = 0;
+  while ( received < sw_info->recv_budget && sw_info->recv_queue->length < RECV_QUEUE_HIGH_WATERMARK ) {
+    bool drained = false;
+    ssize_t recv_length = read_secure_channel( sw_info, &drained );
+    if ( recv_length < 0 ) {
       return -1;
     }
-    uint16_t message_length = ntohs( header->length );
-    if ( message_length > sw_info->fragment_buf->length ) {
+    received += ( size_t ) recv_length;
+    if ( drained ) {
       break;
     }
-    buffer *message = alloc_buffer_with_length( message_length );
-    char *p = append_back_buffer( message, message_length );
-    memcpy( p, sw_info->fragment_buf->data, message_length );
-    remove_front_buffer( sw_info->fragment_buf, message_length ); 
-    enqueue_message( sw_info->recv_queue, message );
-    read_total += message_length;
   }
 
-  // remove headroom manually for next call
-  if ( read_total > 0 ) {
-    memmove( ( char * ) sw_info->fragment_buf->data - read_total,
-             sw_info->fragment_buf->data,
-             sw_info->fragment_buf->length );
-    sw_info->fragment_buf->data = ( char * ) sw_info->fragment_buf->data - read_total;
+  return 0;
+}
+
+
+void
+finalize_secure_channel_receiver( struct switch_info *sw_info ) {
+  assert( sw_info != NULL );
+
+  if ( sw_info->recv_ring == NULL ) {
+    return;
+  }
+  release_recv_chunk( sw_info->recv_ring->current );
+  if ( sw_info->recv_ring->spare != NULL ) {
+    release_recv_chunk( sw_info->recv_ring->spare );
   }
+  xfree( sw_info->recv_ring );
+  sw_info->recv_ring = NULL;
+}
 
-  return 0;
+
+static long
+elapsed_usec( const struct timespec *since ) {
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+
+  return ( now.tv_sec - since->tv_sec ) * 1000000 + ( now.tv_nsec - since->tv_nsec ) / 1000;
 }
 
 
+/*
+ * Handles queued messages until the queue is empty or handle_budget
+ * microseconds have passed. At least one message is handled per call.
+ */
 int
 handle_messages_from_secure_channel( struct switch_info *sw_info ) {
   assert( sw_info != NULL );
   assert( sw_info->recv_queue != NULL );
 
-  int ret;
   int errors = 0;
-  int received = 0;
   buffer *message;
+  struct timespec started_at;
 
-  while ( ( message = dequeue_message( sw_info->recv_queue ) ) != NULL && received < 64 ) { // FIXME: magic number
-    ret = ofpmsg_recv( sw_info, message );
-    if ( ret < 0 ) {
+  clock_gettime( CLOCK_MONOTONIC, &started_at );
+  echo_monitor_seen( sw_info, &started_at );
+  // handling a message may disconnect the switch
+  while ( sw_info->state != SWITCH_STATE_DISCONNECTED
+          && ( message = dequeue_message( sw_info->recv_queue ) ) != NULL ) {
+    if ( ofpmsg_recv( sw_info, message ) < 0 ) {
       error( "Failed to handle message to application." );
       errors++;
     }
-    received++;
+    if ( elapsed_usec( &started_at ) >= sw_info->handle_budget ) {
+      break;
+    }
   }
 
   return errors == 0 ? 0 : -1;
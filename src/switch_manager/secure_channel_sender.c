@@ -23,12 +23,22 @@
 #include <openflow.h>
 #include <string.h>
 #include <unistd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include "message_queue.h"
 #include "ofpmsg_send.h"
 #include "secure_channel_sender.h"
 #include "trema.h"
 
 
+// messages gathered into a single writev()
+#define MAX_MESSAGES_PER_WRITE 64
+
+static uint64_t writes = 0;
+static uint64_t written_messages = 0;
+static uint64_t written_bytes = 0;
+
+
 int
 send_to_secure_channel( struct switch_info *sw_info, buffer *buf ) {
   assert( sw_info != NULL );
@@ -43,34 +53,90 @@ send_to_secure_channel( struct switch_info *sw_info, buffer *buf ) {
 }
 
 
+static ssize_t
+write_secure_channel( struct switch_info *sw_info, struct iovec *iov, int iovcnt, bool more ) {
+  if ( !sw_info->cork ) {
+    return writev( sw_info->secure_channel_fd, iov, iovcnt );
+  }
+
+  // let the kernel hold a partial segment back while more messages follow
+  struct msghdr msg;
+  memset( &msg, 0, sizeof( struct msghdr ) );
+  msg.msg_iov = iov;
+  msg.msg_iovlen = ( size_t ) iovcnt;
+
+  return sendmsg( sw_info->secure_channel_fd, &msg, more ? MSG_MORE : 0 );
+}
+
+
+static void
+release_written_messages( message_queue *send_queue, size_t length ) {
+  while ( length > 0 ) {
+    buffer *buf = peek_message( send_queue );
+    assert( buf != NULL );
+    if ( length < buf->length ) {
+      remove_front_buffer( buf, length );
+      return;
+    }
+    length -= buf->length;
+    free_buffer( dequeue_message( send_queue ) );
+    written_messages++;
+  }
+}
+
+
+static void
+update_sender_stats( void ) {
+  set_stat( "secure_channel_sender.writes", writes );
+  set_stat( "secure_channel_sender.messages", written_messages );
+  set_stat( "secure_channel_sender.bytes", written_bytes );
+}
+
+
 int
 flush_secure_channel( struct switch_info *sw_info ) {
   assert( sw_info != NULL );
   assert( sw_info->send_queue != NULL );
   assert( sw_info->secure_channel_fd >= 0 );
 
-  buffer *buf;
-  ssize_t write_length;
+  struct iovec iov[ MAX_MESSAGES_PER_WRITE ];
+  size_t written = 0;
+  int ret = 0;
+
+  // the rest of the queue is written at the next wakeup if send_budget runs out
+  while ( sw_info->send_queue->head != NULL && written < sw_info->send_budget ) {
+    int iovcnt = 0;
+    size_t length = 0;
+    list_element *element = sw_info->send_queue->head;
+    for ( ; element != NULL && iovcnt < MAX_MESSAGES_PER_WRITE; element = element->next ) {
+      buffer *buf = element->data;
+      iov[ iovcnt ].iov_base = buf->data;
+      iov[ iovcnt ].iov_len = buf->length;
+      length += buf->length;
+      iovcnt++;
+    }
 
-  while ( ( buf = peek_message( sw_info->send_queue ) ) != NULL ) {
-    write_length = write( sw_info->secure_channel_fd, buf->data, buf->length );
+    ssize_t write_length = write_secure_channel( sw_info, iov, iovcnt, element != NULL );
     if ( write_length < 0 ) {
-      if ( errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK ) {
-        return 0;
+      if ( errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK ) {
+        error( "Failed to send a message to secure channel ( errno = %s [%d] ).",
+               strerror( errno ), errno );
+        ret = -1;
       }
-      error( "Failed to send a message to secure channel ( errno = %s [%d] ).",
-             strerror( errno ), errno );
-      return -1;
+      break;
     }
-    if ( ( size_t ) write_length < buf->length ) {
-      remove_front_buffer( buf, ( size_t ) write_length );
-      return 0;
+    writes++;
+    written += ( size_t ) write_length;
+    written_bytes += ( uint64_t ) write_length;
+    release_written_messages( sw_info->send_queue, ( size_t ) write_length );
+    if ( ( size_t ) write_length < length ) {
+      // the rest waits until the secure channel gets writable again
+      break;
     }
-    buf = dequeue_message( sw_info->send_queue );
-    free_buffer( buf );
   }
+  update_sender_stats();
 
-  return 0;
+  return ret;
 }
 
 
@@ -18,100 +18,305 @@
  */
 
 
+#include <assert.h>
 #include <string.h>
 #include <inttypes.h>
+#include <sys/uio.h>
 #include "ofpmsg_send.h"
 #include "openflow_service_interface.h"
 #include "service_interface.h"
 #include "trema.h"
 
 
-static buffer *
-create_openflow_application_message( uint64_t *datapath_id, buffer *data ) {
-  openflow_service_header_t *message;
-  buffer *buf;
-  void *append;
-  size_t append_len = 0;
-
-  if ( data != NULL ) {
-     append_len = data->length;
-  }
-  buf = alloc_buffer_with_length( sizeof( openflow_service_header_t ) + append_len );
-  message = append_back_buffer( buf, sizeof( openflow_service_header_t ) );
-  if (datapath_id == NULL) {
-    message->datapath_id = ~0U; // FIXME: defined invalid datapath_id
+static void
+make_openflow_application_message( struct iovec *iov, openflow_service_header_t *header, uint64_t *datapath_id, buffer *data ) {
+  if ( datapath_id == NULL ) {
+    header->datapath_id = ~0U; // FIXME: defined invalid datapath_id
   } else {
-    message->datapath_id = htonll( *datapath_id );
+    header->datapath_id = htonll( *datapath_id );
   }
-  message->service_name_length = htons( 0 );
+  header->service_name_length = htons( 0 );
   // TODO: append ipaddress and port
-  if ( append_len > 0 ) {
-    append = append_back_buffer( buf, append_len );
-    memcpy( append, data->data, append_len );
-  }
 
-  return buf;
+  // the openflow message is gathered by messenger as it is
+  iov[ 0 ].iov_base = header;
+  iov[ 0 ].iov_len = sizeof( openflow_service_header_t );
+  iov[ 1 ].iov_base = data != NULL ? data->data : NULL;
+  iov[ 1 ].iov_len = data != NULL ? data->length : 0;
 }
 
 
 void
 service_send_to_reply( char *service_name, uint16_t message_type, uint64_t *datapath_id, buffer *data ) {
-  buffer *buf;
+  openflow_service_header_t header;
+  struct iovec iov[ 2 ];
 
   if ( service_name == NULL ) {
     return;
   }
 
-  buf = create_openflow_application_message( datapath_id, data );
-  if ( !send_message( service_name, message_type, buf->data, buf->length ) ) {
+  make_openflow_application_message( iov, &header, datapath_id, data );
+  if ( !send_message_iov( service_name, message_type, iov, 2 ) ) {
     error( "Failed to send message." );
   }
-  free_buffer( buf );
 }
 
 
 void
 service_send_to_application( list_element *service_name_list, uint16_t message_type, uint64_t *datapath_id, buffer *data ) {
-  buffer *buf;
+  service_send_to_uncongested_application( service_name_list, message_type, datapath_id, data, 100 );
+}
+
+
+/*
+ * Sends to the services in service_name_list, except those whose send queue
+ * is at least congestion_threshold percent full. Returns the number of
+ * services skipped.
+ */
+int
+service_send_to_uncongested_application( list_element *service_name_list, uint16_t message_type, uint64_t *datapath_id,
+                                         buffer *data, unsigned int congestion_threshold ) {
+  openflow_service_header_t header;
+  struct iovec iov[ 2 ];
   list_element *list;
   char *service_name;
+  int skipped = 0;
 
   if ( service_name_list == NULL ) {
-    return;
+    return 0;
   }
 
-  buf = create_openflow_application_message( datapath_id, data );
+  make_openflow_application_message( iov, &header, datapath_id, data );
 
   for ( list = service_name_list; list != NULL; list = list->next ) {
     service_name = list->data;
-    if ( !send_message( service_name, message_type, 
-                        buf->data, buf->length ) ) {
+    if ( congestion_threshold < 100 && messenger_send_queue_usage( service_name ) >= congestion_threshold ) {
+      skipped++;
+      continue;
+    }
+    if ( !send_message_iov( service_name, message_type, iov, 2 ) ) {
       error( "Failed to send message." );
     }
   }
-  free_buffer( buf );
+
+  return skipped;
+}
+
+
+/*
+ * Messages built by the library and sent from a trusted service are
+ * validated only once every validation_interval messages, or never if it
+ * is zero. Other messages are always validated.
+ */
+typedef struct {
+  char *service_name;
+  unsigned int validation_interval;
+  unsigned int skipped;
+} trusted_service;
+
+static list_element *trusted_services = NULL;
+
+
+void
+add_trusted_service( const char *service_name, unsigned int validation_interval ) {
+  assert( service_name != NULL );
+
+  trusted_service *trusted = xmalloc( sizeof( trusted_service ) );
+  trusted->service_name = xstrdup( service_name );
+  trusted->validation_interval = validation_interval;
+  trusted->skipped = 0;
+  insert_in_front( &trusted_services, trusted );
+}
+
+
+void
+finalize_trusted_services( void ) {
+  list_element *element;
+  for ( element = trusted_services; element != NULL; element = element->next ) {
+    trusted_service *trusted = element->data;
+    xfree( trusted->service_name );
+    xfree( trusted );
+  }
+  delete_list( trusted_services );
+  trusted_services = NULL;
+}
+
+
+static trusted_service *
+lookup_trusted_service( const char *service_name ) {
+  list_element *element;
+  for ( element = trusted_services; element != NULL; element = element->next ) {
+    trusted_service *trusted = element->data;
+    if ( strcmp( trusted->service_name, service_name ) == 0 ) {
+      return trusted;
+    }
+  }
+
+  return NULL;
+}
+
+
+static bool
+need_validation( trusted_service *trusted ) {
+  if ( trusted == NULL ) {
+    return true;
+  }
+  if ( trusted->validation_interval == 0 ) {
+    return false;
+  }
+  if ( ++trusted->skipped < trusted->validation_interval ) {
+    return false;
+  }
+  trusted->skipped = 0;
+
+  return true;
 }
 
 
+/*
+ * Replies to the application with an error as a switch would, so that a
+ * message dropped here is reported under its transaction id.
+ */
 static void
-handle_openflow_message( uint64_t *datapath_id, char *service_name, buffer *buf ) {
+send_error_to_application( uint64_t *datapath_id, char *service_name, const buffer *message,
+                           uint16_t type, uint16_t code ) {
+  static const size_t ERROR_DATA_LENGTH = 64;
+  const struct ofp_header *header = message->data;
+  buffer data = { message->data, message->length, NULL, NULL };
+  if ( data.length > ERROR_DATA_LENGTH ) {
+    data.length = ERROR_DATA_LENGTH;
+  }
+
+  buffer *error_message = create_error( ntohl( header->xid ), type, code, &data );
+  service_send_to_reply( service_name, MESSENGER_OPENFLOW_MESSAGE, datapath_id, error_message );
+  free_buffer( error_message );
+}
+
+
+static void
+handle_openflow_message( uint64_t *datapath_id, char *service_name, buffer *buf, trusted_service *trusted ) {
   struct ofp_header *header;
   int ret;
 
-  ret = validate_openflow_message( buf );
-  if ( ret != 0 ) {
-    header = buf->data;
-    notice( "Validation error. dpid = %#" PRIx64 ", type %u, errno %d, service_name = %s",
-            *datapath_id, header->type, ret, service_name );
-    free_buffer( buf );
-
-    return;
+  if ( need_validation( trusted ) ) {
+    ret = validate_openflow_message( buf );
+    if ( ret != 0 ) {
+      header = buf->data;
+      notice( "Validation error. dpid = %#" PRIx64 ", type %u, errno %d, service_name = %s%s",
+              *datapath_id, header->type, ret, service_name, trusted != NULL ? " (trusted)" : "" );
+      if ( trusted != NULL ) {
+        increment_stat( "trusted_service.validation_failed" );
+      }
+      uint16_t error_type = OFPET_BAD_REQUEST;
+      uint16_t error_code = OFPBRC_BAD_TYPE;
+      get_error_type_and_code( header->type, ret, &error_type, &error_code );
+      send_error_to_application( datapath_id, service_name, buf, error_type, error_code );
+      free_buffer( buf );
+
+      return;
+    }
   }
 
   switch_event_recv_from_application( datapath_id, service_name, buf );
 }
 
 
+/*
+ * Messages in a sequence are sliced out of the received buffer, which is
+ * released when the last of them has been written to the secure channel.
+ * A slice must not be resized.
+ */
+typedef struct {
+  buffer *messages;
+  unsigned int refs;
+} message_sequence;
+
+
+static void
+release_message_sequence( message_sequence *sequence ) {
+  if ( --sequence->refs == 0 ) {
+    free_buffer( sequence->messages );
+    xfree( sequence );
+  }
+}
+
+
+static void
+release_sliced_message( buffer *message ) {
+  release_message_sequence( message->user_data );
+  message->user_data = NULL;
+  message->user_data_free_function = NULL;
+}
+
+
+static buffer *
+slice_message( message_sequence *sequence, size_t offset, size_t length ) {
+  buffer *message = alloc_buffer();
+  message->data = ( char * ) sequence->messages->data + offset;
+  message->length = length;
+  message->user_data = sequence;
+  message->user_data_free_function = release_sliced_message;
+  sequence->refs++;
+
+  return message;
+}
+
+
+static bool
+ends_with_barrier_request( const buffer *buf, size_t offset ) {
+  if ( buf->length - offset < sizeof( struct ofp_header ) ) {
+    return false;
+  }
+  const struct ofp_header *header = ( const struct ofp_header * ) ( ( const char * ) buf->data + buf->length - sizeof( struct ofp_header ) );
+
+  return header->version == OFP_VERSION && header->type == OFPT_BARRIER_REQUEST &&
+         ntohs( header->length ) == sizeof( struct ofp_header );
+}
+
+
+/*
+ * Splits a sequence of OpenFlow messages and handles them in order. They are
+ * queued to the secure channel one by one and written out together. If the
+ * sequence is broken, the rest of it is rejected except for a trailing
+ * barrier request, which still has to complete the batch.
+ */
+static void
+handle_openflow_messages( uint64_t *datapath_id, char *service_name, buffer *buf, trusted_service *trusted ) {
+  message_sequence *sequence = xmalloc( sizeof( message_sequence ) );
+  sequence->messages = buf;
+  sequence->refs = 1;
+
+  size_t offset = 0;
+  while ( offset < buf->length ) {
+    struct ofp_header *header = ( struct ofp_header * ) ( ( char * ) buf->data + offset );
+    if ( buf->length - offset < sizeof( struct ofp_header ) ||
+         ntohs( header->length ) < sizeof( struct ofp_header ) ||
+         ntohs( header->length ) > buf->length - offset ) {
+      error( "Invalid openflow message in a sequence ( dpid = %#" PRIx64 ", offset = %zu, length = %u ).",
+             *datapath_id, offset, buf->length );
+      bool barrier = ends_with_barrier_request( buf, offset + sizeof( struct ofp_header ) );
+      if ( buf->length - offset >= sizeof( struct ofp_header ) ) {
+        buffer *message = slice_message( sequence, offset, sizeof( struct ofp_header ) );
+        send_error_to_application( datapath_id, service_name, message, OFPET_BAD_REQUEST, OFPBRC_BAD_LEN );
+        free_buffer( message );
+      }
+      if ( barrier ) {
+        size_t barrier_offset = buf->length - sizeof( struct ofp_header );
+        handle_openflow_message( datapath_id, service_name,
+                                 slice_message( sequence, barrier_offset, sizeof( struct ofp_header ) ), trusted );
+      }
+      break;
+    }
+
+    uint16_t length = ntohs( header->length );
+    handle_openflow_message( datapath_id, service_name, slice_message( sequence, offset, length ), trusted );
+    offset += length;
+  }
+
+  release_message_sequence( sequence );
+}
+
+
 static void
 handle_openflow_disconnect_request( uint64_t *datapath_id ) {
   switch_event_disconnect_request( datapath_id );
@@ -125,7 +330,7 @@ service_recv_from_application( uint16_t message_type, buffer *buf ) {
    uint16_t service_name_length;
    char *service_name;
 
-  if ( buf->length < sizeof( openflow_service_header_t ) + sizeof( struct ofp_header ) ) {
+  if ( buf->length < sizeof( openflow_service_header_t ) ) {
     error( "Too short openflow application message(%u).", buf->length );
     free_buffer( buf );
 
@@ -136,7 +341,7 @@ service_recv_from_application( uint16_t message_type, buffer *buf ) {
   datapath_id = ntohll( message->datapath_id );
   service_name_length = ntohs( message->service_name_length );
   service_name = remove_front_buffer( buf, sizeof( openflow_service_header_t ) );
-  if ( service_name_length < 1 ) {
+  if ( service_name_length < 1 || service_name_length > buf->length ) {
     error( "Invalid service name length %u.", service_name_length );
     free_buffer( buf );
 
@@ -152,12 +357,28 @@ service_recv_from_application( uint16_t message_type, buffer *buf ) {
 
   switch ( message_type ) {
   case MESSENGER_OPENFLOW_MESSAGE:
-    handle_openflow_message( &datapath_id, service_name, buf );
+  case MESSENGER_OPENFLOW_BUILT_MESSAGE:
+    if ( buf->length < sizeof( struct ofp_header ) ) {
+      error( "Too short openflow application message(%u).", buf->length );
+      free_buffer( buf );
+      break;
+    }
+    handle_openflow_message( &datapath_id, service_name, buf,
+                             message_type == MESSENGER_OPENFLOW_BUILT_MESSAGE ? lookup_trusted_service( service_name ) : NULL );
+    break;
+  case MESSENGER_OPENFLOW_MESSAGES:
+  case MESSENGER_OPENFLOW_BUILT_MESSAGES:
+    handle_openflow_messages( &datapath_id, service_name, buf,
+                              message_type == MESSENGER_OPENFLOW_BUILT_MESSAGES ? lookup_trusted_service( service_name ) : NULL );
     break;
   case MESSENGER_OPENFLOW_DISCONNECT_REQUEST:
     free_buffer( buf );
     handle_openflow_disconnect_request( &datapath_id );
     break;
+  case MESSENGER_OPENFLOW_LIVENESS_REQUEST:
+    switch_event_liveness_request( &datapath_id, service_name );
+    free_buffer( buf );
+    break;
   default:
     error( "Unknown message type %d.", message_type );
     free_buffer( buf );
@@ -31,7 +31,11 @@
 
 void service_send_to_reply( char *service_name, uint16_t message_type, uint64_t *datapath_id, buffer *buf );
 void service_send_to_application( list_element *service_name_list, uint16_t message_type, uint64_t *datapath_id, buffer *buf );
+int service_send_to_uncongested_application( list_element *service_name_list, uint16_t message_type, uint64_t *datapath_id,
+                                             buffer *buf, unsigned int congestion_threshold );
 void service_recv_from_application( uint16_t message_type, buffer *buf );
+void add_trusted_service( const char *service_name, unsigned int validation_interval );
+void finalize_trusted_services( void );
 
 
 #endif // SERVICE_INTERFACE_H
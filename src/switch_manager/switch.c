@@ -18,6 +18,7 @@
  */
 
 
+#include <errno.h>
 #include <fcntl.h>
 #include <getopt.h>
 #include <inttypes.h>
@@ -27,28 +28,70 @@
 #include <signal.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
 #include "trema.h"
 #include "cookie_table.h"
+#include "dpid_table.h"
+#include "echo_monitor.h"
+#include "flow_reconciler.h"
+#include "flow_shadow.h"
 #include "management_interface.h"
 #include "message_queue.h"
 #include "messenger.h"
 #include "ofpmsg_send.h"
 #include "openflow_service_interface.h"
+#include "packetin_policer.h"
 #include "secure_channel_receiver.h"
 #include "secure_channel_sender.h"
 #include "service_interface.h"
 #include "switch.h"
+#include "switch_pool.h"
 #include "xid_table.h"
 
 
 enum long_options_val {
   NO_FLOW_CLEANUP_LONG_OPTION_VALUE = 1,
+  PACKET_IN_RATE_LONG_OPTION_VALUE,
+  PACKET_IN_BURST_LONG_OPTION_VALUE,
+  PACKET_IN_PORT_RATE_LONG_OPTION_VALUE,
+  PACKET_IN_PORT_BURST_LONG_OPTION_VALUE,
+  LISTEN_LONG_OPTION_VALUE,
+  POOL_LONG_OPTION_VALUE,
+  CORK_LONG_OPTION_VALUE,
+  RECV_BUDGET_LONG_OPTION_VALUE,
+  HANDLE_BUDGET_LONG_OPTION_VALUE,
+  SEND_BUDGET_LONG_OPTION_VALUE,
+  PACKET_IN_CONGESTION_THRESHOLD_LONG_OPTION_VALUE,
+  ECHO_INTERVAL_LONG_OPTION_VALUE,
+  WARM_RESTART_LONG_OPTION_VALUE,
+  TRUSTED_SERVICE_LONG_OPTION_VALUE,
+  SUPPRESS_REDUNDANT_FLOW_MODS_LONG_OPTION_VALUE,
+  SWITCH_MANAGER_LONG_OPTION_VALUE,
 };
 
 static struct option long_options[] = {
   { "socket", 1, NULL, 's' },
   { "no-flow-cleanup", 0, NULL, NO_FLOW_CLEANUP_LONG_OPTION_VALUE },
+  { "packet-in-rate", 1, NULL, PACKET_IN_RATE_LONG_OPTION_VALUE },
+  { "packet-in-burst", 1, NULL, PACKET_IN_BURST_LONG_OPTION_VALUE },
+  { "packet-in-port-rate", 1, NULL, PACKET_IN_PORT_RATE_LONG_OPTION_VALUE },
+  { "packet-in-port-burst", 1, NULL, PACKET_IN_PORT_BURST_LONG_OPTION_VALUE },
+  { "listen", 1, NULL, LISTEN_LONG_OPTION_VALUE },
+  { "pool", 1, NULL, POOL_LONG_OPTION_VALUE },
+  { "cork", 0, NULL, CORK_LONG_OPTION_VALUE },
+  { "recv-budget", 1, NULL, RECV_BUDGET_LONG_OPTION_VALUE },
+  { "handle-budget", 1, NULL, HANDLE_BUDGET_LONG_OPTION_VALUE },
+  { "send-budget", 1, NULL, SEND_BUDGET_LONG_OPTION_VALUE },
+  { "packet-in-congestion-threshold", 1, NULL, PACKET_IN_CONGESTION_THRESHOLD_LONG_OPTION_VALUE },
+  { "echo-interval", 1, NULL, ECHO_INTERVAL_LONG_OPTION_VALUE },
+  { "warm-restart", 2, NULL, WARM_RESTART_LONG_OPTION_VALUE },
+  { "trusted-service", 1, NULL, TRUSTED_SERVICE_LONG_OPTION_VALUE },
+  { "suppress-redundant-flow-mods", 0, NULL, SUPPRESS_REDUNDANT_FLOW_MODS_LONG_OPTION_VALUE },
+  { "switch-manager", 1, NULL, SWITCH_MANAGER_LONG_OPTION_VALUE },
   { NULL, 0, NULL, 0  },
 };
 
@@ -61,17 +104,126 @@ static const time_t COOKIE_TABLE_AGING_INTERVAL = 3600;
 
 static bool age_cookie_table_enabled = false;
 
+static packetin_policer_config_t packetin_policer_config;
+
+#define DEFAULT_ECHO_INTERVAL 5
+static time_t echo_interval = DEFAULT_ECHO_INTERVAL;
+
+#define DEFAULT_FLOW_CLAIM_PERIOD 30
+static bool warm_restart = false;
+static time_t flow_claim_period = DEFAULT_FLOW_CLAIM_PERIOD;
+
+static bool suppress_redundant_flow_mods = false;
+
+/*
+ * Datapath ids are claimed from switch manager before taking the
+ * switch.<datapath id> service name over, so that a secure channel of
+ * a switch that is still held by another switch daemon is disconnected
+ * first. NULL if the daemon is not started by switch manager.
+ */
+static const char *switch_manager_service_name = NULL;
+static char management_service_name[ MESSENGER_SERVICE_NAME_LENGTH ];
+static list_element *granted_datapath_ids = NULL;
+static list_element *disconnect_requested_datapath_ids = NULL;
+
+/*
+ * In multi-switch mode, the switch daemon accepts secure channels from a
+ * listening socket shared with switch manager and handles all of them in
+ * a single epoll loop. switch_info above then only holds the options
+ * common to all secure channels.
+ */
+static int listen_fd = -1;
+static int epoll_fd = -1;
+static list_element *switches = NULL;
+static list_element *disconnected_switches = NULL;
+static hash_table *switch_table = NULL; // datapath_id -> struct switch_info
+
+static const time_t SWITCH_HANDSHAKE_CHECK_INTERVAL = 1;
+#define MAX_EPOLL_EVENTS 256
+#define MAX_ACCEPTS_PER_EVENT 16
+
+/*
+ * A pooled switch daemon is started before a secure channel is accepted,
+ * and receives it from switch manager over a socket pair.
+ */
+static int pool_fd = -1;
+
+/*
+ * Reading from secure channels, handling received messages and writing to
+ * secure channels each get a budget per wakeup. Work left over is resumed
+ * at the next wakeup, which is made immediate by polling an always
+ * readable eventfd while any received message is left. In multi-switch
+ * mode, switches with messages left are served in turn.
+ */
+#define DEFAULT_RECV_BUDGET ( 256 * 1024 )
+#define DEFAULT_HANDLE_BUDGET 1000
+#define DEFAULT_SEND_BUDGET ( 256 * 1024 )
+// send queue usage to an application in percent at which packet_in
+// messages to the application start to be dropped
+#define DEFAULT_PACKETIN_CONGESTION_THRESHOLD 75
+static int backlog_fd = -1;
+static list_element *backlogged_switches = NULL;
+
+/*
+ * Latency of each phase of the handshake. hello and features are counted
+ * from the start of the handshake, accept and ready from the accept of the
+ * secure channel if it is known.
+ */
+enum {
+  HANDSHAKE_PHASE_ACCEPT,   // accepted to the start of the handshake
+  HANDSHAKE_PHASE_HELLO,    // to hello received
+  HANDSHAKE_PHASE_FEATURES, // to features reply received
+  HANDSHAKE_PHASE_READY,    // to ready notified to applications
+  HANDSHAKE_PHASES,
+};
+static const char *HANDSHAKE_PHASE_NAMES[ HANDSHAKE_PHASES ] = { "accept", "hello", "features", "ready" };
+// upper bounds in milliseconds
+static const uint64_t HANDSHAKE_LATENCY_BUCKETS[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000 };
+#define N_HANDSHAKE_LATENCY_BUCKETS ( sizeof( HANDSHAKE_LATENCY_BUCKETS ) / sizeof( HANDSHAKE_LATENCY_BUCKETS[ 0 ] ) )
+static uint64_t handshake_latency_histogram[ HANDSHAKE_PHASES ][ N_HANDSHAKE_LATENCY_BUCKETS + 1 ];
+
 
 void
-usage() {
+switch_daemon_usage() {
   printf(
     "OpenFlow Switch Manager.\n"
     "Usage: %s [OPTION]... [DESTINATION-RULE]...\n"
     "\n"
     "  -s, --socket=fd             secure channnel socket\n"
+    "      --listen=fd             accept secure channels from a listening socket\n"
+    "      --pool=fd               receive a secure channel from switch manager\n"
     "  -n, --name=SERVICE_NAME     service name\n"
     "  -l, --logging_level=LEVEL   set logging level\n"
     "      --no-flow-cleanup       do not cleanup flows on start\n"
+    "      --packet-in-rate=PPS    limit packet_in messages from the switch\n"
+    "      --packet-in-burst=N     allow bursts of N packet_in messages\n"
+    "      --packet-in-port-rate=PPS\n"
+    "                              limit packet_in messages from each port\n"
+    "      --packet-in-port-burst=N\n"
+    "                              allow bursts of N packet_in messages per port\n"
+    "      --cork                  coalesce messages queued to the switch into\n"
+    "                              full-sized segments\n"
+    "      --recv-budget=BYTES     read at most BYTES from the switch per wakeup\n"
+    "      --handle-budget=USEC    handle received messages for at most USEC\n"
+    "                              microseconds per wakeup\n"
+    "      --send-budget=BYTES     write at most BYTES to the switch per wakeup\n"
+    "      --packet-in-congestion-threshold=PERCENT\n"
+    "                              drop packet_in messages to an application whose\n"
+    "                              send queue is PERCENT full (default 75,\n"
+    "                              100: never)\n"
+    "      --echo-interval=SEC     send an echo request to the switch every SEC\n"
+    "                              seconds to measure round trip time (0: never)\n"
+    "      --warm-restart[=SEC]    keep flows in the switch and delete those not\n"
+    "                              added again by applications in SEC seconds\n"
+    "                              (0: never)\n"
+    "      --trusted-service=SERVICE[:N]\n"
+    "                              validate only one in N messages built by the\n"
+    "                              library in SERVICE (default 0: never)\n"
+    "      --suppress-redundant-flow-mods\n"
+    "                              do not send flow_mods adding flows already\n"
+    "                              added to the switch\n"
+    "      --switch-manager=SERVICE_NAME\n"
+    "                              claim datapath ids from switch manager\n"
     "  -h, --help                  display this help and exit\n"
     "\n"
     "DESTINATION-RULE:\n"
@@ -103,12 +255,101 @@ strtofd( const char *str ) {
 }
 
 
+static uint32_t
+strtorate( const char *str ) {
+  char *ep;
+  unsigned long l;
+
+  l = strtoul( str, &ep, 0 );
+  if ( *str == '-' || l > UINT32_MAX || *ep != '\0' ) {
+    die( "Invalid packet_in rate or burst (%s).", str );
+    return 0;
+  }
+  return ( uint32_t ) l;
+}
+
+
+static long
+strtobudget( const char *str ) {
+  char *ep;
+  long l;
+
+  l = strtol( str, &ep, 0 );
+  if ( l <= 0 || l == LONG_MAX || *ep != '\0' ) {
+    die( "Invalid budget (%s).", str );
+    return 0;
+  }
+  return l;
+}
+
+
+static unsigned int
+strtothreshold( const char *str ) {
+  char *ep;
+  long l;
+
+  l = strtol( str, &ep, 0 );
+  if ( l <= 0 || l > 100 || *ep != '\0' ) {
+    die( "Invalid congestion threshold (%s).", str );
+    return 0;
+  }
+  return ( unsigned int ) l;
+}
+
+
+static time_t
+strtointerval( const char *str ) {
+  char *ep;
+  long l;
+
+  l = strtol( str, &ep, 0 );
+  if ( l < 0 || l > INT_MAX || *ep != '\0' ) {
+    die( "Invalid interval (%s).", str );
+    return 0;
+  }
+  return ( time_t ) l;
+}
+
+
+static void
+parse_trusted_service( const char *str ) {
+  char *service_name = xstrdup( str );
+  unsigned int validation_interval = 0;
+
+  char *interval = strrchr( service_name, ':' );
+  if ( interval != NULL ) {
+    *interval++ = '\0';
+    char *ep;
+    unsigned long l = strtoul( interval, &ep, 0 );
+    if ( *interval == '-' || *interval == '\0' || l > UINT_MAX || *ep != '\0' ) {
+      die( "Invalid validation interval (%s).", str );
+      xfree( service_name );
+      return;
+    }
+    validation_interval = ( unsigned int ) l;
+  }
+  if ( strlen( service_name ) == 0 ) {
+    die( "Invalid trusted service (%s).", str );
+    xfree( service_name );
+    return;
+  }
+  add_trusted_service( service_name, validation_interval );
+  xfree( service_name );
+}
+
+
 static void
 option_parser( int argc, char *argv[] ) {
   int c;
 
   switch_info.secure_channel_fd = 0; // stdin
   switch_info.flow_cleanup = true;
+  switch_info.cork = false;
+  switch_info.recv_budget = DEFAULT_RECV_BUDGET;
+  switch_info.handle_budget = DEFAULT_HANDLE_BUDGET;
+  switch_info.send_budget = DEFAULT_SEND_BUDGET;
+  switch_info.packetin_congestion_threshold = DEFAULT_PACKETIN_CONGESTION_THRESHOLD;
+  memset( &packetin_policer_config, 0, sizeof( packetin_policer_config_t ) );
   while ( ( c = getopt_long( argc, argv, short_options, long_options, NULL ) ) != -1 ) {
     switch ( c ) {
       case 's':
@@ -119,12 +360,84 @@ option_parser( int argc, char *argv[] ) {
         switch_info.flow_cleanup = false;
         break;
 
+      case PACKET_IN_RATE_LONG_OPTION_VALUE:
+        packetin_policer_config.switch_rate = strtorate( optarg );
+        break;
+
+      case PACKET_IN_BURST_LONG_OPTION_VALUE:
+        packetin_policer_config.switch_burst = strtorate( optarg );
+        break;
+
+      case PACKET_IN_PORT_RATE_LONG_OPTION_VALUE:
+        packetin_policer_config.port_rate = strtorate( optarg );
+        break;
+
+      case PACKET_IN_PORT_BURST_LONG_OPTION_VALUE:
+        packetin_policer_config.port_burst = strtorate( optarg );
+        break;
+
+      case LISTEN_LONG_OPTION_VALUE:
+        listen_fd = strtofd( optarg );
+        break;
+
+      case POOL_LONG_OPTION_VALUE:
+        pool_fd = strtofd( optarg );
+        break;
+
+      case CORK_LONG_OPTION_VALUE:
+        switch_info.cork = true;
+        break;
+
+      case RECV_BUDGET_LONG_OPTION_VALUE:
+        switch_info.recv_budget = ( size_t ) strtobudget( optarg );
+        break;
+
+      case HANDLE_BUDGET_LONG_OPTION_VALUE:
+        switch_info.handle_budget = strtobudget( optarg );
+        break;
+
+      case SEND_BUDGET_LONG_OPTION_VALUE:
+        switch_info.send_budget = ( size_t ) strtobudget( optarg );
+        break;
+
+      case PACKET_IN_CONGESTION_THRESHOLD_LONG_OPTION_VALUE:
+        switch_info.packetin_congestion_threshold = strtothreshold( optarg );
+        break;
+
+      case ECHO_INTERVAL_LONG_OPTION_VALUE:
+        echo_interval = strtointerval( optarg );
+        break;
+
+      case WARM_RESTART_LONG_OPTION_VALUE:
+        warm_restart = true;
+        if ( optarg != NULL ) {
+          flow_claim_period = strtointerval( optarg );
+        }
+        break;
+
+      case TRUSTED_SERVICE_LONG_OPTION_VALUE:
+        parse_trusted_service( optarg );
+        break;
+
+      case SUPPRESS_REDUNDANT_FLOW_MODS_LONG_OPTION_VALUE:
+        suppress_redundant_flow_mods = true;
+        break;
+
+      case SWITCH_MANAGER_LONG_OPTION_VALUE:
+        switch_manager_service_name = optarg;
+        break;
+
       default:
-        usage();
+        switch_daemon_usage();
         exit( EXIT_SUCCESS );
         return;
     }
   }
+
+  if ( warm_restart ) {
+    // flows are reconciled instead
+    switch_info.flow_cleanup = false;
+  }
 }
 
 
@@ -148,21 +461,214 @@ service_send_state( struct switch_info *sw_info, uint64_t *dpid, uint16_t tag )
 }
 
 
+static bool
+multi_switch_mode( void ) {
+  return listen_fd >= 0;
+}
+
+
+static void
+init_secure_channel( struct switch_info *sw_info, int fd ) {
+  sw_info->secure_channel_fd = fd;
+  fcntl( sw_info->secure_channel_fd, F_SETFL, O_NONBLOCK );
+
+  // default switch configuration
+  sw_info->state = SWITCH_STATE_CONNECTED;
+  sw_info->datapath_id = 0;
+  sw_info->config_flags = OFPC_FRAG_NORMAL;
+  sw_info->miss_send_len = UINT16_MAX;
+
+  sw_info->recv_ring = NULL;
+  sw_info->send_queue = create_message_queue();
+  sw_info->recv_queue = create_message_queue();
+
+  sw_info->packetin_policer = NULL;
+  sw_info->cookie_table = NULL;
+  sw_info->echo_monitor = NULL;
+  sw_info->flow_reconciler = NULL;
+  memset( &sw_info->accepted_at, 0, sizeof( struct timespec ) );
+  memset( &sw_info->connected_at, 0, sizeof( struct timespec ) );
+  sw_info->handshake_deadline = 0;
+  sw_info->polled_events = 0;
+  sw_info->backlogged = false;
+}
+
+
+static void
+close_secure_channel( struct switch_info *sw_info ) {
+  finalize_secure_channel_receiver( sw_info );
+
+  if ( sw_info->send_queue != NULL ) {
+    delete_message_queue( sw_info->send_queue );
+    sw_info->send_queue = NULL;
+  }
+
+  if ( sw_info->recv_queue != NULL ) {
+    delete_message_queue( sw_info->recv_queue );
+    sw_info->recv_queue = NULL;
+  }
+
+  if ( sw_info->secure_channel_fd >= 0 ) {
+    close( sw_info->secure_channel_fd );
+    sw_info->secure_channel_fd = -1;
+  }
+}
+
+
+static void
+make_switch_service_name( char *service_name, size_t length, uint64_t datapath_id ) {
+  snprintf( service_name, length, "%s%" PRIx64, SWITCH_MANAGER_PREFIX, datapath_id );
+}
+
+
+static struct switch_info *
+lookup_switch_info( uint64_t datapath_id ) {
+  if ( multi_switch_mode() ) {
+    return lookup_hash_entry( switch_table, &datapath_id );
+  }
+  if ( datapath_id != switch_info.datapath_id ) {
+    return NULL;
+  }
+
+  return &switch_info;
+}
+
+
+static void
+send_pool_report( uint16_t type, uint64_t latency ) {
+  switch_pool_report report;
+
+  memset( &report, 0, sizeof( switch_pool_report ) );
+  report.type = type;
+  report.latency = latency;
+  if ( send( pool_fd, &report, sizeof( switch_pool_report ), MSG_NOSIGNAL ) < 0 ) {
+    warn( "Failed to send a report to switch manager ( errno = %s [%d] ).", strerror( errno ), errno );
+  }
+}
+
+
+static uint64_t
+elapsed_nsec( const struct timespec *since, const struct timespec *now ) {
+  int64_t elapsed = ( int64_t ) ( now->tv_sec - since->tv_sec ) * 1000000000 + ( now->tv_nsec - since->tv_nsec );
+
+  return elapsed > 0 ? ( uint64_t ) elapsed : 0;
+}
+
+
+static void
+update_handshake_latency( int phase, const struct timespec *since, const struct timespec *now ) {
+  if ( since->tv_sec == 0 && since->tv_nsec == 0 ) {
+    return;
+  }
+
+  uint64_t msec = elapsed_nsec( since, now ) / 1000000;
+  uint64_t *histogram = handshake_latency_histogram[ phase ];
+  unsigned int i;
+  for ( i = 0; i < N_HANDSHAKE_LATENCY_BUCKETS; i++ ) {
+    if ( msec <= HANDSHAKE_LATENCY_BUCKETS[ i ] ) {
+      break;
+    }
+  }
+  histogram[ i ]++;
+
+  // cumulative counts as in "le" buckets
+  char key[ STAT_KEY_LENGTH ];
+  uint64_t count = 0;
+  for ( i = 0; i < N_HANDSHAKE_LATENCY_BUCKETS; i++ ) {
+    count += histogram[ i ];
+    snprintf( key, sizeof( key ), "switch.handshake_latency.%s.le_%" PRIu64 "ms",
+              HANDSHAKE_PHASE_NAMES[ phase ], HANDSHAKE_LATENCY_BUCKETS[ i ] );
+    set_stat( key, count );
+  }
+  count += histogram[ N_HANDSHAKE_LATENCY_BUCKETS ];
+  snprintf( key, sizeof( key ), "switch.handshake_latency.%s.le_inf", HANDSHAKE_PHASE_NAMES[ phase ] );
+  set_stat( key, count );
+}
+
+
+static void
+report_features_reply_latency( void ) {
+  if ( pool_fd < 0 ) {
+    return;
+  }
+
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  send_pool_report( SWITCH_POOL_FEATURES_REPLIED, elapsed_nsec( &switch_info.accepted_at, &now ) );
+
+  close( pool_fd );
+  pool_fd = -1;
+}
+
+
+static void
+recv_secure_channel_from_pool( void ) {
+  switch_pool_handover handover;
+  char control[ CMSG_SPACE( sizeof( int ) ) ];
+  struct iovec iov;
+  struct msghdr msg;
+
+  iov.iov_base = &handover;
+  iov.iov_len = sizeof( switch_pool_handover );
+  memset( &msg, 0, sizeof( struct msghdr ) );
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof( control );
+
+  ssize_t length = recvmsg( pool_fd, &msg, 0 );
+  if ( length < 0 && ( errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK ) ) {
+    return;
+  }
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR( &msg );
+  if ( length != ( ssize_t ) sizeof( switch_pool_handover ) || cmsg == NULL
+       || cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS ) {
+    // switch manager retired this daemon or has gone away
+    debug( "No secure channel is passed from switch manager." );
+    stop_messenger();
+    return;
+  }
+
+  int fd;
+  memcpy( &fd, CMSG_DATA( cmsg ), sizeof( int ) );
+  init_secure_channel( &switch_info, fd );
+  switch_info.accepted_at = handover.accepted_at;
+  attach_packetin_policer( &switch_info );
+  attach_cookie_table( &switch_info );
+  attach_echo_monitor( &switch_info );
+  attach_flow_reconciler( &switch_info );
+  attach_flow_shadow( &switch_info );
+  if ( switch_event_connected( &switch_info ) < 0 ) {
+    error( "Failed to set connected state." );
+    switch_event_disconnected( &switch_info );
+  }
+}
+
+
 static void
 secure_channel_fd_set( fd_set *read_set, fd_set *write_set ) {
   if ( switch_info.secure_channel_fd < 0 ) {
+    if ( pool_fd >= 0 ) {
+      FD_SET( pool_fd, read_set );
+    }
     return;
   }
   FD_SET( switch_info.secure_channel_fd, read_set );
   if ( switch_info.send_queue != NULL && switch_info.send_queue->length > 0 ) {
     FD_SET( switch_info.secure_channel_fd, write_set );
   }
+  if ( switch_info.recv_queue != NULL && switch_info.recv_queue->length > 0 ) {
+    FD_SET( backlog_fd, read_set );
+  }
 }
 
 
 static void
 secure_channel_fd_isset( fd_set *read_set, fd_set *write_set ) {
   if ( switch_info.secure_channel_fd < 0 ) {
+    if ( pool_fd >= 0 && FD_ISSET( pool_fd, read_set ) ) {
+      recv_secure_channel_from_pool();
+    }
     return;
   }
   if ( FD_ISSET( switch_info.secure_channel_fd, write_set ) ) {
@@ -178,71 +684,420 @@ secure_channel_fd_isset( fd_set *read_set, fd_set *write_set ) {
     }
   }
 
-  if ( switch_info.recv_queue->length > 0 ) {
-    int ret = handle_messages_from_secure_channel( &switch_info );
-    if ( ret < 0 ) {
-      stop_messenger();
-    }
+  if ( switch_info.recv_queue->length > 0 ) {
+    int ret = handle_messages_from_secure_channel( &switch_info );
+    if ( ret < 0 ) {
+      stop_messenger();
+    }
+  }
+}
+
+
+/*
+ * Watches the secure channel for writability only while messages are
+ * queued, so that messages queued in a row are written out at once.
+ */
+static int
+update_polled_events( struct switch_info *sw_info ) {
+  uint32_t events = EPOLLIN;
+  if ( sw_info->send_queue->length > 0 ) {
+    events |= EPOLLOUT;
+  }
+  if ( events == sw_info->polled_events ) {
+    return 0;
+  }
+
+  struct epoll_event event;
+  memset( &event, 0, sizeof( struct epoll_event ) );
+  event.events = events;
+  event.data.ptr = sw_info;
+  if ( epoll_ctl( epoll_fd, EPOLL_CTL_MOD, sw_info->secure_channel_fd, &event ) < 0 ) {
+    error( "Failed to modify polled events ( fd = %d, errno = %s [%d] ).",
+           sw_info->secure_channel_fd, strerror( errno ), errno );
+    return -1;
+  }
+  sw_info->polled_events = events;
+
+  return 0;
+}
+
+
+static void
+free_disconnected_switches( void ) {
+  list_element *element;
+  for ( element = disconnected_switches; element != NULL; element = element->next ) {
+    xfree( element->data );
+  }
+  delete_list( disconnected_switches );
+  create_list( &disconnected_switches );
+}
+
+
+static void
+accept_secure_channels( void ) {
+  int i;
+  for ( i = 0; i < MAX_ACCEPTS_PER_EVENT; i++ ) {
+    int fd = accept( listen_fd, NULL, NULL );
+    if ( fd < 0 ) {
+      if ( errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK && errno != ECONNABORTED ) {
+        error( "Failed to accept from switch ( errno = %s [%d] ).", strerror( errno ), errno );
+      }
+      return;
+    }
+
+    struct switch_info *sw_info = xmalloc( sizeof( struct switch_info ) );
+    *sw_info = switch_info; // inherits destination services and options
+    init_secure_channel( sw_info, fd );
+    clock_gettime( CLOCK_MONOTONIC, &sw_info->accepted_at );
+
+    struct epoll_event event;
+    memset( &event, 0, sizeof( struct epoll_event ) );
+    event.events = EPOLLIN;
+    event.data.ptr = sw_info;
+    if ( epoll_ctl( epoll_fd, EPOLL_CTL_ADD, fd, &event ) < 0 ) {
+      error( "Failed to poll secure channel ( fd = %d, errno = %s [%d] ).", fd, strerror( errno ), errno );
+      close_secure_channel( sw_info );
+      xfree( sw_info );
+      continue;
+    }
+    sw_info->polled_events = EPOLLIN;
+    insert_in_front( &switches, sw_info );
+    attach_packetin_policer( sw_info );
+    attach_cookie_table( sw_info );
+    attach_echo_monitor( sw_info );
+    attach_flow_reconciler( sw_info );
+    attach_flow_shadow( sw_info );
+    debug( "Accepted a secure channel ( fd = %d ).", fd );
+
+    if ( switch_event_connected( sw_info ) < 0 || update_polled_events( sw_info ) < 0 ) {
+      switch_event_disconnected( sw_info );
+    }
+  }
+}
+
+
+static void
+handle_received_messages( struct switch_info *sw_info ) {
+  if ( sw_info->recv_queue->length > 0 ) {
+    if ( handle_messages_from_secure_channel( sw_info ) < 0 ) {
+      switch_event_disconnected( sw_info );
+      return;
+    }
+    if ( sw_info->state == SWITCH_STATE_DISCONNECTED ) {
+      return;
+    }
+    if ( sw_info->recv_queue->length > 0 ) {
+      sw_info->backlogged = true;
+      append_to_tail( &backlogged_switches, sw_info );
+    }
+  }
+
+  if ( update_polled_events( sw_info ) < 0 ) {
+    switch_event_disconnected( sw_info );
+  }
+}
+
+
+static void
+handle_backlogged_switches( void ) {
+  list_element *backlogged = backlogged_switches;
+  create_list( &backlogged_switches );
+
+  list_element *element;
+  for ( element = backlogged; element != NULL; element = element->next ) {
+    struct switch_info *sw_info = element->data;
+    // may have been disconnected while handling preceding switches
+    if ( sw_info->state == SWITCH_STATE_DISCONNECTED ) {
+      continue;
+    }
+    sw_info->backlogged = false;
+    handle_received_messages( sw_info );
+  }
+  delete_list( backlogged );
+}
+
+
+static void
+handle_secure_channel_events( struct switch_info *sw_info, uint32_t events ) {
+  // may have been disconnected while handling preceding events
+  if ( sw_info->state == SWITCH_STATE_DISCONNECTED ) {
+    return;
+  }
+
+  if ( ( events & EPOLLOUT ) != 0 ) {
+    if ( flush_secure_channel( sw_info ) < 0 ) {
+      switch_event_disconnected( sw_info );
+      return;
+    }
+  }
+  if ( ( events & ( EPOLLIN | EPOLLERR | EPOLLHUP ) ) != 0 ) {
+    if ( recv_from_secure_channel( sw_info ) < 0 ) {
+      switch_event_disconnected( sw_info );
+      return;
+    }
+  }
+
+  // a backlogged switch waits for its turn
+  if ( !sw_info->backlogged ) {
+    handle_received_messages( sw_info );
+  }
+}
+
+
+static void
+multi_switch_fd_set( fd_set *read_set, fd_set *write_set ) {
+  UNUSED( write_set );
+
+  FD_SET( epoll_fd, read_set );
+  if ( backlogged_switches != NULL ) {
+    FD_SET( backlog_fd, read_set );
+  }
+}
+
+
+static void
+handle_epoll_events( void ) {
+  struct epoll_event events[ MAX_EPOLL_EVENTS ];
+  int n_events = epoll_wait( epoll_fd, events, MAX_EPOLL_EVENTS, 0 );
+  if ( n_events < 0 ) {
+    if ( errno != EINTR ) {
+      error( "Failed to wait for secure channel events ( errno = %s [%d] ).", strerror( errno ), errno );
+    }
+    return;
+  }
+
+  int i;
+  for ( i = 0; i < n_events; i++ ) {
+    if ( events[ i ].data.ptr == NULL ) {
+      accept_secure_channels();
+    }
+    else {
+      handle_secure_channel_events( events[ i ].data.ptr, events[ i ].events );
+    }
+  }
+}
+
+
+static void
+multi_switch_fd_isset( fd_set *read_set, fd_set *write_set ) {
+  UNUSED( write_set );
+
+  // switches that have just become backlogged are served at the next wakeup
+  list_element *backlogged = backlogged_switches;
+  if ( FD_ISSET( epoll_fd, read_set ) ) {
+    handle_epoll_events();
+  }
+  if ( backlogged != NULL ) {
+    handle_backlogged_switches();
+  }
+
+  // freed here since pending events may refer to them
+  free_disconnected_switches();
+}
+
+
+static void
+switch_set_timeout( struct switch_info *sw_info, long sec, void ( *callback )( void *user_data ) ) {
+  struct itimerspec interval;
+
+  if ( multi_switch_mode() ) {
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    sw_info->handshake_deadline = now.tv_sec + sec;
+    return;
+  }
+
+  interval.it_value.tv_sec = sec;
+  interval.it_value.tv_nsec = 0;
+  interval.it_interval.tv_sec = 0;
+  interval.it_interval.tv_nsec = 0;
+  add_timer_event_callback( &interval, callback, sw_info );
+}
+
+
+static void
+switch_unset_timeout( struct switch_info *sw_info, void ( *callback )( void *user_data ) ) {
+  if ( multi_switch_mode() ) {
+    sw_info->handshake_deadline = 0;
+    return;
+  }
+
+  delete_timer_event_callback( callback );
+}
+
+
+static void
+switch_event_timeout_hello( void *user_data ) {
+  struct switch_info *sw_info = user_data;
+
+  if ( sw_info->state != SWITCH_STATE_WAIT_HELLO ) {
+    return;
+  }
+  // delete to hello_wait-timeout timer
+  switch_unset_timeout( sw_info, switch_event_timeout_hello );
+
+  error( "Hello timeout. state:%d, dpid:%#" PRIx64 ", fd:%d.",
+         sw_info->state, sw_info->datapath_id, sw_info->secure_channel_fd );
+  switch_event_disconnected( sw_info );
+}
+
+
+static void
+switch_event_timeout_features_reply( void *user_data ) {
+  struct switch_info *sw_info = user_data;
+
+  if ( sw_info->state != SWITCH_STATE_WAIT_FEATURES_REPLY ) {
+    return;
   }
+  // delete to features_reply_wait-timeout timer
+  switch_unset_timeout( sw_info, switch_event_timeout_features_reply );
+
+  error( "Features Reply timeout. state:%d, dpid:%#" PRIx64 ", fd:%d.",
+         sw_info->state, sw_info->datapath_id, sw_info->secure_channel_fd );
+  switch_event_disconnected( sw_info );
 }
 
 
+/*
+ * Per-switch timers cannot be used in multi-switch mode since timer
+ * callbacks are deleted by function, so handshake deadlines are checked
+ * periodically instead.
+ */
 static void
-switch_set_timeout( long sec, void ( *callback )( void *user_data ), void *user_data ) {
-  struct itimerspec interval;
-
+check_handshake_timeouts( void *user_data ) {
   UNUSED( user_data );
 
-  interval.it_value.tv_sec = sec;
-  interval.it_value.tv_nsec = 0;
-  interval.it_interval.tv_sec = 0;
-  interval.it_interval.tv_nsec = 0;
-  add_timer_event_callback( &interval, callback, NULL );
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+
+  list_element *element = switches;
+  while ( element != NULL ) {
+    struct switch_info *sw_info = element->data;
+    element = element->next;
+    if ( sw_info->handshake_deadline == 0 || sw_info->handshake_deadline > now.tv_sec ) {
+      continue;
+    }
+    switch ( sw_info->state ) {
+    case SWITCH_STATE_WAIT_HELLO:
+      switch_event_timeout_hello( sw_info );
+      break;
+
+    case SWITCH_STATE_WAIT_FEATURES_REPLY:
+      switch_event_timeout_features_reply( sw_info );
+      break;
+
+    default:
+      sw_info->handshake_deadline = 0;
+      break;
+    }
+  }
+
+  free_disconnected_switches();
 }
 
 
 static void
-switch_unset_timeout( void ( *callback )( void *user_data ) ) {
-  delete_timer_event_callback( callback );
+register_switch( struct switch_info *sw_info, const char *service_name ) {
+  struct switch_info *old_sw_info = lookup_hash_entry( switch_table, &sw_info->datapath_id );
+  if ( old_sw_info != NULL ) {
+    warn( "Duplicated datapath id %#" PRIx64 ". Disconnecting previous secure channel ( fd = %d ).",
+          sw_info->datapath_id, old_sw_info->secure_channel_fd );
+    switch_event_disconnected( old_sw_info );
+  }
+
+  insert_hash_entry( switch_table, &sw_info->datapath_id, sw_info );
+  add_message_received_callback( service_name, service_recv );
+  debug( "Add service name %s.", service_name );
 }
 
 
 static void
-switch_event_timeout_hello( void *user_data ) {
-  UNUSED( user_data );
+unregister_switch( struct switch_info *sw_info ) {
+  char service_name[ SWITCH_MANAGER_PREFIX_STR_LEN + SWITCH_MANAGER_DPID_STR_LEN + 1 ];
 
-  if ( switch_info.state != SWITCH_STATE_WAIT_HELLO ) {
+  if ( lookup_hash_entry( switch_table, &sw_info->datapath_id ) != sw_info ) {
     return;
   }
-  // delete to hello_wait-timeout timer
-  switch_unset_timeout( switch_event_timeout_hello );
+  delete_hash_entry( switch_table, &sw_info->datapath_id );
 
-  error( "Hello timeout. state:%d, dpid:%#" PRIx64 ", fd:%d.",
-         switch_info.state, switch_info.datapath_id, switch_info.secure_channel_fd );
-  switch_event_disconnected( &switch_info );
+  make_switch_service_name( service_name, sizeof( service_name ), sw_info->datapath_id );
+  delete_message_received_callback( service_name, service_recv );
+  debug( "Delete service name %s.", service_name );
 }
 
 
-static void
-switch_event_timeout_features_reply( void *user_data ) {
-  UNUSED( user_data );
+static bool
+start_multi_switch( void ) {
+  fcntl( listen_fd, F_SETFL, O_NONBLOCK );
 
-  if ( switch_info.state != SWITCH_STATE_WAIT_FEATURES_REPLY ) {
-    return;
+  epoll_fd = epoll_create( MAX_EPOLL_EVENTS );
+  if ( epoll_fd < 0 ) {
+    error( "Failed to create epoll instance ( errno = %s [%d] ).", strerror( errno ), errno );
+    return false;
   }
-  // delete to features_reply_wait-timeout timer
-  switch_unset_timeout( switch_event_timeout_features_reply );
 
-  error( "Features Reply timeout. state:%d, dpid:%#" PRIx64 ", fd:%d.",
-         switch_info.state, switch_info.datapath_id, switch_info.secure_channel_fd );
-  switch_event_disconnected( &switch_info );
+  struct epoll_event event;
+  memset( &event, 0, sizeof( struct epoll_event ) );
+  event.events = EPOLLIN;
+  event.data.ptr = NULL; // listening socket
+  if ( epoll_ctl( epoll_fd, EPOLL_CTL_ADD, listen_fd, &event ) < 0 ) {
+    error( "Failed to poll listening socket ( fd = %d, errno = %s [%d] ).", listen_fd, strerror( errno ), errno );
+    close( epoll_fd );
+    epoll_fd = -1;
+    return false;
+  }
+
+  create_list( &switches );
+  create_list( &disconnected_switches );
+  create_list( &backlogged_switches );
+  switch_table = create_hash( compare_datapath_id, hash_datapath_id );
+
+  set_fd_set_callback( multi_switch_fd_set );
+  set_check_fd_isset_callback( multi_switch_fd_isset );
+  add_periodic_event_callback( SWITCH_HANDSHAKE_CHECK_INTERVAL, check_handshake_timeouts, NULL );
+
+  return true;
+}
+
+
+static void
+finalize_multi_switch( void ) {
+  delete_periodic_event_callback( check_handshake_timeouts );
+
+  list_element *element;
+  for ( element = switches; element != NULL; element = element->next ) {
+    struct switch_info *sw_info = element->data;
+    close_secure_channel( sw_info );
+    xfree( sw_info );
+  }
+  delete_list( switches );
+  switches = NULL;
+
+  free_disconnected_switches();
+  delete_list( disconnected_switches );
+  disconnected_switches = NULL;
+  delete_list( backlogged_switches );
+  backlogged_switches = NULL;
+
+  delete_hash( switch_table );
+  switch_table = NULL;
+
+  close( epoll_fd );
+  epoll_fd = -1;
 }
 
 
+/*
+ * Hello, features request and set config are queued together so that they
+ * are written out at once, and the handshake takes a single round trip.
+ */
 int
 switch_event_connected( struct switch_info *sw_info ) {
   int ret;
 
+  clock_gettime( CLOCK_MONOTONIC, &sw_info->connected_at );
+  update_handshake_latency( HANDSHAKE_PHASE_ACCEPT, &sw_info->accepted_at, &sw_info->connected_at );
+
   // send secure channel disconnect state to application
   service_send_state( sw_info, &sw_info->datapath_id, MESSENGER_OPENFLOW_CONNECTED );
   debug( "Send connected state" );
@@ -250,9 +1105,17 @@ switch_event_connected( struct switch_info *sw_info ) {
   if ( ret < 0 ) {
     return ret;
   }
+  ret = ofpmsg_send_featuresrequest( sw_info );
+  if ( ret < 0 ) {
+    return ret;
+  }
+  ret = ofpmsg_send_setconfig( sw_info );
+  if ( ret < 0 ) {
+    return ret;
+  }
   sw_info->state = SWITCH_STATE_WAIT_HELLO;
 
-  switch_set_timeout( SWITCH_STATE_TIMEOUT_HELLO, switch_event_timeout_hello, NULL );
+  switch_set_timeout( sw_info, SWITCH_STATE_TIMEOUT_HELLO, switch_event_timeout_hello );
 
   return 0;
 }
@@ -260,52 +1123,64 @@ switch_event_connected( struct switch_info *sw_info ) {
 
 int
 switch_event_recv_hello( struct switch_info *sw_info ) {
-  int ret;
-
   if ( sw_info->state == SWITCH_STATE_WAIT_HELLO ) {
     // cancel to hello_wait-timeout timer
-    switch_unset_timeout( switch_event_timeout_hello );
+    switch_unset_timeout( sw_info, switch_event_timeout_hello );
 
-    ret = ofpmsg_send_featuresrequest( sw_info );
-    if ( ret < 0 ) {
-      return ret;
-    }
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    update_handshake_latency( HANDSHAKE_PHASE_HELLO, &sw_info->connected_at, &now );
+
+    // features request has been sent with hello
     sw_info->state = SWITCH_STATE_WAIT_FEATURES_REPLY;
 
-    switch_set_timeout( SWITCH_STATE_TIMEOUT_FEATURES_REPLY,
-                        switch_event_timeout_features_reply, NULL );
+    switch_set_timeout( sw_info, SWITCH_STATE_TIMEOUT_FEATURES_REPLY,
+                        switch_event_timeout_features_reply );
   }
 
   return 0;
 }
 
 
-int
-switch_event_recv_featuresreply( struct switch_info *sw_info, uint64_t *dpid ) {
+static void
+notify_switch_ready( struct switch_info *sw_info ) {
+  // notify state and datapath_id
+  service_send_state( sw_info, &sw_info->datapath_id, MESSENGER_OPENFLOW_READY );
+  debug( "send ready state" );
+
+  struct timespec now;
+  clock_gettime( CLOCK_MONOTONIC, &now );
+  if ( sw_info->accepted_at.tv_sec != 0 || sw_info->accepted_at.tv_nsec != 0 ) {
+    update_handshake_latency( HANDSHAKE_PHASE_READY, &sw_info->accepted_at, &now );
+  }
+  else {
+    update_handshake_latency( HANDSHAKE_PHASE_READY, &sw_info->connected_at, &now );
+  }
+}
+
+
+/*
+ * Takes the switch.<datapath id> service name over and notifies
+ * applications that the switch is ready.
+ */
+static int
+complete_handshake( struct switch_info *sw_info ) {
   int ret;
   char new_service_name[ SWITCH_MANAGER_PREFIX_STR_LEN + SWITCH_MANAGER_DPID_STR_LEN + 1 ];
   const uint16_t new_service_name_len = SWITCH_MANAGER_PREFIX_STR_LEN + SWITCH_MANAGER_DPID_STR_LEN + 1;
 
-  switch ( sw_info->state ) {
-  case SWITCH_STATE_WAIT_FEATURES_REPLY:
-
-    sw_info->datapath_id = *dpid;
-    sw_info->state = SWITCH_STATE_COMPLETED;
+  sw_info->state = SWITCH_STATE_COMPLETED;
 
-    // cancel to features_reply_wait-timeout timer
-    switch_unset_timeout( switch_event_timeout_features_reply );
+  // TODO: set keepalive-timeout
+  make_switch_service_name( new_service_name, new_service_name_len, sw_info->datapath_id );
 
-    // TODO: set keepalive-timeout
-    snprintf( new_service_name, new_service_name_len, "%s%" PRIx64, SWITCH_MANAGER_PREFIX, sw_info->datapath_id );
+  if ( multi_switch_mode() ) {
+    // switch_table is the registry of secure channels in this daemon
+    register_switch( sw_info, new_service_name );
+  }
+  else {
+    report_features_reply_latency();
 
-    // checking duplicate service
-    pid_t pid = get_trema_process_from_name( new_service_name );
-    if ( pid > 0 ) {
-      // duplicated
-      if ( !terminate_trema_process( pid ) ) {
-        return -1;
-      }
-    }
     // rename service_name of messenger
     rename_message_received_callback( get_trema_name(), new_service_name );
 
@@ -315,23 +1190,169 @@ switch_event_recv_featuresreply( struct switch_info *sw_info, uint64_t *dpid ) {
       start_messenger_dump( new_service_name, DEFAULT_DUMP_SERVICE_NAME );
     }
     set_trema_name( new_service_name );
+  }
+
+  if ( sw_info->flow_reconciler != NULL ) {
+    // ready is notified when flows left in the switch are known
+    return start_flow_reconciliation( sw_info );
+  }
 
-    // notify state and datapath_id
-    service_send_state( sw_info, &sw_info->datapath_id, MESSENGER_OPENFLOW_READY );
-    debug( "send ready state" );
+  notify_switch_ready( sw_info );
 
-    ret = ofpmsg_send_setconfig( sw_info );
+  if ( sw_info->flow_cleanup ) {
+    ret = ofpmsg_send_delete_all_flows( sw_info );
     if ( ret < 0 ) {
       return ret;
     }
-    if ( switch_info.flow_cleanup ) {
-      ret = ofpmsg_send_delete_all_flows( sw_info );
-      if ( ret < 0 ) {
-        return ret;
-      }
+  }
+
+  return 0;
+}
+
+
+static struct switch_info *
+lookup_claiming_switch_info( uint64_t datapath_id ) {
+  if ( !multi_switch_mode() ) {
+    if ( switch_info.state != SWITCH_STATE_WAIT_DPID_CLAIM || switch_info.datapath_id != datapath_id ) {
+      return NULL;
     }
-    break;
+    return &switch_info;
+  }
+
+  list_element *element;
+  for ( element = switches; element != NULL; element = element->next ) {
+    struct switch_info *sw_info = element->data;
+    if ( sw_info->state == SWITCH_STATE_WAIT_DPID_CLAIM && sw_info->datapath_id == datapath_id ) {
+      return sw_info;
+    }
+  }
+
+  return NULL;
+}
+
+
+static void
+defer_datapath_event( list_element **datapath_ids, uint64_t datapath_id, void ( *callback )( void *user_data ) ) {
+  if ( *datapath_ids == NULL ) {
+    struct itimerspec interval = { { 0, 0 }, { 0, 1 } };
+    add_timer_event_callback( &interval, callback, NULL );
+  }
+  uint64_t *deferred = xmalloc( sizeof( uint64_t ) );
+  *deferred = datapath_id;
+  append_to_tail( datapath_ids, deferred );
+}
+
+
+static void
+free_deferred_datapath_ids( list_element **datapath_ids ) {
+  for ( list_element *element = *datapath_ids; element != NULL; element = element->next ) {
+    xfree( element->data );
+  }
+  delete_list( *datapath_ids );
+  *datapath_ids = NULL;
+}
+
+
+static void
+complete_granted_handshakes( void *user_data ) {
+  UNUSED( user_data );
+
+  list_element *granted = granted_datapath_ids;
+  granted_datapath_ids = NULL;
+  for ( list_element *element = granted; element != NULL; element = element->next ) {
+    uint64_t *datapath_id = element->data;
+    struct switch_info *sw_info = lookup_claiming_switch_info( *datapath_id );
+    if ( sw_info != NULL && complete_handshake( sw_info ) < 0 ) {
+      switch_event_disconnected( sw_info );
+    }
+  }
+  free_deferred_datapath_ids( &granted );
+}
+
+
+static void
+disconnect_requested_switches( void *user_data ) {
+  UNUSED( user_data );
+
+  list_element *requested = disconnect_requested_datapath_ids;
+  disconnect_requested_datapath_ids = NULL;
+  for ( list_element *element = requested; element != NULL; element = element->next ) {
+    uint64_t *datapath_id = element->data;
+    struct switch_info *sw_info = lookup_switch_info( *datapath_id );
+    if ( sw_info != NULL ) {
+      switch_event_disconnected( sw_info );
+    }
+  }
+  free_deferred_datapath_ids( &requested );
+}
+
+
+static void
+handle_dpid_claim_reply( uint16_t tag, void *data, size_t len, void *user_data ) {
+  UNUSED( user_data );
+
+  if ( tag != DPID_CLAIM_REQUEST || len != sizeof( dpid_claim_reply ) ) {
+    error( "Invalid datapath id claim reply ( tag = %#x, len = %zu ).", tag, len );
+    return;
+  }
+  dpid_claim_reply *reply = data;
+  uint64_t datapath_id = ntohll( reply->datapath_id );
+
+  struct switch_info *sw_info = lookup_claiming_switch_info( datapath_id );
+  if ( sw_info == NULL ) {
+    debug( "No secure channel claims datapath %#" PRIx64 ".", datapath_id );
+    return;
+  }
+
+  if ( reply->granted == 0 ) {
+    notice( "Datapath %#" PRIx64 " is claimed by a newer secure channel. Disconnecting ( fd = %d ).",
+            datapath_id, sw_info->secure_channel_fd );
+    switch_event_disconnected( sw_info );
+    return;
+  }
+
+  // receive queues must not be renamed or added while messenger walks through them
+  defer_datapath_event( &granted_datapath_ids, datapath_id, complete_granted_handshakes );
+}
+
+
+static int
+claim_datapath_id( struct switch_info *sw_info ) {
+  sw_info->state = SWITCH_STATE_WAIT_DPID_CLAIM;
+
+  uint64_t datapath_id = htonll( sw_info->datapath_id );
+  // replied to the management service, which is not renamed
+  if ( !send_request_message( switch_manager_service_name, management_service_name, DPID_CLAIM_REQUEST,
+                              &datapath_id, sizeof( datapath_id ), NULL ) ) {
+    error( "Failed to claim datapath %#" PRIx64 " from %s.", sw_info->datapath_id, switch_manager_service_name );
+    return -1;
+  }
+
+  return 0;
+}
+
+
+int
+switch_event_recv_featuresreply( struct switch_info *sw_info, uint64_t *dpid ) {
+  switch ( sw_info->state ) {
+  case SWITCH_STATE_WAIT_FEATURES_REPLY:
+
+    sw_info->datapath_id = *dpid;
+
+    // cancel to features_reply_wait-timeout timer
+    switch_unset_timeout( sw_info, switch_event_timeout_features_reply );
+
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    update_handshake_latency( HANDSHAKE_PHASE_FEATURES, &sw_info->connected_at, &now );
+
+    if ( switch_manager_service_name != NULL ) {
+      // the handshake is completed when switch manager grants the datapath id
+      return claim_datapath_id( sw_info );
+    }
+    return complete_handshake( sw_info );
 
+  case SWITCH_STATE_WAIT_DPID_CLAIM:
   case SWITCH_STATE_COMPLETED:
     // NOP
     break;
@@ -347,32 +1368,50 @@ switch_event_recv_featuresreply( struct switch_info *sw_info, uint64_t *dpid ) {
 }
 
 
+void
+switch_event_flow_snapshot_completed( struct switch_info *sw_info ) {
+  if ( sw_info->state == SWITCH_STATE_COMPLETED ) {
+    notify_switch_ready( sw_info );
+  }
+}
+
+
 int
 switch_event_disconnected( struct switch_info *sw_info ) {
+  // applications have not been notified of a switch whose datapath id is being claimed
+  bool notify = sw_info->state != SWITCH_STATE_WAIT_DPID_CLAIM;
+  if ( multi_switch_mode() ) {
+    if ( sw_info->state == SWITCH_STATE_DISCONNECTED ) {
+      return 0;
+    }
+    unregister_switch( sw_info );
+  }
   sw_info->state = SWITCH_STATE_DISCONNECTED;
 
-  if ( sw_info->fragment_buf != NULL ) {
-    free_buffer( sw_info->fragment_buf );
-    sw_info->fragment_buf = NULL;
-  }
+  close_secure_channel( sw_info );
+  detach_packetin_policer( sw_info );
+  detach_cookie_table( sw_info );
+  detach_echo_monitor( sw_info );
+  detach_flow_reconciler( sw_info );
+  detach_flow_shadow( sw_info );
 
-  if ( sw_info->send_queue != NULL ) {
-    delete_message_queue( sw_info->send_queue );
-    sw_info->send_queue = NULL;
+  if ( notify ) {
+    // send secure channle disconnect state to application
+    service_send_state( sw_info, &sw_info->datapath_id, MESSENGER_OPENFLOW_DISCONNECTED );
   }
 
-  if ( sw_info->recv_queue != NULL ) {
-    delete_message_queue( sw_info->recv_queue );
-    sw_info->recv_queue = NULL;
-  }
+  if ( multi_switch_mode() ) {
+    debug( "send disconnected state" );
+    // freed after all pending events are handled
+    delete_element( &switches, sw_info );
+    if ( sw_info->backlogged ) {
+      delete_element( &backlogged_switches, sw_info );
+    }
+    insert_in_front( &disconnected_switches, sw_info );
 
-  if ( sw_info->secure_channel_fd >= 0 ) {
-    close( sw_info->secure_channel_fd );
-    sw_info->secure_channel_fd = -1;
+    return 0;
   }
 
-  // send secure channle disconnect state to application
-  service_send_state( sw_info, &sw_info->datapath_id, MESSENGER_OPENFLOW_DISCONNECTED );
   flush_messenger();
   debug( "send disconnected state" );
 
@@ -384,26 +1423,81 @@ switch_event_disconnected( struct switch_info *sw_info ) {
 
 int
 switch_event_recv_from_application( uint64_t *datapath_id, char *application_service_name, buffer *buf ) {
+  struct switch_info *sw_info = lookup_switch_info( *datapath_id );
 
-  if ( *datapath_id != switch_info.datapath_id ) {
+  if ( sw_info == NULL ) {
     error( "Invalid datapath id %#" PRIx64 ".", *datapath_id );
     free_buffer( buf );
 
     return -1;
   }
 
-  return ofpmsg_send( &switch_info, buf, application_service_name );
+  int ret = ofpmsg_send( sw_info, buf, application_service_name );
+  if ( multi_switch_mode() && update_polled_events( sw_info ) < 0 ) {
+    switch_event_disconnected( sw_info );
+  }
+
+  return ret;
+}
+
+
+/*
+ * Queues a message that the switch daemon sends on its own, e.g. from a
+ * timer, and makes sure it is written out. The switch may be disconnected
+ * on failure.
+ */
+int
+switch_event_send_to_secure_channel( struct switch_info *sw_info, buffer *buf ) {
+  if ( send_to_secure_channel( sw_info, buf ) < 0 ) {
+    free_buffer( buf );
+    return -1;
+  }
+  if ( multi_switch_mode() && update_polled_events( sw_info ) < 0 ) {
+    switch_event_disconnected( sw_info );
+    return -1;
+  }
+
+  return 0;
+}
+
+
+int
+switch_event_liveness_request( uint64_t *datapath_id, char *application_service_name ) {
+  struct switch_info *sw_info = lookup_switch_info( *datapath_id );
+
+  if ( sw_info == NULL ) {
+    error( "Invalid datapath id %#" PRIx64 ".", *datapath_id );
+    return -1;
+  }
+
+  buffer *data = alloc_buffer_with_length( sizeof( openflow_liveness_t ) );
+  get_switch_liveness( sw_info, append_back_buffer( data, sizeof( openflow_liveness_t ) ) );
+
+  list_element *service_name_list;
+  create_list( &service_name_list );
+  append_to_tail( &service_name_list, application_service_name );
+  service_send_to_application( service_name_list, MESSENGER_OPENFLOW_LIVENESS_REPLY, datapath_id, data );
+  delete_list( service_name_list );
+  free_buffer( data );
+
+  return 0;
 }
 
 
 int
 switch_event_disconnect_request( uint64_t *datapath_id ) {
+  struct switch_info *sw_info = lookup_switch_info( *datapath_id );
 
-  if ( *datapath_id != switch_info.datapath_id ) {
+  if ( sw_info == NULL ) {
     error( "Invalid datapath id %#" PRIx64 ".", *datapath_id );
     return -1;
   }
-  return switch_event_disconnected( &switch_info );
+  if ( multi_switch_mode() ) {
+    // unregistering deletes the receive queue this request arrived on
+    defer_datapath_event( &disconnect_requested_datapath_ids, *datapath_id, disconnect_requested_switches );
+    return 0;
+  }
+  return switch_event_disconnected( sw_info );
 }
 
 
@@ -448,15 +1542,29 @@ management_recv( uint16_t tag, void *data, size_t data_len ) {
 }
 
 
-int
-main( int argc, char *argv[] ) {
+/*
+ * Sets up a switch daemon in the calling process, whose main loop then
+ * serves it. init_trema() must have been called, and argv holds the
+ * options and destination rules of a switch daemon. A switch daemon
+ * embedded in an application must be run in multi-switch mode, since a
+ * single switch daemon takes over the messenger service of the process,
+ * and messages between them are delivered without sockets.
+ */
+static int
+setup_switch_daemon( int argc, char *argv[], bool embedded ) {
   int ret;
   int i;
   char *service_name;
-  char management_service_name[ MESSENGER_SERVICE_NAME_LENGTH ];
 
-  init_trema( &argc, &argv );
+  optind = 0;
   option_parser( argc, argv );
+  if ( embedded ) {
+    if ( !multi_switch_mode() ) {
+      error( "A switch daemon in an application must be started with --listen." );
+      return -1;
+    }
+    enable_messenger_local_delivery();
+  }
 
   create_list( &switch_info.vendor_service_name_list );
   create_list( &switch_info.packetin_service_name_list );
@@ -487,39 +1595,100 @@ main( int argc, char *argv[] ) {
     }
   }
 
-  fcntl( switch_info.secure_channel_fd, F_SETFL, O_NONBLOCK );
-  // default switch configuration
-  switch_info.config_flags = OFPC_FRAG_NORMAL;
-  switch_info.miss_send_len = UINT16_MAX;
-
-  switch_info.fragment_buf = NULL;
-  switch_info.send_queue = create_message_queue();
-  switch_info.recv_queue = create_message_queue();
-
   init_xid_table();
   init_cookie_table();
+  init_packetin_policer( &packetin_policer_config );
+  init_echo_monitor( echo_interval );
+  if ( warm_restart ) {
+    init_flow_reconciler( flow_claim_period );
+  }
+  if ( suppress_redundant_flow_mods ) {
+    init_flow_shadow();
+  }
+
+  backlog_fd = eventfd( 1, EFD_NONBLOCK | EFD_CLOEXEC );
+  if ( backlog_fd < 0 ) {
+    error( "Failed to create eventfd ( errno = %s [%d] ).", strerror( errno ), errno );
+    return -1;
+  }
+
+  if ( multi_switch_mode() ) {
+    if ( !start_multi_switch() ) {
+      error( "Failed to start multi-switch mode." );
+      return -1;
+    }
+  }
+  else {
+    if ( pool_fd >= 0 ) {
+      switch_info.secure_channel_fd = -1;
+    }
+    else {
+      init_secure_channel( &switch_info, switch_info.secure_channel_fd );
+      attach_packetin_policer( &switch_info );
+      attach_cookie_table( &switch_info );
+      attach_echo_monitor( &switch_info );
+      attach_flow_reconciler( &switch_info );
+      attach_flow_shadow( &switch_info );
+    }
 
-  set_fd_set_callback( secure_channel_fd_set );
-  set_check_fd_isset_callback( secure_channel_fd_isset );
-  add_message_received_callback( get_trema_name(), service_recv );
+    set_fd_set_callback( secure_channel_fd_set );
+    set_check_fd_isset_callback( secure_channel_fd_isset );
+    add_message_received_callback( get_trema_name(), service_recv );
+  }
 
   snprintf( management_service_name , MESSENGER_SERVICE_NAME_LENGTH,
             "%s.m", get_trema_name() );
   management_service_name[ MESSENGER_SERVICE_NAME_LENGTH - 1 ] = '\0';
   add_message_received_callback( management_service_name, management_recv );
+  if ( switch_manager_service_name != NULL ) {
+    add_message_replied_callback( management_service_name, handle_dpid_claim_reply );
+  }
 
-  ret = switch_event_connected( &switch_info );
-  if ( ret < 0 ) {
-    error( "Failed to set connected state." );
-    return -1;
+  if ( pool_fd >= 0 ) {
+    send_pool_report( SWITCH_POOL_READY, 0 );
   }
+  else if ( !multi_switch_mode() ) {
+    ret = switch_event_connected( &switch_info );
+    if ( ret < 0 ) {
+      error( "Failed to set connected state." );
+      return -1;
+    }
+  }
+
+  return 0;
+}
 
-  start_trema();
 
-  finalize_xid_table();
-  finalize_cookie_table();
+// for an application that links the switch daemon in
+int
+start_switch_daemon( int argc, char *argv[] ) {
+  return setup_switch_daemon( argc, argv, true );
+}
 
-  return 0;
+
+// for the switch daemon executable
+int
+start_standalone_switch_daemon( int argc, char *argv[] ) {
+  return setup_switch_daemon( argc, argv, false );
+}
+
+
+void
+stop_switch_daemon( void ) {
+  finalize_packetin_policer();
+  finalize_cookie_table();
+  finalize_echo_monitor();
+  finalize_flow_reconciler();
+  finalize_flow_shadow();
+  finalize_trusted_services();
+  if ( multi_switch_mode() ) {
+    finalize_multi_switch();
+  }
+  free_deferred_datapath_ids( &granted_datapath_ids );
+  free_deferred_datapath_ids( &disconnect_requested_datapath_ids );
+  finalize_xid_table();
+  close( backlog_fd );
+  backlog_fd = -1;
 }
 
 
@@ -39,6 +39,11 @@
 #define SWITCH_MANAGER_PREFIX_STR_LEN sizeof( SWITCH_MANAGER_PREFIX )
 #define SWITCH_MANAGER_DPID_STR_LEN sizeof( "1234567812345678" )
 
+int start_switch_daemon( int argc, char *argv[] );
+int start_standalone_switch_daemon( int argc, char *argv[] );
+void stop_switch_daemon( void );
+void switch_daemon_usage( void );
+
 int switch_event_connected( struct switch_info *switch_info );
 int switch_event_disconnected( struct switch_info *switch_info );
 int switch_event_recv_hello( struct switch_info *switch_info );
@@ -46,6 +51,9 @@ int switch_event_recv_featuresreply( struct switch_info *switch_info, uint64_t *
 int switch_event_recv_from_application( uint64_t *datapath_id, char *application_service_name, buffer *buf );
 int switch_event_disconnect_request( uint64_t *datapath_id );
 int switch_event_recv_error( struct switch_info *sw_info );
+int switch_event_send_to_secure_channel( struct switch_info *sw_info, buffer *buf );
+int switch_event_liveness_request( uint64_t *datapath_id, char *application_service_name );
+void switch_event_flow_snapshot_completed( struct switch_info *sw_info );
 
 
 #endif // SWITCH_MANAGER_H
@@ -32,7 +32,9 @@
 #include "trema.h"
 #include "secure_channel_listener.h"
 #include "switch_manager.h"
+#include "switch_pool.h"
 #include "dpid_table.h"
+#include "openflow_service_interface.h"
 
 
 #ifdef UNIT_TESTING
@@ -147,10 +149,13 @@ struct listener_info listener_info;
 static struct option long_options[] = {
   { "port", 1, NULL, 'p' },
   { "switch", 1, NULL, 's' },
+  { "multi-switch", 1, NULL, 'm' },
+  { "pool", 1, NULL, 'P' },
+  { "max-pool", 1, NULL, 'M' },
   { NULL, 0, NULL, 0  },
 };
 
-static char short_options[] = "p:s:";
+static char short_options[] = "p:s:m:P:M:";
 
 
 void
@@ -160,12 +165,15 @@ usage() {
 	 "Usage: %s [OPTION]... [-- SWITCH_MANAGER_OPTION]...\n"
 	 "\n"
 	 "  -s, --switch=PATH           the command path of switch\n"
+	 "  -m, --multi-switch=N        handle all switches with N switch processes\n"
+	 "  -P, --pool=N                keep at least N idle switch processes\n"
+	 "  -M, --max-pool=N            keep at most N idle switch processes (default %d)\n"
 	 "  -n, --name=SERVICE_NAME     service name\n"
          "  -p, --port=PORT             server listen port (default %u)\n"
 	 "  -d, --daemonize             run in the background\n"
 	 "  -l, --logging_level=LEVEL   set logging level\n"
 	 "  -h, --help                  display this help and exit\n"
-	 , get_executable_name(), OFP_TCP_PORT
+	 , get_executable_name(), DEFAULT_MAX_SWITCH_DAEMON_POOL_SIZE, OFP_TCP_PORT
 	 );
 }
 
@@ -208,7 +216,8 @@ static void
 secure_channel_fd_set( fd_set *read_set, fd_set *write_set ) {
   UNUSED( write_set );
 
-  if ( listener_info.listen_fd < 0 ) {
+  switch_pool_fd_set( read_set );
+  if ( listener_info.listen_fd < 0 || listener_info.multi_switch_daemons > 0 ) {
     return;
   }
   FD_SET( listener_info.listen_fd, read_set );
@@ -219,7 +228,8 @@ static void
 secure_channel_fd_isset( fd_set *read_set, fd_set *write_set ) {
   UNUSED( write_set );
 
-  if ( listener_info.listen_fd < 0 ) {
+  switch_pool_fd_isset( read_set );
+  if ( listener_info.listen_fd < 0 || listener_info.multi_switch_daemons > 0 ) {
     return;
   }
   if ( FD_ISSET( listener_info.listen_fd, read_set ) ) {
@@ -275,6 +285,7 @@ init_listener_info( struct listener_info *listener_info ) {
   listener_info->switch_daemon = xconcatenate_path( get_trema_home(), SWITCH_MANAGER_PATH );
   listener_info->listen_port = OFP_TCP_PORT;
   listener_info->listen_fd = -1;
+  listener_info->max_switch_daemon_pool_size = DEFAULT_MAX_SWITCH_DAEMON_POOL_SIZE;
 }
 
 
@@ -305,6 +316,20 @@ strtoport( const char *str ) {
 }
 
 
+static int
+strtodaemons( const char *str, int max ) {
+  char *ep;
+  long l;
+
+  l = strtol( str, &ep, 0 );
+  if ( l <= 0 || l > max || *ep != '\0' ) {
+    die( "Invalid number of switch processes. %s", str );
+    return 0;
+  }
+  return ( int ) l;
+}
+
+
 static bool
 parse_argument( struct listener_info *listener_info, int argc, char *argv[] ) {
   int c;
@@ -321,6 +346,24 @@ parse_argument( struct listener_info *listener_info, int argc, char *argv[] ) {
         xfree( (void *)( uintptr_t )listener_info->switch_daemon );
         listener_info->switch_daemon = xstrdup( optarg );
         break;
+      case 'm':
+        listener_info->multi_switch_daemons = strtodaemons( optarg, MAX_MULTI_SWITCH_DAEMONS );
+        if ( listener_info->multi_switch_daemons == 0 ) {
+          return false;
+        }
+        break;
+      case 'P':
+        listener_info->switch_daemon_pool_size = strtodaemons( optarg, MAX_SWITCH_DAEMON_POOL_SIZE );
+        if ( listener_info->switch_daemon_pool_size == 0 ) {
+          return false;
+        }
+        break;
+      case 'M':
+        listener_info->max_switch_daemon_pool_size = strtodaemons( optarg, MAX_SWITCH_DAEMON_POOL_SIZE );
+        if ( listener_info->max_switch_daemon_pool_size == 0 ) {
+          return false;
+        }
+        break;
       default:
         usage();
         exit( EXIT_SUCCESS );
@@ -329,6 +372,10 @@ parse_argument( struct listener_info *listener_info, int argc, char *argv[] ) {
     }
   }
 
+  if ( listener_info->max_switch_daemon_pool_size < listener_info->switch_daemon_pool_size ) {
+    listener_info->max_switch_daemon_pool_size = listener_info->switch_daemon_pool_size;
+  }
+
   listener_info->switch_daemon_argc = argc - optind;
   listener_info->switch_daemon_argv = &argv[ optind ];
 
@@ -347,12 +394,80 @@ catch_sigchild( void ) {
 }
 
 
+static void
+reply_to_dpid_claim( uint64_t datapath_id, messenger_context_handle *handle, bool granted ) {
+  dpid_claim_reply reply;
+  reply.datapath_id = htonll( datapath_id );
+  reply.granted = granted ? 1 : 0;
+  send_reply_message( handle, DPID_CLAIM_REQUEST, &reply, sizeof( reply ) );
+  xfree( handle );
+}
+
+
+static void
+grant_expired_dpid_claim( uint64_t datapath_id, messenger_context_handle *handle ) {
+  warn( "Datapath %#" PRIx64 " is not released in %d seconds. Granting it to %s.",
+        datapath_id, DPID_CLAIM_TIMEOUT, handle->service_name );
+  reply_to_dpid_claim( datapath_id, handle, true );
+}
+
+
+static void
+age_dpid_claims_periodically( void *user_data ) {
+  UNUSED( user_data );
+
+  age_dpid_claims( DPID_CLAIM_TIMEOUT, grant_expired_dpid_claim );
+}
+
+
+static void
+handle_dpid_claim( const messenger_context_handle *handle, void *data, size_t len ) {
+  if ( len != sizeof( uint64_t ) ) {
+    error( "Invalid datapath id claim ( len = %zu ).", len );
+    return;
+  }
+  uint64_t datapath_id = ntohll( *( uint64_t * ) data );
+
+  if ( !lookup_dpid_entry( &datapath_id ) ) {
+    debug( "Datapath %#" PRIx64 " is granted to %s.", datapath_id, handle->service_name );
+    insert_dpid_entry( &datapath_id );
+    dpid_claim_reply reply = { htonll( datapath_id ), 1 };
+    send_reply_message( handle, DPID_CLAIM_REQUEST, &reply, sizeof( reply ) );
+    return;
+  }
+
+  debug( "Datapath %#" PRIx64 " is claimed by %s.", datapath_id, handle->service_name );
+  messenger_context_handle *superseded = hold_dpid_claim( &datapath_id, handle );
+  if ( superseded != NULL ) {
+    // the holder has already been asked to disconnect
+    reply_to_dpid_claim( datapath_id, superseded, false );
+    return;
+  }
+
+  char service_name[ MESSENGER_SERVICE_NAME_LENGTH ];
+  snprintf( service_name, sizeof( service_name ), "%s%" PRIx64, SWITCH_MANAGER_PREFIX, datapath_id );
+  uint16_t name_length = ( uint16_t ) ( strlen( get_trema_name() ) + 1 );
+  buffer *request = alloc_buffer_with_length( sizeof( openflow_service_header_t ) + name_length );
+  openflow_service_header_t *header = append_back_buffer( request, sizeof( openflow_service_header_t ) );
+  header->datapath_id = htonll( datapath_id );
+  header->service_name_length = htons( name_length );
+  memcpy( append_back_buffer( request, name_length ), get_trema_name(), name_length );
+  if ( !send_message( service_name, MESSENGER_OPENFLOW_DISCONNECT_REQUEST, request->data, request->length ) ) {
+    error( "Failed to request %s to disconnect.", service_name );
+  }
+  free_buffer( request );
+}
+
+
 static void
 handle_switch_ready( uint64_t datapath_id, void *user_data ) {
   UNUSED( user_data );
 
   debug( "Switch (dpid = %#" PRIx64 ") is connected.", datapath_id );
-  insert_dpid_entry( &datapath_id );
+  if ( !lookup_dpid_entry( &datapath_id ) ) {
+    // switch daemons not started by us do not claim datapath ids
+    insert_dpid_entry( &datapath_id );
+  }
 }
 
 
@@ -361,6 +476,11 @@ handle_switch_disconnected( uint64_t datapath_id, void *user_data ) {
   UNUSED( user_data );
 
   debug( "Switch (dpid = %#" PRIx64 ") is disconnected.", datapath_id );
+  messenger_context_handle *claim = take_dpid_claim( &datapath_id );
+  if ( claim != NULL ) {
+    reply_to_dpid_claim( datapath_id, claim, true );
+    return;
+  }
   delete_dpid_entry( &datapath_id );
 }
 
@@ -368,9 +488,10 @@ handle_switch_disconnected( uint64_t datapath_id, void *user_data ) {
 static void
 recv_request( const messenger_context_handle *handle,
               uint16_t tag, void *data, size_t len ) {
-  UNUSED( tag );
-  UNUSED( data );
-  UNUSED( len );
+  if ( tag == DPID_CLAIM_REQUEST ) {
+    handle_dpid_claim( handle, data, len );
+    return;
+  }
 
   buffer *reply = get_switches();
   send_reply_message( handle, 0, reply->data, reply->length );
@@ -380,6 +501,7 @@ recv_request( const messenger_context_handle *handle,
 
 static bool
 start_service_management( void ) {
+  add_periodic_event_callback( 1, age_dpid_claims_periodically, NULL );
   return add_message_requested_callback( get_trema_name(), recv_request );
 }
 
@@ -447,8 +569,25 @@ main( int argc, char *argv[] ) {
     exit( EXIT_FAILURE );
   }
 
+  int i;
+  for ( i = 0; i < listener_info.multi_switch_daemons; i++ ) {
+    if ( !secure_channel_start_multi_switch_daemon( &listener_info, i ) ) {
+      finalize_listener_info( &listener_info );
+      exit( EXIT_FAILURE );
+    }
+  }
+  if ( listener_info.multi_switch_daemons == 0 && listener_info.switch_daemon_pool_size > 0 ) {
+    ret = init_switch_pool( &listener_info, ( unsigned int ) listener_info.switch_daemon_pool_size,
+                            ( unsigned int ) listener_info.max_switch_daemon_pool_size );
+    if ( !ret ) {
+      finalize_listener_info( &listener_info );
+      exit( EXIT_FAILURE );
+    }
+  }
+
   start_trema();
 
+  finalize_switch_pool();
   finalize_listener_info( &listener_info );
   stop_switch_management();
   stop_service_management();
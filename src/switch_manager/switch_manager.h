@@ -31,7 +31,10 @@ static const char SWITCH_MANAGER_NAME_OPTION[] = "--name=";
 static const uint SWITCH_MANAGER_NAME_OPTION_STR_LEN = sizeof( SWITCH_MANAGER_NAME_OPTION );
 static const char SWITCH_MANAGER_SOCKET_OPTION[] = "--socket=";
 static const uint SWITCH_MANAGER_SOCKET_OPTION_STR_LEN = sizeof( SWITCH_MANAGER_SOCKET_OPTION );
+static const char SWITCH_MANAGER_LISTEN_OPTION[] = "--listen=";
+static const char SWITCH_MANAGER_POOL_OPTION[] = "--pool=";
 static const char SWITCH_MANAGER_DAEMONIZE_OPTION[] = "--daemonize";
+static const char SWITCH_MANAGER_REGISTRY_OPTION[] = "--switch-manager=";
 static const uint SWITCH_MANAGER_SOCKET_STR_LEN = sizeof( "2147483647" );
 static const char SWITCH_MANAGER_COMMAND_PREFIX[] = "switch.";
 static const uint SWITCH_MANAGER_COMMAND_PREFIX_STR_LEN = sizeof( SWITCH_MANAGER_COMMAND_PREFIX );
@@ -41,6 +44,11 @@ static const uint SWITCH_MANAGER_ADDR_STR_LEN = sizeof( "255.255.255.255:65535"
 
 static const char SWITCH_MANAGER_PATH[] = "objects/switch_manager/switch";
 static const char SWITCH_MANAGER_STATE_PREFIX[] = "state_notify::";
+static const char SWITCH_MANAGER_MULTI_SWITCH_PREFIX[] = "multi.";
+static const int MAX_MULTI_SWITCH_DAEMONS = 256;
+static const char SWITCH_MANAGER_POOL_PREFIX[] = "pool.";
+static const int MAX_SWITCH_DAEMON_POOL_SIZE = 1024;
+static const int DEFAULT_MAX_SWITCH_DAEMON_POOL_SIZE = 128;
 
 
 struct listener_info {
@@ -49,6 +57,9 @@ struct listener_info {
   char **switch_daemon_argv;
   uint16_t listen_port;
   int listen_fd;
+  int multi_switch_daemons; // zero means a switch process per secure channel
+  int switch_daemon_pool_size; // minimum number of idle switch processes
+  int max_switch_daemon_pool_size;
 };
 
 
@@ -0,0 +1,389 @@
+/*
+ * Pool of pre-started switch daemons.
+ *
+ * Instead of forking and executing a switch daemon after accepting a
+ * secure channel, switch manager keeps idle switch daemons that have
+ * already been initialized and passes accepted sockets to them. The
+ * number of idle daemons follows the recent accept rate.
+ *
+ * Copyright (C) 2008-2011 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include "trema.h"
+#include "secure_channel_listener.h"
+#include "switch_pool.h"
+
+
+typedef struct pooled_daemon {
+  int fd;            // our end of the socket pair
+  bool ready;        // initialized and waiting for a secure channel
+  bool handed_over;  // a secure channel has been passed to the daemon
+} pooled_daemon;
+
+
+static struct listener_info *listener = NULL;
+static list_element *daemons = NULL;
+static unsigned int min_pool_size = 0;
+static unsigned int max_pool_size = 0;
+static unsigned int target_pool_size = 0;
+static unsigned int accepts = 0;     // accepted in the current interval
+static unsigned int accept_rate = 0; // smoothed accepts per interval
+
+static const time_t SWITCH_POOL_ADJUST_INTERVAL = 1;
+
+// upper bounds of accept to features reply latency in milliseconds
+static const uint64_t LATENCY_BUCKETS[] = { 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000 };
+#define N_LATENCY_BUCKETS ( sizeof( LATENCY_BUCKETS ) / sizeof( LATENCY_BUCKETS[ 0 ] ) )
+static uint64_t latency_histogram[ N_LATENCY_BUCKETS + 1 ];
+
+
+static pooled_daemon *
+spawn_pooled_daemon( void ) {
+  int fd = secure_channel_start_pooled_switch_daemon( listener );
+  if ( fd < 0 ) {
+    return NULL;
+  }
+
+  pooled_daemon *daemon = xmalloc( sizeof( pooled_daemon ) );
+  daemon->fd = fd;
+  daemon->ready = false;
+  daemon->handed_over = false;
+  insert_in_front( &daemons, daemon );
+
+  return daemon;
+}
+
+
+static void
+delete_pooled_daemon( pooled_daemon *daemon ) {
+  delete_element( &daemons, daemon );
+  close( daemon->fd );
+  xfree( daemon );
+}
+
+
+static void
+delete_pooled_daemons( void ) {
+  while ( daemons != NULL ) {
+    delete_pooled_daemon( daemons->data );
+  }
+}
+
+
+static unsigned int
+count_idle_daemons( void ) {
+  unsigned int n_idle = 0;
+  list_element *element;
+  for ( element = daemons; element != NULL; element = element->next ) {
+    pooled_daemon *daemon = element->data;
+    if ( !daemon->handed_over ) {
+      n_idle++;
+    }
+  }
+
+  return n_idle;
+}
+
+
+// prefers daemons that have completed initialization
+static pooled_daemon *
+lookup_idle_daemon( void ) {
+  pooled_daemon *starting = NULL;
+  list_element *element;
+  for ( element = daemons; element != NULL; element = element->next ) {
+    pooled_daemon *daemon = element->data;
+    if ( daemon->handed_over ) {
+      continue;
+    }
+    if ( daemon->ready ) {
+      return daemon;
+    }
+    if ( starting == NULL ) {
+      starting = daemon;
+    }
+  }
+
+  return starting;
+}
+
+
+// prefers daemons still starting, then the newest one, to keep warm ones
+static pooled_daemon *
+lookup_retiring_daemon( void ) {
+  pooled_daemon *newest = NULL;
+  list_element *element;
+  // daemons are inserted in front, so the list is ordered newest first
+  for ( element = daemons; element != NULL; element = element->next ) {
+    pooled_daemon *daemon = element->data;
+    if ( daemon->handed_over ) {
+      continue;
+    }
+    if ( !daemon->ready ) {
+      return daemon;
+    }
+    if ( newest == NULL ) {
+      newest = daemon;
+    }
+  }
+
+  return newest;
+}
+
+
+static bool
+send_secure_channel( pooled_daemon *daemon, int fd, const struct timespec *accepted_at ) {
+  switch_pool_handover handover;
+  char control[ CMSG_SPACE( sizeof( int ) ) ];
+  struct iovec iov;
+  struct msghdr msg;
+
+  memset( &handover, 0, sizeof( switch_pool_handover ) );
+  handover.accepted_at = *accepted_at;
+  iov.iov_base = &handover;
+  iov.iov_len = sizeof( switch_pool_handover );
+
+  memset( control, 0, sizeof( control ) );
+  memset( &msg, 0, sizeof( struct msghdr ) );
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof( control );
+  struct cmsghdr *cmsg = CMSG_FIRSTHDR( &msg );
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN( sizeof( int ) );
+  memcpy( CMSG_DATA( cmsg ), &fd, sizeof( int ) );
+
+  if ( sendmsg( daemon->fd, &msg, MSG_NOSIGNAL ) < 0 ) {
+    warn( "Failed to pass a secure channel to a pooled switch daemon ( errno = %s [%d] ).",
+          strerror( errno ), errno );
+    return false;
+  }
+
+  return true;
+}
+
+
+/*
+ * Passes an accepted secure channel to an idle switch daemon. If no daemon
+ * is idle, a new one is started and takes the secure channel as soon as it
+ * has been initialized. The caller still owns fd.
+ */
+bool
+switch_pool_hand_over( int fd, const struct timespec *accepted_at ) {
+  assert( accepted_at != NULL );
+
+  accepts++;
+
+  pooled_daemon *daemon;
+  while ( ( daemon = lookup_idle_daemon() ) != NULL ) {
+    if ( send_secure_channel( daemon, fd, accepted_at ) ) {
+      break;
+    }
+    // the daemon has gone away
+    delete_pooled_daemon( daemon );
+  }
+  if ( daemon == NULL ) {
+    daemon = spawn_pooled_daemon();
+    if ( daemon == NULL || !send_secure_channel( daemon, fd, accepted_at ) ) {
+      return false;
+    }
+  }
+  daemon->handed_over = true;
+  increment_stat( "switch_manager.pool.handed_over" );
+
+  // keep the pool filled up during a connect storm
+  if ( count_idle_daemons() < target_pool_size ) {
+    spawn_pooled_daemon();
+  }
+
+  return true;
+}
+
+
+static void
+update_latency_histogram( uint64_t latency ) {
+  uint64_t msec = latency / 1000000;
+  unsigned int i;
+  for ( i = 0; i < N_LATENCY_BUCKETS; i++ ) {
+    if ( msec <= LATENCY_BUCKETS[ i ] ) {
+      break;
+    }
+  }
+  latency_histogram[ i ]++;
+
+  // cumulative counts as in "le" buckets
+  char key[ STAT_KEY_LENGTH ];
+  uint64_t count = 0;
+  for ( i = 0; i < N_LATENCY_BUCKETS; i++ ) {
+    count += latency_histogram[ i ];
+    snprintf( key, sizeof( key ), "switch_manager.features_reply_latency.le_%" PRIu64 "ms", LATENCY_BUCKETS[ i ] );
+    set_stat( key, count );
+  }
+  count += latency_histogram[ N_LATENCY_BUCKETS ];
+  set_stat( "switch_manager.features_reply_latency.le_inf", count );
+}
+
+
+static void
+recv_report( pooled_daemon *daemon ) {
+  switch_pool_report report;
+
+  ssize_t length = recv( daemon->fd, &report, sizeof( switch_pool_report ), 0 );
+  if ( length < 0 && ( errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK ) ) {
+    return;
+  }
+  if ( length != ( ssize_t ) sizeof( switch_pool_report ) ) {
+    if ( !daemon->handed_over ) {
+      warn( "Pooled switch daemon exited before taking a secure channel." );
+    }
+    delete_pooled_daemon( daemon );
+    return;
+  }
+
+  switch ( report.type ) {
+  case SWITCH_POOL_READY:
+    daemon->ready = true;
+    break;
+
+  case SWITCH_POOL_FEATURES_REPLIED:
+    update_latency_histogram( report.latency );
+    // nothing more to hear from the daemon
+    delete_pooled_daemon( daemon );
+    break;
+
+  default:
+    error( "Undefined switch pool report ( type = %#x ).", report.type );
+    break;
+  }
+}
+
+
+void
+switch_pool_fd_set( fd_set *read_set ) {
+  list_element *element;
+  for ( element = daemons; element != NULL; element = element->next ) {
+    pooled_daemon *daemon = element->data;
+    FD_SET( daemon->fd, read_set );
+  }
+}
+
+
+void
+switch_pool_fd_isset( fd_set *read_set ) {
+  list_element *element = daemons;
+  while ( element != NULL ) {
+    pooled_daemon *daemon = element->data;
+    element = element->next;
+    if ( FD_ISSET( daemon->fd, read_set ) ) {
+      recv_report( daemon );
+    }
+  }
+}
+
+
+static void
+adjust_switch_pool( void *user_data ) {
+  UNUSED( user_data );
+
+  accept_rate = ( accept_rate + accepts + 1 ) / 2;
+  accepts = 0;
+
+  target_pool_size = accept_rate;
+  if ( target_pool_size < min_pool_size ) {
+    target_pool_size = min_pool_size;
+  }
+  if ( target_pool_size > max_pool_size ) {
+    target_pool_size = max_pool_size;
+  }
+
+  unsigned int n_idle = count_idle_daemons();
+  for ( ; n_idle < target_pool_size; n_idle++ ) {
+    if ( spawn_pooled_daemon() == NULL ) {
+      break;
+    }
+  }
+  // idle daemons exit when their socket is closed
+  while ( n_idle > target_pool_size ) {
+    delete_pooled_daemon( lookup_retiring_daemon() );
+    n_idle--;
+  }
+
+  set_stat( "switch_manager.pool.target", target_pool_size );
+  set_stat( "switch_manager.pool.idle", n_idle );
+}
+
+
+bool
+init_switch_pool( struct listener_info *listener_info, unsigned int min_size, unsigned int max_size ) {
+  assert( listener_info != NULL );
+  assert( min_size > 0 );
+  assert( min_size <= max_size );
+
+  listener = listener_info;
+  min_pool_size = min_size;
+  max_pool_size = max_size;
+  target_pool_size = min_size;
+  accepts = 0;
+  accept_rate = 0;
+  memset( latency_histogram, 0, sizeof( latency_histogram ) );
+  create_list( &daemons );
+
+  unsigned int i;
+  for ( i = 0; i < min_pool_size; i++ ) {
+    if ( spawn_pooled_daemon() == NULL ) {
+      delete_pooled_daemons();
+      listener = NULL;
+      return false;
+    }
+  }
+  add_periodic_event_callback( SWITCH_POOL_ADJUST_INTERVAL, adjust_switch_pool, NULL );
+
+  return true;
+}
+
+
+void
+finalize_switch_pool( void ) {
+  if ( listener == NULL ) {
+    return;
+  }
+
+  delete_periodic_event_callback( adjust_switch_pool );
+  delete_pooled_daemons();
+  listener = NULL;
+}
+
+
+bool
+switch_pool_enabled( void ) {
+  return listener != NULL;
+}
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2008-2011 NEC Corporation
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License, version 2, as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+
+#ifndef SWITCH_POOL_H
+#define SWITCH_POOL_H
+
+
+#include <sys/select.h>
+#include <time.h>
+#include "trema.h"
+
+
+/*
+ * Messages exchanged between switch manager and a pooled switch daemon
+ * over a SOCK_SEQPACKET socket pair. Both ends run on the same host, so
+ * fields are in host byte order.
+ */
+enum {
+  SWITCH_POOL_READY = 1,          // the daemon is ready to take a secure channel
+  SWITCH_POOL_FEATURES_REPLIED,   // the handshake with the switch completed
+};
+
+typedef struct switch_pool_report {
+  uint16_t type;
+  uint64_t latency; // nanoseconds from accept to features reply
+} switch_pool_report;
+
+// sent with the accepted socket in SCM_RIGHTS
+typedef struct switch_pool_handover {
+  struct timespec accepted_at; // CLOCK_MONOTONIC
+} switch_pool_handover;
+
+
+struct listener_info;
+
+bool init_switch_pool( struct listener_info *listener_info, unsigned int min_size, unsigned int max_size );
+void finalize_switch_pool( void );
+bool switch_pool_enabled( void );
+bool switch_pool_hand_over( int fd, const struct timespec *accepted_at );
+void switch_pool_fd_set( fd_set *read_set );
+void switch_pool_fd_isset( fd_set *read_set );
+
+
+#endif // SWITCH_POOL_H
+
+
+/*
+ * Local variables:
+ * c-basic-offset: 2
+ * indent-tabs-mode: nil
+ * End:
+ */
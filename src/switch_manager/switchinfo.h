@@ -22,6 +22,7 @@
 #define SWITCHINFO_H
 
 
+#include <time.h>
 #include "message_queue.h"
 
 
@@ -30,6 +31,7 @@
 #define SWITCH_STATE_WAIT_FEATURES_REPLY 2
 #define SWITCH_STATE_COMPLETED           3
 #define SWITCH_STATE_DISCONNECTED        4
+#define SWITCH_STATE_WAIT_DPID_CLAIM     5
 
 
 struct switch_info {
@@ -43,6 +45,14 @@ struct switch_info {
 
   int secure_channel_fd;        // socket file descriptor of secure channel
   bool flow_cleanup;
+  bool cork;                    // send with MSG_MORE while more messages are queued
+
+  // budgets per wakeup of the switch daemon
+  size_t recv_budget;           // bytes read from secure channel
+  long handle_budget;           // microseconds spent handling received messages
+  size_t send_budget;           // bytes written to secure channel
+
+  unsigned int packetin_congestion_threshold; // send queue usage in percent to drop packet_in at
 
   int state;                    // state of switch secure channel
   uint64_t datapath_id;
@@ -51,11 +61,22 @@ struct switch_info {
   uint16_t miss_send_len;       /* Max bytes of new flow that datapath should
                                    send to the controller. */
 
-  buffer *fragment_buf;         /* openflow message fragmentation buffer of
-                                   secure channel receiver */
+  struct recv_ring *recv_ring;  // received bytes of secure channel
 
   message_queue *send_queue;
   message_queue *recv_queue;
+
+  struct packetin_policer *packetin_policer;
+  struct cookie_table *cookie_table;
+  struct echo_monitor *echo_monitor;
+  struct flow_reconciler *flow_reconciler;
+  struct flow_shadow *flow_shadow;
+
+  struct timespec accepted_at;  // when the secure channel was accepted. zero if unknown
+  struct timespec connected_at; // when the handshake was started
+  time_t handshake_deadline;    // hello/features reply timeout in multi-switch mode
+  uint32_t polled_events;       // epoll events watched in multi-switch mode
+  bool backlogged;              // has received messages left to handle in multi-switch mode
 };
 
 
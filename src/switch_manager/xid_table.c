@@ -21,54 +21,158 @@
 #include <assert.h>
 #include <openflow.h>
 #include <string.h>
+#include <time.h>
 #include "trema.h"
 #include "xid_table.h"
 
 
-static uint32_t transaction_id = 0U;
+/*
+ * Transaction ids of messages sent to a switch are mapped to the original
+ * ids given by applications. Entries are deleted when the last reply is
+ * received or when their lifetime has passed. Messages that may only be
+ * answered with an error get a short lifetime. Since lifetimes are fixed,
+ * entries are expired in insertion order from the head of two lists.
+ */
+#define XID_REQUEST_LIFETIME 60
+#define XID_NO_REPLY_LIFETIME 5
 
-#define XID_MAX_ENTRIES 4096
+static const time_t XID_TABLE_AGING_INTERVAL = 1;
+
+typedef struct xid_list {
+  xid_entry_t *head;
+  xid_entry_t *tail;
+} xid_list_t;
 
 typedef struct xid_table {
-  xid_entry_t *entries[ XID_MAX_ENTRIES ];
   hash_table *hash;
-  int next_index;
+  xid_list_t requests;
+  xid_list_t no_replies;
+  hash_table *services;
+  unsigned int in_flight;
 } xid_table_t;
 
 static xid_table_t xid_table;
+static uint32_t transaction_id = 0U;
 
 
+/*
+ * Skips ids in use, which are at most as many as live entries since ids
+ * are handed out in sequence.
+ */
 uint32_t
 generate_xid( void ) {
-  uint32_t initial_value = ( transaction_id != UINT32_MAX ) ? ++transaction_id : 0;
-
-  while ( lookup_xid_entry( transaction_id ) != NULL ) {
-    if ( transaction_id != UINT32_MAX ) {
-      transaction_id++;
-    }
-    else {
-      transaction_id = 0;
-    }
-    if ( initial_value == transaction_id ) {
-      error( "Failed to generate transaction id value." );
-      transaction_id = 0;
-      break;
-    }
-  }
+  do {
+    transaction_id++;
+  } while ( lookup_xid_entry( transaction_id ) != NULL );
 
   return transaction_id;
 }
 
 
+static bool
+expects_reply( uint8_t type ) {
+  switch ( type ) {
+  case OFPT_ECHO_REQUEST:
+  case OFPT_VENDOR:
+  case OFPT_FEATURES_REQUEST:
+  case OFPT_GET_CONFIG_REQUEST:
+  case OFPT_STATS_REQUEST:
+  case OFPT_BARRIER_REQUEST:
+  case OFPT_QUEUE_GET_CONFIG_REQUEST:
+    return true;
+
+  default:
+    return false;
+  }
+}
+
+
+static void
+append_xid_entry( xid_list_t *list, xid_entry_t *entry ) {
+  entry->list = list;
+  entry->next = NULL;
+  entry->prev = list->tail;
+  if ( list->tail != NULL ) {
+    list->tail->next = entry;
+  }
+  else {
+    list->head = entry;
+  }
+  list->tail = entry;
+}
+
+
+static void
+remove_xid_entry( xid_entry_t *entry ) {
+  xid_list_t *list = entry->list;
+  if ( entry->prev != NULL ) {
+    entry->prev->next = entry->next;
+  }
+  else {
+    list->head = entry->next;
+  }
+  if ( entry->next != NULL ) {
+    entry->next->prev = entry->prev;
+  }
+  else {
+    list->tail = entry->prev;
+  }
+  entry->prev = entry->next = NULL;
+}
+
+
+static xid_service_t *
+ref_xid_service( const char *service_name ) {
+  xid_service_t *service = lookup_hash_entry( xid_table.services, service_name );
+  if ( service == NULL ) {
+    service = xmalloc( sizeof( xid_service_t ) );
+    service->name = xstrdup( service_name );
+    service->in_flight = 0;
+    insert_hash_entry( xid_table.services, service->name, service );
+  }
+  service->in_flight++;
+
+  return service;
+}
+
+
+// services are kept until finalized so that their stats drop to zero
+static void
+unref_xid_service( xid_service_t *service ) {
+  assert( service->in_flight > 0 );
+
+  service->in_flight--;
+}
+
+
+static void
+delete_xid_services( void ) {
+  hash_iterator iter;
+  hash_entry *e;
+
+  init_hash_iterator( xid_table.services, &iter );
+  while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
+    xid_service_t *service = e->value;
+    xfree( service->name );
+    xfree( service );
+  }
+  delete_hash( xid_table.services );
+  xid_table.services = NULL;
+}
+
+
 static xid_entry_t *
-allocate_xid_entry( uint32_t original_xid, char *service_name, int index ) {
+allocate_xid_entry( uint32_t original_xid, char *service_name ) {
   xid_entry_t *new_entry;
 
   new_entry = xmalloc( sizeof ( xid_entry_t ) );
   new_entry->xid = generate_xid();
   new_entry->original_xid = original_xid;
-  new_entry->service_name = xstrdup( service_name );
-  new_entry->index = index;
+  new_entry->service = ref_xid_service( service_name );
+  new_entry->service_name = new_entry->service->name;
+  new_entry->expire_at = 0;
+  new_entry->list = NULL;
+  new_entry->prev = new_entry->next = NULL;
 
   return new_entry;
 }
@@ -76,71 +180,129 @@ allocate_xid_entry( uint32_t original_xid, char *service_name, int index ) {
 
 static void
 free_xid_entry( xid_entry_t *free_entry ) {
-  xfree( free_entry->service_name );
+  unref_xid_service( free_entry->service );
   xfree( free_entry );
 }
 
 
+static void
+update_xid_table_stats( void ) {
+  char key[ STAT_KEY_LENGTH ];
+  hash_iterator iter;
+  hash_entry *e;
+
+  set_stat( "switch.xid_table.in_flight", xid_table.in_flight );
+  init_hash_iterator( xid_table.services, &iter );
+  while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
+    xid_service_t *service = e->value;
+    snprintf( key, sizeof( key ), "switch.xid_table.in_flight.%s", service->name );
+    set_stat( key, service->in_flight );
+  }
+}
+
+
+static void
+expire_xid_entries( xid_list_t *list, time_t now ) {
+  while ( list->head != NULL && list->head->expire_at <= now ) {
+    xid_entry_t *entry = list->head;
+    debug( "Expiring xid entry ( xid = %#lx, original_xid = %#lx, service_name = %s ).",
+           entry->xid, entry->original_xid, entry->service_name );
+    increment_stat( "switch.xid_table.expired" );
+    delete_xid_entry( entry );
+  }
+}
+
+
+static void
+age_xid_table( void *user_data ) {
+  UNUSED( user_data );
+
+  time_t now = time( NULL );
+  expire_xid_entries( &xid_table.requests, now );
+  expire_xid_entries( &xid_table.no_replies, now );
+  update_xid_table_stats();
+}
+
+
 void
 init_xid_table( void ) {
   memset( &xid_table, 0, sizeof( xid_table_t ) );
   xid_table.hash = create_hash( compare_uint32, hash_uint32 );
-  xid_table.next_index = 0;
+  xid_table.services = create_hash( compare_string, hash_string );
+  add_periodic_event_callback( XID_TABLE_AGING_INTERVAL, age_xid_table, NULL );
+}
+
+
+static void
+delete_xid_entries( xid_list_t *list ) {
+  while ( list->head != NULL ) {
+    delete_xid_entry( list->head );
+  }
 }
 
 
 void
 finalize_xid_table( void ) {
-  for( int i = 0; i < XID_MAX_ENTRIES; i++ ) {
-    if ( xid_table.entries[ i ] != NULL ) {
-      free_xid_entry( xid_table.entries[ i ] );
-      xid_table.entries[ i ] = NULL;
-    }
-  }
+  delete_periodic_event_callback( age_xid_table );
+  delete_xid_entries( &xid_table.requests );
+  delete_xid_entries( &xid_table.no_replies );
   delete_hash( xid_table.hash );
   xid_table.hash = NULL;
-  xid_table.next_index = 0;
+  delete_xid_services();
 }
 
 
 uint32_t
-insert_xid_entry( uint32_t original_xid, char *service_name ) {
+insert_xid_entry( uint32_t original_xid, char *service_name, uint8_t type ) {
   xid_entry_t *new_entry;
 
-  debug( "Inserting xid entry ( original_xid = %#lx, service_name = %s ).",
-         original_xid, service_name );
+  debug( "Inserting xid entry ( original_xid = %#lx, service_name = %s, type = %#x ).",
+         original_xid, service_name, type );
 
-  if ( xid_table.next_index >= XID_MAX_ENTRIES ) {
-    xid_table.next_index = 0;
+  new_entry = allocate_xid_entry( original_xid, service_name );
+  insert_hash_entry( xid_table.hash, &new_entry->xid, new_entry );
+  if ( expects_reply( type ) ) {
+    new_entry->expire_at = time( NULL ) + XID_REQUEST_LIFETIME;
+    append_xid_entry( &xid_table.requests, new_entry );
   }
-
-  if ( xid_table.entries[ xid_table.next_index ] != NULL ) {
-    delete_xid_entry( xid_table.entries[ xid_table.next_index ] );
+  else {
+    new_entry->expire_at = time( NULL ) + XID_NO_REPLY_LIFETIME;
+    append_xid_entry( &xid_table.no_replies, new_entry );
   }
-
-  new_entry = allocate_xid_entry( original_xid, service_name, xid_table.next_index );
-  insert_hash_entry( xid_table.hash, &new_entry->xid, new_entry );
-  xid_table.entries[ xid_table.next_index ] = new_entry;
-  xid_table.next_index++;
+  xid_table.in_flight++;
 
   return new_entry->xid;
 }
 
 
+/*
+ * Renews the lifetime of an entry that is still receiving replies.
+ */
+void
+refresh_xid_entry( xid_entry_t *entry ) {
+  assert( entry != NULL );
+
+  xid_list_t *list = entry->list;
+  remove_xid_entry( entry );
+  entry->expire_at = time( NULL ) + ( list == &xid_table.requests ? XID_REQUEST_LIFETIME : XID_NO_REPLY_LIFETIME );
+  append_xid_entry( list, entry );
+}
+
+
 void
 delete_xid_entry( xid_entry_t *delete_entry ) {
-  debug( "Deleting xid entry ( xid = %#lx, original_xid = %#lx, service_name = %s, index = %d ).",
-         delete_entry->xid, delete_entry->original_xid, delete_entry->service_name, delete_entry->index );
+  debug( "Deleting xid entry ( xid = %#lx, original_xid = %#lx, service_name = %s, expire_at = %u ).",
+         delete_entry->xid, delete_entry->original_xid, delete_entry->service_name, delete_entry->expire_at );
 
   xid_entry_t *deleted = delete_hash_entry( xid_table.hash, &delete_entry->xid );
 
   if ( deleted == NULL ) {
     error( "Failed to delete xid entry ( xid = %#lx ).", delete_entry->xid );
-    free_xid_entry( ( xid_entry_t * ) delete_entry );
     return;
   }
 
-  xid_table.entries[ deleted->index ] = NULL;
+  remove_xid_entry( deleted );
+  xid_table.in_flight--;
   free_xid_entry( deleted );
 }
 
@@ -153,8 +315,8 @@ lookup_xid_entry( uint32_t xid ) {
 
 static void
 dump_xid_entry( xid_entry_t *entry ) {
-  info( "xid = %#lx, original_xid = %#lx, service_name = %s, index = %d",
-        entry->xid, entry->original_xid, entry->service_name, entry->index );
+  info( "xid = %#lx, original_xid = %#lx, service_name = %s, expire_at = %u",
+        entry->xid, entry->original_xid, entry->service_name, entry->expire_at );
 }
 
 
@@ -168,6 +330,11 @@ dump_xid_table( void ) {
   while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
     dump_xid_entry( e->value );
   }
+  init_hash_iterator( xid_table.services, &iter );
+  while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
+    xid_service_t *service = e->value;
+    info( "service_name = %s, in_flight = %u", service->name, service->in_flight );
+  }
   info( "#### END ####" );
 }
 
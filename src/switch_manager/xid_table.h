@@ -24,21 +24,32 @@
 #define XID_TABLE_H
 
 
+#include <time.h>
 #include "trema.h"
 
 
+typedef struct xid_service {
+  char *name;
+  unsigned int in_flight;
+} xid_service_t;
+
 typedef struct xid_entry {
   uint32_t xid;
   uint32_t original_xid;
   char *service_name;
-  int index;
+  xid_service_t *service;
+  time_t expire_at;
+  struct xid_list *list;
+  struct xid_entry *prev;
+  struct xid_entry *next;
 } xid_entry_t;
 
 
 uint32_t generate_xid( void );
 void init_xid_table( void );
 void finalize_xid_table( void );
-uint32_t insert_xid_entry( uint32_t original_xid, char *service_name );
+uint32_t insert_xid_entry( uint32_t original_xid, char *service_name, uint8_t type );
+void refresh_xid_entry( xid_entry_t *entry );
 void delete_xid_entry( xid_entry_t *entry );
 xid_entry_t *lookup_xid_entry( uint32_t xid );
 void dump_xid_table( void );
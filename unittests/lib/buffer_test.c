@@ -292,6 +292,75 @@ test_duplicate_buffer_succeeds_if_initialize_length_is_0() {
 }
 
 
+static void
+test_reset_buffer_succeeds() {
+  buffer *buf = alloc_buffer_with_length( sizeof( tea ) );
+  void *data_pointer = append_back_buffer( buf, sizeof( tea ) );
+  mark_buffer_built_by_library( buf );
+
+  reset_buffer( buf );
+  assert_true( buf->length == 0 );
+  assert_false( buffer_built_by_library( buf ) );
+
+  assert_true( append_back_buffer( buf, sizeof( tea ) ) == data_pointer );
+  assert_true( buf->length == sizeof( tea ) );
+
+  free_buffer( buf );
+}
+
+
+static void
+test_reset_buffer_keeps_resized_space() {
+  buffer *buf = alloc_buffer_with_length( sizeof( tea ) );
+  append_back_buffer( buf, sizeof( tea ) );
+  void *data_pointer = append_back_buffer( buf, sizeof( tea ) );
+  data_pointer = ( char * ) data_pointer - sizeof( tea );
+
+  reset_buffer( buf );
+  assert_true( append_back_buffer( buf, sizeof( tea ) * 2 ) == data_pointer );
+
+  free_buffer( buf );
+}
+
+
+static void
+test_mark_buffer_built_by_library_succeeds() {
+  buffer *buf = alloc_buffer_with_length( sizeof( tea ) );
+  append_back_buffer( buf, sizeof( tea ) );
+  assert_false( buffer_built_by_library( buf ) );
+
+  mark_buffer_built_by_library( buf );
+  assert_true( buffer_built_by_library( buf ) );
+
+  buffer *duplicate = duplicate_buffer( buf );
+  assert_true( buffer_built_by_library( duplicate ) );
+
+  free_buffer( buf );
+  free_buffer( duplicate );
+}
+
+
+static void
+test_resizing_buffer_clears_built_by_library_mark() {
+  buffer *buf = alloc_buffer_with_length( sizeof( tea ) );
+  append_back_buffer( buf, sizeof( tea ) );
+
+  mark_buffer_built_by_library( buf );
+  append_back_buffer( buf, 1 );
+  assert_false( buffer_built_by_library( buf ) );
+
+  mark_buffer_built_by_library( buf );
+  append_front_buffer( buf, 1 );
+  assert_false( buffer_built_by_library( buf ) );
+
+  mark_buffer_built_by_library( buf );
+  remove_front_buffer( buf, 1 );
+  assert_false( buffer_built_by_library( buf ) );
+
+  free_buffer( buf );
+}
+
+
 static void
 dump_function( const char *format, ... ) {
   char hex[ 1000 ];
@@ -349,6 +418,12 @@ main() {
     unit_test( test_duplicate_buffer_succeeds ),
     unit_test( test_duplicate_buffer_succeeds_if_initialize_length_is_0 ),
 
+    unit_test( test_reset_buffer_succeeds ),
+    unit_test( test_reset_buffer_keeps_resized_space ),
+
+    unit_test( test_mark_buffer_built_by_library_succeeds ),
+    unit_test( test_resizing_buffer_clears_built_by_library_mark ),
+
     unit_test( test_dump_buffer ),
   };
   setup_leak_detector();
@@ -33,10 +33,21 @@
 #include "utility.h"
 
 
+typedef struct match_cache_entry {
+  struct ofp_match ofp_match;
+  match_entry *entry;
+  uint32_t generation;
+} match_cache_entry;
+
+
 typedef struct match_table {
   hash_table *exact_table; // no wildcards are set
   list_element *wildcard_table; // wildcard flags are set
   pthread_mutex_t *mutex;
+  match_cache_entry *cache;
+  uint32_t generation;
+  uint64_t cache_hits;
+  uint64_t cache_misses;
 } match_table;
 
 
@@ -82,10 +93,12 @@ test_init_and_finalize_match_table_successed() {
   init_match_table();
   assert_true( match_table_head.exact_table != NULL );
   assert_true( match_table_head.wildcard_table == NULL );
+  assert_true( match_table_head.cache != NULL );
 
   finalize_match_table();
   assert_true( match_table_head.exact_table == NULL );
   assert_true( match_table_head.wildcard_table == NULL );
+  assert_true( match_table_head.cache == NULL );
 
   teardown();
 }
@@ -791,6 +804,156 @@ test_insert_and_delete_of_exact_all_entry_failed() {
 }
 
 
+static void
+test_lookup_of_exact_alice_entry_hits_cache() {
+  setup();
+
+  struct ofp_match lookup_match;
+  match_entry *first, *second;
+  uint64_t hits, misses;
+
+  init_match_table();
+
+  intsert_alice_match_entry();
+
+  set_alice_match_entry( &lookup_match );
+
+  first = lookup_match_entry( &lookup_match );
+  assert_true( first != NULL );
+  second = lookup_match_entry( &lookup_match );
+  assert_true( second == first );
+
+  get_match_table_cache_stats( &hits, &misses );
+  assert_int_equal( ( int ) hits, 1 );
+  assert_int_equal( ( int ) misses, 1 );
+
+  finalize_match_table();
+
+  teardown();
+}
+
+
+static void
+test_cached_miss_is_invalidated_by_insert() {
+  setup();
+
+  struct ofp_match lookup_match;
+  match_entry *match_entry;
+
+  init_match_table();
+
+  set_alice_match_entry( &lookup_match );
+  match_entry = lookup_match_entry( &lookup_match );
+  assert_true( match_entry == NULL );
+
+  intsert_any_match_entry();
+
+  match_entry = lookup_match_entry( &lookup_match );
+  assert_true( match_entry != NULL );
+  assert_string_equal( ( char * ) match_entry->services_name->data, ANY_MATCH_SERVICE_NAME );
+
+  finalize_match_table();
+
+  teardown();
+}
+
+
+static void
+test_cached_hit_is_invalidated_by_delete() {
+  setup();
+
+  struct ofp_match lookup_match;
+  match_entry *match_entry;
+
+  init_match_table();
+
+  intsert_alice_match_entry();
+
+  set_alice_match_entry( &lookup_match );
+  match_entry = lookup_match_entry( &lookup_match );
+  assert_true( match_entry != NULL );
+
+  delete_alice_match_entry();
+
+  match_entry = lookup_match_entry( &lookup_match );
+  assert_true( match_entry == NULL );
+
+  finalize_match_table();
+
+  teardown();
+}
+
+
+static void
+test_lookup_match_strict_entry_ignores_lower_priority_entry() {
+  setup();
+
+  struct ofp_match match;
+  match_entry *match_entry;
+
+  init_match_table();
+
+  intsert_any_match_entry();
+  intsert_lldp_match_entry();
+
+  set_lldp_match_entry( &match );
+  match_entry = lookup_match_strict_entry( &match, LLDP_MATCH_PRIORITY );
+  assert_true( match_entry != NULL );
+  assert_true( match_entry->priority == LLDP_MATCH_PRIORITY );
+  assert_string_equal( ( char * ) match_entry->services_name->data, LLDP_MATCH_SERVICE_NAME );
+
+  match_entry = lookup_match_strict_entry( &match, ANY_MATCH_PRIORITY );
+  assert_true( match_entry == NULL );
+
+  set_any_match_entry( &match );
+  match_entry = lookup_match_strict_entry( &match, ANY_MATCH_PRIORITY );
+  assert_true( match_entry != NULL );
+  assert_string_equal( ( char * ) match_entry->services_name->data, ANY_MATCH_SERVICE_NAME );
+
+  finalize_match_table();
+
+  teardown();
+}
+
+
+static void
+count_match_table_walker( struct ofp_match match, uint16_t priority, const char *service_name, void *user_data ) {
+  int *count = user_data;
+
+  if ( match.wildcards == 0 ) {
+    assert_string_equal( service_name, ALICE_MATCH_SERVICE_NAME );
+  }
+  else {
+    assert_true( priority == LLDP_MATCH_PRIORITY );
+    assert_string_equal( service_name, LLDP_MATCH_SERVICE_NAME );
+  }
+  ( *count )++;
+}
+
+
+static void
+test_foreach_match_table_calls_function_for_each_service() {
+  setup();
+
+  int count = 0;
+
+  init_match_table();
+
+  foreach_match_table( count_match_table_walker, &count );
+  assert_int_equal( count, 0 );
+
+  intsert_alice_match_entry();
+  intsert_lldp_match_entry();
+
+  foreach_match_table( count_match_table_walker, &count );
+  assert_int_equal( count, 2 );
+
+  finalize_match_table();
+
+  teardown();
+}
+
+
 /*************************************************************************
  * Run tests.
  *************************************************************************/
@@ -817,6 +980,11 @@ main() {
     unit_test( test_insert_and_lookup_of_exact_alice_entry_failed ),
     unit_test( test_delete_of_exact_alice_entry_failed ),
     unit_test( test_insert_and_delete_of_exact_all_entry_failed ),
+    unit_test( test_lookup_of_exact_alice_entry_hits_cache ),
+    unit_test( test_cached_miss_is_invalidated_by_insert ),
+    unit_test( test_cached_hit_is_invalidated_by_delete ),
+    unit_test( test_lookup_match_strict_entry_ignores_lower_priority_entry ),
+    unit_test( test_foreach_match_table_calls_function_for_each_service ),
   };
 
   return run_tests( tests );
@@ -85,6 +85,7 @@ typedef struct send_queue {
   struct timespec reconnect_at;
   struct sockaddr_un server_addr;
   message_buffer *buffer;
+  uint32_t partial_length;
 } send_queue;
 
 
@@ -398,6 +399,219 @@ test_send_then_message_received_callback_is_called() {
 }
 
 
+static void
+test_send_iov_then_message_received_callback_is_called() {
+  init_messenger( "/tmp" );
+
+  will_return_count( mock_clock_gettime, 0, -1 );
+
+  const char service_name[] = "Say HELLO";
+
+  expect_value( callback_hello, tag, 43556 );
+  expect_string( callback_hello, data, "HELLO" );
+  expect_value( callback_hello, len, 6 );
+
+  struct iovec iov[ 2 ];
+  iov[ 0 ].iov_base = ( void * ) ( uintptr_t ) "HEL";
+  iov[ 0 ].iov_len = strlen( "HEL" );
+  iov[ 1 ].iov_base = ( void * ) ( uintptr_t ) "LO";
+  iov[ 1 ].iov_len = strlen( "LO" ) + 1;
+
+  add_message_received_callback( service_name, callback_hello );
+  send_message_iov( service_name, 43556, iov, 2 );
+  start_messenger();
+
+  delete_message_received_callback( service_name, callback_hello );
+  delete_send_queue( lookup_hash_entry( send_queues, service_name ) );
+
+  finalize_messenger();
+}
+
+
+static void
+callback_large( uint16_t tag, void *data, size_t len ) {
+  check_expected( tag );
+  check_expected( len );
+
+  size_t i;
+  for ( i = 0; i < len; i++ ) {
+    assert_int_equal( ( ( uint8_t * ) data )[ i ], ( uint8_t ) i );
+  }
+
+  stop_messenger();
+}
+
+
+static void
+test_send_large_message_then_message_received_callback_is_called() {
+  init_messenger( "/tmp" );
+
+  will_return_count( mock_clock_gettime, 0, -1 );
+
+  const char service_name[] = "Large";
+  uint8_t data[ 10000 ];
+  size_t i;
+  for ( i = 0; i < sizeof( data ); i++ ) {
+    data[ i ] = ( uint8_t ) i;
+  }
+
+  expect_value( callback_large, tag, 43557 );
+  expect_value( callback_large, len, sizeof( data ) );
+
+  add_message_received_callback( service_name, callback_large );
+  send_message( service_name, 43557, data, sizeof( data ) );
+  start_messenger();
+
+  delete_message_received_callback( service_name, callback_large );
+  delete_send_queue( lookup_hash_entry( send_queues, service_name ) );
+
+  finalize_messenger();
+}
+
+
+static void
+test_send_locally_then_message_received_callback_is_called() {
+  init_messenger( "/tmp" );
+
+  const char service_name[] = "Say HELLO";
+
+  expect_value( callback_hello, tag, 43556 );
+  expect_string( callback_hello, data, "HELLO" );
+  expect_value( callback_hello, len, 6 );
+
+  enable_messenger_local_delivery();
+  add_message_received_callback( service_name, callback_hello );
+  assert_true( send_message( service_name, 43556, "HELLO", strlen( "HELLO" ) + 1 ) );
+  assert_true( lookup_hash_entry( send_queues, service_name ) == NULL );
+  start_messenger();
+
+  delete_message_received_callback( service_name, callback_hello );
+
+  finalize_messenger();
+}
+
+
+static void
+callback_ping( uint16_t tag, void *data, size_t len ) {
+  check_expected( tag );
+  check_expected( data );
+  check_expected( len );
+
+  if ( tag == 1 ) {
+    // queued while the first message is delivered, and delivered in the next round
+    assert_true( send_message( "PING PONG", 2, "PONG", strlen( "PONG" ) + 1 ) );
+    assert_string_equal( data, "PING" );
+  }
+  else {
+    stop_messenger();
+  }
+}
+
+
+static void
+test_send_locally_from_callback_then_message_is_delivered_next() {
+  init_messenger( "/tmp" );
+
+  const char service_name[] = "PING PONG";
+
+  expect_value( callback_ping, tag, 1 );
+  expect_string( callback_ping, data, "PING" );
+  expect_value( callback_ping, len, 5 );
+  expect_value( callback_ping, tag, 2 );
+  expect_string( callback_ping, data, "PONG" );
+  expect_value( callback_ping, len, 5 );
+
+  enable_messenger_local_delivery();
+  add_message_received_callback( service_name, callback_ping );
+  assert_true( send_message( service_name, 1, "PING", strlen( "PING" ) + 1 ) );
+  start_messenger();
+
+  delete_message_received_callback( service_name, callback_ping );
+
+  finalize_messenger();
+}
+
+
+/********************************************************************************
+ * Messenger channel tests.
+ ********************************************************************************/
+
+static void
+test_send_to_channel_then_message_received_callback_is_called() {
+  init_messenger( "/tmp" );
+
+  const char service_name[] = "Say HELLO";
+
+  expect_value( callback_hello, tag, 43556 );
+  expect_string( callback_hello, data, "HELLO" );
+  expect_value( callback_hello, len, 6 );
+
+  add_message_received_callback( service_name, callback_hello );
+  messenger_channel *channel = open_messenger_channel( service_name );
+  assert_true( channel != NULL );
+  assert_int_equal( send_message_to_channel( channel, 43556, "HELLO", strlen( "HELLO" ) + 1 ), 1 );
+  start_messenger();
+
+  close_messenger_channel( channel );
+  delete_message_received_callback( service_name, callback_hello );
+
+  finalize_messenger();
+}
+
+
+static void
+test_open_messenger_channel_fails_if_service_is_not_found() {
+  init_messenger( "/tmp" );
+
+  assert_true( open_messenger_channel( "No such service" ) == NULL );
+
+  finalize_messenger();
+}
+
+
+static void
+test_open_messenger_channel_fails_if_socket_fails() {
+  init_messenger( "/tmp" );
+
+  fail_mock_socket = true;
+  assert_true( open_messenger_channel( "Say HELLO" ) == NULL );
+  fail_mock_socket = false;
+
+  finalize_messenger();
+}
+
+
+/********************************************************************************
+ * Send queue usage tests.
+ ********************************************************************************/
+
+static void
+test_send_queue_usage() {
+  init_messenger( "/tmp" );
+
+  will_return_count( mock_clock_gettime, 0, -1 );
+
+  const char service_name[] = "Usage";
+  char data[ 4000 ];
+  memset( data, 0, sizeof( data ) );
+
+  assert_int_equal( ( int ) messenger_send_queue_usage( service_name ), 0 );
+
+  // not connected, so that messages stay in the send queue
+  int i;
+  for ( i = 0; i < 100; i++ ) {
+    send_message( service_name, 1, data, sizeof( data ) );
+  }
+  unsigned int usage = messenger_send_queue_usage( service_name );
+  assert_true( usage > 0 );
+  assert_true( usage <= 100 );
+
+  delete_send_queue( lookup_hash_entry( send_queues, service_name ) );
+
+  finalize_messenger();
+}
+
+
 /********************************************************************************
  * Run tests.
  ********************************************************************************/
@@ -423,6 +637,34 @@ main() {
     unit_test_setup_teardown( test_send_then_message_received_callback_is_called,
                               reset_messenger,
                               reset_messenger ),
+    unit_test_setup_teardown( test_send_iov_then_message_received_callback_is_called,
+                              reset_messenger,
+                              reset_messenger ),
+    unit_test_setup_teardown( test_send_large_message_then_message_received_callback_is_called,
+                              reset_messenger,
+                              reset_messenger ),
+    unit_test_setup_teardown( test_send_locally_then_message_received_callback_is_called,
+                              reset_messenger,
+                              reset_messenger ),
+    unit_test_setup_teardown( test_send_locally_from_callback_then_message_is_delivered_next,
+                              reset_messenger,
+                              reset_messenger ),
+
+    // Messenger channel tests.
+    unit_test_setup_teardown( test_send_to_channel_then_message_received_callback_is_called,
+                              reset_messenger,
+                              reset_messenger ),
+    unit_test_setup_teardown( test_open_messenger_channel_fails_if_service_is_not_found,
+                              reset_messenger,
+                              reset_messenger ),
+    unit_test_setup_teardown( test_open_messenger_channel_fails_if_socket_fails,
+                              reset_messenger,
+                              reset_messenger ),
+
+    // Send queue usage tests.
+    unit_test_setup_teardown( test_send_queue_usage,
+                              reset_messenger,
+                              reset_messenger ),
   };
   return run_tests( tests );
 }
@@ -46,11 +46,27 @@ typedef struct {
   uint64_t value;
 } stat_entry;
 
+typedef struct {
+  uint64_t datapath_id;
+  uint32_t transaction_id;
+} openflow_request_key;
+
+typedef struct {
+  openflow_request_key key;
+  bool expires;
+  struct timespec expires_at;
+  openflow_reply_handler reply_callback;
+  openflow_request_timeout_handler timeout_callback;
+  void *user_data;
+} pending_openflow_request;
+
 
 extern bool openflow_application_interface_initialized;
 extern openflow_event_handlers_t event_handlers;
 extern char service_name[ MESSENGER_SERVICE_NAME_LENGTH ];
 extern hash_table *stats;
+extern list_element *partial_stats_replies;
+extern hash_table *pending_openflow_requests;
 
 extern void assert_if_not_initialized();
 extern void handle_error( const uint64_t datapath_id, buffer *data );
@@ -69,6 +85,9 @@ extern void handle_openflow_message( void *data, size_t length );
 extern void handle_message( uint16_t type, void *data, size_t length );
 extern void insert_dpid( list_element **head, uint64_t *dpid );
 extern void handle_list_switches_reply( uint16_t message_type, void *data, size_t length, void *user_data );
+extern void age_coalesced_packet_ins( void *user_data );
+extern void age_openflow_requests( void *user_data );
+extern void init_openflow_request_key( openflow_request_key *key, uint64_t datapath_id, uint32_t transaction_id );
 
 
 #define SWITCH_READY_HANDLER ( ( void * ) 0x00020001 )
@@ -97,6 +116,14 @@ extern void handle_list_switches_reply( uint16_t message_type, void *data, size_
 #define QUEUE_GET_CONFIG_REPLY_USER_DATA ( ( void * ) 0x000100a1 )
 #define LIST_SWITCHES_REPLY_HANDLER ( ( void * ) 0x0001000b )
 #define LIST_SWITCHES_REPLY_USER_DATA ( ( void * ) 0x000100b1 )
+#define PACKET_IN_THROTTLED_HANDLER ( ( void * ) 0x00020003 )
+#define PACKET_IN_THROTTLED_USER_DATA ( ( void * ) 0x00020031 )
+#define SWITCH_LIVENESS_REPLY_HANDLER ( ( void * ) 0x00020004 )
+#define SWITCH_LIVENESS_REPLY_USER_DATA ( ( void * ) 0x00020041 )
+#define STATS_REPLY_PART_HANDLER ( ( void * ) 0x00020005 )
+#define STATS_REPLY_PART_USER_DATA ( ( void * ) 0x00020051 )
+#define STATS_REPLY_COMPLETION_HANDLER ( ( void * ) 0x00020006 )
+#define STATS_REPLY_COMPLETION_USER_DATA ( ( void * ) 0x00020061 )
 
 static const pid_t PID = 12345;
 static char SERVICE_NAME[] = "learning switch application 0";
@@ -112,7 +139,11 @@ static openflow_event_handlers_t NULL_EVENT_HANDLERS = { false, ( void * ) 0, (
                                                          ( void * ) 0, ( void * ) 0,
                                                          ( void * ) 0, ( void * ) 0,
                                                          ( void * ) 0, ( void * ) 0,
-                                                         ( void * ) 0 };
+                                                         ( void * ) 0,
+                                                         ( void * ) 0, ( void * ) 0,
+                                                         ( void * ) 0, ( void * ) 0,
+                                                         ( void * ) 0, ( void * ) 0,
+                                                         ( void * ) 0, ( void * ) 0 };
 static openflow_event_handlers_t EVENT_HANDLERS = {
   false, SWITCH_READY_HANDLER, SWITCH_READY_USER_DATA,
   SWITCH_DISCONNECTED_HANDLER, SWITCH_DISCONNECTED_USER_DATA,
@@ -126,7 +157,11 @@ static openflow_event_handlers_t EVENT_HANDLERS = {
   STATS_REPLY_HANDLER, STATS_REPLY_USER_DATA,
   BARRIER_REPLY_HANDLER, BARRIER_REPLY_USER_DATA,
   QUEUE_GET_CONFIG_REPLY_HANDLER, QUEUE_GET_CONFIG_REPLY_USER_DATA,
-  LIST_SWITCHES_REPLY_HANDLER
+  LIST_SWITCHES_REPLY_HANDLER,
+  PACKET_IN_THROTTLED_HANDLER, PACKET_IN_THROTTLED_USER_DATA,
+  SWITCH_LIVENESS_REPLY_HANDLER, SWITCH_LIVENESS_REPLY_USER_DATA,
+  STATS_REPLY_PART_HANDLER, STATS_REPLY_PART_USER_DATA,
+  STATS_REPLY_COMPLETION_HANDLER, STATS_REPLY_COMPLETION_USER_DATA
 };
 static uint64_t DATAPATH_ID = 0x0102030405060708ULL;
 static char REMOTE_SERVICE_NAME[] = "switch.102030405060708";
@@ -147,7 +182,15 @@ static struct ofp_match MATCH = { OFPFW_ALL, 1,
 static uint8_t USER_DATA[ USER_DATA_LEN ];
 
 
+static stat_entry *
+lookup_stat_entry( const char *key ) {
+  publish_stat_counters();
+  return lookup_hash_entry( stats, key );
+}
+
+
 static bool packet_in_handler_called = false;
+static buffer *sent_message = NULL;
 
 
 /********************************************************************************
@@ -205,6 +248,29 @@ mock_send_message( char *service_name, uint16_t tag, void *data, size_t len ) {
 }
 
 
+bool
+mock_send_message_iov( const char *service_name, uint16_t tag, const struct iovec *iov, int iovcnt ) {
+  uint32_t tag32 = tag;
+  size_t len = 0;
+  int i;
+
+  if ( sent_message != NULL ) {
+    free_buffer( sent_message );
+  }
+  sent_message = alloc_buffer();
+  for ( i = 0; i < iovcnt; i++ ) {
+    memcpy( append_back_buffer( sent_message, iov[ i ].iov_len ), iov[ i ].iov_base, iov[ i ].iov_len );
+    len += iov[ i ].iov_len;
+  }
+
+  check_expected( service_name );
+  check_expected( tag32 );
+  check_expected( len );
+
+  return ( bool ) mock();
+}
+
+
 bool
 mock_send_request_message( char *to_service_name, char *from_service_name, uint16_t tag,
                            void *data, size_t len, void *user_data ) {
@@ -244,6 +310,27 @@ mock_delete_message_replied_callback( char *service_name,
 bool
 mock_parse_packet( buffer *buf ) {
   alloc_packet( buf );
+  packet_info( buf )->l2_data.eth = buf->data;
+  return ( bool ) mock();
+}
+
+
+bool
+mock_add_periodic_event_callback( const time_t seconds, void ( *callback )( void *user_data ), void *user_data ) {
+  uint32_t seconds32 = ( uint32_t ) seconds;
+
+  check_expected( seconds32 );
+  check_expected( callback );
+  check_expected( user_data );
+
+  return ( bool ) mock();
+}
+
+
+bool
+mock_delete_periodic_event_callback( void ( *callback )( void *user_data ) ) {
+  check_expected( callback );
+
   return ( bool ) mock();
 }
 
@@ -385,6 +472,65 @@ mock_stats_reply_handler( uint64_t datapath_id, uint32_t transaction_id, uint16_
 }
 
 
+static void
+mock_stats_reply_part_handler( uint64_t datapath_id, uint32_t transaction_id, uint16_t type,
+                               uint16_t flags, stats_reply_iterator *entries, void *user_data ) {
+  uint32_t type32 = type;
+  uint32_t flags32 = flags;
+
+  check_expected( &datapath_id );
+  check_expected( transaction_id );
+  check_expected( type32 );
+  check_expected( flags32 );
+  check_expected( user_data );
+
+  const struct ofp_table_stats *entry;
+  while ( ( entry = next_stats_reply_entry( entries ) ) != NULL ) {
+    uint32_t table_id = entry->table_id;
+    check_expected( table_id );
+  }
+}
+
+
+static void
+mock_stats_reply_completion_handler( uint64_t datapath_id, uint32_t transaction_id, uint16_t type,
+                                     stats_reply_iterator *entries, void *user_data ) {
+  uint32_t type32 = type;
+
+  check_expected( &datapath_id );
+  check_expected( transaction_id );
+  check_expected( type32 );
+  check_expected( user_data );
+
+  const struct ofp_flow_stats *entry;
+  while ( ( entry = next_stats_reply_entry( entries ) ) != NULL ) {
+    uint64_t cookie = ntohll( entry->cookie );
+    check_expected( cookie );
+  }
+}
+
+
+static void
+mock_openflow_reply_handler( uint64_t datapath_id, const buffer *reply, void *user_data ) {
+  const struct ofp_header *header = reply->data;
+  uint32_t type32 = header->type;
+  uint32_t transaction_id = ntohl( header->xid );
+
+  check_expected( &datapath_id );
+  check_expected( type32 );
+  check_expected( transaction_id );
+  check_expected( user_data );
+}
+
+
+static void
+mock_openflow_request_timeout_handler( uint64_t datapath_id, uint32_t transaction_id, void *user_data ) {
+  check_expected( &datapath_id );
+  check_expected( transaction_id );
+  check_expected( user_data );
+}
+
+
 static void
 mock_barrier_reply_handler( uint64_t datapath_id, uint32_t transaction_id, void *user_data ) {
   check_expected( &datapath_id );
@@ -393,6 +539,19 @@ mock_barrier_reply_handler( uint64_t datapath_id, uint32_t transaction_id, void
 }
 
 
+static void
+mock_flow_mod_batch_handler( uint64_t datapath_id, bool completed, const flow_mod_batch_error *errors,
+                             unsigned int n_errors, void *user_data ) {
+  check_expected( &datapath_id );
+  check_expected( completed );
+  check_expected( n_errors );
+  if ( n_errors > 0 ) {
+    check_expected( errors );
+  }
+  check_expected( user_data );
+}
+
+
 static void
 mock_queue_get_config_reply_handler( uint64_t datapath_id, uint32_t transaction_id,
                                      uint16_t port, const list_element *queues, void *user_data ) {
@@ -411,6 +570,27 @@ mock_queue_get_config_reply_handler( uint64_t datapath_id, uint32_t transaction_
 }
 
 
+static void
+mock_packet_in_throttled_handler( uint64_t datapath_id, uint16_t in_port, bool throttled,
+                                  uint64_t dropped, void *user_data ) {
+  uint32_t in_port32 = in_port;
+
+  check_expected( &datapath_id );
+  check_expected( in_port32 );
+  check_expected( throttled );
+  check_expected( &dropped );
+  check_expected( user_data );
+}
+
+
+static void
+mock_switch_liveness_reply_handler( uint64_t datapath_id, const openflow_liveness_t *liveness, void *user_data ) {
+  check_expected( &datapath_id );
+  check_expected( liveness );
+  check_expected( user_data );
+}
+
+
 static void
 mock_handle_list_switches_reply( const list_element *switches, void *user_data ) {
   uint64_t *dpid1, *dpid2, *dpid3;
@@ -487,9 +667,29 @@ cleanup() {
   memset( &event_handlers, 0, sizeof( event_handlers ) );
   memset( USER_DATA, 'Z', sizeof( USER_DATA ) );
   if ( stats != NULL ) {
+    hash_iterator iter;
+    hash_entry *e;
+    init_hash_iterator( stats, &iter );
+    while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
+      xfree( delete_hash_entry( stats, e->key ) );
+    }
     delete_hash( stats );
     stats = NULL;
   }
+  if ( sent_message != NULL ) {
+    free_buffer( sent_message );
+    sent_message = NULL;
+  }
+  if ( pending_openflow_requests != NULL ) {
+    hash_iterator iter;
+    hash_entry *e;
+    init_hash_iterator( pending_openflow_requests, &iter );
+    while ( ( e = iterate_hash_next( &iter ) ) != NULL ) {
+      xfree( e->value );
+    }
+    delete_hash( pending_openflow_requests );
+    pending_openflow_requests = NULL;
+  }
 }
 
 
@@ -705,7 +905,7 @@ test_handle_switch_ready() {
   set_switch_ready_handler( mock_switch_ready_handler, user_data );
   handle_message( MESSENGER_OPENFLOW_READY, data->data, data->length );
 
-  stat_entry *stat = lookup_hash_entry( stats, "openflow_application_interface.switch_ready_receive_succeeded" );
+  stat_entry *stat = lookup_stat_entry( "openflow_application_interface.switch_ready_receive_succeeded" );
   assert_int_equal( ( int ) stat->value, 1 );
 
   free_buffer( data );
@@ -726,7 +926,7 @@ test_handle_switch_ready_with_simple_handler() {
   set_switch_ready_handler( mock_simple_switch_ready_handler, user_data );
   handle_message( MESSENGER_OPENFLOW_READY, data->data, data->length );
 
-  stat_entry *stat = lookup_hash_entry( stats, "openflow_application_interface.switch_ready_receive_succeeded" );
+  stat_entry *stat = lookup_stat_entry( "openflow_application_interface.switch_ready_receive_succeeded" );
   assert_int_equal( ( int ) stat->value, 1 );
 
   free_buffer( data );
@@ -1053,6 +1253,118 @@ test_handle_packet_in_without_handler() {
 }
 
 
+static void
+test_handle_packet_in_suppresses_duplicates_within_coalescing_window() {
+  uint8_t reason = OFPR_NO_MATCH;
+  uint16_t in_port = 1;
+  uint32_t buffer_id = 0x01020304;
+  buffer *data = alloc_buffer_with_length( 64 );
+  alloc_packet( data );
+  append_back_buffer( data, 64 );
+  memset( data->data, 0x01, 64 );
+  uint16_t total_len = ( uint16_t ) data->length;
+
+  expect_value( mock_add_periodic_event_callback, seconds32, 1 );
+  expect_value( mock_add_periodic_event_callback, callback, age_coalesced_packet_ins );
+  expect_value( mock_add_periodic_event_callback, user_data, NULL );
+  will_return( mock_add_periodic_event_callback, true );
+  assert_true( set_packet_in_coalescing_window( 60000 ) );
+
+  will_return( mock_parse_packet, true );
+  will_return( mock_parse_packet, true );
+  expect_memory( mock_packet_in_handler, &datapath_id, &DATAPATH_ID, sizeof( uint64_t ) );
+  expect_value( mock_packet_in_handler, transaction_id, TRANSACTION_ID );
+  expect_value( mock_packet_in_handler, buffer_id, buffer_id );
+  expect_value( mock_packet_in_handler, total_len32, ( uint32_t ) total_len );
+  expect_value( mock_packet_in_handler, in_port32, ( uint32_t ) in_port );
+  expect_value( mock_packet_in_handler, reason32, ( uint32_t ) reason );
+  expect_value( mock_packet_in_handler, data->length, data->length );
+  expect_memory( mock_packet_in_handler, data->data, data->data, data->length );
+  expect_memory( mock_packet_in_handler, user_data, USER_DATA, USER_DATA_LEN );
+
+  set_packet_in_handler( mock_packet_in_handler, USER_DATA );
+
+  size_t header_length = sizeof( openflow_service_header_t ) + strlen( SERVICE_NAME ) + 1;
+  expect_string( mock_send_message_iov, service_name, REMOTE_SERVICE_NAME );
+  expect_value( mock_send_message_iov, tag32, MESSENGER_OPENFLOW_BUILT_MESSAGE );
+  expect_value( mock_send_message_iov, len, header_length + offsetof( struct ofp_packet_out, actions ) );
+  will_return( mock_send_message_iov, true );
+
+  buffer *buffer = create_packet_in( TRANSACTION_ID, buffer_id, total_len, in_port, reason, data );
+  handle_packet_in( DATAPATH_ID, buffer );
+  handle_packet_in( DATAPATH_ID, buffer );
+
+  struct ofp_packet_out *packet_out = ( struct ofp_packet_out * ) ( ( char * ) sent_message->data + header_length );
+  assert_int_equal( packet_out->header.type, OFPT_PACKET_OUT );
+  assert_int_equal( ntohl( packet_out->buffer_id ), buffer_id );
+  assert_int_equal( ntohs( packet_out->in_port ), in_port );
+  assert_int_equal( ntohs( packet_out->actions_len ), 0 );
+
+  stat_entry *stat = lookup_stat_entry( "openflow_application_interface.packet_in_coalesced" );
+  assert_int_equal( ( int ) stat->value, 1 );
+  stat = lookup_stat_entry( "openflow_application_interface.packet_in_buffer_released" );
+  assert_int_equal( ( int ) stat->value, 1 );
+
+  expect_value( mock_delete_periodic_event_callback, callback, age_coalesced_packet_ins );
+  will_return( mock_delete_periodic_event_callback, true );
+  assert_true( set_packet_in_coalescing_window( 0 ) );
+
+  free_buffer( buffer );
+  xfree( delete_hash_entry( stats, "openflow_application_interface.packet_in_coalesced" ) );
+  xfree( delete_hash_entry( stats, "openflow_application_interface.packet_in_buffer_released" ) );
+  xfree( delete_hash_entry( stats, "openflow_application_interface.packet_out_send_succeeded" ) );
+}
+
+
+static void
+test_handle_packet_in_suppresses_unbuffered_duplicates_without_packet_out() {
+  uint8_t reason = OFPR_NO_MATCH;
+  uint16_t in_port = 1;
+  uint32_t buffer_id = UINT32_MAX;
+  buffer *data = alloc_buffer_with_length( 64 );
+  alloc_packet( data );
+  append_back_buffer( data, 64 );
+  memset( data->data, 0x01, 64 );
+  uint16_t total_len = ( uint16_t ) data->length;
+
+  expect_value( mock_add_periodic_event_callback, seconds32, 1 );
+  expect_value( mock_add_periodic_event_callback, callback, age_coalesced_packet_ins );
+  expect_value( mock_add_periodic_event_callback, user_data, NULL );
+  will_return( mock_add_periodic_event_callback, true );
+  assert_true( set_packet_in_coalescing_window( 60000 ) );
+
+  will_return( mock_parse_packet, true );
+  will_return( mock_parse_packet, true );
+  expect_memory( mock_packet_in_handler, &datapath_id, &DATAPATH_ID, sizeof( uint64_t ) );
+  expect_value( mock_packet_in_handler, transaction_id, TRANSACTION_ID );
+  expect_value( mock_packet_in_handler, buffer_id, buffer_id );
+  expect_value( mock_packet_in_handler, total_len32, ( uint32_t ) total_len );
+  expect_value( mock_packet_in_handler, in_port32, ( uint32_t ) in_port );
+  expect_value( mock_packet_in_handler, reason32, ( uint32_t ) reason );
+  expect_value( mock_packet_in_handler, data->length, data->length );
+  expect_memory( mock_packet_in_handler, data->data, data->data, data->length );
+  expect_memory( mock_packet_in_handler, user_data, USER_DATA, USER_DATA_LEN );
+
+  set_packet_in_handler( mock_packet_in_handler, USER_DATA );
+
+  buffer *buffer = create_packet_in( TRANSACTION_ID, buffer_id, total_len, in_port, reason, data );
+  handle_packet_in( DATAPATH_ID, buffer );
+  handle_packet_in( DATAPATH_ID, buffer );
+
+  assert_true( sent_message == NULL );
+  stat_entry *stat = lookup_stat_entry( "openflow_application_interface.packet_in_coalesced" );
+  assert_int_equal( ( int ) stat->value, 1 );
+  assert_true( lookup_stat_entry( "openflow_application_interface.packet_in_buffer_released" ) == NULL );
+
+  expect_value( mock_delete_periodic_event_callback, callback, age_coalesced_packet_ins );
+  will_return( mock_delete_periodic_event_callback, true );
+  assert_true( set_packet_in_coalescing_window( 0 ) );
+
+  free_buffer( buffer );
+  xfree( delete_hash_entry( stats, "openflow_application_interface.packet_in_coalesced" ) );
+}
+
+
 static void
 test_handle_packet_in_should_die_if_message_is_NULL() {
   expect_string( mock_die, format, "handle_packet_in(): packet_in message should not be empty." );
@@ -1133,6 +1445,38 @@ test_set_stats_reply_handler_if_handler_is_NULL() {
 }
 
 
+static void
+test_set_stats_reply_part_handler() {
+  assert_true( set_stats_reply_part_handler( mock_stats_reply_part_handler, USER_DATA ) );
+  assert_true( event_handlers.stats_reply_part_callback == mock_stats_reply_part_handler );
+  assert_true( event_handlers.stats_reply_part_user_data == USER_DATA );
+}
+
+
+static void
+test_set_stats_reply_part_handler_if_handler_is_NULL() {
+  expect_string( mock_die, format, "Callback function ( stats_reply_part_handler ) must not be NULL." );
+  expect_assert_failure( set_stats_reply_part_handler( NULL, NULL ) );
+  assert_memory_equal( &event_handlers, &NULL_EVENT_HANDLERS, sizeof( event_handlers ) );
+}
+
+
+static void
+test_set_stats_reply_completion_handler() {
+  assert_true( set_stats_reply_completion_handler( mock_stats_reply_completion_handler, USER_DATA ) );
+  assert_true( event_handlers.stats_reply_completion_callback == mock_stats_reply_completion_handler );
+  assert_true( event_handlers.stats_reply_completion_user_data == USER_DATA );
+}
+
+
+static void
+test_set_stats_reply_completion_handler_if_handler_is_NULL() {
+  expect_string( mock_die, format, "Callback function ( stats_reply_completion_handler ) must not be NULL." );
+  expect_assert_failure( set_stats_reply_completion_handler( NULL, NULL ) );
+  assert_memory_equal( &event_handlers, &NULL_EVENT_HANDLERS, sizeof( event_handlers ) );
+}
+
+
 /********************************************************************************
  * set_barrier_reply_handler() tests.
  ********************************************************************************/
@@ -1193,6 +1537,46 @@ test_set_list_switches_reply_handler_if_handler_is_NULL() {
 }
 
 
+/********************************************************************************
+ * set_packet_in_throttled_handler() tests.
+ ********************************************************************************/
+
+static void
+test_set_packet_in_throttled_handler() {
+  assert_true( set_packet_in_throttled_handler( PACKET_IN_THROTTLED_HANDLER, PACKET_IN_THROTTLED_USER_DATA ) );
+  assert_int_equal( event_handlers.packet_in_throttled_callback, PACKET_IN_THROTTLED_HANDLER );
+  assert_int_equal( event_handlers.packet_in_throttled_user_data, PACKET_IN_THROTTLED_USER_DATA );
+}
+
+
+static void
+test_set_packet_in_throttled_handler_if_handler_is_NULL() {
+  expect_string( mock_die, format, "Callback function ( packet_in_throttled_handler ) must not be NULL." );
+  expect_assert_failure( set_packet_in_throttled_handler( NULL, NULL ) );
+  assert_memory_equal( &event_handlers, &NULL_EVENT_HANDLERS, sizeof( event_handlers ) );
+}
+
+
+/********************************************************************************
+ * set_switch_liveness_reply_handler() tests.
+ ********************************************************************************/
+
+static void
+test_set_switch_liveness_reply_handler() {
+  assert_true( set_switch_liveness_reply_handler( SWITCH_LIVENESS_REPLY_HANDLER, SWITCH_LIVENESS_REPLY_USER_DATA ) );
+  assert_int_equal( event_handlers.switch_liveness_reply_callback, SWITCH_LIVENESS_REPLY_HANDLER );
+  assert_int_equal( event_handlers.switch_liveness_reply_user_data, SWITCH_LIVENESS_REPLY_USER_DATA );
+}
+
+
+static void
+test_set_switch_liveness_reply_handler_if_handler_is_NULL() {
+  expect_string( mock_die, format, "Callback function ( switch_liveness_reply_handler ) must not be NULL." );
+  expect_assert_failure( set_switch_liveness_reply_handler( NULL, NULL ) );
+  assert_memory_equal( &event_handlers, &NULL_EVENT_HANDLERS, sizeof( event_handlers ) );
+}
+
+
 /********************************************************************************
  * send_openflow_message() tests.
  ********************************************************************************/
@@ -1223,16 +1607,16 @@ test_send_openflow_message() {
           SERVICE_NAME, strlen( SERVICE_NAME ) + 1 );
   memcpy( ( char * ) expected_data + header_length, buffer->data, buffer->length );
 
-  expect_string( mock_send_message, service_name, REMOTE_SERVICE_NAME );
-  expect_value( mock_send_message, tag32, MESSENGER_OPENFLOW_MESSAGE );
-  expect_value( mock_send_message, len, expected_length );
-  expect_memory( mock_send_message, data, expected_data, expected_length );
-  will_return( mock_send_message, true );
+  expect_string( mock_send_message_iov, service_name, REMOTE_SERVICE_NAME );
+  expect_value( mock_send_message_iov, tag32, MESSENGER_OPENFLOW_BUILT_MESSAGE );
+  expect_value( mock_send_message_iov, len, expected_length );
+  will_return( mock_send_message_iov, true );
 
   ret = send_openflow_message( DATAPATH_ID, buffer );
   
   assert_true( ret );
-  stat_entry *stat = lookup_hash_entry( stats, "openflow_application_interface.hello_send_succeeded" );
+  assert_memory_equal( sent_message->data, expected_data, expected_length );
+  stat_entry *stat = lookup_stat_entry( "openflow_application_interface.hello_send_succeeded" );
   assert_int_equal( ( int ) stat->value, 1 );
 
   free_buffer( buffer );
@@ -1241,6 +1625,28 @@ test_send_openflow_message() {
 }
 
 
+static void
+test_send_openflow_message_if_message_is_not_built_by_library() {
+  buffer *buffer = alloc_buffer_with_length( sizeof( struct ofp_header ) );
+  struct ofp_header *ofp = append_back_buffer( buffer, sizeof( struct ofp_header ) );
+  ofp->version = OFP_VERSION;
+  ofp->type = OFPT_HELLO;
+  ofp->length = htons( sizeof( struct ofp_header ) );
+  ofp->xid = htonl( TRANSACTION_ID );
+
+  expect_string( mock_send_message_iov, service_name, REMOTE_SERVICE_NAME );
+  expect_value( mock_send_message_iov, tag32, MESSENGER_OPENFLOW_MESSAGE );
+  expect_value( mock_send_message_iov, len, sizeof( openflow_service_header_t ) + strlen( SERVICE_NAME ) + 1 +
+                sizeof( struct ofp_header ) );
+  will_return( mock_send_message_iov, true );
+
+  assert_true( send_openflow_message( DATAPATH_ID, buffer ) );
+
+  free_buffer( buffer );
+  xfree( delete_hash_entry( stats, "openflow_application_interface.hello_send_succeeded" ) );
+}
+
+
 static void
 test_send_openflow_message_if_message_is_NULL() {
   expect_assert_failure( send_openflow_message( DATAPATH_ID, NULL ) );
@@ -1261,6 +1667,346 @@ test_send_openflow_message_if_message_length_is_zero() {
 }
 
 
+/********************************************************************************
+ * send_switch_liveness_request() tests.
+ ********************************************************************************/
+
+static void
+test_send_switch_liveness_request() {
+  size_t expected_length = sizeof( openflow_service_header_t ) + strlen( SERVICE_NAME ) + 1;
+  void *expected_data = xcalloc( 1, expected_length );
+  openflow_service_header_t *header = expected_data;
+  header->datapath_id = htonll( DATAPATH_ID );
+  header->service_name_length = htons( ( uint16_t ) ( strlen( SERVICE_NAME ) + 1 ) );
+  memcpy( header + 1, SERVICE_NAME, strlen( SERVICE_NAME ) + 1 );
+
+  expect_string( mock_send_message, service_name, REMOTE_SERVICE_NAME );
+  expect_value( mock_send_message, tag32, MESSENGER_OPENFLOW_LIVENESS_REQUEST );
+  expect_value( mock_send_message, len, expected_length );
+  expect_memory( mock_send_message, data, expected_data, expected_length );
+  will_return( mock_send_message, true );
+
+  assert_true( send_switch_liveness_request( DATAPATH_ID ) );
+
+  stat_entry *stat = lookup_stat_entry( "openflow_application_interface.switch_liveness_request_send_succeeded" );
+  assert_int_equal( ( int ) stat->value, 1 );
+
+  xfree( expected_data );
+  xfree( delete_hash_entry( stats, "openflow_application_interface.switch_liveness_request_send_succeeded" ) );
+}
+
+
+/********************************************************************************
+ * send_openflow_request() tests.
+ ********************************************************************************/
+
+static void
+send_barrier_request_for_test( time_t timeout ) {
+  buffer *request = create_barrier_request( TRANSACTION_ID );
+
+  if ( pending_openflow_requests == NULL ) {
+    expect_value( mock_add_periodic_event_callback, seconds32, 1 );
+    expect_value( mock_add_periodic_event_callback, callback, age_openflow_requests );
+    expect_value( mock_add_periodic_event_callback, user_data, NULL );
+    will_return( mock_add_periodic_event_callback, true );
+  }
+  expect_string( mock_send_message_iov, service_name, REMOTE_SERVICE_NAME );
+  expect_value( mock_send_message_iov, tag32, MESSENGER_OPENFLOW_BUILT_MESSAGE );
+  expect_value( mock_send_message_iov, len, sizeof( openflow_service_header_t ) + strlen( SERVICE_NAME ) + 1 + sizeof( struct ofp_header ) );
+  will_return( mock_send_message_iov, true );
+
+  assert_true( send_openflow_request( DATAPATH_ID, request, mock_openflow_reply_handler,
+                                      mock_openflow_request_timeout_handler, timeout, USER_DATA ) );
+
+  free_buffer( request );
+  xfree( delete_hash_entry( stats, "openflow_application_interface.barrier_request_send_succeeded" ) );
+}
+
+
+static void
+receive_openflow_message_for_test( buffer *message ) {
+  append_front_buffer( message, sizeof( openflow_service_header_t ) );
+  openflow_service_header_t *header = message->data;
+  header->datapath_id = htonll( DATAPATH_ID );
+  header->service_name_length = 0;
+
+  handle_message( MESSENGER_OPENFLOW_MESSAGE, message->data, message->length );
+}
+
+
+static void
+test_send_openflow_request_then_reply_callback_is_called() {
+  send_barrier_request_for_test( 10 );
+
+  expect_memory( mock_openflow_reply_handler, &datapath_id, &DATAPATH_ID, sizeof( uint64_t ) );
+  expect_value( mock_openflow_reply_handler, type32, OFPT_BARRIER_REPLY );
+  expect_value( mock_openflow_reply_handler, transaction_id, TRANSACTION_ID );
+  expect_value( mock_openflow_reply_handler, user_data, USER_DATA );
+
+  // the barrier reply handler must not be called
+  set_barrier_reply_handler( mock_barrier_reply_handler, BARRIER_REPLY_USER_DATA );
+  buffer *reply = create_barrier_reply( TRANSACTION_ID );
+  receive_openflow_message_for_test( reply );
+
+  openflow_request_key key;
+  init_openflow_request_key( &key, DATAPATH_ID, TRANSACTION_ID );
+  assert_true( lookup_hash_entry( pending_openflow_requests, &key ) == NULL );
+
+  free_buffer( reply );
+  xfree( delete_hash_entry( stats, "openflow_application_interface.barrier_reply_receive_succeeded" ) );
+}
+
+
+static void
+test_send_openflow_request_then_reply_callback_is_called_for_each_stats_reply_part() {
+  send_barrier_request_for_test( 10 );
+
+  expect_memory_count( mock_openflow_reply_handler, &datapath_id, &DATAPATH_ID, sizeof( uint64_t ), 2 );
+  expect_value_count( mock_openflow_reply_handler, type32, OFPT_STATS_REPLY, 2 );
+  expect_value_count( mock_openflow_reply_handler, transaction_id, TRANSACTION_ID, 2 );
+  expect_value_count( mock_openflow_reply_handler, user_data, USER_DATA, 2 );
+
+  openflow_request_key key;
+  init_openflow_request_key( &key, DATAPATH_ID, TRANSACTION_ID );
+  list_element *table_stats;
+  struct ofp_table_stats table_stats_entry;
+  memset( &table_stats_entry, 0, sizeof( table_stats_entry ) );
+  create_list( &table_stats );
+  append_to_tail( &table_stats, &table_stats_entry );
+
+  buffer *first = create_table_stats_reply( TRANSACTION_ID, OFPSF_REPLY_MORE, table_stats );
+  receive_openflow_message_for_test( first );
+  assert_true( lookup_hash_entry( pending_openflow_requests, &key ) != NULL );
+
+  buffer *last = create_table_stats_reply( TRANSACTION_ID, 0, table_stats );
+  receive_openflow_message_for_test( last );
+  assert_true( lookup_hash_entry( pending_openflow_requests, &key ) == NULL );
+
+  delete_list( table_stats );
+  free_buffer( first );
+  free_buffer( last );
+  xfree( delete_hash_entry( stats, "openflow_application_interface.stats_reply_receive_succeeded" ) );
+}
+
+
+static void
+test_send_openflow_request_then_timeout_callback_is_called() {
+  send_barrier_request_for_test( 10 );
+
+  // nothing expires yet
+  age_openflow_requests( NULL );
+
+  openflow_request_key key;
+  init_openflow_request_key( &key, DATAPATH_ID, TRANSACTION_ID );
+  pending_openflow_request *request = lookup_hash_entry( pending_openflow_requests, &key );
+  assert_true( request != NULL );
+  request->expires_at.tv_sec = 0;
+
+  expect_memory( mock_openflow_request_timeout_handler, &datapath_id, &DATAPATH_ID, sizeof( uint64_t ) );
+  expect_value( mock_openflow_request_timeout_handler, transaction_id, TRANSACTION_ID );
+  expect_value( mock_openflow_request_timeout_handler, user_data, USER_DATA );
+
+  age_openflow_requests( NULL );
+  assert_true( lookup_hash_entry( pending_openflow_requests, &key ) == NULL );
+}
+
+
+static void
+test_send_openflow_request_then_timeout_callback_is_called_if_switch_is_disconnected() {
+  send_barrier_request_for_test( 0 );
+
+  expect_memory( mock_openflow_request_timeout_handler, &datapath_id, &DATAPATH_ID, sizeof( uint64_t ) );
+  expect_value( mock_openflow_request_timeout_handler, transaction_id, TRANSACTION_ID );
+  expect_value( mock_openflow_request_timeout_handler, user_data, USER_DATA );
+
+  buffer *data = alloc_buffer_with_length( sizeof( openflow_service_header_t ) );
+  uint64_t *datapath_id = append_back_buffer( data, sizeof( openflow_service_header_t ) );
+  *datapath_id = htonll( DATAPATH_ID );
+  handle_switch_events( MESSENGER_OPENFLOW_DISCONNECTED, data->data, data->length );
+
+  openflow_request_key key;
+  init_openflow_request_key( &key, DATAPATH_ID, TRANSACTION_ID );
+  assert_true( lookup_hash_entry( pending_openflow_requests, &key ) == NULL );
+
+  free_buffer( data );
+  xfree( delete_hash_entry( stats, "openflow_application_interface.switch_disconnected_receive_succeeded" ) );
+}
+
+
+static void
+test_send_openflow_request_if_request_is_pending() {
+  send_barrier_request_for_test( 0 );
+
+  buffer *request = create_barrier_request( TRANSACTION_ID );
+  assert_false( send_openflow_request( DATAPATH_ID, request, mock_openflow_reply_handler,
+                                       mock_openflow_request_timeout_handler, 0, USER_DATA ) );
+
+  free_buffer( request );
+}
+
+
+static void
+test_send_openflow_request_if_reply_callback_is_NULL() {
+  buffer *request = create_barrier_request( TRANSACTION_ID );
+
+  expect_string( mock_die, format, "Callback function ( openflow_reply_handler ) must not be NULL." );
+  expect_assert_failure( send_openflow_request( DATAPATH_ID, request, NULL, NULL, 0, NULL ) );
+
+  free_buffer( request );
+}
+
+
+/********************************************************************************
+ * send_flow_mod_batch() tests.
+ ********************************************************************************/
+
+static flow_mod_batch *
+create_flow_mod_batch_with( unsigned int n_flow_mods ) {
+  flow_mod_batch *batch = create_flow_mod_batch();
+  unsigned int i;
+  for ( i = 0; i < n_flow_mods; i++ ) {
+    buffer *flow_mod = create_flow_mod( TRANSACTION_ID, MATCH, 0, OFPFC_ADD, 60, 0, UINT16_MAX,
+                                        UINT32_MAX, OFPP_NONE, 0, NULL );
+    assert_true( append_flow_mod_to_batch( batch, flow_mod ) );
+    free_buffer( flow_mod );
+  }
+
+  return batch;
+}
+
+
+static uint32_t
+sent_transaction_id( unsigned int index ) {
+  size_t offset = sizeof( openflow_service_header_t ) + strlen( SERVICE_NAME ) + 1;
+  offset += index * sizeof( struct ofp_flow_mod );
+  struct ofp_header *header = ( struct ofp_header * ) ( ( char * ) sent_message->data + offset );
+
+  return ntohl( header->xid );
+}
+
+
+static void
+test_send_flow_mod_batch() {
+  flow_mod_batch *batch = create_flow_mod_batch_with( 2 );
+
+  expect_string( mock_send_message_iov, service_name, REMOTE_SERVICE_NAME );
+  expect_value( mock_send_message_iov, tag32, MESSENGER_OPENFLOW_BUILT_MESSAGES );
+  expect_value( mock_send_message_iov, len, sizeof( openflow_service_header_t ) + strlen( SERVICE_NAME ) + 1 +
+                sizeof( struct ofp_flow_mod ) * 2 + sizeof( struct ofp_header ) );
+  will_return( mock_send_message_iov, true );
+
+  assert_true( send_flow_mod_batch( DATAPATH_ID, batch, mock_flow_mod_batch_handler, USER_DATA ) );
+
+  struct ofp_header *barrier = ( struct ofp_header * ) ( ( char * ) sent_message->data + sent_message->length -
+                                                         sizeof( struct ofp_header ) );
+  assert_int_equal( barrier->type, OFPT_BARRIER_REQUEST );
+  assert_true( sent_transaction_id( 0 ) != sent_transaction_id( 1 ) );
+  stat_entry *stat = lookup_stat_entry( "openflow_application_interface.flow_mod_send_succeeded" );
+  assert_int_equal( ( int ) stat->value, 2 );
+
+  // errors are reported to the batch handler instead of the error handler
+  buffer *data = alloc_buffer_with_length( 16 );
+  append_back_buffer( data, 16 );
+  memset( data->data, 'a', 16 );
+  buffer *error = create_error( sent_transaction_id( 1 ), OFPET_FLOW_MOD_FAILED, OFPFMFC_ALL_TABLES_FULL, data );
+  set_error_handler( mock_error_handler, USER_DATA );
+  handle_error( DATAPATH_ID, error );
+
+  flow_mod_batch_error expected_error = { 1, OFPET_FLOW_MOD_FAILED, OFPFMFC_ALL_TABLES_FULL };
+  expect_memory( mock_flow_mod_batch_handler, &datapath_id, &DATAPATH_ID, sizeof( uint64_t ) );
+  expect_value( mock_flow_mod_batch_handler, completed, true );
+  expect_value( mock_flow_mod_batch_handler, n_errors, 1 );
+  expect_memory( mock_flow_mod_batch_handler, errors, &expected_error, sizeof( flow_mod_batch_error ) );
+  expect_memory( mock_flow_mod_batch_handler, user_data, USER_DATA, USER_DATA_LEN );
+
+  buffer *barrier_reply = create_barrier_reply( ntohl( barrier->xid ) );
+  set_barrier_reply_handler( mock_barrier_reply_handler, USER_DATA );
+  handle_barrier_reply( DATAPATH_ID, barrier_reply );
+
+  free_buffer( barrier_reply );
+  free_buffer( error );
+  free_buffer( data );
+  delete_flow_mod_batch( batch );
+  xfree( delete_hash_entry( stats, "openflow_application_interface.flow_mod_send_succeeded" ) );
+  xfree( delete_hash_entry( stats, "openflow_application_interface.barrier_request_send_succeeded" ) );
+}
+
+
+static void
+test_send_flow_mod_batch_if_switch_is_disconnected() {
+  flow_mod_batch *batch = create_flow_mod_batch_with( 1 );
+
+  expect_string( mock_send_message_iov, service_name, REMOTE_SERVICE_NAME );
+  expect_value( mock_send_message_iov, tag32, MESSENGER_OPENFLOW_BUILT_MESSAGES );
+  expect_value( mock_send_message_iov, len, sizeof( openflow_service_header_t ) + strlen( SERVICE_NAME ) + 1 +
+                sizeof( struct ofp_flow_mod ) + sizeof( struct ofp_header ) );
+  will_return( mock_send_message_iov, true );
+
+  assert_true( send_flow_mod_batch( DATAPATH_ID, batch, mock_flow_mod_batch_handler, USER_DATA ) );
+
+  expect_memory( mock_flow_mod_batch_handler, &datapath_id, &DATAPATH_ID, sizeof( uint64_t ) );
+  expect_value( mock_flow_mod_batch_handler, completed, false );
+  expect_value( mock_flow_mod_batch_handler, n_errors, 0 );
+  expect_memory( mock_flow_mod_batch_handler, user_data, USER_DATA, USER_DATA_LEN );
+
+  buffer *data = alloc_buffer_with_length( sizeof( openflow_service_header_t ) );
+  uint64_t *datapath_id = append_back_buffer( data, sizeof( openflow_service_header_t ) );
+  *datapath_id = htonll( DATAPATH_ID );
+  handle_switch_events( MESSENGER_OPENFLOW_DISCONNECTED, data->data, data->length );
+
+  free_buffer( data );
+  delete_flow_mod_batch( batch );
+}
+
+
+static void
+test_send_flow_mod_batch_in_chunks() {
+  const unsigned int n_flow_mods_per_chunk = 65536 / sizeof( struct ofp_flow_mod );
+  flow_mod_batch *batch = create_flow_mod_batch_with( n_flow_mods_per_chunk + 1 );
+  size_t header_length = sizeof( openflow_service_header_t ) + strlen( SERVICE_NAME ) + 1;
+
+  expect_string( mock_send_message_iov, service_name, REMOTE_SERVICE_NAME );
+  expect_value( mock_send_message_iov, tag32, MESSENGER_OPENFLOW_BUILT_MESSAGES );
+  expect_value( mock_send_message_iov, len, header_length + sizeof( struct ofp_flow_mod ) * n_flow_mods_per_chunk );
+  will_return( mock_send_message_iov, true );
+  expect_string( mock_send_message_iov, service_name, REMOTE_SERVICE_NAME );
+  expect_value( mock_send_message_iov, tag32, MESSENGER_OPENFLOW_BUILT_MESSAGES );
+  expect_value( mock_send_message_iov, len, header_length + sizeof( struct ofp_flow_mod ) + sizeof( struct ofp_header ) );
+  will_return( mock_send_message_iov, true );
+
+  assert_true( send_flow_mod_batch( DATAPATH_ID, batch, mock_flow_mod_batch_handler, USER_DATA ) );
+
+  struct ofp_header *barrier = ( struct ofp_header * ) ( ( char * ) sent_message->data + sent_message->length -
+                                                         sizeof( struct ofp_header ) );
+  assert_int_equal( barrier->type, OFPT_BARRIER_REQUEST );
+
+  expect_memory( mock_flow_mod_batch_handler, &datapath_id, &DATAPATH_ID, sizeof( uint64_t ) );
+  expect_value( mock_flow_mod_batch_handler, completed, true );
+  expect_value( mock_flow_mod_batch_handler, n_errors, 0 );
+  expect_memory( mock_flow_mod_batch_handler, user_data, USER_DATA, USER_DATA_LEN );
+
+  buffer *barrier_reply = create_barrier_reply( ntohl( barrier->xid ) );
+  handle_barrier_reply( DATAPATH_ID, barrier_reply );
+
+  free_buffer( barrier_reply );
+  delete_flow_mod_batch( batch );
+  xfree( delete_hash_entry( stats, "openflow_application_interface.flow_mod_send_succeeded" ) );
+  xfree( delete_hash_entry( stats, "openflow_application_interface.barrier_request_send_succeeded" ) );
+}
+
+
+static void
+test_append_flow_mod_to_batch_if_message_is_not_flow_mod() {
+  flow_mod_batch *batch = create_flow_mod_batch();
+  buffer *hello = create_hello( TRANSACTION_ID );
+
+  assert_false( append_flow_mod_to_batch( batch, hello ) );
+
+  free_buffer( hello );
+  delete_flow_mod_batch( batch );
+}
+
+
 /********************************************************************************
  * handle_error() tests.
  ********************************************************************************/
@@ -2213,6 +2959,139 @@ test_handle_stats_reply_with_undefined_type() {
 }
 
 
+static buffer *
+create_flow_stats_reply_with_cookies( uint16_t flags, uint64_t first_cookie, int n_entries ) {
+  uint16_t stats_len = offsetof( struct ofp_flow_stats, actions );
+  list_element *flow_stats;
+  create_list( &flow_stats );
+  for ( int i = 0; i < n_entries; i++ ) {
+    struct ofp_flow_stats *stats = xcalloc( 1, stats_len );
+    stats->length = stats_len;
+    stats->match = MATCH;
+    stats->cookie = first_cookie + ( uint64_t ) i;
+    append_to_tail( &flow_stats, stats );
+  }
+
+  buffer *buffer = create_flow_stats_reply( TRANSACTION_ID, flags, flow_stats );
+
+  for ( list_element *e = flow_stats; e != NULL; e = e->next ) {
+    xfree( e->data );
+  }
+  delete_list( flow_stats );
+
+  return buffer;
+}
+
+
+static void
+test_handle_stats_reply_calls_part_handler_for_each_part() {
+  list_element *table_stats;
+  struct ofp_table_stats stats[ 2 ];
+  memset( stats, 0, sizeof( stats ) );
+  stats[ 0 ].table_id = 1;
+  stats[ 1 ].table_id = 2;
+  create_list( &table_stats );
+  append_to_tail( &table_stats, &stats[ 0 ] );
+  append_to_tail( &table_stats, &stats[ 1 ] );
+  buffer *buffer = create_table_stats_reply( TRANSACTION_ID, OFPSF_REPLY_MORE, table_stats );
+
+  expect_memory( mock_stats_reply_part_handler, &datapath_id, &DATAPATH_ID, sizeof( uint64_t ) );
+  expect_value( mock_stats_reply_part_handler, transaction_id, TRANSACTION_ID );
+  expect_value( mock_stats_reply_part_handler, type32, OFPST_TABLE );
+  expect_value( mock_stats_reply_part_handler, flags32, OFPSF_REPLY_MORE );
+  expect_memory( mock_stats_reply_part_handler, user_data, USER_DATA, USER_DATA_LEN );
+  expect_value( mock_stats_reply_part_handler, table_id, 1 );
+  expect_value( mock_stats_reply_part_handler, table_id, 2 );
+
+  set_stats_reply_part_handler( mock_stats_reply_part_handler, USER_DATA );
+  handle_stats_reply( DATAPATH_ID, buffer );
+
+  delete_list( table_stats );
+  free_buffer( buffer );
+}
+
+
+static void
+test_handle_stats_reply_calls_completion_handler_after_last_part() {
+  buffer *first = create_flow_stats_reply_with_cookies( OFPSF_REPLY_MORE, 1, 2 );
+  buffer *last = create_flow_stats_reply_with_cookies( 0, 3, 1 );
+
+  set_stats_reply_completion_handler( mock_stats_reply_completion_handler, USER_DATA );
+  handle_stats_reply( DATAPATH_ID, first );
+  assert_true( partial_stats_replies != NULL );
+
+  expect_memory( mock_stats_reply_completion_handler, &datapath_id, &DATAPATH_ID, sizeof( uint64_t ) );
+  expect_value( mock_stats_reply_completion_handler, transaction_id, TRANSACTION_ID );
+  expect_value( mock_stats_reply_completion_handler, type32, OFPST_FLOW );
+  expect_memory( mock_stats_reply_completion_handler, user_data, USER_DATA, USER_DATA_LEN );
+  expect_value( mock_stats_reply_completion_handler, cookie, 1 );
+  expect_value( mock_stats_reply_completion_handler, cookie, 2 );
+  expect_value( mock_stats_reply_completion_handler, cookie, 3 );
+
+  handle_stats_reply( DATAPATH_ID, last );
+  assert_true( partial_stats_replies == NULL );
+
+  free_buffer( first );
+  free_buffer( last );
+}
+
+
+static void
+test_handle_stats_reply_reassembles_many_parts() {
+  set_stats_reply_completion_handler( mock_stats_reply_completion_handler, USER_DATA );
+  for ( int i = 0; i < 4; i++ ) {
+    buffer *part = create_flow_stats_reply_with_cookies( OFPSF_REPLY_MORE, ( uint64_t ) ( i * 3 + 1 ), 3 );
+    handle_stats_reply( DATAPATH_ID, part );
+    free_buffer( part );
+  }
+
+  expect_memory( mock_stats_reply_completion_handler, &datapath_id, &DATAPATH_ID, sizeof( uint64_t ) );
+  expect_value( mock_stats_reply_completion_handler, transaction_id, TRANSACTION_ID );
+  expect_value( mock_stats_reply_completion_handler, type32, OFPST_FLOW );
+  expect_memory( mock_stats_reply_completion_handler, user_data, USER_DATA, USER_DATA_LEN );
+  for ( uint64_t cookie = 1; cookie <= 13; cookie++ ) {
+    expect_value( mock_stats_reply_completion_handler, cookie, cookie );
+  }
+
+  buffer *last = create_flow_stats_reply_with_cookies( 0, 13, 1 );
+  handle_stats_reply( DATAPATH_ID, last );
+  assert_true( partial_stats_replies == NULL );
+
+  free_buffer( last );
+}
+
+
+static void
+test_handle_stats_reply_discards_partial_reply_if_switch_is_disconnected() {
+  buffer *first = create_flow_stats_reply_with_cookies( OFPSF_REPLY_MORE, 1, 2 );
+
+  set_stats_reply_completion_handler( mock_stats_reply_completion_handler, USER_DATA );
+  handle_stats_reply( DATAPATH_ID, first );
+  assert_true( partial_stats_replies != NULL );
+
+  buffer *data = alloc_buffer_with_length( sizeof( openflow_service_header_t ) );
+  uint64_t *datapath_id = append_back_buffer( data, sizeof( openflow_service_header_t ) );
+  *datapath_id = htonll( DATAPATH_ID );
+  handle_switch_events( MESSENGER_OPENFLOW_DISCONNECTED, data->data, data->length );
+  assert_true( partial_stats_replies == NULL );
+
+  free_buffer( data );
+  free_buffer( first );
+}
+
+
+static void
+test_next_stats_reply_entry_stops_at_malformed_entry() {
+  struct ofp_flow_stats stats;
+  memset( &stats, 0, sizeof( stats ) );
+  stats.length = htons( sizeof( stats ) * 2 );
+
+  stats_reply_iterator entries = { OFPST_FLOW, &stats, sizeof( stats ) };
+  assert_true( next_stats_reply_entry( &entries ) == NULL );
+  assert_int_equal( ( int ) entries.remaining, 0 );
+}
+
+
 static void
 test_handle_stats_reply_if_handler_is_not_registered() {
   char mfr_desc[ DESC_STR_LEN ];
@@ -2560,7 +3439,7 @@ test_handle_switch_events_if_type_is_MESSENGER_OPENFLOW_CONNECTED() {
 
   handle_switch_events( MESSENGER_OPENFLOW_CONNECTED, data->data, data->length );
 
-  stat_entry *stat = lookup_hash_entry( stats, "openflow_application_interface.switch_connected_receive_succeeded" );
+  stat_entry *stat = lookup_stat_entry( "openflow_application_interface.switch_connected_receive_succeeded" );
   assert_int_equal( ( int ) stat->value, 1 );
 
   free_buffer( data );
@@ -2584,7 +3463,7 @@ test_handle_switch_events_if_type_is_MESSENGER_OPENFLOW_DISCONNECTED() {
   set_switch_disconnected_handler( mock_switch_disconnected_handler, SWITCH_DISCONNECTED_USER_DATA );
   handle_switch_events( MESSENGER_OPENFLOW_DISCONNECTED, data->data, data->length );
 
-  stat_entry *stat = lookup_hash_entry( stats, "openflow_application_interface.switch_disconnected_receive_succeeded" );
+  stat_entry *stat = lookup_stat_entry( "openflow_application_interface.switch_disconnected_receive_succeeded" );
   assert_int_equal( ( int ) stat->value, 1 );
 
   free_buffer( data );
@@ -2633,7 +3512,7 @@ test_handle_switch_events_if_unhandled_message_type() {
   // FIXME
   handle_switch_events( MESSENGER_OPENFLOW_MESSAGE, data->data, data->length );
 
-  stat_entry *stat = lookup_hash_entry( stats, "openflow_application_interface.undefined_switch_event_receive_succeeded" );
+  stat_entry *stat = lookup_stat_entry( "openflow_application_interface.undefined_switch_event_receive_succeeded" );
   assert_int_equal( ( int ) stat->value, 1 );
 
   free_buffer( data );
@@ -2675,7 +3554,7 @@ test_handle_openflow_message() {
     set_error_handler( mock_error_handler, USER_DATA );
     handle_openflow_message( buffer->data, buffer->length );
 
-    stat = lookup_hash_entry( stats, "openflow_application_interface.error_receive_succeeded" );
+    stat = lookup_stat_entry( "openflow_application_interface.error_receive_succeeded" );
     assert_int_equal( ( int ) stat->value, 1 );
 
     free_buffer( data );
@@ -2705,7 +3584,7 @@ test_handle_openflow_message() {
     set_vendor_handler( mock_vendor_handler, USER_DATA );
     handle_openflow_message( buffer->data, buffer->length );
 
-    stat = lookup_hash_entry( stats, "openflow_application_interface.vendor_receive_succeeded" );
+    stat = lookup_stat_entry( "openflow_application_interface.vendor_receive_succeeded" );
     assert_int_equal( ( int ) stat->value, 1 );
 
     free_buffer( data );
@@ -2769,7 +3648,7 @@ test_handle_openflow_message() {
     set_features_reply_handler( mock_features_reply_handler, USER_DATA );
     handle_openflow_message( buffer->data, buffer->length );
 
-    stat = lookup_hash_entry( stats, "openflow_application_interface.features_reply_receive_succeeded" );
+    stat = lookup_stat_entry( "openflow_application_interface.features_reply_receive_succeeded" );
     assert_int_equal( ( int ) stat->value, 1 );
 
     xfree( phy_port[0] );
@@ -2798,7 +3677,7 @@ test_handle_openflow_message() {
     set_get_config_reply_handler( mock_get_config_reply_handler, USER_DATA );
     handle_openflow_message( buffer->data, buffer->length );
 
-    stat = lookup_hash_entry( stats, "openflow_application_interface.get_config_reply_receive_succeeded" );
+    stat = lookup_stat_entry( "openflow_application_interface.get_config_reply_receive_succeeded" );
     assert_int_equal( ( int ) stat->value, 1 );
 
     free_buffer( buffer );
@@ -2839,7 +3718,7 @@ test_handle_openflow_message() {
     set_packet_in_handler( mock_packet_in_handler, USER_DATA );
     handle_openflow_message( buffer->data, buffer->length );
 
-    stat = lookup_hash_entry( stats, "openflow_application_interface.packet_in_receive_succeeded" );
+    stat = lookup_stat_entry( "openflow_application_interface.packet_in_receive_succeeded" );
     assert_int_equal( ( int ) stat->value, 1 );
 
     free_buffer( data );
@@ -2881,7 +3760,7 @@ test_handle_openflow_message() {
     set_flow_removed_handler( mock_flow_removed_handler, USER_DATA );
     handle_openflow_message( buffer->data, buffer->length );
 
-    stat = lookup_hash_entry( stats, "openflow_application_interface.flow_removed_receive_succeeded" );
+    stat = lookup_stat_entry( "openflow_application_interface.flow_removed_receive_succeeded" );
     assert_int_equal( ( int ) stat->value, 1 );
 
     free_buffer( buffer );
@@ -2918,7 +3797,7 @@ test_handle_openflow_message() {
     set_port_status_handler( mock_port_status_handler, USER_DATA );
     handle_openflow_message( buffer->data, buffer->length );
 
-    stat = lookup_hash_entry( stats, "openflow_application_interface.port_status_receive_succeeded" );
+    stat = lookup_stat_entry( "openflow_application_interface.port_status_receive_succeeded" );
     assert_int_equal( ( int ) stat->value, 1 );
 
     free_buffer( buffer );
@@ -2971,7 +3850,7 @@ test_handle_openflow_message() {
     set_stats_reply_handler( mock_stats_reply_handler, USER_DATA );
     handle_openflow_message( buffer->data, buffer->length );
 
-    stat = lookup_hash_entry( stats, "openflow_application_interface.stats_reply_receive_succeeded" );
+    stat = lookup_stat_entry( "openflow_application_interface.stats_reply_receive_succeeded" );
     assert_int_equal( ( int ) stat->value, 1 );
 
     free_buffer( buffer );
@@ -2993,7 +3872,7 @@ test_handle_openflow_message() {
     set_barrier_reply_handler( mock_barrier_reply_handler, USER_DATA );
     handle_openflow_message( buffer->data, buffer->length );
 
-    stat = lookup_hash_entry( stats, "openflow_application_interface.barrier_reply_receive_succeeded" );
+    stat = lookup_stat_entry( "openflow_application_interface.barrier_reply_receive_succeeded" );
     assert_int_equal( ( int ) stat->value, 1 );
 
     free_buffer( buffer );
@@ -3044,7 +3923,7 @@ test_handle_openflow_message() {
     set_queue_get_config_reply_handler( mock_queue_get_config_reply_handler, USER_DATA );
     handle_openflow_message( buffer->data, buffer->length );
 
-    stat = lookup_hash_entry( stats, "openflow_application_interface.queue_get_config_reply_receive_succeeded" );
+    stat = lookup_stat_entry( "openflow_application_interface.queue_get_config_reply_receive_succeeded" );
     assert_int_equal( ( int ) stat->value, 1 );
 
     xfree( queue[ 0 ] );
@@ -3151,7 +4030,7 @@ test_handle_message_if_type_is_MESSENGER_OPENFLOW_MESSAGE() {
   set_barrier_reply_handler( mock_barrier_reply_handler, BARRIER_REPLY_USER_DATA );
   handle_message( MESSENGER_OPENFLOW_MESSAGE, data->data, data->length );
 
-  stat_entry *stat = lookup_hash_entry( stats, "openflow_application_interface.barrier_reply_receive_succeeded" );
+  stat_entry *stat = lookup_stat_entry( "openflow_application_interface.barrier_reply_receive_succeeded" );
   assert_int_equal( ( int ) stat->value, 1 );
 
 
@@ -3170,7 +4049,7 @@ test_handle_message_if_type_is_MESSENGER_OPENFLOW_CONNECTED() {
 
   handle_message( MESSENGER_OPENFLOW_CONNECTED, data->data, data->length );
 
-  stat_entry *stat = lookup_hash_entry( stats, "openflow_application_interface.switch_connected_receive_succeeded" );
+  stat_entry *stat = lookup_stat_entry( "openflow_application_interface.switch_connected_receive_succeeded" );
   assert_int_equal( ( int ) stat->value, 1 );
 
   free_buffer( data );
@@ -3194,7 +4073,7 @@ test_handle_message_if_type_is_MESSENGER_OPENFLOW_DISCONNECTED() {
   set_switch_disconnected_handler( mock_switch_disconnected_handler, SWITCH_DISCONNECTED_USER_DATA );
   handle_message( MESSENGER_OPENFLOW_DISCONNECTED, data->data, data->length );
 
-  stat_entry *stat = lookup_hash_entry( stats, "openflow_application_interface.switch_disconnected_receive_succeeded" );
+  stat_entry *stat = lookup_stat_entry( "openflow_application_interface.switch_disconnected_receive_succeeded" );
   assert_int_equal( ( int ) stat->value, 1 );
 
   free_buffer( data );
@@ -3202,6 +4081,92 @@ test_handle_message_if_type_is_MESSENGER_OPENFLOW_DISCONNECTED() {
 }
 
 
+static void
+test_handle_message_if_type_is_MESSENGER_OPENFLOW_LIVENESS_REPLY() {
+  openflow_service_header_t *header;
+  openflow_liveness_t *reply;
+  openflow_liveness_t expected_liveness;
+  buffer *data;
+
+  memset( &expected_liveness, 0, sizeof( openflow_liveness_t ) );
+  expected_liveness.echo_interval = 5;
+  expected_liveness.last_seen = 1;
+  expected_liveness.echo_requests = 10;
+  expected_liveness.echo_replies = 9;
+  expected_liveness.echo_missed = 1;
+  expected_liveness.rtt_last = 300;
+  expected_liveness.rtt_min = 120;
+  expected_liveness.rtt_max = 4000;
+  expected_liveness.rtt_smoothed = 350;
+  expected_liveness.rtt_histogram[ 2 ] = 8;
+  expected_liveness.rtt_histogram[ 5 ] = 1;
+
+  data = alloc_buffer_with_length( sizeof( openflow_service_header_t ) + sizeof( openflow_liveness_t ) );
+  header = append_back_buffer( data, sizeof( openflow_service_header_t ) );
+  header->datapath_id = htonll( DATAPATH_ID );
+  header->service_name_length = 0;
+  reply = append_back_buffer( data, sizeof( openflow_liveness_t ) );
+  memset( reply, 0, sizeof( openflow_liveness_t ) );
+  reply->echo_interval = htonl( 5 );
+  reply->last_seen = htonl( 1 );
+  reply->echo_requests = htonll( 10 );
+  reply->echo_replies = htonll( 9 );
+  reply->echo_missed = htonll( 1 );
+  reply->rtt_last = htonl( 300 );
+  reply->rtt_min = htonl( 120 );
+  reply->rtt_max = htonl( 4000 );
+  reply->rtt_smoothed = htonl( 350 );
+  reply->rtt_histogram[ 2 ] = htonl( 8 );
+  reply->rtt_histogram[ 5 ] = htonl( 1 );
+
+  expect_memory( mock_switch_liveness_reply_handler, &datapath_id, &DATAPATH_ID, sizeof( uint64_t ) );
+  expect_memory( mock_switch_liveness_reply_handler, liveness, &expected_liveness, sizeof( openflow_liveness_t ) );
+  expect_value( mock_switch_liveness_reply_handler, user_data, SWITCH_LIVENESS_REPLY_USER_DATA );
+
+  set_switch_liveness_reply_handler( mock_switch_liveness_reply_handler, SWITCH_LIVENESS_REPLY_USER_DATA );
+  handle_message( MESSENGER_OPENFLOW_LIVENESS_REPLY, data->data, data->length );
+
+  stat_entry *stat = lookup_stat_entry( "openflow_application_interface.switch_liveness_reply_receive_succeeded" );
+  assert_int_equal( ( int ) stat->value, 1 );
+
+  free_buffer( data );
+  xfree( delete_hash_entry( stats, "openflow_application_interface.switch_liveness_reply_receive_succeeded" ) );
+}
+
+
+static void
+test_handle_message_if_type_is_MESSENGER_OPENFLOW_PACKET_IN_THROTTLED() {
+  openflow_service_header_t *header;
+  openflow_packet_in_throttled_t *event;
+  buffer *data;
+  uint64_t dropped = 1000;
+
+  data = alloc_buffer_with_length( sizeof( openflow_service_header_t ) + sizeof( openflow_packet_in_throttled_t ) );
+  header = append_back_buffer( data, sizeof( openflow_service_header_t ) );
+  header->datapath_id = htonll( DATAPATH_ID );
+  header->service_name_length = 0;
+  event = append_back_buffer( data, sizeof( openflow_packet_in_throttled_t ) );
+  event->in_port = htons( 1 );
+  event->throttled = 0;
+  event->dropped = htonll( dropped );
+
+  expect_memory( mock_packet_in_throttled_handler, &datapath_id, &DATAPATH_ID, sizeof( uint64_t ) );
+  expect_value( mock_packet_in_throttled_handler, in_port32, 1 );
+  expect_value( mock_packet_in_throttled_handler, throttled, false );
+  expect_memory( mock_packet_in_throttled_handler, &dropped, &dropped, sizeof( uint64_t ) );
+  expect_value( mock_packet_in_throttled_handler, user_data, PACKET_IN_THROTTLED_USER_DATA );
+
+  set_packet_in_throttled_handler( mock_packet_in_throttled_handler, PACKET_IN_THROTTLED_USER_DATA );
+  handle_message( MESSENGER_OPENFLOW_PACKET_IN_THROTTLED, data->data, data->length );
+
+  stat_entry *stat = lookup_stat_entry( "openflow_application_interface.packet_in_throttled_receive_succeeded" );
+  assert_int_equal( ( int ) stat->value, 1 );
+
+  free_buffer( data );
+  xfree( delete_hash_entry( stats, "openflow_application_interface.packet_in_throttled_receive_succeeded" ) );
+}
+
+
 static void
 test_handle_message_if_message_is_NULL() {
   expect_assert_failure( handle_message( MESSENGER_OPENFLOW_MESSAGE, NULL, 1 ) );
@@ -3230,7 +4195,7 @@ test_handle_message_if_unhandled_message_type() {
   // FIXME
   handle_message( MESSENGER_OPENFLOW_DISCONNECTED + 1, data->data, data->length );
 
-  stat_entry *stat = lookup_hash_entry( stats, "openflow_application_interface.undefined_switch_event_receive_succeeded" );
+  stat_entry *stat = lookup_stat_entry( "openflow_application_interface.undefined_switch_event_receive_succeeded" );
   assert_int_equal( ( int ) stat->value, 1 );
 
   free_buffer( data );
@@ -3284,6 +4249,10 @@ main() {
 
     unit_test_setup_teardown( test_set_stats_reply_handler, init, cleanup ),
     unit_test_setup_teardown( test_set_stats_reply_handler_if_handler_is_NULL, init, cleanup ),
+    unit_test_setup_teardown( test_set_stats_reply_part_handler, init, cleanup ),
+    unit_test_setup_teardown( test_set_stats_reply_part_handler_if_handler_is_NULL, init, cleanup ),
+    unit_test_setup_teardown( test_set_stats_reply_completion_handler, init, cleanup ),
+    unit_test_setup_teardown( test_set_stats_reply_completion_handler_if_handler_is_NULL, init, cleanup ),
 
     unit_test_setup_teardown( test_set_barrier_reply_handler, init, cleanup ),
     unit_test_setup_teardown( test_set_barrier_reply_handler_if_handler_is_NULL, init, cleanup ),
@@ -3294,10 +4263,30 @@ main() {
     unit_test_setup_teardown( test_set_list_switches_reply_handler, init, cleanup ),
     unit_test_setup_teardown( test_set_list_switches_reply_handler_if_handler_is_NULL, init, cleanup ),
 
+    unit_test_setup_teardown( test_set_packet_in_throttled_handler, init, cleanup ),
+    unit_test_setup_teardown( test_set_packet_in_throttled_handler_if_handler_is_NULL, init, cleanup ),
+
+    unit_test_setup_teardown( test_set_switch_liveness_reply_handler, init, cleanup ),
+    unit_test_setup_teardown( test_set_switch_liveness_reply_handler_if_handler_is_NULL, init, cleanup ),
+
     unit_test_setup_teardown( test_send_openflow_message, init, cleanup ),
+    unit_test_setup_teardown( test_send_openflow_message_if_message_is_not_built_by_library, init, cleanup ),
     unit_test_setup_teardown( test_send_openflow_message_if_message_is_NULL, init, cleanup ),
     unit_test_setup_teardown( test_send_openflow_message_if_message_length_is_zero, init, cleanup ),
 
+    unit_test_setup_teardown( test_send_switch_liveness_request, init, cleanup ),
+
+    unit_test_setup_teardown( test_send_openflow_request_then_reply_callback_is_called, init, cleanup ),
+    unit_test_setup_teardown( test_send_openflow_request_then_reply_callback_is_called_for_each_stats_reply_part, init, cleanup ),
+    unit_test_setup_teardown( test_send_openflow_request_then_timeout_callback_is_called, init, cleanup ),
+    unit_test_setup_teardown( test_send_openflow_request_then_timeout_callback_is_called_if_switch_is_disconnected, init, cleanup ),
+    unit_test_setup_teardown( test_send_openflow_request_if_request_is_pending, init, cleanup ),
+    unit_test_setup_teardown( test_send_openflow_request_if_reply_callback_is_NULL, init, cleanup ),
+    unit_test_setup_teardown( test_send_flow_mod_batch, init, cleanup ),
+    unit_test_setup_teardown( test_send_flow_mod_batch_if_switch_is_disconnected, init, cleanup ),
+    unit_test_setup_teardown( test_send_flow_mod_batch_in_chunks, init, cleanup ),
+    unit_test_setup_teardown( test_append_flow_mod_to_batch_if_message_is_not_flow_mod, init, cleanup ),
+
     unit_test_setup_teardown( test_handle_error, init, cleanup ),
     unit_test_setup_teardown( test_handle_error_if_handler_is_not_registered, init, cleanup ),
     unit_test_setup_teardown( test_handle_error_if_message_is_NULL, init, cleanup ),
@@ -3325,6 +4314,8 @@ main() {
     unit_test_setup_teardown( test_set_simple_packet_in_handler, init, cleanup ),
     unit_test_setup_teardown( test_set_packet_in_handler_should_die_if_handler_is_NULL, init, cleanup ),
     unit_test_setup_teardown( test_handle_packet_in, init, cleanup ),
+    unit_test_setup_teardown( test_handle_packet_in_suppresses_duplicates_within_coalescing_window, init, cleanup ),
+    unit_test_setup_teardown( test_handle_packet_in_suppresses_unbuffered_duplicates_without_packet_out, init, cleanup ),
     unit_test_setup_teardown( test_handle_packet_in_with_simple_handler, init, cleanup ),
     unit_test_setup_teardown( test_handle_packet_in_with_malformed_packet, init, cleanup ),
     unit_test_setup_teardown( test_handle_packet_in_without_data, init, cleanup ),
@@ -3350,6 +4341,11 @@ main() {
     unit_test_setup_teardown( test_handle_stats_reply_if_type_is_OFPST_QUEUE, init, cleanup ),
     unit_test_setup_teardown( test_handle_stats_reply_if_type_is_OFPST_VENDOR, init, cleanup ),
     unit_test_setup_teardown( test_handle_stats_reply_with_undefined_type, init, cleanup ),
+    unit_test_setup_teardown( test_handle_stats_reply_calls_part_handler_for_each_part, init, cleanup ),
+    unit_test_setup_teardown( test_handle_stats_reply_calls_completion_handler_after_last_part, init, cleanup ),
+    unit_test_setup_teardown( test_handle_stats_reply_reassembles_many_parts, init, cleanup ),
+    unit_test_setup_teardown( test_handle_stats_reply_discards_partial_reply_if_switch_is_disconnected, init, cleanup ),
+    unit_test_setup_teardown( test_next_stats_reply_entry_stops_at_malformed_entry, init, cleanup ),
     unit_test_setup_teardown( test_handle_stats_reply_if_handler_is_not_registered, init, cleanup ),
     unit_test_setup_teardown( test_handle_stats_reply_if_message_is_NULL, init, cleanup ),
     unit_test_setup_teardown( test_handle_stats_reply_if_message_length_is_zero, init, cleanup ),
@@ -3388,6 +4384,8 @@ main() {
     unit_test_setup_teardown( test_handle_message_if_type_is_MESSENGER_OPENFLOW_MESSAGE, init, cleanup ),
     unit_test_setup_teardown( test_handle_message_if_type_is_MESSENGER_OPENFLOW_CONNECTED, init, cleanup ),
     unit_test_setup_teardown( test_handle_message_if_type_is_MESSENGER_OPENFLOW_DISCONNECTED, init, cleanup ),
+    unit_test_setup_teardown( test_handle_message_if_type_is_MESSENGER_OPENFLOW_PACKET_IN_THROTTLED, init, cleanup ),
+    unit_test_setup_teardown( test_handle_message_if_type_is_MESSENGER_OPENFLOW_LIVENESS_REPLY, init, cleanup ),
     unit_test_setup_teardown( test_handle_message_if_message_is_NULL, init, cleanup ),
     unit_test_setup_teardown( test_handle_message_if_message_length_is_zero, init, cleanup ),
     unit_test_setup_teardown( test_handle_message_if_unhandled_message_type, init, cleanup ),
@@ -228,6 +228,7 @@ test_create_hello() {
   assert_int_equal( hello->type, OFPT_HELLO );
   assert_int_equal( ntohs( hello->length ), sizeof( struct ofp_header ) );
   assert_int_equal( ( int ) ntohl( hello->xid ), ( int ) MY_TRANSACTION_ID );
+  assert_true( buffer_built_by_library( buffer ) );
 
   free_buffer( buffer );
 }
@@ -1458,6 +1459,149 @@ test_create_flow_mod() {
 }
 
 
+static void
+test_create_flow_mod_into() {
+  uint8_t hw_addr[ OFP_ETH_ALEN ] = { 0x00, 0x11, 0x22, 0x33, 0x44, 0x55 };
+  openflow_actions *actions = create_actions();
+  append_action_set_dl_dst( actions, hw_addr );
+  append_action_set_vlan_vid( actions, 10 );
+  append_action_output( actions, 1, 128 );
+  openflow_action_builder builder;
+  init_action_builder( &builder );
+  assert_true( build_action_set_dl_dst( &builder, hw_addr ) );
+  assert_true( build_action_set_vlan_vid( &builder, 10 ) );
+  assert_true( build_action_output( &builder, 1, 128 ) );
+  assert_int_equal( builder.n_actions, 3 );
+  assert_int_equal( builder.length, get_actions_length( actions ) );
+
+  buffer *expected = create_flow_mod( MY_TRANSACTION_ID, MATCH, 10, OFPFC_ADD, 5, 10, PRIORITY,
+                                      BUFFER_ID, OFPP_NONE, OFPFF_SEND_FLOW_REM, actions );
+  buffer *buffer = alloc_buffer_with_length( 128 );
+  void *data = buffer->data;
+  assert_true( create_flow_mod_into( buffer, MY_TRANSACTION_ID, MATCH, 10, OFPFC_ADD, 5, 10, PRIORITY,
+                                     BUFFER_ID, OFPP_NONE, OFPFF_SEND_FLOW_REM, &builder ) == buffer );
+
+  assert_int_equal( ( int ) buffer->length, ( int ) expected->length );
+  assert_memory_equal( buffer->data, expected->data, expected->length );
+  assert_true( buffer_built_by_library( buffer ) );
+
+  // the space is reused
+  create_flow_mod_into( buffer, MY_TRANSACTION_ID, MATCH, 10, OFPFC_ADD, 5, 10, PRIORITY,
+                        BUFFER_ID, OFPP_NONE, OFPFF_SEND_FLOW_REM, &builder );
+  assert_true( buffer->data == data );
+  assert_memory_equal( buffer->data, expected->data, expected->length );
+
+  free_buffer( buffer );
+  free_buffer( expected );
+  delete_actions( actions );
+}
+
+
+static void
+test_create_packet_out_into() {
+  openflow_actions *actions = create_actions();
+  append_action_output( actions, OFPP_FLOOD, UINT16_MAX );
+  openflow_action_builder builder;
+  init_action_builder( &builder );
+  build_action_output( &builder, OFPP_FLOOD, UINT16_MAX );
+  buffer *data = create_dummy_data( LONG_DATA_LENGTH );
+
+  buffer *expected = create_packet_out( MY_TRANSACTION_ID, UINT32_MAX, 2, actions, data );
+  buffer *buffer = alloc_buffer();
+  create_packet_out_into( buffer, MY_TRANSACTION_ID, UINT32_MAX, 2, &builder, data );
+
+  assert_int_equal( ( int ) buffer->length, ( int ) expected->length );
+  assert_memory_equal( buffer->data, expected->data, expected->length );
+  assert_true( buffer_built_by_library( buffer ) );
+
+  free_buffer( buffer );
+  free_buffer( expected );
+  free_buffer( data );
+  delete_actions( actions );
+}
+
+
+static void
+test_build_action_fails_if_builder_is_full() {
+  openflow_action_builder builder;
+  init_action_builder( &builder );
+
+  int i;
+  for ( i = 0; i < ( int ) ( OPENFLOW_ACTION_BUILDER_LENGTH / sizeof( struct ofp_action_output ) ); i++ ) {
+    assert_true( build_action_output( &builder, 1, 128 ) );
+  }
+  assert_false( build_action_output( &builder, 1, 128 ) );
+  assert_int_equal( builder.length, OPENFLOW_ACTION_BUILDER_LENGTH );
+}
+
+
+static void
+test_create_flow_mod_from_template() {
+  openflow_actions *actions = create_actions();
+  append_action_set_vlan_vid( actions, 10 );
+  append_action_output( actions, 1, 128 );
+  compiled_actions *compiled = compile_actions( actions );
+  assert_int_equal( compiled->n_actions, 2 );
+  assert_int_equal( compiled->length, get_actions_length( actions ) );
+
+  flow_mod_template *template = create_flow_mod_template( 10, OFPFC_ADD, 5, 10, PRIORITY, OFPP_NONE,
+                                                          OFPFF_SEND_FLOW_REM, compiled );
+  release_compiled_actions( compiled );
+
+  buffer *expected = create_flow_mod( MY_TRANSACTION_ID, MATCH, 10, OFPFC_ADD, 5, 10, PRIORITY,
+                                      BUFFER_ID, OFPP_NONE, OFPFF_SEND_FLOW_REM, actions );
+  buffer *buffer = alloc_buffer();
+  assert_true( create_flow_mod_from_template( buffer, template, MY_TRANSACTION_ID, MATCH, BUFFER_ID ) == buffer );
+
+  assert_int_equal( ( int ) buffer->length, ( int ) expected->length );
+  assert_memory_equal( buffer->data, expected->data, expected->length );
+  assert_true( buffer_built_by_library( buffer ) );
+
+  free_buffer( buffer );
+  free_buffer( expected );
+  delete_flow_mod_template( template );
+  delete_actions( actions );
+}
+
+
+static void
+test_create_packet_out_with_compiled_actions() {
+  openflow_actions *actions = create_actions();
+  append_action_output( actions, OFPP_FLOOD, UINT16_MAX );
+  compiled_actions *compiled = compile_actions( actions );
+  assert_true( hold_compiled_actions( compiled ) == compiled );
+  assert_int_equal( compiled->reference_count, 2 );
+  release_compiled_actions( compiled );
+  assert_int_equal( compiled->reference_count, 1 );
+
+  buffer *expected = create_packet_out( MY_TRANSACTION_ID, BUFFER_ID, 2, actions, NULL );
+  buffer *buffer = alloc_buffer();
+  create_packet_out_with_compiled_actions( buffer, MY_TRANSACTION_ID, BUFFER_ID, 2, compiled, NULL );
+
+  assert_int_equal( ( int ) buffer->length, ( int ) expected->length );
+  assert_memory_equal( buffer->data, expected->data, expected->length );
+
+  free_buffer( buffer );
+  free_buffer( expected );
+  release_compiled_actions( compiled );
+  delete_actions( actions );
+}
+
+
+static void
+test_compile_actions_succeeds_without_actions() {
+  openflow_actions *actions = create_actions();
+  compiled_actions *compiled = compile_actions( actions );
+
+  assert_int_equal( compiled->n_actions, 0 );
+  assert_int_equal( compiled->length, 0 );
+  assert_true( compiled->actions == NULL );
+
+  release_compiled_actions( compiled );
+  delete_actions( actions );
+}
+
+
 /********************************************************************************
  * create_stats_request() test.
  ********************************************************************************/
@@ -2788,6 +2932,42 @@ test_validate_flow_mod_fails_if_message_is_not_flow_mod() {
 }
 
 
+static void
+test_validate_flow_mod_fails_if_action_is_invalid() {
+  openflow_actions *actions = create_actions();
+  append_action_set_nw_tos( actions, 0x10 );
+  append_action_output( actions, 1, 128 );
+  buffer *flow_mod = create_flow_mod( MY_TRANSACTION_ID, MATCH, 10, OFPFC_ADD, 5, 10, PRIORITY,
+                                      BUFFER_ID, UINT16_MAX, NO_FLAGS, actions );
+  struct ofp_flow_mod *ofp_flow_mod = flow_mod->data;
+  struct ofp_action_nw_tos *nw_tos = ( struct ofp_action_nw_tos * ) ofp_flow_mod->actions;
+  struct ofp_action_output *output = ( struct ofp_action_output * ) ( nw_tos + 1 );
+
+  assert_int_equal( validate_flow_mod( flow_mod ), 0 );
+
+  nw_tos->nw_tos = 0x03;
+  assert_int_equal( validate_flow_mod( flow_mod ), ERROR_INVALID_NW_TOS );
+  nw_tos->nw_tos = 0x10;
+
+  output->port = 0;
+  assert_int_equal( validate_flow_mod( flow_mod ), ERROR_INVALID_PORT_NO );
+  output->port = htons( 1 );
+
+  output->type = htons( OFPAT_ENQUEUE + 1 );
+  assert_int_equal( validate_flow_mod( flow_mod ), ERROR_UNDEFINED_ACTION_TYPE );
+  output->type = htons( OFPAT_SET_DL_SRC );
+  assert_int_equal( validate_flow_mod( flow_mod ), ERROR_TOO_SHORT_ACTION_DL_SRC );
+  output->type = htons( OFPAT_VENDOR );
+  assert_int_equal( validate_flow_mod( flow_mod ), 0 );
+
+  nw_tos->len = htons( 4 );
+  assert_int_equal( validate_flow_mod( flow_mod ), ERROR_TOO_SHORT_ACTION );
+
+  free_buffer( flow_mod );
+  delete_actions( actions );
+}
+
+
 /********************************************************************************
  * validate_port_mod() tests.
  ********************************************************************************/
@@ -6890,6 +7070,12 @@ main() {
     unit_test_setup_teardown( test_create_packet_out, init, teardown ),
     unit_test_setup_teardown( test_create_packet_out_without_actions, init, teardown ),
     unit_test_setup_teardown( test_create_flow_mod, init, teardown ),
+    unit_test_setup_teardown( test_create_flow_mod_into, init, teardown ),
+    unit_test_setup_teardown( test_create_packet_out_into, init, teardown ),
+    unit_test_setup_teardown( test_build_action_fails_if_builder_is_full, init, teardown ),
+    unit_test_setup_teardown( test_create_flow_mod_from_template, init, teardown ),
+    unit_test_setup_teardown( test_create_packet_out_with_compiled_actions, init, teardown ),
+    unit_test_setup_teardown( test_compile_actions_succeeds_without_actions, init, teardown ),
     unit_test_setup_teardown( test_create_flow_stats_request, init, teardown ),
     unit_test_setup_teardown( test_create_flow_stats_reply, init, teardown ),
 
@@ -6944,6 +7130,7 @@ main() {
     unit_test_setup_teardown( test_validate_flow_mod, init, teardown ),
     unit_test_setup_teardown( test_validate_flow_mod_fails_if_message_is_NULL, init, teardown ),
     unit_test_setup_teardown( test_validate_flow_mod_fails_if_message_is_not_flow_mod, init, teardown ),
+    unit_test_setup_teardown( test_validate_flow_mod_fails_if_action_is_invalid, init, teardown ),
     unit_test_setup_teardown( test_validate_port_mod, init, teardown ),
     unit_test_setup_teardown( test_validate_port_mod_fails_if_message_is_NULL, init, teardown ),
     unit_test_setup_teardown( test_validate_port_mod_fails_if_message_is_not_port_mod, init, teardown ),
@@ -212,6 +212,54 @@ test_increment_stat_fails_if_not_initialized() {
 }
 
 
+/********************************************************************************
+ * set_stat() tests.
+ ********************************************************************************/
+
+static void
+test_set_stat_succeeds_with_defined_key() {
+  assert_true( init_stat() );
+
+  const char *key = "key";
+  assert_true( add_stat_entry( key ) );
+  increment_stat( key );
+  set_stat( key, 123 );
+
+  stat_entry *entry = lookup_hash_entry( stats, key );
+  assert_string_equal( entry->key, key );
+  uint64_t expected_value = 123;
+  assert_memory_equal( &entry->value, &expected_value, sizeof( uint64_t ) );
+
+  assert_true( finalize_stat() );
+}
+
+
+static void
+test_set_stat_succeeds_with_undefined_key() {
+  assert_true( init_stat() );
+
+  const char *key = "key";
+  set_stat( key, 123 );
+
+  stat_entry *entry = lookup_hash_entry( stats, key );
+  assert_string_equal( entry->key, key );
+  uint64_t expected_value = 123;
+  assert_memory_equal( &entry->value, &expected_value, sizeof( uint64_t ) );
+
+  assert_true( finalize_stat() );
+}
+
+
+static void
+test_set_stat_fails_if_key_is_NULL() {
+  assert_true( init_stat() );
+
+  expect_assert_failure( set_stat( NULL, 0 ) );
+
+  assert_true( finalize_stat() );
+}
+
+
 /********************************************************************************
  * dump_stats() tests.
  ********************************************************************************/
@@ -249,6 +297,64 @@ test_dump_stats_fails_if_not_initialized() {
 }
 
 
+/********************************************************************************
+ * stat_counters tests.
+ ********************************************************************************/
+
+static void
+counter_name( unsigned int index, char *name, size_t length ) {
+  snprintf( name, length, "counter.%u", index );
+}
+
+
+static void
+test_dump_stats_publishes_non_zero_counters() {
+  assert_true( init_stat() );
+
+  uint64_t values[ 3 ] = { 0, 0, 0 };
+  stat_counters counters = { values, 3, counter_name, NULL };
+  add_stat_counters( &counters );
+  add_stat_counters( &counters );
+  increment_stat_counter( &counters, 1 );
+  increment_stat_counter( &counters, 1 );
+  assert_true( values[ 1 ] == 2 );
+
+  expect_string( mock_info, message, "Statistics:" );
+  expect_string( mock_info, message, "counter.1: 2" );
+  dump_stats();
+
+  assert_true( lookup_hash_entry( stats, "counter.0" ) == NULL );
+
+  assert_true( finalize_stat() );
+}
+
+
+static void
+test_delete_stat_counters_succeeds() {
+  assert_true( init_stat() );
+
+  uint64_t values[ 1 ] = { 0 };
+  stat_counters counters = { values, 1, counter_name, NULL };
+  add_stat_counters( &counters );
+  increment_stat_counter( &counters, 0 );
+  delete_stat_counters( &counters );
+
+  publish_stat_counters();
+  assert_true( lookup_hash_entry( stats, "counter.0" ) == NULL );
+
+  assert_true( finalize_stat() );
+}
+
+
+static void
+test_increment_stat_counter_fails_if_index_is_out_of_range() {
+  uint64_t values[ 1 ] = { 0 };
+  stat_counters counters = { values, 1, counter_name, NULL };
+
+  expect_assert_failure( increment_stat_counter( &counters, 1 ) );
+}
+
+
 /********************************************************************************
  * Run tests.
  ********************************************************************************/
@@ -274,10 +380,20 @@ main() {
     unit_test_setup_teardown( test_increment_stat_fails_if_key_is_NULL, reset, reset ),
     unit_test_setup_teardown( test_increment_stat_fails_if_not_initialized, reset, reset ),
 
+    // set_stat() tests.
+    unit_test_setup_teardown( test_set_stat_succeeds_with_defined_key, reset, reset ),
+    unit_test_setup_teardown( test_set_stat_succeeds_with_undefined_key, reset, reset ),
+    unit_test_setup_teardown( test_set_stat_fails_if_key_is_NULL, reset, reset ),
+
     // dump_sats() tests.
     unit_test_setup_teardown( test_dump_stats_succeeds, reset, reset ),
     unit_test_setup_teardown( test_dump_stats_succeeds_without_entries, reset, reset ),
     unit_test_setup_teardown( test_dump_stats_fails_if_not_initialized, reset, reset ),
+
+    // stat_counters tests.
+    unit_test_setup_teardown( test_dump_stats_publishes_non_zero_counters, reset, reset ),
+    unit_test_setup_teardown( test_delete_stat_counters_succeeds, reset, reset ),
+    unit_test_setup_teardown( test_increment_stat_counter_fails_if_index_is_out_of_range, reset, reset ),
   };
   return run_tests( tests );
 }
@@ -20,12 +20,14 @@
  */
 
 
+#include <getopt.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "unittest.h"
+#include "cmockery_trema.h"
 #include "trema.h"
 #include "match_table.h"
+#include "packetin_filter_interface.h"
 
 void usage();
 void handle_packet_in( uint64_t datapath_id, uint32_t transaction_id,
@@ -33,9 +35,10 @@ void handle_packet_in( uint64_t datapath_id, uint32_t transaction_id,
   uint16_t in_port, uint8_t reason, const buffer *data,
   void *user_data );
 void register_dl_type_filter( uint16_t dl_type, uint16_t priority,
-  const char *service_name, const char *entry_name );
-void register_any_filter( uint16_t priority, const char *service_name,
-  const char *entry_name );
+  const char *service_name );
+void register_any_filter( uint16_t priority, const char *service_name );
+void handle_request( const messenger_context_handle *handle, uint16_t tag,
+  void *data, size_t length );
 int packetin_filter_main( int argc, char *argv[] );
 
 
@@ -44,14 +47,34 @@ int packetin_filter_main( int argc, char *argv[] );
  *************************************************************************/
 
 
+static bool use_match_table = false;
+
+
 static void
 setup() {
-  init_log( "packetin_filter_test", false );
+  stub_logger();
 }
 
 
 static void
 teardown() {
+  unstub_logger();
+}
+
+
+static void
+setup_match_table() {
+  setup();
+  init_match_table();
+  use_match_table = true;
+}
+
+
+static void
+teardown_match_table() {
+  use_match_table = false;
+  finalize_match_table();
+  teardown();
 }
 
 
@@ -66,6 +89,14 @@ mock_die( char *format, ... ) {
 }
 
 
+void
+mock_exit( int status ) {
+  check_expected( status );
+
+  mock_assert( false, "exit", __FILE__, __LINE__ );
+}
+
+
 int
 mock_printf2( char *format, ... ) {
   UNUSED( format );
@@ -83,7 +114,6 @@ mock_error( const char *format, ... ) {
   va_end( args );   
 
   check_expected( buffer );
-  ( void ) mock();
 }
 
 
@@ -100,8 +130,6 @@ mock_set_match_from_packet( struct ofp_match *match, const uint16_t in_port,
   memset( match, 0, sizeof( struct ofp_match ) );
   match->in_port = in_port;
   match->wildcards = wildcards;
-
-  ( void ) mock();
 }
 
 
@@ -126,15 +154,17 @@ mock_create_packet_in( const uint32_t transaction_id, const uint32_t buffer_id,
 
 void
 mock_insert_match_entry( struct ofp_match *ofp_match, uint16_t priority,
-  /* const */ char *service_name, /* const */ char *entry_name ) {
+  /* const */ char *service_name ) {
+  if ( use_match_table ) {
+    insert_match_entry( ofp_match, priority, service_name );
+    return;
+  }
+
   uint32_t priority32 = priority;
 
   check_expected( ofp_match );
   check_expected( priority32 );
   check_expected( service_name );
-  check_expected( entry_name );
-
-  ( void ) mock();
 }
 
 
@@ -161,12 +191,50 @@ mock_send_message( /* const */ char *service_name, const uint16_t tag,
 }
 
 
+bool
+mock_add_message_received_callback( /* const */ char *service_name,
+  void ( *callback )( uint16_t tag, void *data, size_t len ) ) {
+  UNUSED( callback );
+
+  check_expected( service_name );
+
+  return ( bool ) mock();
+}
+
+
+bool
+mock_add_message_requested_callback( /* const */ char *service_name,
+  void ( *callback )( const messenger_context_handle *handle, uint16_t tag, void *data, size_t len ) ) {
+  UNUSED( callback );
+
+  check_expected( service_name );
+
+  return ( bool ) mock();
+}
+
+
+static uint8_t reply_data[ sizeof( packetin_filter_entries ) + sizeof( packetin_filter_entry ) * PACKETIN_FILTER_DUMP_PAGE_SIZE ];
+
+bool
+mock_send_reply_message( const messenger_context_handle *handle, const uint16_t tag,
+  const void *data, size_t len ) {
+  UNUSED( handle );
+  uint32_t tag32 = tag;
+
+  check_expected( tag32 );
+  check_expected( len );
+
+  assert_true( len <= sizeof( reply_data ) );
+  memcpy( reply_data, data, len );
+
+  return ( bool ) mock();
+}
+
+
 void
 mock_init_trema( int *argc, char ***argv ) {
   UNUSED( argc );
   UNUSED( argv );
-
-  ( void ) mock();
 }
 
 
@@ -181,7 +249,6 @@ mock_set_packet_in_handler( packet_in_handler callback, void *user_data ) {
 
 void
 mock_start_trema( void ) {
-  ( void ) mock();
 }
 
 
@@ -191,6 +258,88 @@ mock_get_executable_name( void ) {
 }
 
 
+const char *
+mock_get_trema_name( void ) {
+  return "packetin_filter";
+}
+
+
+/*************************************************************************
+ * Helper functions.
+ *************************************************************************/
+
+
+static packetin_filter_entries *
+create_filter_entries( int n_entries, size_t *length ) {
+  *length = offsetof( packetin_filter_entries, entries ) + sizeof( packetin_filter_entry ) * ( size_t ) n_entries;
+  packetin_filter_entries *entries = xcalloc( 1, *length );
+  entries->n_entries = htons( ( uint16_t ) n_entries );
+
+  return entries;
+}
+
+
+static void
+set_filter_entry( packetin_filter_entries *entries, int index, uint16_t dl_type, uint16_t priority, const char *service_name ) {
+  packetin_filter_entry entry;
+  memset( &entry, 0, sizeof( packetin_filter_entry ) );
+
+  struct ofp_match match;
+  memset( &match, 0, sizeof( struct ofp_match ) );
+  match.wildcards = OFPFW_ALL & ~OFPFW_DL_TYPE;
+  match.dl_type = dl_type;
+  hton_match( &match, &match );
+  memcpy( &entry.match, &match, sizeof( struct ofp_match ) );
+  entry.priority = htons( priority );
+  strncpy( entry.service_name, service_name, sizeof( entry.service_name ) - 1 );
+
+  memcpy( &entries->entries[ index ], &entry, sizeof( packetin_filter_entry ) );
+}
+
+
+static bool
+filter_installed( uint16_t dl_type, uint16_t priority ) {
+  struct ofp_match match;
+  memset( &match, 0, sizeof( struct ofp_match ) );
+  match.wildcards = OFPFW_ALL & ~OFPFW_DL_TYPE;
+  match.dl_type = dl_type;
+
+  return lookup_match_strict_entry( &match, priority ) != NULL;
+}
+
+
+static void
+expect_filter_reply( uint16_t tag ) {
+  expect_value( mock_send_reply_message, tag32, tag );
+  expect_value( mock_send_reply_message, len, sizeof( packetin_filter_reply ) );
+  will_return( mock_send_reply_message, true );
+}
+
+
+static void
+assert_filter_reply( uint8_t status, uint16_t n_entries ) {
+  packetin_filter_reply *reply = ( packetin_filter_reply * ) reply_data;
+  assert_int_equal( reply->status, status );
+  assert_int_equal( ntohs( reply->n_entries ), n_entries );
+}
+
+
+static void
+add_filters( int n_entries ) {
+  size_t length;
+  packetin_filter_entries *entries = create_filter_entries( n_entries, &length );
+  for ( int i = 0; i < n_entries; i++ ) {
+    set_filter_entry( entries, i, ( uint16_t ) ( 0x1000 + i ), 0x8000, "service_name" );
+  }
+
+  expect_filter_reply( MESSENGER_ADD_PACKETIN_FILTER_REPLY );
+  handle_request( NULL, MESSENGER_ADD_PACKETIN_FILTER_REQUEST, entries, length );
+  assert_filter_reply( PACKETIN_FILTER_OPERATION_SUCCEEDED, ( uint16_t ) n_entries );
+
+  xfree( entries );
+}
+
+
 /*************************************************************************
  * Test functions.
  *************************************************************************/
@@ -224,15 +373,15 @@ test_handle_packet_in_successed() {
   buffer *buf;
 
   data = alloc_buffer();
+  alloc_packet( data );
   expect_not_value( mock_set_match_from_packet, match, NULL );
   expect_value( mock_set_match_from_packet, in_port32, in_port32 );
   expect_value( mock_set_match_from_packet, wildcards, 0 );
   expect_value( mock_set_match_from_packet, packet, data );
-  will_return_void( mock_set_match_from_packet );
 
   memset( &match_entry, 0, sizeof( match_entry ) );
-  match_entry.service_name = ( char * )( uintptr_t )( "service_name" );
-  match_entry.entry_name = ( char * )( uintptr_t )( "entry_name" );
+  create_list( &match_entry.services_name );
+  append_to_tail( &match_entry.services_name, ( void * ) ( uintptr_t ) "service_name" );
   expect_not_value( mock_lookup_match_entry, match, NULL );
   will_return( mock_lookup_match_entry, &match_entry );
 
@@ -245,7 +394,7 @@ test_handle_packet_in_successed() {
   expect_value( mock_create_packet_in, data, data );
   will_return( mock_create_packet_in, buf );
 
-  expect_value( mock_send_message, service_name, match_entry.service_name );
+  expect_string( mock_send_message, service_name, "service_name" );
   expect_value( mock_send_message, tag32, MESSENGER_OPENFLOW_MESSAGE );
   expect_not_value( mock_send_message, data, NULL );
   expect_not_value( mock_send_message, len, 0 );
@@ -254,6 +403,7 @@ test_handle_packet_in_successed() {
   handle_packet_in( datapath_id, transaction_id, buffer_id, ( uint16_t ) total_len32,
     ( uint16_t ) in_port32, ( uint8_t ) reason32, data, user_data );
 
+  delete_list( match_entry.services_name );
   free_buffer( data );
 
   teardown();
@@ -274,12 +424,12 @@ test_handle_packet_in_lookup_failed() {
   void *user_data = NULL;
 
   data = alloc_buffer();
+  alloc_packet( data );
 
   expect_not_value( mock_set_match_from_packet, match, NULL );
   expect_value( mock_set_match_from_packet, in_port32, in_port32 );
   expect_value( mock_set_match_from_packet, wildcards, 0 );
   expect_value( mock_set_match_from_packet, packet, data );
-  will_return_void( mock_set_match_from_packet );
 
   expect_not_value( mock_lookup_match_entry, match, NULL );
   will_return( mock_lookup_match_entry, NULL );
@@ -310,15 +460,15 @@ test_handle_packet_in_send_failed() {
   buffer *buf;
 
   data = alloc_buffer();
+  alloc_packet( data );
   expect_not_value( mock_set_match_from_packet, match, NULL );
   expect_value( mock_set_match_from_packet, in_port32, in_port32 );
   expect_value( mock_set_match_from_packet, wildcards, 0 );
   expect_value( mock_set_match_from_packet, packet, data );
-  will_return_void( mock_set_match_from_packet );
 
   memset( &match_entry, 0, sizeof( match_entry ) );
-  match_entry.service_name = ( char * )( uintptr_t )( "service_name" );
-  match_entry.entry_name = ( char * )( uintptr_t )( "entry_name" );
+  create_list( &match_entry.services_name );
+  append_to_tail( &match_entry.services_name, ( void * ) ( uintptr_t ) "service_name" );
   expect_not_value( mock_lookup_match_entry, match, NULL );
   will_return( mock_lookup_match_entry, &match_entry );
 
@@ -331,18 +481,18 @@ test_handle_packet_in_send_failed() {
   expect_value( mock_create_packet_in, data, data );
   will_return( mock_create_packet_in, buf );
 
-  expect_string( mock_send_message, service_name, match_entry.service_name );
+  expect_string( mock_send_message, service_name, "service_name" );
   expect_value( mock_send_message, tag32, MESSENGER_OPENFLOW_MESSAGE );
   expect_not_value( mock_send_message, data, NULL );
   expect_not_value( mock_send_message, len, 0 );
   will_return( mock_send_message, false );
 
-  expect_string( mock_error, buffer, "Failed to send a message to service_name ( entry_name = entry_name, match = wildcards = 0, in_port = 1, dl_src = 00:00:00:00:00:00, dl_dst = 00:00:00:00:00:00, dl_vlan = 0, dl_vlan_pcp = 0, dl_type = 0, nw_tos = 0, nw_proto = 0, nw_src = 0.0.0.0, nw_dst = 0.0.0.0, tp_src = 0, tp_dst = 0 )." );
-  will_return_void( mock_error );
+  expect_string( mock_error, buffer, "Failed to send a message to service_name ( match = wildcards = 0, in_port = 1, dl_src = 00:00:00:00:00:00, dl_dst = 00:00:00:00:00:00, dl_vlan = 0, dl_vlan_pcp = 0, dl_type = 0, nw_tos = 0, nw_proto = 0, nw_src = 0.0.0.0, nw_dst = 0.0.0.0, tp_src = 0, tp_dst = 0 )." );
 
   handle_packet_in( datapath_id, transaction_id, buffer_id, ( uint16_t ) total_len32,
                     ( uint16_t ) in_port32, ( uint8_t ) reason32, data, user_data );
 
+  delete_list( match_entry.services_name );
   free_buffer( data );
 
   teardown();
@@ -359,10 +509,8 @@ test_register_dl_type_filter() {
   expect_not_value( mock_insert_match_entry, ofp_match, NULL );
   expect_value( mock_insert_match_entry, priority32, priority32 );
   expect_string( mock_insert_match_entry, service_name, "service_name" );
-  expect_string( mock_insert_match_entry, entry_name, "entry_name" );
-  will_return_void( mock_insert_match_entry );
 
-  register_dl_type_filter( ( uint16_t ) dl_type32, ( uint16_t ) priority32, "service_name", "entry_name" );
+  register_dl_type_filter( ( uint16_t ) dl_type32, ( uint16_t ) priority32, "service_name" );
 
   teardown();
 }
@@ -377,10 +525,8 @@ test_register_any_filter() {
   expect_not_value( mock_insert_match_entry, ofp_match, NULL );
   expect_value( mock_insert_match_entry, priority32, priority32 );
   expect_string( mock_insert_match_entry, service_name, "service_name" );
-  expect_string( mock_insert_match_entry, entry_name, "entry_name" );
-  will_return_void( mock_insert_match_entry );
 
-  register_any_filter( ( uint16_t ) priority32, "service_name", "entry_name" );
+  register_any_filter( ( uint16_t ) priority32, "service_name" );
 
   teardown();
 }
@@ -396,24 +542,20 @@ test_packetin_filter_main_successed() {
       ( char * )( uintptr_t )"packet_in::hub",
       NULL,
     };
-  int argc = ARRAY_SIZE( argv ) - 1;
+  int argc = ( int ) ( sizeof( argv ) / sizeof( argv[ 0 ] ) ) - 1;
   int ret;
 
   expect_not_value( mock_insert_match_entry, ofp_match, NULL );
   expect_value( mock_insert_match_entry, priority32, 0x8000 );
   expect_string( mock_insert_match_entry, service_name, "topo" );
-  expect_string( mock_insert_match_entry, entry_name, "filter-lldp" );
-  will_return_void( mock_insert_match_entry );
 
   expect_not_value( mock_insert_match_entry, ofp_match, NULL );
   expect_value( mock_insert_match_entry, priority32, 0 );
   expect_string( mock_insert_match_entry, service_name, "hub" );
-  expect_string( mock_insert_match_entry, entry_name, "filter-any" );
-  will_return_void( mock_insert_match_entry );
 
-  will_return_void( mock_init_trema );
   will_return( mock_set_packet_in_handler, true );
-  will_return_void( mock_start_trema );
+  expect_string( mock_add_message_requested_callback, service_name, "packetin_filter" );
+  will_return( mock_add_message_requested_callback, true );
 
   optind = 1;
   ret = packetin_filter_main( argc, argv );
@@ -433,21 +575,188 @@ test_packetin_filter_main_invalid_match_type() {
       ( char * )( uintptr_t )"INVALID_MATCH_TYPE::dummy_service_name",
       NULL,
     };
-  int argc = ARRAY_SIZE( argv ) - 1;
-  int ret;
+  int argc = ( int ) ( sizeof( argv ) / sizeof( argv[ 0 ] ) ) - 1;
 
   will_return( mock_printf2, 1 );
-  will_return_void( mock_init_trema );
+  expect_value( mock_exit, status, EXIT_FAILURE );
 
   optind = 1;
-  ret = packetin_filter_main( argc, argv );
-
-  assert_true( ret == EXIT_FAILURE );
+  expect_assert_failure( packetin_filter_main( argc, argv ) );
 
   teardown();
 }
 
 
+/*************************************************************************
+ * Filter rule request tests.
+ *************************************************************************/
+
+static void
+test_add_filter_request_succeeds() {
+  setup_match_table();
+
+  add_filters( 2 );
+
+  assert_true( filter_installed( 0x1000, 0x8000 ) );
+  assert_true( filter_installed( 0x1001, 0x8000 ) );
+
+  teardown_match_table();
+}
+
+
+static void
+test_add_filter_request_fails_if_rule_is_already_installed() {
+  setup_match_table();
+
+  add_filters( 1 );
+
+  size_t length;
+  packetin_filter_entries *entries = create_filter_entries( 2, &length );
+  set_filter_entry( entries, 0, 0x2000, 0x8000, "service_name" );
+  set_filter_entry( entries, 1, 0x1000, 0x8000, "service_name" );
+
+  expect_string( mock_error, buffer, "Filter rule already exists ( match = [wildcards = 0x3fffef, in_port = 0, dl_src = 00:00:00:00:00:00, dl_dst = 00:00:00:00:00:00, dl_vlan = 0, dl_vlan_pcp = 0, dl_type = 0x1000, nw_tos = 0, nw_proto = 0, nw_src = 0.0.0.0, nw_dst = 0.0.0.0, tp_src = 0, tp_dst = 0], priority = 32768, service_name = service_name )." );
+  expect_filter_reply( MESSENGER_ADD_PACKETIN_FILTER_REPLY );
+  handle_request( NULL, MESSENGER_ADD_PACKETIN_FILTER_REQUEST, entries, length );
+  assert_filter_reply( PACKETIN_FILTER_OPERATION_FAILED, 0 );
+
+  // nothing is applied
+  assert_false( filter_installed( 0x2000, 0x8000 ) );
+
+  xfree( entries );
+  teardown_match_table();
+}
+
+
+static void
+test_add_filter_request_fails_if_rule_is_duplicated() {
+  setup_match_table();
+
+  size_t length;
+  packetin_filter_entries *entries = create_filter_entries( 2, &length );
+  set_filter_entry( entries, 0, 0x1000, 0x8000, "service_name" );
+  set_filter_entry( entries, 1, 0x1000, 0x8000, "service_name" );
+
+  expect_string( mock_error, buffer, "Duplicated filter rule in a request ( index = 0, 1 )." );
+  expect_filter_reply( MESSENGER_ADD_PACKETIN_FILTER_REPLY );
+  handle_request( NULL, MESSENGER_ADD_PACKETIN_FILTER_REQUEST, entries, length );
+  assert_filter_reply( PACKETIN_FILTER_OPERATION_FAILED, 0 );
+
+  assert_false( filter_installed( 0x1000, 0x8000 ) );
+
+  xfree( entries );
+  teardown_match_table();
+}
+
+
+static void
+test_add_filter_request_fails_if_length_is_invalid() {
+  setup_match_table();
+
+  size_t length;
+  packetin_filter_entries *entries = create_filter_entries( 1, &length );
+  set_filter_entry( entries, 0, 0x1000, 0x8000, "service_name" );
+
+  expect_string( mock_error, buffer, "Invalid packetin filter request ( length = 75, n_entries = 1 )." );
+  expect_filter_reply( MESSENGER_ADD_PACKETIN_FILTER_REPLY );
+  handle_request( NULL, MESSENGER_ADD_PACKETIN_FILTER_REQUEST, entries, length - 1 );
+  assert_filter_reply( PACKETIN_FILTER_OPERATION_FAILED, 0 );
+
+  assert_false( filter_installed( 0x1000, 0x8000 ) );
+
+  xfree( entries );
+  teardown_match_table();
+}
+
+
+static void
+test_delete_filter_request_succeeds() {
+  setup_match_table();
+
+  add_filters( 2 );
+
+  size_t length;
+  packetin_filter_entries *entries = create_filter_entries( 1, &length );
+  set_filter_entry( entries, 0, 0x1000, 0x8000, "service_name" );
+
+  expect_filter_reply( MESSENGER_DELETE_PACKETIN_FILTER_REPLY );
+  handle_request( NULL, MESSENGER_DELETE_PACKETIN_FILTER_REQUEST, entries, length );
+  assert_filter_reply( PACKETIN_FILTER_OPERATION_SUCCEEDED, 1 );
+
+  assert_false( filter_installed( 0x1000, 0x8000 ) );
+  assert_true( filter_installed( 0x1001, 0x8000 ) );
+
+  xfree( entries );
+  teardown_match_table();
+}
+
+
+static void
+test_delete_filter_request_fails_if_rule_is_not_found() {
+  setup_match_table();
+
+  size_t length;
+  packetin_filter_entries *entries = create_filter_entries( 1, &length );
+  set_filter_entry( entries, 0, 0x1000, 0x8000, "service_name" );
+
+  expect_string( mock_error, buffer, "Filter rule not found ( match = [wildcards = 0x3fffef, in_port = 0, dl_src = 00:00:00:00:00:00, dl_dst = 00:00:00:00:00:00, dl_vlan = 0, dl_vlan_pcp = 0, dl_type = 0x1000, nw_tos = 0, nw_proto = 0, nw_src = 0.0.0.0, nw_dst = 0.0.0.0, tp_src = 0, tp_dst = 0], priority = 32768, service_name = service_name )." );
+  expect_filter_reply( MESSENGER_DELETE_PACKETIN_FILTER_REPLY );
+  handle_request( NULL, MESSENGER_DELETE_PACKETIN_FILTER_REQUEST, entries, length );
+  assert_filter_reply( PACKETIN_FILTER_OPERATION_FAILED, 0 );
+
+  xfree( entries );
+  teardown_match_table();
+}
+
+
+static uint16_t
+dump_filters( uint32_t offset ) {
+  packetin_filter_dump_request request;
+  request.offset = htonl( offset );
+
+  expect_value( mock_send_reply_message, tag32, MESSENGER_DUMP_PACKETIN_FILTER_REPLY );
+  expect_any( mock_send_reply_message, len );
+  will_return( mock_send_reply_message, true );
+  handle_request( NULL, MESSENGER_DUMP_PACKETIN_FILTER_REQUEST, &request, sizeof( request ) );
+
+  return ntohs( ( ( packetin_filter_entries * ) reply_data )->n_entries );
+}
+
+
+static void
+test_dump_filter_request_succeeds() {
+  setup_match_table();
+
+  add_filters( 2 );
+
+  expect_value( mock_send_reply_message, tag32, MESSENGER_DUMP_PACKETIN_FILTER_REPLY );
+  expect_value( mock_send_reply_message, len, offsetof( packetin_filter_entries, entries ) + sizeof( packetin_filter_entry ) * 2 );
+  will_return( mock_send_reply_message, true );
+  handle_request( NULL, MESSENGER_DUMP_PACKETIN_FILTER_REQUEST, NULL, 0 );
+
+  packetin_filter_entries *entries = ( packetin_filter_entries * ) reply_data;
+  assert_int_equal( ntohs( entries->n_entries ), 2 );
+  assert_string_equal( entries->entries[ 0 ].service_name, "service_name" );
+  assert_int_equal( ntohs( entries->entries[ 0 ].priority ), 0x8000 );
+
+  teardown_match_table();
+}
+
+
+static void
+test_dump_filter_request_pages_rules() {
+  setup_match_table();
+
+  add_filters( PACKETIN_FILTER_DUMP_PAGE_SIZE + 1 );
+
+  assert_int_equal( dump_filters( 0 ), PACKETIN_FILTER_DUMP_PAGE_SIZE );
+  assert_int_equal( dump_filters( PACKETIN_FILTER_DUMP_PAGE_SIZE ), 1 );
+  assert_int_equal( dump_filters( PACKETIN_FILTER_DUMP_PAGE_SIZE + 1 ), 0 );
+
+  teardown_match_table();
+}
+
+
 /*************************************************************************
  * Run tests.
  *************************************************************************/
@@ -463,6 +772,15 @@ main() {
     unit_test( test_register_any_filter ),
     unit_test( test_packetin_filter_main_successed ),
     unit_test( test_packetin_filter_main_invalid_match_type ),
+
+    unit_test( test_add_filter_request_succeeds ),
+    unit_test( test_add_filter_request_fails_if_rule_is_already_installed ),
+    unit_test( test_add_filter_request_fails_if_rule_is_duplicated ),
+    unit_test( test_add_filter_request_fails_if_length_is_invalid ),
+    unit_test( test_delete_filter_request_succeeds ),
+    unit_test( test_delete_filter_request_fails_if_rule_is_not_found ),
+    unit_test( test_dump_filter_request_succeeds ),
+    unit_test( test_dump_filter_request_pages_rules ),
   };
 
   return run_tests( tests );